@@ -49,6 +49,8 @@ AddShader("FRAGMENT", "IBLFilter.glsl", "-D=PIPELINE_IBL_IRRADIANCE_ARRAY", "_Ir
 
 AddShader("VERTEX", "SphereVert.glsl", "-D=SPHERE_HELPER_MESH", "_Helper")
 AddShader("FRAGMENT", "SphereFrag.glsl", "-D=SPHERE_HELPER_MESH", "_Helper")
+AddShader("VERTEX", "SphereVert.glsl", "-D=SPHERE_HELPER_IMPOSTOR", "_Impostor")
+AddShader("FRAGMENT", "SphereFrag.glsl", "-D=SPHERE_HELPER_IMPOSTOR", "_Impostor")
 
 
 # Mesh Shaders...
@@ -62,6 +64,15 @@ AddShader("VERTEX",   "MeshVert.glsl", "-D=PIPELINE_STAGE_OMNI_SHADOW", "_OmniSh
 AddShader("FRAGMENT", "MeshFrag.glsl", "-D=PIPELINE_STAGE_OMNI_SHADOW", "_OmniShadow")
 
 
+# Compute Shaders...
+AddShader("COMPUTE", "HiZBuild.glsl")
+AddShader("COMPUTE", "OcclusionCull.glsl")
+AddShader("COMPUTE", "IrradianceFilter.glsl")
+AddShader("COMPUTE", "IrradianceFilter.glsl", "-D=PIPELINE_IBL_IRRADIANCE_ARRAY", "_Array")
+AddShader("COMPUTE", "MipDownsample.glsl")
+AddShader("COMPUTE", "MipDownsample.glsl", "-D=MIP_FORMAT_R8", "_R8")
+
+
 
 
 
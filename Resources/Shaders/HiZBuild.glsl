@@ -0,0 +1,106 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+
+
+// HiZBuild:
+//    - Build a single level of the depth pyramid, each texel keeps the farthest depth
+//      of the texels it covers in the previous level, level 0 is built from the depth target.
+//
+
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+
+
+// Input...
+layout(binding = 0) uniform sampler2D inDepth;
+layout(binding = 1, r32f) uniform readonly image2D inSrcLevel;
+
+
+// Output...
+layout(binding = 2, r32f) uniform writeonly image2D outDstLevel;
+
+
+
+// Level Constants.
+layout( push_constant ) uniform Constant
+{
+	// X,Y: Source Size, Z,W: Destination Size.
+	ivec4 Size;
+
+	// X,Y: Source Offset in the depth target, Z: The level we are building.
+	ivec4 Params;
+
+} inHiZ;
+
+
+
+
+
+
+// Load source texel clamped to the source size.
+float LoadSource(ivec2 Coord)
+{
+	Coord = min(Coord, inHiZ.Size.xy - 1);
+
+	if (inHiZ.Params.z == 0)
+		return texelFetch(inDepth, inHiZ.Params.xy + Coord, 0).r;
+
+	return imageLoad(inSrcLevel, Coord).r;
+}
+
+
+
+
+void main()
+{
+	ivec2 Dst = ivec2(gl_GlobalInvocationID.xy);
+
+	if (any(greaterThanEqual(Dst, inHiZ.Size.zw)))
+		return;
+
+	ivec2 Src = Dst * 2;
+
+	float Depth = max(max(LoadSource(Src), LoadSource(Src + ivec2(1, 0))),
+		max(LoadSource(Src + ivec2(0, 1)), LoadSource(Src + ivec2(1, 1))));
+
+
+	// Odd source size, the last column/row also covers the extra texel.
+	bool IsOddX = (inHiZ.Size.x & 1) != 0 && Dst.x == inHiZ.Size.z - 1;
+	bool IsOddY = (inHiZ.Size.y & 1) != 0 && Dst.y == inHiZ.Size.w - 1;
+
+	if (IsOddX)
+		Depth = max(Depth, max(LoadSource(Src + ivec2(2, 0)), LoadSource(Src + ivec2(2, 1))));
+
+	if (IsOddY)
+		Depth = max(Depth, max(LoadSource(Src + ivec2(0, 2)), LoadSource(Src + ivec2(1, 2))));
+
+	if (IsOddX && IsOddY)
+		Depth = max(Depth, LoadSource(Src + ivec2(2, 2)));
+
+
+	imageStore(outDstLevel, Dst, vec4(Depth));
+}
@@ -0,0 +1,144 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+
+
+// IrradianceFilter:
+//    - Pre-filter the irradiance of a captured radiance cube map, each invocation computes
+//      a single texel of one face, used by light probes & irradiance volumes on async compute.
+//
+
+
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+
+
+#define PI 3.14159265
+#define TWO_PI 6.2831853
+#define HALF_PI 1.5707963
+
+
+
+// Input...
+#if defined(PIPELINE_IBL_IRRADIANCE_ARRAY)
+layout(binding = 0) uniform samplerCubeArray Environment;
+#else
+layout(binding = 0) uniform samplerCube Environment;
+#endif
+
+
+// Output, the irradiance cube map faces as a 2D array.
+layout(binding = 1, rgba16f) uniform writeonly image2DArray outIrradiance;
+
+
+
+// Filter Constants.
+layout( push_constant ) uniform Constant
+{
+	// X: Face Size, Y: The probe cube index in the array.
+	ivec4 Params;
+
+} inFilter;
+
+
+
+
+
+
+// Return the direction of a cube map texel, matching the vulkan cube map face selection.
+vec3 GetCubeDirection(ivec2 Coord, int Face)
+{
+	vec2 uv = (vec2(Coord) + 0.5) / float(inFilter.Params.x) * 2.0 - 1.0;
+
+	switch (Face)
+	{
+	case 0: return normalize(vec3( 1.0, -uv.y, -uv.x));
+	case 1: return normalize(vec3(-1.0, -uv.y,  uv.x));
+	case 2: return normalize(vec3( uv.x,  1.0,  uv.y));
+	case 3: return normalize(vec3( uv.x, -1.0, -uv.y));
+	case 4: return normalize(vec3( uv.x, -uv.y,  1.0));
+	}
+
+	return normalize(vec3(-uv.x, -uv.y, -1.0));
+}
+
+
+
+// Pre-fitler Irradiance, same sampling as the IBLFilter fragment shader:
+//    - http://www.codinglabs.net/article_physically_based_rendering.aspx
+//
+vec3 ComputeIrradiance(vec3 Normal)
+{
+	vec3 irradiance = vec3(0.0);
+	float NumSamples = 0.0;
+
+	// Compute Basis 
+	vec3 up = abs(Normal.z) > 0.999 ? vec3(0.0, sign(-Normal.z), 0.0) : vec3(0.0, 0.0, 1.0);
+	vec3 right = normalize( cross(up, Normal) );
+	up = normalize( cross(Normal, right) );
+	
+	// Delta
+	float phidlt = 0.05;
+	float thetadlt = 0.015;
+	
+	// Compute Irradiance from by sampling Environment Texture Hemisphere...
+	for (float phi = 0; phi < TWO_PI; phi += phidlt)
+	{
+		for (float theta = 0; theta < HALF_PI; theta += thetadlt)
+		{
+			float sinTheta = sin(theta);
+			float cosTheta = cos(theta);
+			
+			vec3 base0 = cos(phi) * right + sin(phi) * up;
+			vec3 sv = cosTheta * Normal + sinTheta * base0; // Sample Vector in the hemisphere
+
+#if defined(PIPELINE_IBL_IRRADIANCE_ARRAY)
+			irradiance += textureLod(Environment, vec4(sv, inFilter.Params.y), 0.0).rgb * cosTheta * sinTheta;
+#else
+			irradiance += textureLod(Environment, sv, 0.0).rgb * cosTheta * sinTheta;
+#endif
+
+			NumSamples += 1.0;
+		}
+	}
+	
+	return PI * irradiance / NumSamples;
+}
+
+
+
+
+void main()
+{
+	ivec2 Coord = ivec2(gl_GlobalInvocationID.xy);
+	int Face = int(gl_GlobalInvocationID.z);
+
+	if (any(greaterThanEqual(Coord, ivec2(inFilter.Params.x))))
+		return;
+
+	vec3 Irradiance = ComputeIrradiance(GetCubeDirection(Coord, Face));
+
+	imageStore(outIrradiance, ivec3(Coord, inFilter.Params.y * 6 + Face), vec4(Irradiance, 1.0));
+}
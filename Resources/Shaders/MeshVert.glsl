@@ -32,13 +32,30 @@
 
 
 
-// Transform Binding.
-//layout(binding = 1) uniform TransformBlock
-//{
-//	// Model Transformation Matrix.
-//	mat4 ModelMatrix;
-//
-//} inTransform;
+// Per-Instance Transform.
+struct InstanceData
+{
+	// Model Transformation Matrix.
+	mat4 ModelMatrix;
+
+	// Normal Transformation Matrix.
+	mat4 NormalMatrix;
+};
+
+
+// Instances Binding.
+layout(std430, binding = 1) readonly buffer InstanceBuffer
+{
+	InstanceData Instances[];
+} inInstances;
+
+
+// Instance Indices Binding, the index of each drawn instance in the instances buffer, culling compacts
+// the visible instances of each draw in it.
+layout(std430, binding = 2) readonly buffer InstanceIndexBuffer
+{
+	uint Indices[];
+} inInstanceIndices;
 
 
 
@@ -66,6 +83,10 @@ layout(location = 2) in vec2 inTexCoord;
 
 
 
+// The occlusion culling depth pre-pass & the G-Buffer pass must produce the same depth.
+invariant gl_Position;
+
+
 // Output...
 layout(location = 0) out VERTEX_OUT
 {
@@ -82,14 +103,19 @@ layout(location = 0) out VERTEX_OUT
 
 void main()
 {
+	InstanceData Instance = inInstances.Instances[inInstanceIndices.Indices[gl_InstanceIndex]];
+	vec3 Position = (Instance.ModelMatrix * vec4(inPosition, 1.0)).xyz;
+
 #if defined(PIPELINE_STAGE_DIR_SHADOW) || defined(PIPELINE_STAGE_OMNI_SHADOW)
-	gl_Position = inShadow.ShadowMatrix * vec4(inPosition, 1.0);
+	mat4 ViewProjMatrix = inShadow.ShadowMatrix;
 #else
-	gl_Position = inCommon.ViewProjMatrix * vec4(inPosition, 1.0);
+	mat4 ViewProjMatrix = inCommon.ViewProjMatrix;
 #endif
 
-	outVert.Position = inPosition;
-	outVert.Normal = inNormal;
+	gl_Position = ViewProjMatrix * vec4(Position, 1.0);
+
+	outVert.Position = Position;
+	outVert.Normal = normalize(mat3(Instance.NormalMatrix) * inNormal);
 	outVert.TexCoord = inTexCoord;
 }
 
@@ -0,0 +1,272 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+
+
+// MipDownsample:
+//    - Generate the whole mip chain of an image in a single dispatch, each workgroup reduce a 64x64
+//      tile of the source level down to 6 mips through shared memory.
+//    - The last workgroup of a layer to finish, found using an atomic counter, reduce the remaining
+//      mips from mip 6. The z dimension of the dispatch is the image layer or cube face.
+//
+
+
+layout(local_size_x = 256, local_size_y = 1, local_size_z = 1) in;
+
+
+
+#define MIP_TILE_LEVELS 6
+#define MIP_FLAG_SRGB 1
+#define MIP_FLAG_KAISER 2
+
+
+#if defined(MIP_FORMAT_R8)
+#define MIP_FORMAT r8
+#else
+#define MIP_FORMAT rgba8
+#endif
+
+
+
+// The source level.
+layout(binding = 0, MIP_FORMAT) uniform readonly image2DArray Mip0;
+
+// The generated levels, levels the image doesn't have are bound to its last level & never written.
+layout(binding = 1, MIP_FORMAT) uniform writeonly image2DArray Mip1;
+layout(binding = 2, MIP_FORMAT) uniform writeonly image2DArray Mip2;
+layout(binding = 3, MIP_FORMAT) uniform writeonly image2DArray Mip3;
+layout(binding = 4, MIP_FORMAT) uniform writeonly image2DArray Mip4;
+layout(binding = 5, MIP_FORMAT) uniform writeonly image2DArray Mip5;
+layout(binding = 6, MIP_FORMAT) uniform coherent image2DArray Mip6;
+layout(binding = 7, MIP_FORMAT) uniform writeonly image2DArray Mip7;
+layout(binding = 8, MIP_FORMAT) uniform writeonly image2DArray Mip8;
+layout(binding = 9, MIP_FORMAT) uniform writeonly image2DArray Mip9;
+layout(binding = 10, MIP_FORMAT) uniform writeonly image2DArray Mip10;
+layout(binding = 11, MIP_FORMAT) uniform writeonly image2DArray Mip11;
+layout(binding = 12, MIP_FORMAT) uniform writeonly image2DArray Mip12;
+
+
+// The number of finished workgroups of each layer, reset by the last one.
+layout(std430, binding = 13) coherent buffer CounterBuffer
+{
+	uint Counter[];
+};
+
+
+// Downsample Constants.
+layout( push_constant ) uniform Constant
+{
+	// X: Width, Y: Height, Z: Number of mip levels, W: Flags.
+	ivec4 Params;
+} inConstant;
+
+
+
+// Kaiser windowed sinc (beta = 4, radius = 3 texels) for a 2x reduction, taps at -2.5 to 2.5 texels.
+const float KAISER_WEIGHTS[6] = float[](-0.02099248, 0.09450233, 0.42649015, 0.42649015, 0.09450233, -0.02099248);
+
+
+// The first reduced level of the tile, reduced in place for the next levels.
+shared vec4 sTile[32][32];
+
+// True if this is the last workgroup of its layer.
+shared uint sIsLast;
+
+
+
+
+vec4 ToLinear(vec4 color)
+{
+	if ((inConstant.Params.w & MIP_FLAG_SRGB) == 0)
+		return color;
+
+	bvec3 isLow = lessThanEqual(color.rgb, vec3(0.04045));
+	color.rgb = mix(pow((color.rgb + 0.055) / 1.055, vec3(2.4)), color.rgb / 12.92, isLow);
+	return color;
+}
+
+
+vec4 ToSRGB(vec4 color)
+{
+	if ((inConstant.Params.w & MIP_FLAG_SRGB) == 0)
+		return color;
+
+	bvec3 isLow = lessThanEqual(color.rgb, vec3(0.0031308));
+	color.rgb = mix(1.055 * pow(color.rgb, vec3(1.0 / 2.4)) - 0.055, color.rgb * 12.92, isLow);
+	return color;
+}
+
+
+ivec2 GetMipSize(int level)
+{
+	return max(ivec2(1), inConstant.Params.xy >> level);
+}
+
+
+// Load a texel of a level reduced by a tile, clamped to the level size.
+vec4 LoadLevel(int level, ivec2 coord, int layer)
+{
+	coord = clamp(coord, ivec2(0), GetMipSize(level) - 1);
+	vec4 color = level == 0 ? imageLoad(Mip0, ivec3(coord, layer)) : imageLoad(Mip6, ivec3(coord, layer));
+	return ToLinear(color);
+}
+
+
+void StoreLevel(int level, ivec2 coord, int layer, vec4 color)
+{
+	if (any(greaterThanEqual(coord, GetMipSize(level))))
+		return;
+
+	ivec3 texel = ivec3(coord, layer);
+	color = ToSRGB(color);
+
+	switch (level)
+	{
+	case 1: imageStore(Mip1, texel, color); break;
+	case 2: imageStore(Mip2, texel, color); break;
+	case 3: imageStore(Mip3, texel, color); break;
+	case 4: imageStore(Mip4, texel, color); break;
+	case 5: imageStore(Mip5, texel, color); break;
+	case 6: imageStore(Mip6, texel, color); break;
+	case 7: imageStore(Mip7, texel, color); break;
+	case 8: imageStore(Mip8, texel, color); break;
+	case 9: imageStore(Mip9, texel, color); break;
+	case 10: imageStore(Mip10, texel, color); break;
+	case 11: imageStore(Mip11, texel, color); break;
+	case 12: imageStore(Mip12, texel, color); break;
+	}
+}
+
+
+// Compute a texel of the level below the source level, the kaiser filter is only used on the source image.
+vec4 ReduceSource(int level, ivec2 coord, int layer)
+{
+	ivec2 src = coord * 2;
+
+	if (level == 0 && (inConstant.Params.w & MIP_FLAG_KAISER) != 0)
+	{
+		vec4 color = vec4(0.0);
+
+		for (int y = 0; y < 6; ++y)
+		{
+			for (int x = 0; x < 6; ++x)
+			{
+				float weight = KAISER_WEIGHTS[x] * KAISER_WEIGHTS[y];
+				color += weight * LoadLevel(level, src + ivec2(x - 2, y - 2), layer);
+			}
+		}
+
+		return clamp(color, vec4(0.0), vec4(1.0));
+	}
+
+	return 0.25 * (LoadLevel(level, src, layer)
+		+ LoadLevel(level, src + ivec2(1, 0), layer)
+		+ LoadLevel(level, src + ivec2(0, 1), layer)
+		+ LoadLevel(level, src + ivec2(1, 1), layer));
+}
+
+
+// Reduce a 64x64 tile of a level to up to 6 levels below it, the tile origin is in the first reduced level.
+void ReduceTile(int level, ivec2 tile, int layer, uint index)
+{
+	int lastLevel = min(level + MIP_TILE_LEVELS, inConstant.Params.z - 1);
+
+	// First level, each invocation reduce 4 texels from the image.
+	for (uint i = 0; i < 4; ++i)
+	{
+		uint texel = index + i * 256;
+		ivec2 coord = ivec2(texel % 32, texel / 32);
+
+		vec4 color = ReduceSource(level, tile + coord, layer);
+		StoreLevel(level + 1, tile + coord, layer, color);
+		sTile[coord.y][coord.x] = color;
+	}
+
+	barrier();
+
+	// Next levels, reduced from shared memory.
+	int size = 16;
+
+	for (int mip = level + 2; mip <= lastLevel; ++mip)
+	{
+		tile /= 2;
+
+		ivec2 coord = ivec2(index % size, index / size);
+		bool isActive = index < uint(size * size);
+		vec4 color = vec4(0.0);
+
+		if (isActive)
+		{
+			ivec2 src = coord * 2;
+			color = 0.25 * (sTile[src.y][src.x] + sTile[src.y][src.x + 1]
+				+ sTile[src.y + 1][src.x] + sTile[src.y + 1][src.x + 1]);
+
+			StoreLevel(mip, tile + coord, layer, color);
+		}
+
+		barrier();
+
+		if (isActive)
+			sTile[coord.y][coord.x] = color;
+
+		barrier();
+		size /= 2;
+	}
+}
+
+
+
+void main()
+{
+	int layer = int(gl_WorkGroupID.z);
+	uint index = gl_LocalInvocationIndex;
+
+	ReduceTile(0, ivec2(gl_WorkGroupID.xy) * 32, layer, index);
+
+	// No mips after the tile?
+	if (inConstant.Params.z - 1 <= MIP_TILE_LEVELS)
+		return;
+
+	// Make mip 6 visible to the other workgroups, the last one to finish reduce the rest.
+	memoryBarrierImage();
+	barrier();
+
+	if (index == 0)
+	{
+		uint numGroups = gl_NumWorkGroups.x * gl_NumWorkGroups.y;
+		sIsLast = atomicAdd(Counter[layer], 1u) == numGroups - 1u ? 1u : 0u;
+	}
+
+	barrier();
+
+	if (sIsLast == 0u)
+		return;
+
+	// Reset for the next image.
+	if (index == 0)
+		Counter[layer] = 0u;
+
+	memoryBarrierImage();
+	ReduceTile(MIP_TILE_LEVELS, ivec2(0), layer, index);
+}
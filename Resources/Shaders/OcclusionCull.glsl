@@ -0,0 +1,314 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+
+
+// OcclusionCull:
+//    - Two phase occlusion culling of the scene instances bounds.
+//    - Phase 0: select the instances that were visible last frame for the depth pre-pass.
+//    - Phase 1: test all instances against the depth pyramid and write the final draw commands,
+//      instances drawn in the pre-pass are always drawn so disoccluded instances are never missed.
+//    - Each phase first resets its draw commands to zero instances, then every visible instance is
+//      added to its draw command instance count & its index is compacted into the phase instance indices.
+//
+
+
+layout(local_size_x = 64) in;
+
+
+#define SMALL_NUM 0.000001
+
+#define CULL_PHASE_PRE_PASS 0
+#define CULL_PHASE_FINAL 1
+
+#define CULL_MODE_RESET_DRAWS 0
+#define CULL_MODE_INSTANCES 1
+
+#define CULL_FLAG_ALWAYS_VISIBLE 1u
+#define CULL_FLAG_SOFTWARE_VISIBILITY 1u
+
+#define STATS_VISIBLE 0
+#define STATS_OCCLUDED 1
+#define STATS_FRUSTUM 2
+#define STATS_PRE_PASS 3
+
+
+
+
+// A single instance to cull.
+struct CullObject
+{
+	// World Bounds Minimum.
+	vec4 BoundsMin;
+
+	// World Bounds Maximum.
+	vec4 BoundsMax;
+
+	// X: Draw Index, Y: Instance Index, Z: First Instance of the Draw, W: Flags.
+	uvec4 Info;
+};
+
+
+// A single draw of instances.
+struct CullDraw
+{
+	// X: Index Count, Y: First Instance.
+	uvec4 Draw;
+};
+
+
+// Matches VkDrawIndexedIndirectCommand.
+struct DrawCommand
+{
+	uint IndexCount;
+	uint InstanceCount;
+	uint FirstIndex;
+	int VertexOffset;
+	uint FirstInstance;
+};
+
+
+
+// Input...
+layout(std430, binding = 0) readonly buffer ObjectsBuffer
+{
+	CullObject Objects[];
+} inObjects;
+
+
+layout(std430, binding = 1) buffer VisibilityBuffer
+{
+	uint Visibility[];
+} ioVisibility;
+
+
+layout(binding = 4) uniform sampler2D inHiZ;
+
+
+layout(std430, binding = 5) readonly buffer DrawsBuffer
+{
+	CullDraw Draws[];
+} inDraws;
+
+
+layout(std430, binding = 7) readonly buffer SoftwareVisibilityBuffer
+{
+	uint Visibility[];
+} inSoftware;
+
+
+// Output...
+layout(std430, binding = 2) buffer IndirectBuffer
+{
+	DrawCommand Commands[];
+} outIndirect;
+
+
+layout(std430, binding = 6) writeonly buffer InstanceIndexBuffer
+{
+	uint Indices[];
+} outInstanceIndices;
+
+
+layout(std430, binding = 3) buffer StatsBuffer
+{
+	uint Stats[];
+} ioStats;
+
+
+
+// Cull Constants.
+layout( push_constant ) uniform Constant
+{
+	// The View & Projection Matrix of the view.
+	mat4 ViewProjMatrix;
+
+	// X,Y: Depth Pyramid Level 0 Size, Z: Number of Levels.
+	vec4 HiZSize;
+
+	// X: Number of Draws or Instances, Y: Phase, Z: Mode, W: Flags.
+	uvec4 Params;
+
+	// X: Visibility Offset, Y: Commands Offset, Z: Stats Offset, W: Instance Indices Offset.
+	uvec4 Offsets;
+
+} inCull;
+
+
+
+
+
+
+// Project the bounds to screen, return false if the bounds is completely outside the frustum.
+bool ProjectBounds(vec3 BMin, vec3 BMax, out vec4 Rect, out float MinZ, out bool IsCrossNear)
+{
+	uint OutsideMask = 0x3fu;
+	Rect = vec4(1.0, 1.0, 0.0, 0.0);
+	MinZ = 1.0;
+	IsCrossNear = false;
+
+	for (int i = 0; i < 8; ++i)
+	{
+		vec3 Corner = vec3((i & 1) != 0 ? BMax.x : BMin.x, (i & 2) != 0 ? BMax.y : BMin.y, (i & 4) != 0 ? BMax.z : BMin.z);
+		vec4 Clip = inCull.ViewProjMatrix * vec4(Corner, 1.0);
+
+		// Outside Planes...
+		uint Mask = 0u;
+		Mask |= Clip.x < -Clip.w ? 1u : 0u;
+		Mask |= Clip.x >  Clip.w ? 2u : 0u;
+		Mask |= Clip.y < -Clip.w ? 4u : 0u;
+		Mask |= Clip.y >  Clip.w ? 8u : 0u;
+		Mask |= Clip.z <  0.0    ? 16u : 0u;
+		Mask |= Clip.z >  Clip.w ? 32u : 0u;
+		OutsideMask &= Mask;
+
+		if (Clip.w <= SMALL_NUM)
+		{
+			IsCrossNear = true;
+			continue;
+		}
+
+		vec3 Ndc = Clip.xyz / Clip.w;
+		vec2 UV = clamp(Ndc.xy * 0.5 + 0.5, vec2(0.0), vec2(1.0));
+		Rect.xy = min(Rect.xy, UV);
+		Rect.zw = max(Rect.zw, UV);
+		MinZ = min(MinZ, Ndc.z);
+	}
+
+	return OutsideMask == 0;
+}
+
+
+
+// Test screen rect against the depth pyramid, return true if the rect is behind the pyramid depth.
+bool IsOccluded(vec4 Rect, float MinZ)
+{
+	vec2 Size = (Rect.zw - Rect.xy) * inCull.HiZSize.xy;
+	int NumLevels = int(inCull.HiZSize.z);
+
+	// The level where the rect covers at most 2x2 texels.
+	int Level = int(ceil(log2(max(max(Size.x, Size.y), 1.0))));
+	Level = clamp(Level, 0, NumLevels - 1);
+
+	ivec2 LevelSize = max(ivec2(inCull.HiZSize.xy) >> Level, ivec2(1));
+	ivec2 CMin = clamp(ivec2(Rect.xy * vec2(LevelSize)), ivec2(0), LevelSize - 1);
+	ivec2 CMax = clamp(ivec2(Rect.zw * vec2(LevelSize)), ivec2(0), LevelSize - 1);
+
+	float MaxDepth = 0.0;
+
+	for (int y = CMin.y; y <= CMax.y; ++y)
+	{
+		for (int x = CMin.x; x <= CMax.x; ++x)
+		{
+			MaxDepth = max(MaxDepth, texelFetch(inHiZ, ivec2(x, y), Level).r);
+		}
+	}
+
+	return MinZ > MaxDepth;
+}
+
+
+
+
+// Reset the draw command of the phase, its instances are added by the instances cull.
+void ResetDraw(uint Index)
+{
+	CullDraw Draw = inDraws.Draws[Index];
+
+	DrawCommand Cmd;
+	Cmd.IndexCount = Draw.Draw.x;
+	Cmd.InstanceCount = 0u;
+	Cmd.FirstIndex = 0u;
+	Cmd.VertexOffset = 0;
+	Cmd.FirstInstance = inCull.Offsets.w + Draw.Draw.y;
+
+	outIndirect.Commands[inCull.Offsets.y + Index] = Cmd;
+}
+
+
+
+
+void main()
+{
+	uint Index = gl_GlobalInvocationID.x;
+
+	if (Index >= inCull.Params.x)
+		return;
+
+	if (inCull.Params.z == CULL_MODE_RESET_DRAWS)
+	{
+		ResetDraw(Index);
+		return;
+	}
+
+	CullObject Obj = inObjects.Objects[Index];
+	uint InstanceIndex = Obj.Info.y;
+	uint Phase = inCull.Params.y;
+	uint StatsOffset = inCull.Offsets.z;
+
+	vec4 Rect;
+	float MinZ;
+	bool IsCrossNear;
+	bool IsInFrustum = ProjectBounds(Obj.BoundsMin.xyz, Obj.BoundsMax.xyz, Rect, MinZ, IsCrossNear);
+
+	bool IsAlwaysVisible = (Obj.Info.w & CULL_FLAG_ALWAYS_VISIBLE) != 0u;
+	IsInFrustum = IsInFrustum || IsAlwaysVisible;
+
+	// Occluded by the software occlusion culling of this view?
+	bool IsSoftwareVisible = (inCull.Params.w & CULL_FLAG_SOFTWARE_VISIBILITY) == 0u
+		|| (inSoftware.Visibility[InstanceIndex / 32u] & (1u << (InstanceIndex % 32u))) != 0u;
+
+	// Visible last frame?
+	bool IsPrePass = IsInFrustum && IsSoftwareVisible && ioVisibility.Visibility[inCull.Offsets.x + InstanceIndex] != 0u;
+	bool IsVisible = IsPrePass;
+
+
+	if (Phase == CULL_PHASE_FINAL)
+	{
+		bool IsVisibleNow = IsInFrustum && IsSoftwareVisible && (IsAlwaysVisible || IsCrossNear || !IsOccluded(Rect, MinZ));
+		ioVisibility.Visibility[inCull.Offsets.x + InstanceIndex] = IsVisibleNow ? 1u : 0u;
+		IsVisible = IsPrePass || IsVisibleNow;
+
+		// Stats...
+		if (IsVisible)
+			atomicAdd(ioStats.Stats[StatsOffset + STATS_VISIBLE], 1u);
+		else if (IsInFrustum)
+			atomicAdd(ioStats.Stats[StatsOffset + STATS_OCCLUDED], 1u);
+		else
+			atomicAdd(ioStats.Stats[StatsOffset + STATS_FRUSTUM], 1u);
+	}
+	else if (IsPrePass)
+	{
+		atomicAdd(ioStats.Stats[StatsOffset + STATS_PRE_PASS], 1u);
+	}
+
+
+	// Add the instance to its draw command...
+	if (IsVisible)
+	{
+		uint Slot = atomicAdd(outIndirect.Commands[inCull.Offsets.y + Obj.Info.x].InstanceCount, 1u);
+		outInstanceIndices.Indices[inCull.Offsets.w + Obj.Info.z + Slot] = InstanceIndex;
+	}
+}
@@ -32,24 +32,35 @@
 
 
 
+// Impostors are helpers without a mesh.
+#if defined(SPHERE_HELPER_IMPOSTOR)
+#define SPHERE_HELPER_MESH
+#endif
+
+
+
 
 // VERTEX OUTPUT...
 layout(location = 0) in VERTEX_OUT
 {
 	vec3 Position;
-} inFrag;
 
+#if defined(SPHERE_HELPER_MESH)
+	flat vec4 HelperPosition;
+	flat vec4 HelperColor;
+#endif
 
+#if defined(SPHERE_HELPER_IMPOSTOR)
+	flat vec3 Right;
+	flat vec3 Up;
+	flat float Radius;
+	vec2 QuadCoord;
+#endif
+} inFrag;
 
-#if defined(SPHERE_HELPER_MESH)
 
-layout(push_constant) uniform Constants
-{
-	vec4 Position;
-	vec4 Scale;
-	vec4 Color;
-} inConstant;
 
+#if defined(SPHERE_HELPER_MESH)
 
 
 
@@ -71,15 +82,34 @@ layout(location = 0) out vec4 FragColor;
 
 void main()
 {
-	FragColor.rgb = inConstant.Color.rgb;
+	FragColor.rgb = inFrag.HelperColor.rgb;
+	float FragDepth = gl_FragCoord.z;
+
+#if defined(SPHERE_HELPER_IMPOSTOR)
+	// Analytic sphere on the quad.
+	float R2 = dot(inFrag.QuadCoord, inFrag.QuadCoord);
+
+	if (R2 > 1.0)
+		discard;
+
+	float NdotV = sqrt(1.0 - R2);
+	vec3 Forward = cross(inFrag.Up, inFrag.Right);
+	vec3 N = inFrag.Right * inFrag.QuadCoord.x + inFrag.Up * inFrag.QuadCoord.y - Forward * NdotV;
+
+	// The depth of the sphere surface.
+	vec4 SurfaceClip = inCommon.ViewProjMatrix * vec4(inFrag.HelperPosition.xyz + N * inFrag.Radius, 1.0);
+	FragDepth = SurfaceClip.z / SurfaceClip.w;
+
+	FragColor.rgb *= 0.35 + 0.65 * NdotV;
+#endif
 
 	vec2 ScreenCoord = gl_FragCoord.xy / inCommon.Viewport.zw;
 	vec2 TargetTexCoord = ScreenCoord * (inCommon.Viewport.zw - inCommon.Viewport.xy) / inCommon.TargetSize.xy;
 	float Depth = texture(gDepth, TargetTexCoord).r;
 
-	if (Depth < gl_FragCoord.z)
+	if (Depth < FragDepth)
 	{
-		if (inConstant.Position.w < 1.0)
+		if (inFrag.HelperPosition.w < 1.0)
 			discard;
 
 		FragColor.rgb = FragColor.rgb * 0.1;
@@ -32,22 +32,54 @@
 
 
 
+// Impostors are helpers without a mesh.
+#if defined(SPHERE_HELPER_IMPOSTOR)
+#define SPHERE_HELPER_MESH
+#endif
+
+
+
 
+#if !defined(SPHERE_HELPER_IMPOSTOR)
 // Input Attributes...
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inNormal;
 layout(location = 2) in vec2 inTexCoord;
+#endif
 
 
 
 
 #if defined(SPHERE_HELPER_MESH)
-layout(push_constant) uniform Constants
+// Per-Instance Helper Data.
+struct HelperInstance
 {
+	// Helper Position(XYZ) & Draw Occluded Flag(W).
 	vec4 Position;
+
+	// Helper Scale.
 	vec4 Scale;
+
+	// Helper Color.
 	vec4 Color;
-} inConstant;
+};
+
+
+// Helpers Binding.
+layout(std430, binding = 5) readonly buffer HelperBuffer
+{
+	HelperInstance Instances[];
+} inHelpers;
+#endif
+
+
+
+#if defined(SPHERE_HELPER_IMPOSTOR)
+// The quad corners, two triangles.
+const vec2 QuadCorners[6] = vec2[](
+	vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0),
+	vec2(-1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0)
+);
 #endif
 
 
@@ -58,6 +90,18 @@ layout(push_constant) uniform Constants
 layout(location = 0) out VERTEX_OUT
 {
 	vec3 Position;
+
+#if defined(SPHERE_HELPER_MESH)
+	flat vec4 HelperPosition;
+	flat vec4 HelperColor;
+#endif
+
+#if defined(SPHERE_HELPER_IMPOSTOR)
+	flat vec3 Right;
+	flat vec3 Up;
+	flat float Radius;
+	vec2 QuadCoord;
+#endif
 } outVert;
 
 
@@ -70,12 +114,36 @@ layout(location = 0) out VERTEX_OUT
 void main()
 {
 
-#if defined(SPHERE_HELPER_MESH)
-	gl_Position = inCommon.ViewProjMatrix * vec4(inPosition * inConstant.Scale.xyz + inConstant.Position.xyz, 1.0);
+#if defined(SPHERE_HELPER_IMPOSTOR)
+	HelperInstance Helper = inHelpers.Instances[gl_InstanceIndex];
+	vec2 Corner = QuadCorners[gl_VertexIndex];
+
+	// Quad facing the view position.
+	vec3 Forward = normalize(Helper.Position.xyz - inCommon.ViewPos);
+	vec3 UpRef = abs(Forward.y) > 0.99 ? vec3(1.0, 0.0, 0.0) : vec3(0.0, 1.0, 0.0);
+	vec3 Right = normalize(cross(Forward, UpRef));
+	vec3 Up = cross(Right, Forward);
+
+	vec3 Position = Helper.Position.xyz + (Right * Corner.x + Up * Corner.y) * Helper.Scale.x;
+	gl_Position = inCommon.ViewProjMatrix * vec4(Position, 1.0);
+
+	outVert.Position = Position;
+	outVert.HelperPosition = Helper.Position;
+	outVert.HelperColor = Helper.Color;
+	outVert.Right = Right;
+	outVert.Up = Up;
+	outVert.Radius = Helper.Scale.x;
+	outVert.QuadCoord = Corner;
+#elif defined(SPHERE_HELPER_MESH)
+	HelperInstance Helper = inHelpers.Instances[gl_InstanceIndex];
+	gl_Position = inCommon.ViewProjMatrix * vec4(inPosition * Helper.Scale.xyz + Helper.Position.xyz, 1.0);
+
+	outVert.Position = inPosition;
+	outVert.HelperPosition = Helper.Position;
+	outVert.HelperColor = Helper.Color;
 #else
 	gl_Position = vec4(inPosition, 1.0);
-#endif
-
 	outVert.Position = inPosition;
+#endif
 }
 
@@ -36,6 +36,23 @@
 #include "GLFW/glfw3.h"
 #include "Importers/GLTFImporter.h"
 #include "Importers/RTGIImporter.h"
+#include "Importers/ScenePackage.h"
+#include "Importers/SceneLoader.h"
+#include "Importers/AssetRegistry.h"
+#include "Render/Renderer.h"
+#include "Render/RendererPipeline.h"
+#include "Render/RendererStats.h"
+#include "Render/RenderStageOcclusion.h"
+#include "Render/RenderGraph.h"
+#include "Render/RenderPassCache.h"
+#include "Render/RenderTextureStreamer.h"
+#include "Render/RenderData/RenderScene.h"
+#include "Render/RenderData/Shaders/RenderFrameAllocator.h"
+#include "Render/VKInterface/VKIDevice.h"
+#include "Render/VKInterface/VKIUploadManager.h"
+#include "Render/VKInterface/VKIMipGenerator.h"
+#include "Render/VKInterface/VKIDeletionQueue.h"
+#include "Core/OcclusionRasterizer.h"
 
 #include "glm/gtc/type_ptr.hpp"
 
@@ -104,6 +121,9 @@ AppUser::~AppUser()
 
 void AppUser::Initialize()
 {
+	// Scenes dropped on the window are loaded in the background.
+	mSceneLoader = UniquePtr<SceneLoader>(new SceneLoader());
+
 	// Bind File Drop to load scene..
 	Application::Get().GetMainWindow()->FileDropEvent.BindMemberRaw(this, &AppUser::LoadNewScene);
 
@@ -115,33 +135,24 @@ void AppUser::Destroy()
 	// Clear Binding.
 	Application::Get().GetMainWindow()->FileDropEvent.Reset();
 
+	// Stop loading & destroy the scene being loaded.
+	mSceneLoader.reset();
+
 }
 
 
 void AppUser::LoadNewScene(const std::string& path)
 {
-	LOGI("Loading scene... (%s)", path.c_str());
-
 	if (path.empty())
 		return;
 
+	// Loaded on the loader thread, the scene replace the current one once it is ready.
+	mSceneLoader->Load(path);
+}
 
-	std::string ext = GISystem::GetFileExtension(path);
-	bool isSuccess = false;
-	Ptr<Scene> scene;
-
-
-	// Load based on extension...
-	if (GLTFImporter::IsSupported(path))
-	{
-		scene = Ptr<Scene>(new Scene());
-		isSuccess = GLTFImporter::Import(scene.get(), path);
-	}
-
-	// Failed to load?
-	if (!isSuccess)
-		return;
 
+void AppUser::SetupLoadedScene(Ptr<Scene> scene, const std::string& path)
+{
 	// Delete old Scene...
 	Application::Get().ReplaceScene(nullptr);
 
@@ -190,10 +201,23 @@ void AppUser::Update(float deltaTime, Scene* scene)
 	// TEMP------------------------------------------
 
 
+	// Swap in the loaded scene at the end of the update, nothing uses the current scene after this.
+	Ptr<Scene> loadedScene = mSceneLoader->Update();
+
+	if (loadedScene)
+		SetupLoadedScene(loadedScene, mSceneLoader->GetFile());
+
 }
 	
 
-void AppUser::UpdateInput(float deltaTime)
+void AppUser::LateUpdate(float deltaTime, Scene* scene)
+{
+	UpdateNavInput();
+	UpdateNav(deltaTime, scene);
+}
+
+
+void AppUser::UpdateNavInput()
 {
 	auto appWindow = Application::Get().GetMainWindow();
 	auto window = appWindow->GetHandle();
@@ -207,14 +231,27 @@ void AppUser::UpdateInput(float deltaTime)
 	g_KeyUp = glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS ? 1.0f : 0.0f;
 	g_KeyDown = glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS ? 1.0f : 0.0f;
 	g_KeyShift = glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS ? 1.0f : 0.0f;
+	g_KeyMouseRight = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS ? 1.0f : 0.0f;
+
+	double mx, my;
+	glfwGetCursorPos(window, &mx, &my);
+	g_MouseOffset = glm::vec2((float)mx - g_MousePos.x, (float)my - g_MousePos.y);
+	g_MousePos = glm::vec2((float)mx, (float)my);
+}
+
+
+void AppUser::UpdateInput(float deltaTime)
+{
+	auto appWindow = Application::Get().GetMainWindow();
+	auto window = appWindow->GetHandle();
+
+	UpdateNavInput();
 
 	KEY_STATE_UPDATE(g_Key1, g_Key1_Released, GLFW_KEY_1);
 	KEY_STATE_UPDATE(g_Key2, g_Key2_Released, GLFW_KEY_2);
 	KEY_STATE_UPDATE(g_Key3, g_Key3_Released, GLFW_KEY_3);
 	KEY_STATE_UPDATE(g_Key4, g_Key4_Released, GLFW_KEY_4);
 
-	g_KeyMouseRight = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS ? 1.0f : 0.0f;
-
 	g_KeyMouseLeft_Released = false;
 	if (g_KeyMouseLeft > 0.0f)
 	{
@@ -229,12 +266,6 @@ void AppUser::UpdateInput(float deltaTime)
 	{
 		g_KeyMouseLeft = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS ? 1.0f : 0.0f;
 	}
-
-	
-	double mx, my;
-	glfwGetCursorPos(window, &mx, &my);
-	g_MouseOffset = glm::vec2((float)mx - g_MousePos.x, (float)my - g_MousePos.y);
-	g_MousePos = glm::vec2((float)mx, (float)my);
 }
 
 
@@ -331,6 +362,20 @@ void AppUser::UpdateImGui()
 	ImGui::Text("%.3f ms/Frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
 	ImGui::Separator();
 
+	// -----
+	// SCENE LOADING
+	if (mSceneLoader->IsLoading())
+	{
+		const char* stage = mSceneLoader->GetState() == ESceneLoadState::Importing ? "Importing" : "Uploading";
+		ImGui::Text("%s %s...", stage, GISystem::GetFileName(GISystem::NormalizePath(mSceneLoader->GetFile()), true).c_str());
+		ImGui::ProgressBar(mSceneLoader->GetProgress());
+
+		if (ImGui::Button("Cancel Loading"))
+			mSceneLoader->Cancel();
+
+		ImGui::Separator();
+	}
+
 
 	// -----
 	// SUN
@@ -366,6 +411,178 @@ void AppUser::UpdateImGui()
 		}
 	}
 
+	// A copy of the stats published by the thread rendering frames.
+	RendererStats renderStats = Application::Get().GetRenderer()->GetStats();
+
+	// -----
+	// OCCLUSION
+	{
+		ImGui::Separator();
+		ImGui::Checkbox("Occlusion Culling", &scene->GetGlobal().isOcclusionCulling);
+
+		for (uint32_t i = 0; i < OCCLUSION_MAX_VIEWS; ++i)
+		{
+			const OcclusionViewStats& stats = renderStats.occlusionViews[i];
+
+			if (i == 0)
+				ImGui::Text("Main View");
+			else
+				ImGui::Text("Capture Face %d", i - 1);
+
+			ImGui::Text("  Visible: %d, Occluded: %d, Frustum: %d, Pre-Pass: %d",
+				stats.visible, stats.occluded, stats.frustumCulled, stats.prePass);
+		}
+
+		ImGui::Checkbox("Software Occlusion", &scene->GetGlobal().isSoftwareOcclusion);
+
+		if (scene->GetGlobal().isSoftwareOcclusion)
+		{
+			const OcclusionRasterizerStats& rstats = renderStats.occlusionRasterizer;
+			ImGui::Text("  Occluders: %d, Triangles: %d, Raster: %.3f ms", rstats.numOccluders, rstats.numTriangles, rstats.rasterTime);
+			ImGui::Text("  Tested: %d, Culled: %d, Test: %.3f ms", rstats.numTested, rstats.numCulled, rstats.testTime);
+		}
+	}
+
+	// -----
+	// FRAME PACING
+	{
+		ImGui::Separator();
+		RendererFrameSettings& frame = Application::Get().GetRenderer()->GetFrameSettings();
+		const RendererFrameStats& fstats = renderStats.frame;
+
+		int framesInFlight = (int)frame.framesInFlight;
+		if (ImGui::SliderInt("Frames In-Flight", &framesInFlight, 1, (int)Renderer::NUM_CONCURRENT_FRAMES))
+			frame.framesInFlight = (uint32_t)framesInFlight;
+
+		const char* presentModes[] = { "Fifo", "Mailbox", "Immediate" };
+		int presentMode = (int)frame.presentMode;
+		if (ImGui::Combo("Present Mode", &presentMode, presentModes, 3))
+			frame.presentMode = (ERenderPresentMode)presentMode;
+
+		ImGui::SliderFloat("Max FPS", &frame.maxFrameRate, 0.0f, 240.0f, "%.0f");
+		ImGui::Checkbox("Render Thread", &frame.isRenderThread);
+
+		ImGui::Checkbox("Low Latency", &frame.isLowLatency);
+
+		if (Application::Get().GetRenderer()->GetVKDevice()->IsAsyncCompute())
+			ImGui::Checkbox("Async Compute", &frame.isAsyncCompute);
+
+		ImGui::Text("  Frame: %.2f ms (%.1f FPS), Latency: %.2f ms",
+			fstats.frameTime, fstats.frameTime > 0.0f ? 1000.0f / fstats.frameTime : 0.0f, fstats.latency);
+		ImGui::Text("  GPU Wait: %.2f ms, Limiter: %.2f ms", fstats.waitTime, fstats.limiterTime);
+		ImGui::Text("  Record: %.2f ms, Snapshot Wait: %.2f ms", fstats.recordTime, fstats.snapshotWaitTime);
+	}
+
+	// -----
+	// RESOLUTION
+	{
+		ImGui::Separator();
+		RendererFrameSettings& frame = Application::Get().GetRenderer()->GetFrameSettings();
+		const RendererResolution& resolution = renderStats.resolution;
+		ImGui::Checkbox("Dynamic Resolution", &frame.isDynamicResolution);
+
+		if (frame.isDynamicResolution)
+			ImGui::SliderFloat("GPU Target (ms)", &frame.targetGPUTime, 4.0f, 33.0f, "%.1f");
+		else
+			ImGui::SliderFloat("Render Scale", &frame.renderScale, resolution.minScale, resolution.maxScale, "%.2f");
+
+		ImGui::Text("  Render: %dx%d -> %dx%d, Scale: %.2f, GPU: %.2f ms",
+			resolution.renderSize.x, resolution.renderSize.y, resolution.outputSize.x, resolution.outputSize.y,
+			resolution.scale, resolution.smoothTime);
+	}
+
+	// -----
+	// DRAWS
+	{
+		ImGui::Separator();
+
+		const RDDrawStats& dstats = renderStats.draws;
+		ImGui::Text("Draws: %d, Sort: %.3f ms", dstats.numDraws, dstats.sortTime);
+		ImGui::Text("  Pipeline Binds: %d, Material Binds: %d, Buffer Binds: %d",
+			dstats.numPipelineBinds, dstats.numMaterialBinds, dstats.numBufferBinds);
+		ImGui::Text("  Redundant Binds Skipped: %d", dstats.numRedundantBinds);
+
+		const RenderFrameAllocatorStats& astats = renderStats.frameAllocator;
+		ImGui::Text("Frame Memory: %d KB, Peak: %d KB, Allocs: %d, Overflows: %d",
+			astats.usedBytes / 1024, astats.peakBytes / 1024, astats.numAllocations, astats.numOverflows);
+
+		const ScenePackageStats& pstats = ScenePackage::GetStats();
+		if (pstats.totalTime > 0.0f)
+		{
+			ImGui::Text("Scene Package: %.1f ms (Images %.1f ms, Meshes %.1f ms), Cold Import: %.1f ms",
+				pstats.totalTime, pstats.imageTime, pstats.meshTime, pstats.coldTime);
+			ImGui::Text("  Textures: %.1f MB (RGBA %.1f MB), BC Encode: %.1f MTexel/s, PSNR: %.2f dB",
+				(float)pstats.imageBytes / (1024.0f * 1024.0f), (float)pstats.rawImageBytes / (1024.0f * 1024.0f),
+				pstats.encodeRate, pstats.encodePSNR);
+		}
+
+		AssetRegistryStats arstats = AssetRegistry::GetStats();
+		ImGui::Text("Asset Registry: %d images, %d meshes, Hits: %d/%d images, %d/%d meshes, Saved: %.1f MB",
+			arstats.numImages, arstats.numMeshes, arstats.numImageHits, arstats.numImageLookups, arstats.numMeshHits,
+			arstats.numMeshLookups, (float)(arstats.savedImageBytes + arstats.savedMeshBytes) / (1024.0f * 1024.0f));
+
+		// Texture streaming, the budget of the streamed mips in video memory.
+		const RenderTextureStreamerStats& tstats = renderStats.textureStreamer;
+
+		int budgetMB = (int)(tstats.budget / (1024 * 1024));
+		if (ImGui::SliderInt("Texture Budget (MB)", &budgetMB, 8, 2048))
+			Application::Get().GetRenderer()->GetTextureStreamer()->SetBudget((uint64_t)budgetMB * 1024 * 1024);
+
+		ImGui::Text("Streamed Textures: %d, Resident: %d, Over Budget: %d, Pending: %d, Update: %.3f ms",
+			tstats.numImages, tstats.numResident, tstats.numOverBudget, tstats.numPending, tstats.updateTime);
+		ImGui::Text("  Resident: %.1f MB, Required: %.1f MB, Streaming: %.1f MB, Streamed In: %d, Evicted: %d",
+			(float)tstats.residentBytes / (1024.0f * 1024.0f), (float)tstats.requiredBytes / (1024.0f * 1024.0f),
+			(float)tstats.pendingBytes / (1024.0f * 1024.0f), (int)tstats.numStreamedIn, (int)tstats.numEvicted);
+
+		const VKIUploadStats& ustats = renderStats.uploads;
+		ImGui::Text("Uploads: %d (%.1f MB), Batches: %d, Stalls: %d, Dedicated: %d",
+			ustats.numUploads, (float)ustats.uploadedBytes / (1024.0f * 1024.0f), ustats.numBatches,
+			ustats.numStalls, ustats.numDedicated);
+
+		// Mip generation, timed per million source texels to compare the compute & blit paths.
+		RendererFrameSettings& frame = Application::Get().GetRenderer()->GetFrameSettings();
+		const VKIMipStats& mstats = renderStats.mips;
+
+		ImGui::Checkbox("Compute Mips", &frame.isComputeMips);
+
+		if (frame.isComputeMips)
+		{
+			ImGui::Checkbox("Kaiser Filter", &frame.isKaiserMips);
+			ImGui::Checkbox("sRGB Correct", &frame.isSRGBCorrectMips);
+		}
+
+		ImGui::Text("  Mips Compute: %d (%.3f ms/MTexel), Blit: %d (%.3f ms/MTexel)",
+			mstats.numCompute, mstats.computeTexels ? mstats.computeTime * 1e6 / (double)mstats.computeTexels : 0.0,
+			mstats.numBlit, mstats.blitTexels ? mstats.blitTime * 1e6 / (double)mstats.blitTexels : 0.0);
+
+		const RenderGraphStats& gstats = renderStats.graph;
+		ImGui::Text("Graph Passes: %d, Culled: %d, Barriers: %d in %d batches, Skipped: %d",
+			gstats.numPasses, gstats.numCulledPasses, gstats.numImageBarriers, gstats.numBarrierBatches,
+			gstats.numSkippedBarriers);
+		ImGui::Text("  Transients: %d, Memory: %.1f MB aliased into %.1f MB",
+			gstats.numTransients, (float)gstats.transientBytes / (1024.0f * 1024.0f),
+			(float)gstats.allocatedBytes / (1024.0f * 1024.0f));
+
+		// Secondary command buffers reused while their pass inputs are unchanged.
+		const RenderPassCacheStats& cstats = renderStats.passCache;
+		ImGui::Checkbox("Cache Passes", &frame.isCachePasses);
+
+		ImGui::Text("  Cached Passes: %d, Recorded: %d, Record: %.3f ms",
+			cstats.numCached, cstats.numRecorded, cstats.recordTime);
+
+		const VKIDeletionStats& qstats = renderStats.deletions;
+		ImGui::Text("Deferred Deletes: %d pending, Peak: %d, Destroyed: %d",
+			qstats.numPending, qstats.peakPending, (uint32_t)qstats.numDestroyed);
+	}
+
+	// -----
+	// HELPERS
+	{
+		ImGui::Separator();
+		ImGui::Checkbox("Probe Helpers", &scene->GetGlobal().isLightProbeHelpers);
+		ImGui::Checkbox("Helper Impostors", &scene->GetGlobal().isHelperImpostors);
+	}
+
 	// -----
 
 	ImGui::Separator();
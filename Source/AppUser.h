@@ -35,6 +35,7 @@
 
 
 class Scene;
+class SceneLoader;
 
 
 
@@ -63,6 +64,9 @@ public:
 	// Update User Interaction.
 	void Update(float deltaTime, Scene* scene);
 
+	// Update only the navigation input & the camera, called right before recording in low latency mode.
+	void LateUpdate(float deltaTime, Scene* scene);
+
 	// Called every frame to Update ImGui ui.
 	void UpdateImGui();
 
@@ -70,17 +74,26 @@ private:
 	// Update Input States.
 	void UpdateInput(float deltaTime);
 
+	// Update the input states used for navigation.
+	void UpdateNavInput();
+
 	// Update Navigation.
 	void UpdateNav(float deltaTime, Scene* scene);
 
 	// Perfrm Scene Select.
 	void SceneSelect(Scene* scene);
 
-	// Load a new scene from path.
+	// Start loading a new scene from path in the background.
 	void LoadNewScene(const std::string& path);
 
+	// Setup a loaded scene & replace the current one with it.
+	void SetupLoadedScene(Ptr<Scene> scene, const std::string& path);
+
 	// Mark all light components in the scene dirty to get updated.
 	void UpdateProbes();
 
+private:
+	// Load scenes on a loader thread.
+	UniquePtr<SceneLoader> mSceneLoader;
 };
 
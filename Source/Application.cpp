@@ -27,7 +27,11 @@
 #include "AppUser.h"
 #include "Render/Renderer.h"
 #include "Importers/GLTFImporter.h"
+#include "Importers/OBJImporter.h"
 #include "Importers/RTGIImporter.h"
+#include "Importers/ScenePackage.h"
+#include "Core/OcclusionRasterizer.h"
+#include "Tests/Tests.h"
 
 #include "Scene/Scene.h"
 #include "Scene/LightProbeNode.h"
@@ -51,6 +55,7 @@ UniquePtr<Application> Application::mInstance = UniquePtr<Application>(new Appli
 Application::Application()
 	: mAppTime(0.0f)
 	, mDeltaTime(0.0f)
+	, mHasPendingScene(false)
 {
 	// The Application Name.
 	mAppName = "RealTimeGI";
@@ -66,7 +71,24 @@ Application::~Application()
 
 void Application::ProcessArg(int argc, char** argv)
 {
+	for (int32_t i = 1; i < argc; ++i)
+	{
+		// -benchobj <file>: benchmark the OBJ importer against tinyobjloader.
+		if (strcmp(argv[i], "-benchobj") == 0 && i + 1 < argc)
+			OBJImporter::Benchmark(argv[++i]);
+
+		// -benchocclusion: benchmark the software occlusion rasterizer.
+		if (strcmp(argv[i], "-benchocclusion") == 0)
+			OcclusionRasterizer::Benchmark(100);
 
+		// -runtests: run the CPU tests, exit with the number of failed checks.
+		if (strcmp(argv[i], "-runtests") == 0)
+			exit((int32_t)Tests::RunAll());
+
+		// -gltfflatten: import glTF files into a single node, ignoring their node hierarchy.
+		if (strcmp(argv[i], "-gltfflatten") == 0)
+			GLTFImporter::SetImportMode(EGLTFImportMode::Flatten);
+	}
 }
 
 
@@ -92,7 +114,7 @@ void Application::Initialize()
 	mMainScene->GetCamera().SetAspect(mAppWnd->GetFrameBufferAspect());
 	mMainScene->ComputeBounds();
 
-	GLTFImporter::Import(mMainScene.get(), RESOURCES_DIRECTORY "Models/Sponza/Sponza.gltf");
+	ScenePackage::Import(mMainScene.get(), RESOURCES_DIRECTORY "Models/Sponza/Sponza.gltf");
 	mMainScene->ResetView(); // Reset view.
 	mMainScene->GetGlobal().SetSunColor( glm::vec3(1.0f, 0.9f, 0.85f) );
 	mMainScene->GetGlobal().SetSunPower(4.0f);
@@ -378,9 +400,20 @@ void Application::Initialize()
 
 void Application::ReplaceScene(Ptr<Scene> scene)
 {
+	// The render thread is done with the frames using the old scene.
+	mRenderer->FlushRenderThread();
+
+	// Replaced while recording a frame that uses the scene? replace it at the next update.
+	if (mRenderer->IsRendering())
+	{
+		mPendingScene = scene;
+		mHasPendingScene = true;
+		return;
+	}
+
 	if (mMainScene)
 	{
-		mRenderer->WaitForIdle();
+		// Scene resources are destroyed once the frames using them are done.
 		mMainScene->Destroy();
 		mMainScene.reset();
 	}
@@ -412,12 +445,16 @@ int32_t Application::Run()
 	// Main Loop...
 	while (!mAppWnd->ShouldClose())
 	{
+		// Frame Limiter, before sampling input to keep the latency low.
+		mRenderer->PaceFrame();
+
 		// Time...
 		mDeltaTime = (float)glfwGetTime() - mAppTime;
 		mAppTime = (float)glfwGetTime();
 
 		// Window System Events...
 		glfwPollEvents();
+		mRenderer->MarkInputSampled();
 
 		// ...
 		Update();
@@ -446,6 +483,13 @@ void Application::Destroy()
 		mMainScene.reset();
 	}
 
+	// Destroy a scene that never got swapped in.
+	if (mPendingScene)
+	{
+		mPendingScene->Destroy();
+		mPendingScene.reset();
+	}
+
 	// Destroy Renderer.
 	mRenderer->Destroy();
 }
@@ -453,6 +497,12 @@ void Application::Destroy()
 
 void Application::Update()
 {
+	if (mHasPendingScene)
+	{
+		mHasPendingScene = false;
+		ReplaceScene(std::move(mPendingScene));
+	}
+
 	mAppUser->Update(mDeltaTime, mMainScene.get());
 
 
@@ -464,6 +514,21 @@ void Application::Update()
 }
 
 
+void Application::LateUpdate()
+{
+	float deltaTime = (float)glfwGetTime() - mAppTime;
+	mAppTime = (float)glfwGetTime();
+
+	glfwPollEvents();
+	mRenderer->MarkInputSampled();
+
+	if (mMainScene)
+	{
+		mAppUser->LateUpdate(deltaTime, mMainScene.get());
+	}
+}
+
+
 void Application::Render()
 {
 	// Don't Render while minimized.
@@ -471,12 +536,6 @@ void Application::Render()
 		return;
 
 
-	// Begin Rendering...
-	mRenderer->BeginRender(mMainScene.get());
-
-	// Render...
-	mRenderer->Render();
-
-	// End Rendering...
-	mRenderer->EndRender();
+	// Capture the scene & render it, recording overlaps the next update if the render thread is enabled.
+	mRenderer->SubmitFrame(mMainScene.get());
 }
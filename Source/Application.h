@@ -95,6 +95,9 @@ public:
 	// Replace current Main application scene.
 	void ReplaceScene(Ptr<Scene> scene);
 
+	// Sample input & update the view again right before recording the frame, used by the low latency mode.
+	void LateUpdate();
+
 private:
 	// Initialize the window.
 	void SetupWindow();
@@ -121,6 +124,10 @@ private:
 	// The application main scene.
 	Ptr<Scene> mMainScene;
 
+	// Scene replaced while rendering, it replace the main scene at the next update.
+	Ptr<Scene> mPendingScene;
+	bool mHasPendingScene;
+
 	// The application's name.
 	std::string mAppName;
 
@@ -0,0 +1,575 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+
+
+
+#include "BlockCompression.h"
+
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+
+
+
+// The number of least squares passes refining the BC1 endpoints.
+#define BC1_REFINE_PASSES 2
+
+// The size of a BC1 or single channel block in bytes.
+#define BC_HALF_BLOCK_SIZE 8
+
+
+
+
+// Convert 8-bit color to 565.
+static inline uint16_t BCTo565(const float* color)
+{
+	uint32_t r = (uint32_t)(std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+	uint32_t g = (uint32_t)(std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f + 0.5f);
+	uint32_t b = (uint32_t)(std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+	return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+
+// Expand 565 color to 8-bit.
+static inline void BCFrom565(uint16_t c, int32_t* outColor)
+{
+	int32_t r = (c >> 11) & 31;
+	int32_t g = (c >> 5) & 63;
+	int32_t b = c & 31;
+	outColor[0] = (r << 3) | (r >> 2);
+	outColor[1] = (g << 2) | (g >> 4);
+	outColor[2] = (b << 3) | (b >> 2);
+}
+
+
+// Build the 4 colors palette of BC1 endpoints.
+static void BCBuildPalette(uint16_t c0, uint16_t c1, int32_t palette[4][3])
+{
+	BCFrom565(c0, palette[0]);
+	BCFrom565(c1, palette[1]);
+
+	for (int32_t i = 0; i < 3; ++i)
+	{
+		palette[2][i] = (2 * palette[0][i] + palette[1][i]) / 3;
+		palette[3][i] = (palette[0][i] + 2 * palette[1][i]) / 3;
+	}
+}
+
+
+// Pick the closest palette color for each pixel, return the squared error.
+static int32_t BCPickIndices(const uint8_t* rgba, const int32_t palette[4][3], uint8_t* outIndices)
+{
+	int32_t totalError = 0;
+
+	for (int32_t i = 0; i < 16; ++i)
+	{
+		const uint8_t* p = rgba + i * 4;
+		int32_t bestError = INT32_MAX;
+
+		for (uint8_t k = 0; k < 4; ++k)
+		{
+			int32_t dr = p[0] - palette[k][0];
+			int32_t dg = p[1] - palette[k][1];
+			int32_t db = p[2] - palette[k][2];
+			int32_t error = dr * dr + dg * dg + db * db;
+
+			if (error < bestError)
+			{
+				bestError = error;
+				outIndices[i] = k;
+			}
+		}
+
+		totalError += bestError;
+	}
+
+	return totalError;
+}
+
+
+// Solve the endpoints that best fit the pixels with their indices in the least squares sense.
+static bool BCRefineEndpoints(const uint8_t* rgba, const uint8_t* indices, float* outColor0, float* outColor1)
+{
+	// Weight of endpoint 0 for each index.
+	static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+	float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+	float ax[3] = { 0.0f, 0.0f, 0.0f };
+	float bx[3] = { 0.0f, 0.0f, 0.0f };
+
+	for (int32_t i = 0; i < 16; ++i)
+	{
+		float a = weights[indices[i]];
+		float b = 1.0f - a;
+		aa += a * a;
+		bb += b * b;
+		ab += a * b;
+
+		for (int32_t c = 0; c < 3; ++c)
+		{
+			ax[c] += a * rgba[i * 4 + c];
+			bx[c] += b * rgba[i * 4 + c];
+		}
+	}
+
+	float det = aa * bb - ab * ab;
+
+	if (std::abs(det) < 1e-6f)
+		return false;
+
+	float invDet = 1.0f / det;
+
+	for (int32_t c = 0; c < 3; ++c)
+	{
+		outColor0[c] = (ax[c] * bb - bx[c] * ab) * invDet;
+		outColor1[c] = (bx[c] * aa - ax[c] * ab) * invDet;
+	}
+
+	return true;
+}
+
+
+// Write BC1 color block, the endpoints are ordered for the 4 colors mode.
+static void BCWriteColorBlock(uint16_t c0, uint16_t c1, uint8_t* indices, uint8_t* outBlock)
+{
+	if (c0 < c1)
+	{
+		std::swap(c0, c1);
+
+		for (int32_t i = 0; i < 16; ++i)
+			indices[i] ^= 1;
+	}
+	else if (c0 == c1)
+	{
+		memset(indices, 0, 16);
+	}
+
+	uint32_t bits = 0;
+
+	for (int32_t i = 0; i < 16; ++i)
+		bits |= (uint32_t)indices[i] << (i * 2);
+
+	outBlock[0] = (uint8_t)(c0 & 0xFF);
+	outBlock[1] = (uint8_t)(c0 >> 8);
+	outBlock[2] = (uint8_t)(c1 & 0xFF);
+	outBlock[3] = (uint8_t)(c1 >> 8);
+	memcpy(outBlock + 4, &bits, 4);
+}
+
+
+// Compress the colors of a block, endpoints along the principal axis of the colors then refined by least squares.
+static void BCCompressColorBlock(const uint8_t* rgba, uint8_t* outBlock)
+{
+	float mean[3] = { 0.0f, 0.0f, 0.0f };
+
+	for (int32_t i = 0; i < 16; ++i)
+	{
+		for (int32_t c = 0; c < 3; ++c)
+			mean[c] += rgba[i * 4 + c] / 16.0f;
+	}
+
+	// Covariance...
+	float cov[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+
+	for (int32_t i = 0; i < 16; ++i)
+	{
+		float r = rgba[i * 4 + 0] - mean[0];
+		float g = rgba[i * 4 + 1] - mean[1];
+		float b = rgba[i * 4 + 2] - mean[2];
+		cov[0] += r * r;
+		cov[1] += r * g;
+		cov[2] += r * b;
+		cov[3] += g * g;
+		cov[4] += g * b;
+		cov[5] += b * b;
+	}
+
+	// Principal axis by power iteration.
+	float axis[3] = { 0.9f, 1.0f, 0.7f };
+
+	for (int32_t iter = 0; iter < 8; ++iter)
+	{
+		float x = axis[0] * cov[0] + axis[1] * cov[1] + axis[2] * cov[2];
+		float y = axis[0] * cov[1] + axis[1] * cov[3] + axis[2] * cov[4];
+		float z = axis[0] * cov[2] + axis[1] * cov[4] + axis[2] * cov[5];
+		float len = std::max(std::max(std::abs(x), std::abs(y)), std::abs(z));
+
+		if (len < 1e-6f)
+			break;
+
+		axis[0] = x / len;
+		axis[1] = y / len;
+		axis[2] = z / len;
+	}
+
+	float axisLen2 = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+	float minT = 0.0f, maxT = 0.0f;
+
+	for (int32_t i = 0; i < 16; ++i)
+	{
+		float t = (rgba[i * 4 + 0] - mean[0]) * axis[0] + (rgba[i * 4 + 1] - mean[1]) * axis[1]
+			+ (rgba[i * 4 + 2] - mean[2]) * axis[2];
+
+		minT = std::min(minT, t);
+		maxT = std::max(maxT, t);
+	}
+
+	float color0[3], color1[3];
+
+	for (int32_t c = 0; c < 3; ++c)
+	{
+		color0[c] = mean[c] + axis[c] * maxT / axisLen2;
+		color1[c] = mean[c] + axis[c] * minT / axisLen2;
+	}
+
+	uint16_t c0 = BCTo565(color0);
+	uint16_t c1 = BCTo565(color1);
+
+	int32_t palette[4][3];
+	uint8_t indices[16];
+	BCBuildPalette(c0, c1, palette);
+	int32_t error = BCPickIndices(rgba, palette, indices);
+
+	// Refine...
+	for (int32_t pass = 0; pass < BC1_REFINE_PASSES && error > 0; ++pass)
+	{
+		if (!BCRefineEndpoints(rgba, indices, color0, color1))
+			break;
+
+		uint16_t r0 = BCTo565(color0);
+		uint16_t r1 = BCTo565(color1);
+		uint8_t rindices[16];
+
+		BCBuildPalette(r0, r1, palette);
+		int32_t rerror = BCPickIndices(rgba, palette, rindices);
+
+		if (rerror >= error)
+			break;
+
+		c0 = r0;
+		c1 = r1;
+		error = rerror;
+		memcpy(indices, rindices, 16);
+	}
+
+	BCWriteColorBlock(c0, c1, indices, outBlock);
+}
+
+
+// Compress a single channel of a block, 8 values interpolated between the channel min & max.
+static void BCCompressChannelBlock(const uint8_t* rgba, int32_t channel, uint8_t* outBlock)
+{
+	int32_t minValue = 255, maxValue = 0;
+
+	for (int32_t i = 0; i < 16; ++i)
+	{
+		minValue = std::min(minValue, (int32_t)rgba[i * 4 + channel]);
+		maxValue = std::max(maxValue, (int32_t)rgba[i * 4 + channel]);
+	}
+
+	uint64_t bits = 0;
+
+	if (maxValue != minValue)
+	{
+		int32_t range = maxValue - minValue;
+
+		for (int32_t i = 0; i < 16; ++i)
+		{
+			// Position from min to max, index 0 is max, 1 is min & 2-7 are interpolated from max to min.
+			int32_t pos = ((rgba[i * 4 + channel] - minValue) * 14 + range) / (range * 2);
+			uint64_t index = pos == 7 ? 0 : pos == 0 ? 1 : (uint64_t)(8 - pos);
+			bits |= index << (i * 3);
+		}
+	}
+
+	outBlock[0] = (uint8_t)maxValue;
+	outBlock[1] = (uint8_t)minValue;
+
+	for (int32_t i = 0; i < 6; ++i)
+		outBlock[2 + i] = (uint8_t)(bits >> (i * 8));
+}
+
+
+// Decompress a single channel block.
+static void BCDecompressChannelBlock(const uint8_t* block, int32_t channel, uint8_t* outRGBA)
+{
+	int32_t a0 = block[0];
+	int32_t a1 = block[1];
+	int32_t values[8] = { a0, a1 };
+
+	if (a0 > a1)
+	{
+		for (int32_t k = 2; k < 8; ++k)
+			values[k] = ((8 - k) * a0 + (k - 1) * a1) / 7;
+	}
+	else
+	{
+		for (int32_t k = 2; k < 6; ++k)
+			values[k] = ((6 - k) * a0 + (k - 1) * a1) / 5;
+
+		values[6] = 0;
+		values[7] = 255;
+	}
+
+	uint64_t bits = 0;
+
+	for (int32_t i = 0; i < 6; ++i)
+		bits |= (uint64_t)block[2 + i] << (i * 8);
+
+	for (int32_t i = 0; i < 16; ++i)
+		outRGBA[i * 4 + channel] = (uint8_t)values[(bits >> (i * 3)) & 7];
+}
+
+
+// Decompress a color block, isBC1 allows the 3 colors & transparent mode.
+static void BCDecompressColorBlock(const uint8_t* block, bool isBC1, uint8_t* outRGBA)
+{
+	uint16_t c0 = (uint16_t)(block[0] | (block[1] << 8));
+	uint16_t c1 = (uint16_t)(block[2] | (block[3] << 8));
+	int32_t palette[4][4];
+
+	BCFrom565(c0, palette[0]);
+	BCFrom565(c1, palette[1]);
+	palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+
+	for (int32_t i = 0; i < 3; ++i)
+	{
+		if (c0 > c1 || !isBC1)
+		{
+			palette[2][i] = (2 * palette[0][i] + palette[1][i]) / 3;
+			palette[3][i] = (palette[0][i] + 2 * palette[1][i]) / 3;
+		}
+		else
+		{
+			palette[2][i] = (palette[0][i] + palette[1][i]) / 2;
+			palette[3][i] = 0;
+		}
+	}
+
+	if (c0 <= c1 && isBC1)
+		palette[3][3] = 0;
+
+	uint32_t bits = 0;
+	memcpy(&bits, block + 4, 4);
+
+	for (int32_t i = 0; i < 16; ++i)
+	{
+		const int32_t* color = palette[(bits >> (i * 2)) & 3];
+
+		for (int32_t c = 0; c < 4; ++c)
+			outRGBA[i * 4 + c] = (uint8_t)color[c];
+	}
+}
+
+
+// Return the number of channels compared for a block format.
+static int32_t BCGetCompareChannels(EImageFormat format)
+{
+	switch (format)
+	{
+	case EImageFormat::BC1: return 3;
+	case EImageFormat::BC3: return 4;
+	case EImageFormat::BC5: return 2;
+	default: return 0;
+	}
+}
+
+
+// Copy the 4x4 block at x, y of an image, the pixels outside of the image are clamped to its edge.
+static void BCLoadBlock(const uint8_t* rgba, const glm::ivec2& size, int32_t x, int32_t y, uint8_t* outBlock)
+{
+	for (int32_t by = 0; by < 4; ++by)
+	{
+		int32_t py = std::min(y + by, size.y - 1);
+
+		for (int32_t bx = 0; bx < 4; ++bx)
+		{
+			int32_t px = std::min(x + bx, size.x - 1);
+			memcpy(outBlock + (by * 4 + bx) * 4, rgba + (py * size.x + px) * 4, 4);
+		}
+	}
+}
+
+
+
+// --- -- - -- --- --- -- - -- --- --- -- - -- --- --- -- - -- --- --- -- - -- --- ---
+
+
+
+
+void BCCompressBlock(EImageFormat format, const uint8_t* rgba, uint8_t* outBlock)
+{
+	switch (format)
+	{
+	case EImageFormat::BC1:
+		BCCompressColorBlock(rgba, outBlock);
+		break;
+
+	case EImageFormat::BC3:
+		BCCompressChannelBlock(rgba, 3, outBlock);
+		BCCompressColorBlock(rgba, outBlock + BC_HALF_BLOCK_SIZE);
+		break;
+
+	case EImageFormat::BC5:
+		BCCompressChannelBlock(rgba, 0, outBlock);
+		BCCompressChannelBlock(rgba, 1, outBlock + BC_HALF_BLOCK_SIZE);
+		break;
+
+	default:
+		CHECK(0 && "Unsupported Format.");
+		break;
+	}
+}
+
+
+void BCDecompressBlock(EImageFormat format, const uint8_t* block, uint8_t* outRGBA)
+{
+	switch (format)
+	{
+	case EImageFormat::BC1:
+		BCDecompressColorBlock(block, true, outRGBA);
+		break;
+
+	case EImageFormat::BC3:
+		BCDecompressColorBlock(block + BC_HALF_BLOCK_SIZE, false, outRGBA);
+		BCDecompressChannelBlock(block, 3, outRGBA);
+		break;
+
+	case EImageFormat::BC5:
+		memset(outRGBA, 0, 64);
+		BCDecompressChannelBlock(block, 0, outRGBA);
+		BCDecompressChannelBlock(block + BC_HALF_BLOCK_SIZE, 1, outRGBA);
+
+		for (int32_t i = 0; i < 16; ++i)
+			outRGBA[i * 4 + 3] = 255;
+
+		break;
+
+	default:
+		CHECK(0 && "Unsupported Format.");
+		break;
+	}
+}
+
+
+void BCCompressMipChain(EImageFormat format, const glm::ivec2& size, uint32_t numMips, const uint8_t* src, uint8_t* dst)
+{
+	uint32_t srcOffsets[IMAGE2D_MAX_MIPS];
+	uint32_t dstOffsets[IMAGE2D_MAX_MIPS];
+	Image2D::ComputeMipChain(EImageFormat::RGBA, size, numMips, srcOffsets);
+	Image2D::ComputeMipChain(format, size, numMips, dstOffsets);
+
+	uint32_t blockSize = GetImgBlockSize(format);
+	uint8_t pixels[64];
+
+	for (uint32_t i = 0; i < numMips; ++i)
+	{
+		glm::ivec2 mipSize(std::max(size.x >> i, 1), std::max(size.y >> i, 1));
+		uint8_t* block = dst + dstOffsets[i];
+
+		for (int32_t y = 0; y < mipSize.y; y += 4)
+		{
+			for (int32_t x = 0; x < mipSize.x; x += 4)
+			{
+				BCLoadBlock(src + srcOffsets[i], mipSize, x, y, pixels);
+				BCCompressBlock(format, pixels, block);
+				block += blockSize;
+			}
+		}
+	}
+}
+
+
+void BCDecompressMipChain(EImageFormat format, const glm::ivec2& size, uint32_t numMips, const uint8_t* src, uint8_t* dst)
+{
+	uint32_t srcOffsets[IMAGE2D_MAX_MIPS];
+	uint32_t dstOffsets[IMAGE2D_MAX_MIPS];
+	Image2D::ComputeMipChain(format, size, numMips, srcOffsets);
+	Image2D::ComputeMipChain(EImageFormat::RGBA, size, numMips, dstOffsets);
+
+	uint32_t blockSize = GetImgBlockSize(format);
+	uint8_t pixels[64];
+
+	for (uint32_t i = 0; i < numMips; ++i)
+	{
+		glm::ivec2 mipSize(std::max(size.x >> i, 1), std::max(size.y >> i, 1));
+		const uint8_t* block = src + srcOffsets[i];
+		uint8_t* mip = dst + dstOffsets[i];
+
+		for (int32_t y = 0; y < mipSize.y; y += 4)
+		{
+			for (int32_t x = 0; x < mipSize.x; x += 4)
+			{
+				BCDecompressBlock(format, block, pixels);
+				block += blockSize;
+
+				// Write the pixels inside the mip.
+				for (int32_t by = 0; by < 4 && y + by < mipSize.y; ++by)
+				{
+					int32_t width = std::min(4, mipSize.x - x);
+					memcpy(mip + ((y + by) * mipSize.x + x) * 4, pixels + by * 16, width * 4);
+				}
+			}
+		}
+	}
+}
+
+
+float BCComputePSNR(EImageFormat format, const glm::ivec2& size, const uint8_t* rgba, const uint8_t* blocks)
+{
+	int32_t numChannels = BCGetCompareChannels(format);
+	uint32_t blockSize = GetImgBlockSize(format);
+	uint8_t pixels[64];
+	double error = 0.0;
+
+	for (int32_t y = 0; y < size.y; y += 4)
+	{
+		for (int32_t x = 0; x < size.x; x += 4)
+		{
+			BCDecompressBlock(format, blocks, pixels);
+			blocks += blockSize;
+
+			for (int32_t by = 0; by < 4 && y + by < size.y; ++by)
+			{
+				for (int32_t bx = 0; bx < 4 && x + bx < size.x; ++bx)
+				{
+					const uint8_t* a = rgba + ((y + by) * size.x + x + bx) * 4;
+					const uint8_t* b = pixels + (by * 4 + bx) * 4;
+
+					for (int32_t c = 0; c < numChannels; ++c)
+						error += (double)((a[c] - b[c]) * (a[c] - b[c]));
+				}
+			}
+		}
+	}
+
+	double mse = error / ((double)size.x * size.y * numChannels);
+
+	if (mse <= 0.0)
+		return 100.0f;
+
+	return (float)(10.0 * std::log10(255.0 * 255.0 / mse));
+}
+
@@ -0,0 +1,48 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#pragma once
+
+
+#include "Core.h"
+#include "Image2D.h"
+
+
+
+
+
+// Compress a block of 4x4 RGBA pixels.
+//    - BC1 keeps the colors, BC3 the colors & alpha, BC5 the red & green channels.
+void BCCompressBlock(EImageFormat format, const uint8_t* rgba, uint8_t* outBlock);
+
+// Decompress a block into 4x4 RGBA pixels, the channels not kept by the format are opaque black.
+void BCDecompressBlock(EImageFormat format, const uint8_t* block, uint8_t* outRGBA);
+
+// Compress an RGBA mip chain into a block compressed one, both laid out as Image2D::ComputeMipChain does.
+void BCCompressMipChain(EImageFormat format, const glm::ivec2& size, uint32_t numMips, const uint8_t* src, uint8_t* dst);
+
+// Decompress a block compressed mip chain into an RGBA one.
+void BCDecompressMipChain(EImageFormat format, const glm::ivec2& size, uint32_t numMips, const uint8_t* src, uint8_t* dst);
+
+// Return the PSNR in dB of a compressed image against its RGBA source, only the channels kept by the format are compared.
+float BCComputePSNR(EImageFormat format, const glm::ivec2& size, const uint8_t* rgba, const uint8_t* blocks);
+
@@ -26,6 +26,8 @@
 
 #include "Core.h"
 #include "glm/vec3.hpp"
+#include "glm/vec4.hpp"
+#include "glm/mat4x4.hpp"
 #include "glm/common.hpp"
 
 
@@ -93,6 +95,23 @@ public:
 	// Return the box maximum point.
 	inline const glm::vec3& GetMax() const { return mMax; }
 
+	// Return a box that bounds this box after transforming it by a matrix.
+	inline Box Transform(const glm::mat4& mtx) const
+	{
+		Box box;
+
+		if (!mValid)
+			return box;
+
+		for (uint32_t i = 0; i < 8; ++i)
+		{
+			glm::vec3 p((i & 1) ? mMax.x : mMin.x, (i & 2) ? mMax.y : mMin.y, (i & 4) ? mMax.z : mMin.z);
+			box.Add(glm::vec3(mtx * glm::vec4(p, 1.0f)));
+		}
+
+		return box;
+	}
+
 	// Reset Box to invalid.
 	inline void Reset()
 	{
@@ -27,6 +27,8 @@
 
 #if BUILD_WIN
 #include "Windows.h"
+#else
+#include <sys/stat.h>
 #endif
 
 
@@ -106,6 +108,31 @@ std::string GISystem::GetDirectory(const std::string& file)
 }
 
 
+bool GISystem::GetFileInfo(const std::string& file, uint64_t& outSize, uint64_t& outTime)
+{
+#if BUILD_WIN
+	WIN32_FILE_ATTRIBUTE_DATA info;
+
+	if (!GetFileAttributesExA(file.c_str(), GetFileExInfoStandard, &info)
+		|| (info.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+		return false;
+
+	outSize = ((uint64_t)info.nFileSizeHigh << 32) | (uint64_t)info.nFileSizeLow;
+	outTime = ((uint64_t)info.ftLastWriteTime.dwHighDateTime << 32) | (uint64_t)info.ftLastWriteTime.dwLowDateTime;
+#else
+	struct stat info;
+
+	if (stat(file.c_str(), &info) != 0 || !S_ISREG(info.st_mode))
+		return false;
+
+	outSize = (uint64_t)info.st_size;
+	outTime = (uint64_t)info.st_mtim.tv_sec * 1000000000ull + (uint64_t)info.st_mtim.tv_nsec;
+#endif
+
+	return true;
+}
+
+
 void GISystem::Sleep(uint64_t ms)
 {
 	::Sleep(ms);
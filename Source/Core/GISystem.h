@@ -48,6 +48,10 @@ public:
 	// Return directory form file path.
 	static std::string GetDirectory(const std::string& file);
 
+	// Get the size & last write time of a file, return false if it doesn't exist. The time is only comparable
+	// to other times returned by this function.
+	static bool GetFileInfo(const std::string& file, uint64_t& outSize, uint64_t& outTime);
+
 	// Sleep.
 	static void Sleep(uint64_t ms);
 };
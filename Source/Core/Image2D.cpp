@@ -38,6 +38,48 @@
 #include "stb_image.h"
 
 
+#include <cmath>
+#include <algorithm>
+
+
+
+
+
+// Lookup tables used to filter sRGB pixels in linear space.
+struct SRGBTables
+{
+	// sRGB byte to linear.
+	float toLinear[256];
+
+	// Linear quantized to 12 bits to sRGB byte.
+	uint8_t toSRGB[4096];
+
+	// Construct.
+	SRGBTables()
+	{
+		for (uint32_t i = 0; i < 256; ++i)
+		{
+			float c = (float)i / 255.0f;
+			toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+		}
+
+		for (uint32_t i = 0; i < 4096; ++i)
+		{
+			float l = (float)i / 4095.0f;
+			float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+			toSRGB[i] = (uint8_t)std::min(c * 255.0f + 0.5f, 255.0f);
+		}
+	}
+
+	// Return the tables, created the first time they are used.
+	static const SRGBTables& Get()
+	{
+		static SRGBTables tables;
+		return tables;
+	}
+};
+
+
 
 
 
@@ -57,6 +99,15 @@ void GetImgPixelInfo(EImageFormat format, int32_t& outBPP)
 		outBPP = 32;
 		break;
 
+	case EImageFormat::BC1:
+		outBPP = 4;
+		break;
+
+	case EImageFormat::BC3:
+	case EImageFormat::BC5:
+		outBPP = 8;
+		break;
+
 	default:
 		CHECK(0 && "Unsupported Format.");
 		break;
@@ -65,10 +116,28 @@ void GetImgPixelInfo(EImageFormat format, int32_t& outBPP)
 }
 
 
+uint32_t GetImgBlockSize(EImageFormat format)
+{
+	switch (format)
+	{
+	case EImageFormat::BC1:
+		return 8;
+
+	case EImageFormat::BC3:
+	case EImageFormat::BC5:
+		return 16;
+
+	default:
+		return 0;
+	}
+}
+
+
 Image2D::Image2D()
 	: mFormat(EImageFormat::None)
 	, mIsSRGB(true)
 	, mIsGenMips(false)
+	, mNumMips(1)
 {
 
 }
@@ -82,8 +151,10 @@ Image2D::~Image2D()
 
 void Image2D::Allocate(EImageFormat format, const glm::ivec2& size)
 {
+	CHECK(GetImgBlockSize(format) == 0 && "Block compressed images can't be allocated.");
 	mFormat = format;
 	mSize = size;
+	mNumMips = 1;
 
 	int32_t BPP = 0;
 	GetImgPixelInfo(format, BPP);
@@ -97,6 +168,7 @@ void Image2D::Reset()
 {
 	// Free data.
 	mData.Reset();
+	mNumMips = 1;
 
 
 }
@@ -115,19 +187,41 @@ bool Image2D::LoadImage(const std::string& imgFile)
 		return false;
 	}
 
-	mFormat = EImageFormat::RGBA;
+	AdoptPixels(pixels, glm::ivec2(imgWidth, imgHeight));
+	return true;
+}
+
 
-	// Allocate & Copy
-	Allocate(mFormat, glm::ivec2(imgWidth, imgHeight));
-	mData.CopyData(0, mData.GetSize(), pixels);
+bool Image2D::LoadImage(const uint8_t* fileData, uint32_t size)
+{
+	// Decode Image using stb...
+	int imgWidth, imgHeight, imgNumChannels;
+	stbi_uc* pixels = stbi_load_from_memory(fileData, (int)size, &imgWidth, &imgHeight, &imgNumChannels, STBI_rgb_alpha);
 
-	// Free Loaded Image.
-	stbi_image_free(pixels);
+	// Failed to Decode?
+	if (!pixels)
+	{
+		LOGE("Failed to decode image data(%d bytes)", size);
+		return false;
+	}
 
+	AdoptPixels(pixels, glm::ivec2(imgWidth, imgHeight));
 	return true;
 }
 
 
+void Image2D::AdoptPixels(uint8_t* pixels, const glm::ivec2& size)
+{
+	mFormat = EImageFormat::RGBA;
+	mSize = size;
+	mNumMips = 1;
+
+	// stb allocates with malloc, the pixels are kept as they are.
+	mData.Reset();
+	mData.Adopt(pixels, (uint32_t)(size.x * size.y * 4));
+}
+
+
 bool Image2D::SaveImage(const std::string& imgFile)
 {
 	CHECK(0 && "Not supported yet.");
@@ -135,6 +229,118 @@ bool Image2D::SaveImage(const std::string& imgFile)
 }
 
 
+void Image2D::WrapMipChain(EImageFormat format, const glm::ivec2& size, bool isSRGB, uint32_t numMips,
+	const uint8_t* data, uint32_t dataSize, const Ptr<void>& owner)
+{
+	CHECK(ComputeMipChain(format, size, numMips, nullptr) <= dataSize);
+
+	mFormat = format;
+	mSize = size;
+	mIsSRGB = isSRGB;
+	mIsGenMips = numMips > 1;
+	mNumMips = numMips;
+
+	mData.Reset();
+	mData.Wrap(data, dataSize, owner);
+}
+
+
+uint32_t Image2D::BuildMipChain(std::vector<uint8_t>& outChain) const
+{
+	CHECK(mData.IsValid() && mNumMips == 1);
+	CHECK((mFormat == EImageFormat::R || mFormat == EImageFormat::RGBA) && "Unsupported Format.");
+
+	uint32_t numMips = mIsGenMips ? GetMaxMips(mSize) : 1;
+	uint32_t offsets[IMAGE2D_MAX_MIPS];
+
+	outChain.resize(ComputeMipChain(mFormat, mSize, numMips, offsets));
+	memcpy(outChain.data(), mData.GetData(), mData.GetSize());
+
+	int32_t BPP = 0;
+	GetImgPixelInfo(mFormat, BPP);
+
+	// sRGB color channels are averaged in linear space, alpha is always linear.
+	const SRGBTables& tables = SRGBTables::Get();
+	int32_t numChannels = BPP >> 3;
+	int32_t numColors = !mIsSRGB ? 0 : (numChannels == 4 ? 3 : numChannels);
+
+	for (uint32_t i = 1; i < numMips; ++i)
+	{
+		glm::ivec2 srcSize(std::max(mSize.x >> (i - 1), 1), std::max(mSize.y >> (i - 1), 1));
+		glm::ivec2 dstSize(std::max(mSize.x >> i, 1), std::max(mSize.y >> i, 1));
+		const uint8_t* src = outChain.data() + offsets[i - 1];
+		uint8_t* dst = outChain.data() + offsets[i];
+
+		for (int32_t y = 0; y < dstSize.y; ++y)
+		{
+			// Odd sizes clamp the last row & column.
+			const uint8_t* row0 = src + std::min(y * 2, srcSize.y - 1) * srcSize.x * numChannels;
+			const uint8_t* row1 = src + std::min(y * 2 + 1, srcSize.y - 1) * srcSize.x * numChannels;
+
+			for (int32_t x = 0; x < dstSize.x; ++x)
+			{
+				int32_t x0 = std::min(x * 2, srcSize.x - 1) * numChannels;
+				int32_t x1 = std::min(x * 2 + 1, srcSize.x - 1) * numChannels;
+
+				for (int32_t c = 0; c < numChannels; ++c)
+				{
+					if (c < numColors)
+					{
+						float l = (tables.toLinear[row0[x0 + c]] + tables.toLinear[row0[x1 + c]]
+							+ tables.toLinear[row1[x0 + c]] + tables.toLinear[row1[x1 + c]]) * 0.25f;
+
+						*dst++ = tables.toSRGB[(uint32_t)(l * 4095.0f + 0.5f)];
+					}
+					else
+					{
+						*dst++ = (uint8_t)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+					}
+				}
+			}
+		}
+	}
+
+	return numMips;
+}
+
+
+uint32_t Image2D::ComputeMipChain(EImageFormat format, const glm::ivec2& size, uint32_t numMips, uint32_t* outOffsets)
+{
+	CHECK(numMips > 0 && numMips <= IMAGE2D_MAX_MIPS);
+
+	int32_t BPP = 0;
+	GetImgPixelInfo(format, BPP);
+	uint32_t blockSize = GetImgBlockSize(format);
+
+	uint32_t offset = 0;
+
+	for (uint32_t i = 0; i < numMips; ++i)
+	{
+		// Buffer to image copies need 4 bytes aligned offsets, block sizes keep blocks aligned.
+		offset = ALIGN_SIZE(offset, 4u);
+
+		if (outOffsets)
+			outOffsets[i] = offset;
+
+		uint32_t width = (uint32_t)std::max(size.x >> i, 1);
+		uint32_t height = (uint32_t)std::max(size.y >> i, 1);
+
+		if (blockSize != 0)
+			offset += blockSize * ((width + 3) / 4) * ((height + 3) / 4);
+		else
+			offset += (uint32_t)(BPP >> 3) * width * height;
+	}
+
+	return offset;
+}
+
+
+uint32_t Image2D::GetMaxMips(const glm::ivec2& size)
+{
+	return static_cast<uint32_t>(std::floor(std::log2(std::max(size.x, size.y)))) + 1;
+}
+
+
 void Image2D::UpdateRenderImage()
 {
 	mRenderImage = UniquePtr<RenderImage>(new RenderImage());
@@ -32,6 +32,7 @@
 
 
 #include <string>
+#include <vector>
 
 
 
@@ -41,6 +42,11 @@ class RenderImage;
 
 
 
+// The max number of mips in an image mip chain.
+#define IMAGE2D_MAX_MIPS 16
+
+
+
 
 
 
@@ -53,7 +59,12 @@ enum class EImageFormat : uint32_t
 	//
 	R,
 	RGB,
-	RGBA
+	RGBA,
+
+	// Block compressed 4x4 blocks, BC1 opaque colors, BC3 colors & alpha, BC5 red & green.
+	BC1,
+	BC3,
+	BC5
 };
 
 
@@ -61,6 +72,9 @@ enum class EImageFormat : uint32_t
 // Return the pixel info associated with image format.
 extern void GetImgPixelInfo(EImageFormat format, int32_t& outBPP);
 
+// Return the size in bytes of a 4x4 block of a block compressed format, zero for other formats.
+extern uint32_t GetImgBlockSize(EImageFormat format);
+
 
 
 
@@ -74,6 +88,7 @@ public:
 	Image2DData()
 		: mData(nullptr)
 		, mSize(0)
+		, mIsOwned(true)
 	{
 
 	}
@@ -81,7 +96,8 @@ public:
 	// Destruct.
 	~Image2DData()
 	{
-		free(mData);
+		if (mIsOwned)
+			free(mData);
 	}
 
 	// Allocate new image data.
@@ -93,6 +109,25 @@ public:
 		mData = (uint8_t*)malloc(size);
 	}
 
+	// Take ownership of data allocated with malloc, used to keep decoded images without a copy.
+	inline void Adopt(uint8_t* data, uint32_t size)
+	{
+		CHECK(mData == nullptr && "Trying to reallocate before data get freed.");
+		mSize = size;
+		mData = data;
+	}
+
+	// Reference data owned by someone else, it must stay valid while it is used.
+	// @param owner: optional owner of the data kept alive until the data is reset.
+	inline void Wrap(const uint8_t* data, uint32_t size, const Ptr<void>& owner = nullptr)
+	{
+		CHECK(mData == nullptr && "Trying to reallocate before data get freed.");
+		mSize = size;
+		mData = const_cast<uint8_t*>(data);
+		mOwner = owner;
+		mIsOwned = false;
+	}
+
 	// Copy data into this image data.
 	void CopyData(uint32_t offset, uint32_t size, uint8_t* src)
 	{
@@ -103,7 +138,13 @@ public:
 	inline void Reset()
 	{
 		mSize = 0;
-		free(mData);
+
+		if (mIsOwned)
+			free(mData);
+
+		mData = nullptr;
+		mOwner.reset();
+		mIsOwned = true;
 	}
 
 	// Return the image data.
@@ -122,6 +163,12 @@ private:
 
 	// Size in bytes.
 	uint32_t mSize;
+
+	// The owner of referenced data, if any.
+	Ptr<void> mOwner;
+
+	// False if the data is only referenced & not freed by us.
+	bool mIsOwned;
 };
 
 
@@ -148,11 +195,14 @@ public:
 	// Load image from file.
 	bool LoadImage(const std::string& imgFile);
 
+	// Load image from encoded file data in memory (png, jpeg...).
+	bool LoadImage(const uint8_t* fileData, uint32_t size);
+
 	// Save image to a file.
 	bool SaveImage(const std::string& imgFile);
 
 	// Return the image size.
-	inline const glm::ivec2& GetSize() { return mSize; }
+	inline const glm::ivec2& GetSize() const { return mSize; }
 	
 	// Create/Update render mesh data.
 	void UpdateRenderImage();
@@ -174,6 +224,28 @@ public:
 	inline void SetGenMips(bool value) { mIsGenMips = value; }
 	inline bool IsGenMips() const { return mIsGenMips; }
 
+	// Return the number of mips stored in the image data, more than one if it has a precomputed mip chain.
+	inline uint32_t GetNumMips() const { return mNumMips; }
+
+	// Reference a precomputed mip chain owned by someone else, laid out as ComputeMipChain does.
+	// The chain must stay valid while the image exists, its render image streams the mips from it.
+	void WrapMipChain(EImageFormat format, const glm::ivec2& size, bool isSRGB, uint32_t numMips,
+		const uint8_t* data, uint32_t dataSize, const Ptr<void>& owner = nullptr);
+
+	// Build the full mip chain of the image data on the cpu with a box filter, in linear space for sRGB images.
+	// @return the number of mips in the chain.
+	uint32_t BuildMipChain(std::vector<uint8_t>& outChain) const;
+
+	// Return the offset of each mip in a mip chain & its total size, each mip start is 4 bytes aligned.
+	static uint32_t ComputeMipChain(EImageFormat format, const glm::ivec2& size, uint32_t numMips, uint32_t* outOffsets);
+
+	// Return the number of mips of a full mip chain.
+	static uint32_t GetMaxMips(const glm::ivec2& size);
+
+private:
+	// Take ownership of decoded RGBA pixels.
+	void AdoptPixels(uint8_t* pixels, const glm::ivec2& size);
+
 private:
 	// The image size.
 	glm::ivec2 mSize;
@@ -192,5 +264,8 @@ private:
 
 	// if true will generate mipmaps for this image.
 	bool mIsGenMips;
+
+	// The number of mips in the image data.
+	uint32_t mNumMips;
 };
 
@@ -0,0 +1,156 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+
+
+
+#include "MappedFile.h"
+
+
+
+#if BUILD_WIN
+#include "Windows.h"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+
+
+
+
+MappedFile::MappedFile()
+	: mData(nullptr)
+	, mSize(0)
+#if BUILD_WIN
+	, mFile(INVALID_HANDLE_VALUE)
+	, mMapping(nullptr)
+#else
+	, mFile(-1)
+#endif
+{
+
+}
+
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+
+bool MappedFile::Open(const std::string& file)
+{
+	Close();
+
+#if BUILD_WIN
+	mFile = CreateFileA(file.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+	if (mFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(mFile, &fileSize) || fileSize.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+
+	mMapping = CreateFileMappingA(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	if (!mMapping)
+	{
+		Close();
+		return false;
+	}
+
+	mData = (const uint8_t*)MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0);
+	mSize = (size_t)fileSize.QuadPart;
+#else
+	mFile = open(file.c_str(), O_RDONLY);
+
+	if (mFile < 0)
+		return false;
+
+	struct stat fileStat;
+	if (fstat(mFile, &fileStat) != 0 || fileStat.st_size == 0)
+	{
+		Close();
+		return false;
+	}
+
+	void* data = mmap(nullptr, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, mFile, 0);
+
+	if (data == MAP_FAILED)
+	{
+		Close();
+		return false;
+	}
+
+	// Mostly read front to back by the importers.
+	madvise(data, (size_t)fileStat.st_size, MADV_SEQUENTIAL);
+
+	mData = (const uint8_t*)data;
+	mSize = (size_t)fileStat.st_size;
+#endif
+
+	if (!mData)
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+
+void MappedFile::Close()
+{
+#if BUILD_WIN
+	if (mData)
+		UnmapViewOfFile(mData);
+
+	if (mMapping)
+		CloseHandle(mMapping);
+
+	if (mFile != INVALID_HANDLE_VALUE)
+		CloseHandle(mFile);
+
+	mMapping = nullptr;
+	mFile = INVALID_HANDLE_VALUE;
+#else
+	if (mData)
+		munmap((void*)mData, mSize);
+
+	if (mFile >= 0)
+		close(mFile);
+
+	mFile = -1;
+#endif
+
+	mData = nullptr;
+	mSize = 0;
+}
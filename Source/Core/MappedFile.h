@@ -0,0 +1,80 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+
+
+
+#pragma once
+
+
+#include "Core.h"
+
+#include <string>
+
+
+
+
+
+// MappedFile:
+//    - a read-only view of a whole file mapped into memory, pages are loaded on access.
+//
+class MappedFile
+{
+public:
+	// Construct.
+	MappedFile();
+
+	// Destruct.
+	~MappedFile();
+
+	// Map the file, return false if it can't be opened or it is empty.
+	bool Open(const std::string& file);
+
+	// Unmap and close the file.
+	void Close();
+
+	// Return the mapped file data.
+	inline const uint8_t* GetData() const { return mData; }
+
+	// Return the file size in bytes.
+	inline size_t GetSize() const { return mSize; }
+
+	// Return true if the file is mapped.
+	inline bool IsOpen() const { return mData != nullptr; }
+
+private:
+	// The mapped file data.
+	const uint8_t* mData;
+
+	// The file size in bytes.
+	size_t mSize;
+
+#if BUILD_WIN
+	// The file & mapping handles.
+	void* mFile;
+	void* mMapping;
+#else
+	// The file descriptor.
+	int mFile;
+#endif
+};
+
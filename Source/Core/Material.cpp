@@ -119,5 +119,5 @@ void Material::UpdateRenderMaterial()
 	}
 
 
-	mRenderMaterial->Setup(&mData, rColorTex, rMetRoughTex);
+	mRenderMaterial->Setup(rColorTex, rMetRoughTex);
 }
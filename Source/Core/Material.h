@@ -85,6 +85,9 @@ public:
 	void SetRoughnessMetallic(Ptr<Image2D> img);
 	Ptr<Image2D> GetRoughnessMetallic();
 
+	// Return the material data.
+	inline const MaterialData& GetData() const { return mData; }
+
 	// Retrun true if the material is dirty and need updating.
 	inline bool IsDirty() const { return mIsDirty; }
 
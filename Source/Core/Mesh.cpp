@@ -32,6 +32,7 @@
 
 
 Mesh::Mesh()
+	: mUVDensity(0.0f)
 {
 
 }
@@ -45,6 +46,8 @@ Mesh::~Mesh()
 
 void Mesh::UpdateRenderMesh()
 {
+	mUVDensity = ComputeUVDensity();
+
 	if (!mRenderMesh)
 	{
 		mRenderMesh = UniquePtr<RenderMesh>(new RenderMesh());
@@ -57,6 +60,31 @@ void Mesh::UpdateRenderMesh()
 }
 
 
+float Mesh::ComputeUVDensity() const
+{
+	double worldArea = 0.0;
+	double uvArea = 0.0;
+
+	for (size_t i = 0; i + 2 < mIndices.size(); i += 3)
+	{
+		const MeshVert& v0 = mVertices[mIndices[i + 0]];
+		const MeshVert& v1 = mVertices[mIndices[i + 1]];
+		const MeshVert& v2 = mVertices[mIndices[i + 2]];
+
+		worldArea += glm::length(glm::cross(v1.position - v0.position, v2.position - v0.position));
+
+		glm::vec2 e0 = v1.texCoord - v0.texCoord;
+		glm::vec2 e1 = v2.texCoord - v0.texCoord;
+		uvArea += fabsf(e0.x * e1.y - e0.y * e1.x);
+	}
+
+	if (worldArea <= 0.0 || uvArea <= 0.0)
+		return 0.0f;
+
+	return (float)sqrt(uvArea / worldArea);
+}
+
+
 Mesh* Mesh::MakeSphere(uint32_t seg, float radius)
 {
 	float H_SEG = static_cast<float>(seg);
@@ -83,6 +83,9 @@ public:
 	inline Box& GetBounds() { return mBounds; }
 	inline const Box& GetBounds() const { return mBounds; }
 
+	// Return the texture coordinates per world unit of the mesh surface, computed by UpdateRenderMesh.
+	inline float GetUVDensity() const { return mUVDensity; }
+
 	// Create/Update render mesh data.
 	void UpdateRenderMesh();
 
@@ -97,6 +100,10 @@ public:
 	// Create Box Mesh.
 	static Mesh* MakeBox();
 
+private:
+	// Compute the texture coordinates per world unit from the area of the triangles in both spaces.
+	float ComputeUVDensity() const;
+
 private:
 	// Mesh Vertices.
 	std::vector<MeshVert> mVertices;
@@ -107,6 +114,9 @@ private:
 	// Mesh Bounds.
 	Box mBounds;
 
+	// Texture coordinates per world unit, zero if unknown.
+	float mUVDensity;
+
 	// The render data for this mesh.
 	Ptr<RenderMesh> mRenderMesh;
 };
@@ -0,0 +1,448 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#include "OcclusionRasterizer.h"
+#include "Mesh.h"
+#include "Transform.h"
+
+
+#include <emmintrin.h>
+#include <cfloat>
+#include <chrono>
+#include <algorithm>
+#include <random>
+
+
+
+#define RASTER_SMALL_NUM 0.000001f
+
+// The benchmark scene, same depth buffer size as the renderer.
+#define RASTER_BENCH_WIDTH 256
+#define RASTER_BENCH_HEIGHT 128
+#define RASTER_BENCH_NUM_OCCLUDERS 512
+#define RASTER_BENCH_NUM_TESTS 4096
+
+
+
+
+// Return the current time in milliseconds.
+static double GetTimeMS()
+{
+	using namespace std::chrono;
+	return duration<double, std::milli>(high_resolution_clock::now().time_since_epoch()).count();
+}
+
+
+
+
+
+OcclusionRasterizer::OcclusionRasterizer()
+	: mWidth(0)
+	, mHeight(0)
+	, mTilesX(0)
+	, mTilesY(0)
+	, mViewProj(1.0f)
+	, mStepTime(0.0)
+{
+	mStats = OcclusionRasterizerStats{};
+}
+
+
+OcclusionRasterizer::~OcclusionRasterizer()
+{
+
+}
+
+
+void OcclusionRasterizer::Initialize(uint32_t width, uint32_t height)
+{
+	mTilesX = (std::max(width, 1u) + TILE_SIZE - 1) / TILE_SIZE;
+	mTilesY = (std::max(height, 1u) + TILE_SIZE - 1) / TILE_SIZE;
+	mWidth = mTilesX * TILE_SIZE;
+	mHeight = mTilesY * TILE_SIZE;
+
+	mDepth.resize(mWidth * mHeight, 1.0f);
+	mTileDepth.resize(mTilesX * mTilesY, 1.0f);
+}
+
+
+void OcclusionRasterizer::Begin(const glm::mat4& viewProj)
+{
+	CHECK(mWidth != 0 && "Rasterizer not initialized.");
+
+	mViewProj = viewProj;
+	mStats = OcclusionRasterizerStats{};
+	mStepTime = GetTimeMS();
+
+	std::fill(mDepth.begin(), mDepth.end(), 1.0f);
+	std::fill(mTileDepth.begin(), mTileDepth.end(), 1.0f);
+}
+
+
+void OcclusionRasterizer::RenderOccluder(const Mesh* mesh, const glm::mat4& transform)
+{
+	const std::vector<MeshVert>& verts = mesh->GetVertices();
+	const std::vector<uint32_t>& indices = mesh->GetIndices();
+
+	if (verts.empty() || indices.empty())
+		return;
+
+	RenderTriangles(&verts[0].position, sizeof(MeshVert), indices.data(), (uint32_t)indices.size(), transform);
+	++mStats.numOccluders;
+}
+
+
+void OcclusionRasterizer::RenderTriangles(const glm::vec3* positions, uint32_t stride,
+	const uint32_t* indices, uint32_t numIndices, const glm::mat4& transform)
+{
+	// The number of vertices referenced by the indices.
+	uint32_t numVerts = 0;
+
+	for (uint32_t i = 0; i < numIndices; ++i)
+		numVerts = std::max(numVerts, indices[i] + 1);
+
+	// Transform to clip space once for all triangles.
+	mClipVerts.resize(numVerts);
+	glm::mat4 mvp = mViewProj * transform;
+	const uint8_t* data = reinterpret_cast<const uint8_t*>(positions);
+
+	for (uint32_t i = 0; i < numVerts; ++i)
+	{
+		const glm::vec3& p = *reinterpret_cast<const glm::vec3*>(data + (size_t)i * stride);
+		mClipVerts[i] = mvp * glm::vec4(p, 1.0f);
+	}
+
+
+	const glm::vec2 size((float)mWidth, (float)mHeight);
+
+	for (uint32_t i = 0; i + 2 < numIndices; i += 3)
+	{
+		const glm::vec4& c0 = mClipVerts[indices[i + 0]];
+		const glm::vec4& c1 = mClipVerts[indices[i + 1]];
+		const glm::vec4& c2 = mClipVerts[indices[i + 2]];
+
+		// Skip triangles crossing the near plane, not rendering an occluder is always safe.
+		if (c0.w <= RASTER_SMALL_NUM || c1.w <= RASTER_SMALL_NUM || c2.w <= RASTER_SMALL_NUM
+			|| c0.z < 0.0f || c1.z < 0.0f || c2.z < 0.0f)
+			continue;
+
+		glm::vec3 v[3];
+		const glm::vec4* c[3] = { &c0, &c1, &c2 };
+
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			glm::vec3 ndc = glm::vec3(*c[k]) / c[k]->w;
+			v[k] = glm::vec3((glm::vec2(ndc) * 0.5f + 0.5f) * size, ndc.z);
+		}
+
+		RasterizeTriangle(v[0], v[1], v[2]);
+	}
+}
+
+
+void OcclusionRasterizer::RasterizeTriangle(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2)
+{
+	float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+
+	if (std::abs(area) < RASTER_SMALL_NUM)
+		return;
+
+	// Both sides of occluders are rendered, flip to keep a positive area.
+	glm::vec3 a = v0;
+	glm::vec3 b = area > 0.0f ? v1 : v2;
+	glm::vec3 c = area > 0.0f ? v2 : v1;
+	area = std::abs(area);
+
+
+	// Bounds clamped to the depth buffer, x aligned to 4 pixels.
+	int32_t minX = std::max((int32_t)std::floor(std::min(a.x, std::min(b.x, c.x))), 0) & ~3;
+	int32_t minY = std::max((int32_t)std::floor(std::min(a.y, std::min(b.y, c.y))), 0);
+	int32_t maxX = std::min((int32_t)std::ceil(std::max(a.x, std::max(b.x, c.x))), (int32_t)mWidth - 1);
+	int32_t maxY = std::min((int32_t)std::ceil(std::max(a.y, std::max(b.y, c.y))), (int32_t)mHeight - 1);
+
+	if (minX > maxX || minY > maxY)
+		return;
+
+	++mStats.numTriangles;
+
+
+	// Edge functions, E(x, y) = A * x + B * y + C, positive inside.
+	const glm::vec3* e[3][2] = { { &b, &c }, { &c, &a }, { &a, &b } };
+	float edgeA[3], edgeB[3], edgeC[3];
+
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		const glm::vec3& p0 = *e[i][0];
+		const glm::vec3& p1 = *e[i][1];
+		edgeA[i] = p0.y - p1.y;
+		edgeB[i] = p1.x - p0.x;
+		edgeC[i] = p0.x * p1.y - p0.y * p1.x;
+	}
+
+	// Depth plane from barycentrics, Z(x, y) = A * x + B * y + C.
+	float invArea = 1.0f / area;
+	float zA = (edgeA[1] * (b.z - a.z) + edgeA[2] * (c.z - a.z)) * invArea;
+	float zB = (edgeB[1] * (b.z - a.z) + edgeB[2] * (c.z - a.z)) * invArea;
+	float zC = a.z + (edgeC[1] * (b.z - a.z) + edgeC[2] * (c.z - a.z)) * invArea;
+
+
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 offsetX = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 eA0 = _mm_set1_ps(edgeA[0]), eA1 = _mm_set1_ps(edgeA[1]), eA2 = _mm_set1_ps(edgeA[2]);
+	const __m128 zAv = _mm_set1_ps(zA);
+
+	for (int32_t y = minY; y <= maxY; ++y)
+	{
+		float py = (float)y + 0.5f;
+		__m128 rowE0 = _mm_set1_ps(edgeB[0] * py + edgeC[0]);
+		__m128 rowE1 = _mm_set1_ps(edgeB[1] * py + edgeC[1]);
+		__m128 rowE2 = _mm_set1_ps(edgeB[2] * py + edgeC[2]);
+		__m128 rowZ = _mm_set1_ps(zB * py + zC);
+		float* row = mDepth.data() + (size_t)y * mWidth;
+
+		for (int32_t x = minX; x <= maxX; x += 4)
+		{
+			__m128 px = _mm_add_ps(_mm_set1_ps((float)x), offsetX);
+
+			// Coverage Mask...
+			__m128 e0 = _mm_add_ps(_mm_mul_ps(eA0, px), rowE0);
+			__m128 e1 = _mm_add_ps(_mm_mul_ps(eA1, px), rowE1);
+			__m128 e2 = _mm_add_ps(_mm_mul_ps(eA2, px), rowE2);
+			__m128 mask = _mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_and_ps(_mm_cmpge_ps(e1, zero), _mm_cmpge_ps(e2, zero)));
+
+			if (_mm_movemask_ps(mask) == 0)
+				continue;
+
+			// Depth Test...
+			__m128 z = _mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_mul_ps(zAv, px), rowZ), zero), one);
+			__m128 old = _mm_loadu_ps(row + x);
+			mask = _mm_and_ps(mask, _mm_cmplt_ps(z, old));
+
+			_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(mask, z), _mm_andnot_ps(mask, old)));
+		}
+	}
+}
+
+
+void OcclusionRasterizer::End()
+{
+	// Farthest depth of each tile...
+	for (uint32_t ty = 0; ty < mTilesY; ++ty)
+	{
+		for (uint32_t tx = 0; tx < mTilesX; ++tx)
+		{
+			__m128 tileMax = _mm_setzero_ps();
+
+			for (uint32_t y = 0; y < TILE_SIZE; ++y)
+			{
+				const float* row = mDepth.data() + (size_t)(ty * TILE_SIZE + y) * mWidth + tx * TILE_SIZE;
+				tileMax = _mm_max_ps(tileMax, _mm_max_ps(_mm_loadu_ps(row), _mm_loadu_ps(row + 4)));
+			}
+
+			tileMax = _mm_max_ps(tileMax, _mm_shuffle_ps(tileMax, tileMax, _MM_SHUFFLE(1, 0, 3, 2)));
+			tileMax = _mm_max_ps(tileMax, _mm_shuffle_ps(tileMax, tileMax, _MM_SHUFFLE(2, 3, 0, 1)));
+			_mm_store_ss(&mTileDepth[ty * mTilesX + tx], tileMax);
+		}
+	}
+
+	double time = GetTimeMS();
+	mStats.rasterTime = (float)(time - mStepTime);
+	mStepTime = time;
+}
+
+
+bool OcclusionRasterizer::TestBox(const Box& box)
+{
+	++mStats.numTested;
+
+	const glm::vec3& bmin = box.GetMin();
+	const glm::vec3& bmax = box.GetMax();
+
+	glm::vec2 rmin(FLT_MAX), rmax(-FLT_MAX);
+	float minZ = 1.0f;
+
+	for (uint32_t i = 0; i < 8; ++i)
+	{
+		glm::vec4 clip = mViewProj * glm::vec4((i & 1) ? bmax.x : bmin.x, (i & 2) ? bmax.y : bmin.y,
+			(i & 4) ? bmax.z : bmin.z, 1.0f);
+
+		// Crossing the near plane, visible.
+		if (clip.w <= RASTER_SMALL_NUM || clip.z < 0.0f)
+			return true;
+
+		glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		glm::vec2 p = (glm::vec2(ndc) * 0.5f + 0.5f) * glm::vec2((float)mWidth, (float)mHeight);
+		rmin = glm::min(rmin, p);
+		rmax = glm::max(rmax, p);
+		minZ = std::min(minZ, ndc.z);
+	}
+
+	// Outside the screen or behind the far plane.
+	if (rmax.x < 0.0f || rmax.y < 0.0f || rmin.x > (float)mWidth || rmin.y > (float)mHeight || minZ > 1.0f)
+	{
+		++mStats.numCulled;
+		return false;
+	}
+
+	int32_t x0 = std::max((int32_t)std::floor(rmin.x), 0);
+	int32_t y0 = std::max((int32_t)std::floor(rmin.y), 0);
+	int32_t x1 = std::min((int32_t)std::ceil(rmax.x), (int32_t)mWidth - 1);
+	int32_t y1 = std::min((int32_t)std::ceil(rmax.y), (int32_t)mHeight - 1);
+
+
+	// Test tiles first, then the pixels of the tiles that may pass.
+	for (int32_t ty = y0 / (int32_t)TILE_SIZE; ty <= y1 / (int32_t)TILE_SIZE; ++ty)
+	{
+		for (int32_t tx = x0 / (int32_t)TILE_SIZE; tx <= x1 / (int32_t)TILE_SIZE; ++tx)
+		{
+			if (minZ > mTileDepth[ty * mTilesX + tx])
+				continue;
+
+			int32_t tileX = tx * (int32_t)TILE_SIZE;
+			int32_t tileY = ty * (int32_t)TILE_SIZE;
+
+			if (TestRect(std::max(x0, tileX), std::max(y0, tileY),
+				std::min(x1, tileX + (int32_t)TILE_SIZE - 1), std::min(y1, tileY + (int32_t)TILE_SIZE - 1), minZ))
+				return true;
+		}
+	}
+
+	++mStats.numCulled;
+	return false;
+}
+
+
+bool OcclusionRasterizer::TestRect(int32_t x0, int32_t y0, int32_t x1, int32_t y1, float depth) const
+{
+	const __m128 z = _mm_set1_ps(depth);
+	const __m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+
+	for (int32_t y = y0; y <= y1; ++y)
+	{
+		const float* row = mDepth.data() + (size_t)y * mWidth;
+
+		for (int32_t x = x0 & ~3; x <= x1; x += 4)
+		{
+			// Mask pixels outside the rect.
+			__m128i px = _mm_add_epi32(_mm_set1_epi32(x), lanes);
+			__m128i inside = _mm_andnot_si128(_mm_cmplt_epi32(px, _mm_set1_epi32(x0)),
+				_mm_andnot_si128(_mm_cmpgt_epi32(px, _mm_set1_epi32(x1)), _mm_set1_epi32(-1)));
+
+			__m128 pass = _mm_and_ps(_mm_castsi128_ps(inside), _mm_cmpge_ps(_mm_loadu_ps(row + x), z));
+
+			if (_mm_movemask_ps(pass) != 0)
+				return true;
+		}
+	}
+
+	return false;
+}
+
+
+void OcclusionRasterizer::EndTests()
+{
+	double time = GetTimeMS();
+	mStats.testTime = (float)(time - mStepTime);
+	mStepTime = time;
+}
+
+
+OcclusionBenchmarkStats OcclusionRasterizer::Benchmark(uint32_t numFrames)
+{
+	OcclusionBenchmarkStats stats = OcclusionBenchmarkStats{};
+	stats.numFrames = std::max(numFrames, 1u);
+
+	// Unit cube occluder, 12 triangles.
+	const glm::vec3 cubeVerts[8] = {
+		glm::vec3(-1.0f, -1.0f, -1.0f), glm::vec3(1.0f, -1.0f, -1.0f), glm::vec3(-1.0f, 1.0f, -1.0f), glm::vec3(1.0f, 1.0f, -1.0f),
+		glm::vec3(-1.0f, -1.0f, 1.0f), glm::vec3(1.0f, -1.0f, 1.0f), glm::vec3(-1.0f, 1.0f, 1.0f), glm::vec3(1.0f, 1.0f, 1.0f)
+	};
+
+	const uint32_t cubeIndices[36] = {
+		0, 1, 3, 0, 3, 2,   4, 6, 7, 4, 7, 5,   0, 2, 6, 0, 6, 4,
+		1, 5, 7, 1, 7, 3,   0, 4, 5, 0, 5, 1,   2, 3, 7, 2, 7, 6
+	};
+
+	// Random occluders & test boxes in front of the camera, fixed seed to compare runs.
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> spread(-40.0f, 40.0f);
+	std::uniform_real_distribution<float> depth(5.0f, 150.0f);
+	std::uniform_real_distribution<float> size(0.5f, 4.0f);
+
+	std::vector<glm::mat4> occluders(RASTER_BENCH_NUM_OCCLUDERS);
+	std::vector<Box> boxes(RASTER_BENCH_NUM_TESTS);
+
+	for (glm::mat4& mtx : occluders)
+	{
+		glm::vec3 pos(spread(rng), spread(rng) * 0.25f, depth(rng));
+		glm::vec3 scale(size(rng), size(rng), size(rng));
+		mtx = glm::mat4(glm::vec4(scale.x, 0.0f, 0.0f, 0.0f), glm::vec4(0.0f, scale.y, 0.0f, 0.0f),
+			glm::vec4(0.0f, 0.0f, scale.z, 0.0f), glm::vec4(pos, 1.0f));
+	}
+
+	for (Box& box : boxes)
+	{
+		glm::vec3 pos(spread(rng), spread(rng) * 0.25f, depth(rng));
+		glm::vec3 extent = glm::vec3(size(rng)) * 0.5f;
+		box = Box(pos - extent, pos + extent);
+	}
+
+	glm::mat4 viewProj = Transform::Perspective(glm::radians(60.0f), 2.0f, 0.1f, 200.0f)
+		* Transform::LookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	OcclusionRasterizer rasterizer;
+	rasterizer.Initialize(RASTER_BENCH_WIDTH, RASTER_BENCH_HEIGHT);
+
+	for (uint32_t frame = 0; frame < stats.numFrames; ++frame)
+	{
+		rasterizer.Begin(viewProj);
+
+		for (const glm::mat4& mtx : occluders)
+			rasterizer.RenderTriangles(cubeVerts, sizeof(glm::vec3), cubeIndices, 36, mtx);
+
+		rasterizer.End();
+
+		for (const Box& box : boxes)
+			rasterizer.TestBox(box);
+
+		rasterizer.EndTests();
+
+		const OcclusionRasterizerStats& frameStats = rasterizer.GetStats();
+		stats.numTriangles = frameStats.numTriangles;
+		stats.numTested = frameStats.numTested;
+		stats.numCulled = frameStats.numCulled;
+		stats.rasterTime += frameStats.rasterTime;
+		stats.testTime += frameStats.testTime;
+	}
+
+	stats.numOccluders = RASTER_BENCH_NUM_OCCLUDERS;
+	stats.rasterTime /= (float)stats.numFrames;
+	stats.testTime /= (float)stats.numFrames;
+	stats.triangleRate = stats.rasterTime > 0.0f ? (float)stats.numTriangles / stats.rasterTime : 0.0f;
+
+	LOGI("Occlusion benchmark %dx%d, %d frames: raster %d occluders %d triangles %.3f ms (%.0f tris/ms), test %d boxes %d culled %.3f ms.",
+		RASTER_BENCH_WIDTH, RASTER_BENCH_HEIGHT, stats.numFrames, stats.numOccluders, stats.numTriangles, stats.rasterTime,
+		stats.triangleRate, stats.numTested, stats.numCulled, stats.testTime);
+
+	return stats;
+}
@@ -0,0 +1,176 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#pragma once
+
+
+
+
+#include "Core.h"
+#include "Box.h"
+
+#include "glm/vec3.hpp"
+#include "glm/vec4.hpp"
+#include "glm/matrix.hpp"
+
+
+#include <vector>
+
+
+
+
+class Mesh;
+
+
+
+
+// Software occlusion statistics of the last rendered view.
+struct OcclusionRasterizerStats
+{
+	// Number of occluders & triangles rasterized.
+	uint32_t numOccluders;
+	uint32_t numTriangles;
+
+	// Number of boxes tested & how many of them were culled.
+	uint32_t numTested;
+	uint32_t numCulled;
+
+	// Time spent rasterizing occluders & testing boxes in milliseconds.
+	float rasterTime;
+	float testTime;
+};
+
+
+
+// Software occlusion benchmark results, times are averaged over the frames.
+struct OcclusionBenchmarkStats
+{
+	// The number of frames & the size of each frame.
+	uint32_t numFrames;
+	uint32_t numOccluders;
+	uint32_t numTriangles;
+	uint32_t numTested;
+
+	// The average number of culled boxes per frame.
+	uint32_t numCulled;
+
+	// Average time rasterizing occluders & testing boxes per frame in milliseconds.
+	float rasterTime;
+	float testTime;
+
+	// Rasterized triangles per millisecond.
+	float triangleRate;
+};
+
+
+
+
+
+// OcclusionRasterizer:
+//    - CPU depth rasterizer used for occlusion culling, occluders are rasterized into a low resolution
+//      depth buffer using SSE, 4 pixels at a time, each 8x8 tile keeps its farthest depth so most box
+//      tests are resolved from the tiles without touching the pixels.
+//    - depth follows the renderer convention, 0 near & 1 far.
+//
+class OcclusionRasterizer
+{
+public:
+	// The size of the hierarchical tile in pixels.
+	static const uint32_t TILE_SIZE = 8;
+
+public:
+	// Construct.
+	OcclusionRasterizer();
+
+	// Destruct.
+	~OcclusionRasterizer();
+
+	// Initialize the depth buffer, the size is rounded up to the tile size.
+	void Initialize(uint32_t width, uint32_t height);
+
+	// Clear the depth buffer and start a new view.
+	void Begin(const glm::mat4& viewProj);
+
+	// Rasterize the triangles of an occluder mesh instance.
+	void RenderOccluder(const Mesh* mesh, const glm::mat4& transform);
+
+	// Rasterize a triangle list transformed by transform into the depth buffer.
+	void RenderTriangles(const glm::vec3* positions, uint32_t stride, const uint32_t* indices, uint32_t numIndices,
+		const glm::mat4& transform);
+
+	// Done rendering occluders, build the tiles depth.
+	void End();
+
+	// Test a world bounding box, return true if the box is visible.
+	bool TestBox(const Box& box);
+
+	// Done testing boxes for this view, used for the test time stats.
+	void EndTests();
+
+	// Return the depth buffer size.
+	inline uint32_t GetWidth() const { return mWidth; }
+	inline uint32_t GetHeight() const { return mHeight; }
+
+	// Return the depth buffer.
+	inline const std::vector<float>& GetDepth() const { return mDepth; }
+
+	// Return the stats of the last view.
+	inline const OcclusionRasterizerStats& GetStats() const { return mStats; }
+
+	// Rasterize a random field of box occluders & test boxes against them for numFrames, used to
+	// measure the rasterizer outside the renderer.
+	static OcclusionBenchmarkStats Benchmark(uint32_t numFrames);
+
+private:
+	// Rasterize a single triangle, x & y in pixels, z depth.
+	void RasterizeTriangle(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2);
+
+	// Test a pixels rect against a depth, return true if any pixel is behind the depth.
+	bool TestRect(int32_t x0, int32_t y0, int32_t x1, int32_t y1, float depth) const;
+
+private:
+	// The depth buffer size.
+	uint32_t mWidth;
+	uint32_t mHeight;
+
+	// The number of tiles.
+	uint32_t mTilesX;
+	uint32_t mTilesY;
+
+	// The depth buffer.
+	std::vector<float> mDepth;
+
+	// The farthest depth in each tile.
+	std::vector<float> mTileDepth;
+
+	// Transformed vertices of the occluder we are currently rendering.
+	std::vector<glm::vec4> mClipVerts;
+
+	// The current view projection.
+	glm::mat4 mViewProj;
+
+	// The current view stats.
+	OcclusionRasterizerStats mStats;
+
+	// Start time of the current step, used for the time stats.
+	double mStepTime;
+};
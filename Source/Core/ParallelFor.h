@@ -0,0 +1,68 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+
+#include "Core.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+
+
+
+
+// Run func(i) for each index in [0, count) on up to maxThreads threads, the calling thread is one of them.
+// Indices are taken in order from a shared counter, sort the work largest first to balance uneven jobs.
+// @return the number of threads used.
+template<class Func>
+uint32_t ParallelFor(uint32_t count, uint32_t maxThreads, const Func& func)
+{
+	if (count == 0)
+		return 0;
+
+	std::atomic<uint32_t> nextIndex(0);
+
+	auto worker = [count, &func, &nextIndex]()
+	{
+		for (uint32_t i = nextIndex++; i < count; i = nextIndex++)
+			func(i);
+	};
+
+	uint32_t numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	numThreads = std::min(numThreads, std::min(count, std::max(maxThreads, 1u)));
+
+	std::vector<std::thread> threads;
+	threads.reserve(numThreads - 1);
+
+	for (uint32_t i = 1; i < numThreads; ++i)
+		threads.emplace_back(worker);
+
+	worker();
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	return numThreads;
+}
@@ -0,0 +1,87 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+
+#include "RadixSort.h"
+
+
+
+
+
+
+void RadixSort64(std::vector<RadixSortItem>& items, std::vector<RadixSortItem>& temp)
+{
+	const size_t count = items.size();
+
+	if (count < 2)
+		return;
+
+	temp.resize(count);
+
+	// The histogram of each digit, built in one pass.
+	uint32_t histograms[8][256] = {};
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		uint64_t key = items[i].key;
+
+		for (uint32_t d = 0; d < 8; ++d)
+			++histograms[d][(key >> (d * 8)) & 0xFF];
+	}
+
+	RadixSortItem* src = items.data();
+	RadixSortItem* dst = temp.data();
+
+	for (uint32_t d = 0; d < 8; ++d)
+	{
+		uint32_t* histogram = histograms[d];
+		uint32_t shift = d * 8;
+
+		// Skip digits that are the same for all items.
+		if (histogram[(src[0].key >> shift) & 0xFF] == count)
+			continue;
+
+		// Prefix sum, the start offset of each bucket.
+		uint32_t offset = 0;
+
+		for (uint32_t b = 0; b < 256; ++b)
+		{
+			uint32_t num = histogram[b];
+			histogram[b] = offset;
+			offset += num;
+		}
+
+		// Scatter...
+		for (size_t i = 0; i < count; ++i)
+		{
+			uint32_t bucket = (src[i].key >> shift) & 0xFF;
+			dst[histogram[bucket]++] = src[i];
+		}
+
+		std::swap(src, dst);
+	}
+
+	// The result ended in the temp buffer?
+	if (src != items.data())
+		items.swap(temp);
+}
+
@@ -0,0 +1,51 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#pragma once
+
+
+#include "Core.h"
+
+#include <vector>
+
+
+
+
+
+// A single item sorted by its key.
+struct RadixSortItem
+{
+	// The sort key.
+	uint64_t key;
+
+	// The value of the item, usually an index.
+	uint32_t value;
+};
+
+
+
+
+// Sort the items by their keys in ascending order, LSD radix sort using 8-bit digits.
+//    - temp is used as a scratch buffer to avoid allocations between calls.
+//    - digits that are the same for all items are skipped.
+void RadixSort64(std::vector<RadixSortItem>& items, std::vector<RadixSortItem>& temp);
+
@@ -0,0 +1,92 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+
+#include "Core.h"
+
+#include <atomic>
+
+
+
+
+
+// SPSCQueue:
+//    - lock-free bounded queue with a single producer thread & a single consumer thread.
+//    - the producer only writes the tail & the consumer only writes the head, SIZE must be a power of two.
+//
+template<class T, uint32_t SIZE>
+class SPSCQueue
+{
+	static_assert((SIZE & (SIZE - 1)) == 0, "SPSCQueue size must be a power of two.");
+
+public:
+	// Construct.
+	SPSCQueue()
+		: mHead(0)
+		, mTail(0)
+	{
+
+	}
+
+	// Push an item to the queue, return false if the queue is full. Called by the producer thread only.
+	bool Push(const T& item)
+	{
+		uint32_t tail = mTail.load(std::memory_order_relaxed);
+
+		if (tail - mHead.load(std::memory_order_acquire) == SIZE)
+			return false;
+
+		mItems[tail & (SIZE - 1)] = item;
+		mTail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Pop an item from the queue, return false if the queue is empty. Called by the consumer thread only.
+	bool Pop(T& item)
+	{
+		uint32_t head = mHead.load(std::memory_order_relaxed);
+
+		if (head == mTail.load(std::memory_order_acquire))
+			return false;
+
+		item = mItems[head & (SIZE - 1)];
+		mHead.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Return true if the queue is empty, only a hint while the other thread is using the queue.
+	inline bool IsEmpty() const
+	{
+		return mHead.load(std::memory_order_acquire) == mTail.load(std::memory_order_acquire);
+	}
+
+private:
+	// The items ring buffer.
+	T mItems[SIZE];
+
+	// The index of the next item to pop, written by the consumer. On its own cache line to avoid false sharing.
+	alignas(64) std::atomic<uint32_t> mHead;
+
+	// The index of the next item to push, written by the producer.
+	alignas(64) std::atomic<uint32_t> mTail;
+};
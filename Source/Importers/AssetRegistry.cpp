@@ -0,0 +1,393 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "AssetRegistry.h"
+#include "Core/Image2D.h"
+#include "Core/Mesh.h"
+#include "Core/MappedFile.h"
+
+
+#include <map>
+#include <mutex>
+#include <vector>
+#include <cstring>
+
+
+
+
+// Primes of the content hash rounds.
+#define ASSET_HASH_PRIME1 0x9E3779B185EBCA87ull
+#define ASSET_HASH_PRIME2 0xC2B2AE3D27D4EB4Full
+#define ASSET_HASH_PRIME3 0x165667B19E3779F9ull
+
+// The seed of the second hash of encoded data, the two hashes make a 128 bit key.
+#define ASSET_HASH_ENCODED_SEED 0x7F4A7C15F39CC060ull
+
+
+
+
+// A registered asset, images decoded from encoded data keep a second hash of it to compare with on hits.
+template<class T>
+struct ARAsset
+{
+	// The asset, the registry doesn't keep it alive.
+	std::weak_ptr<T> asset;
+
+	// Decoded from encoded data & the second hash of it, the asset keeps its content otherwise.
+	bool isEncoded;
+	uint64_t encodedHash;
+};
+
+
+// The content of an image lookup, the image itself or the second hash of the encoded data it is decoded from.
+struct ARImageKey
+{
+	const Image2D* image;
+	uint64_t encodedHash;
+};
+
+
+// The content of a mesh lookup.
+struct ARMeshKey
+{
+	const MeshVert* vertices;
+	size_t numVertices;
+	const uint32_t* indices;
+	size_t numIndices;
+};
+
+
+// The registered assets by content hash & the registry stats, guarded by the mutex.
+static std::mutex sRegistryMutex;
+static std::map< uint64_t, ARAsset<Image2D> > sRegistryImages;
+static std::map< uint64_t, ARAsset<Mesh> > sRegistryMeshes;
+static AssetRegistryStats sRegistryStats = AssetRegistryStats{};
+
+
+
+// --- -- - -- --- --- -- - -- --- --- -- - -- --- --- -- - -- --- --- -- - -- --- ---
+
+
+
+// Mix a word into the hash.
+static inline uint64_t ARMix(uint64_t hash, uint64_t word)
+{
+	word *= ASSET_HASH_PRIME2;
+	word = (word << 31) | (word >> 33);
+	hash ^= word * ASSET_HASH_PRIME1;
+	hash = (hash << 27) | (hash >> 37);
+	return hash * ASSET_HASH_PRIME1 + ASSET_HASH_PRIME3;
+}
+
+
+// Return true if both ranges have the same bytes.
+static inline bool ARIsSameData(const void* a, const void* b, size_t size)
+{
+	return size == 0 || memcmp(a, b, size) == 0;
+}
+
+
+// Return true if a registered image has the content of the lookup, the hash alone may collide.
+static bool ARIsSame(const ARAsset<Image2D>& entry, const Image2D& registered, const ARImageKey& key)
+{
+	// Decoded from the same encoded data? both hashes match.
+	if (!key.image)
+		return entry.isEncoded && entry.encodedHash == key.encodedHash;
+
+	if (entry.isEncoded)
+		return false;
+
+	// The same mip chain.
+	const Image2D& image = *key.image;
+	const Image2DData& data = image.GetImgData();
+
+	return registered.GetFormat() == image.GetFormat() && registered.GetSize() == image.GetSize()
+		&& registered.IsSRGB() == image.IsSRGB() && registered.GetNumMips() == image.GetNumMips()
+		&& registered.GetImgData().IsValid() && data.IsValid() && registered.GetImgData().GetSize() == data.GetSize()
+		&& ARIsSameData(registered.GetImgData().GetData(), data.GetData(), data.GetSize());
+}
+
+
+// Return true if a registered mesh has the content of the lookup, the hash alone may collide.
+static bool ARIsSame(const ARAsset<Mesh>&, const Mesh& registered, const ARMeshKey& key)
+{
+	return registered.GetVertices().size() == key.numVertices && registered.GetIndices().size() == key.numIndices
+		&& ARIsSameData(registered.GetVertices().data(), key.vertices, key.numVertices * sizeof(MeshVert))
+		&& ARIsSameData(registered.GetIndices().data(), key.indices, key.numIndices * sizeof(uint32_t));
+}
+
+
+// Find a live asset with the content of the key in the map, the expired entry is removed.
+template<class T, class Key>
+static Ptr<T> ARFind(std::map< uint64_t, ARAsset<T> >& assets, uint64_t hash, const Key& key)
+{
+	auto iter = assets.find(hash);
+
+	if (iter == assets.end())
+		return nullptr;
+
+	Ptr<T> asset = iter->second.asset.lock();
+
+	if (!asset)
+	{
+		assets.erase(iter);
+		return nullptr;
+	}
+
+	// Same hash but a different content?
+	if (!ARIsSame(iter->second, *asset, key))
+		return nullptr;
+
+	return asset;
+}
+
+
+// Register an asset in the map unless a live one has the same content, return the registered one.
+// A live asset with the same hash & a different content stays registered, the new one isn't shared.
+template<class T, class Key>
+static Ptr<T> ARAdd(std::map< uint64_t, ARAsset<T> >& assets, uint64_t hash, const Ptr<T>& asset, const Key& key,
+	bool isEncoded = false, uint64_t encodedHash = 0)
+{
+	auto iter = assets.find(hash);
+	Ptr<T> registered = iter != assets.end() ? iter->second.asset.lock() : nullptr;
+
+	if (registered)
+		return ARIsSame(iter->second, *registered, key) ? registered : asset;
+
+	ARAsset<T>& entry = assets[hash];
+	entry.asset = asset;
+	entry.isEncoded = isEncoded;
+	entry.encodedHash = encodedHash;
+	return asset;
+}
+
+
+// Remove the expired entries of the map.
+template<class T>
+static void ARPrune(std::map< uint64_t, ARAsset<T> >& assets)
+{
+	for (auto iter = assets.begin(); iter != assets.end();)
+	{
+		if (iter->second.asset.expired())
+			iter = assets.erase(iter);
+		else
+			++iter;
+	}
+}
+
+
+
+// --- -- - -- --- --- -- - -- --- --- -- - -- --- --- -- - -- --- --- -- - -- --- ---
+
+
+
+uint64_t AssetRegistry::Hash(const void* data, size_t size, uint64_t seed)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	uint64_t hash = seed + ASSET_HASH_PRIME3 + (uint64_t)size;
+
+	// Words...
+	size_t i = 0;
+
+	for (; i + 8 <= size; i += 8)
+	{
+		uint64_t word;
+		memcpy(&word, bytes + i, 8);
+		hash = ARMix(hash, word);
+	}
+
+	// Remaining bytes...
+	uint64_t tail = 0;
+
+	for (size_t j = 0; i + j < size; ++j)
+		tail |= (uint64_t)bytes[i + j] << (j * 8);
+
+	hash = ARMix(hash, tail);
+
+	// Avalanche.
+	hash ^= hash >> 33;
+	hash *= ASSET_HASH_PRIME2;
+	hash ^= hash >> 29;
+	hash *= ASSET_HASH_PRIME3;
+	hash ^= hash >> 32;
+
+	return hash;
+}
+
+
+uint64_t AssetRegistry::HashMesh(const Mesh* mesh)
+{
+	const std::vector<MeshVert>& verts = mesh->GetVertices();
+	const std::vector<uint32_t>& indices = mesh->GetIndices();
+
+	uint64_t hash = Hash(verts.data(), verts.size() * sizeof(MeshVert));
+	return Hash(indices.data(), indices.size() * sizeof(uint32_t), hash);
+}
+
+
+Ptr<Image2D> AssetRegistry::FindImage(uint64_t hash, const Image2D* image)
+{
+	std::lock_guard<std::mutex> lock(sRegistryMutex);
+	Ptr<Image2D> registered = ARFind(sRegistryImages, hash, ARImageKey{ image, 0 });
+
+	++sRegistryStats.numImageLookups;
+
+	if (registered)
+	{
+		++sRegistryStats.numImageHits;
+		sRegistryStats.savedImageBytes += image->GetImgData().GetSize();
+	}
+
+	return registered;
+}
+
+
+Ptr<Image2D> AssetRegistry::AddImage(uint64_t hash, const Ptr<Image2D>& image)
+{
+	std::lock_guard<std::mutex> lock(sRegistryMutex);
+	return ARAdd(sRegistryImages, hash, image, ARImageKey{ image.get(), 0 });
+}
+
+
+Ptr<Image2D> AssetRegistry::LoadImage(const uint8_t* data, size_t size, bool* isShared)
+{
+	uint64_t hash = Hash(data, size);
+	ARImageKey key{ nullptr, Hash(data, size, ASSET_HASH_ENCODED_SEED) };
+	Ptr<Image2D> image;
+
+	{
+		std::lock_guard<std::mutex> lock(sRegistryMutex);
+		image = ARFind(sRegistryImages, hash, key);
+
+		++sRegistryStats.numImageLookups;
+
+		if (image)
+		{
+			++sRegistryStats.numImageHits;
+			sRegistryStats.savedImageBytes += size;
+		}
+	}
+
+	if (isShared)
+		*isShared = image != nullptr;
+
+	if (image)
+		return image;
+
+	Ptr<Image2D> decoded = std::make_shared<Image2D>();
+
+	if (!decoded->LoadImage(data, (uint32_t)size) || decoded->GetSize().x == 0 || decoded->GetSize().y == 0)
+		return nullptr;
+
+	decoded->SetGenMips(true);
+
+	// Decoded by another thread at the same time? use the registered one.
+	{
+		std::lock_guard<std::mutex> lock(sRegistryMutex);
+		image = ARAdd(sRegistryImages, hash, decoded, key, true, key.encodedHash);
+	}
+
+	if (isShared)
+		*isShared = image != decoded;
+
+	return image;
+}
+
+
+Ptr<Image2D> AssetRegistry::LoadImage(const std::string& file, bool* isShared)
+{
+	MappedFile mapped;
+
+	if (!mapped.Open(file))
+	{
+		LOGE("Failed to load image file(%s)", file.c_str());
+		return nullptr;
+	}
+
+	return LoadImage(mapped.GetData(), mapped.GetSize(), isShared);
+}
+
+
+Ptr<Mesh> AssetRegistry::FindMesh(uint64_t hash, const MeshVert* vertices, size_t numVertices,
+	const uint32_t* indices, size_t numIndices)
+{
+	std::lock_guard<std::mutex> lock(sRegistryMutex);
+	Ptr<Mesh> mesh = ARFind(sRegistryMeshes, hash, ARMeshKey{ vertices, numVertices, indices, numIndices });
+
+	++sRegistryStats.numMeshLookups;
+
+	if (mesh)
+	{
+		++sRegistryStats.numMeshHits;
+		sRegistryStats.savedMeshBytes += numVertices * sizeof(MeshVert) + numIndices * sizeof(uint32_t);
+	}
+
+	return mesh;
+}
+
+
+Ptr<Mesh> AssetRegistry::FindMesh(uint64_t hash, const Mesh* mesh)
+{
+	return FindMesh(hash, mesh->GetVertices().data(), mesh->GetVertices().size(),
+		mesh->GetIndices().data(), mesh->GetIndices().size());
+}
+
+
+Ptr<Mesh> AssetRegistry::AddMesh(uint64_t hash, const Ptr<Mesh>& mesh)
+{
+	ARMeshKey key{ mesh->GetVertices().data(), mesh->GetVertices().size(),
+		mesh->GetIndices().data(), mesh->GetIndices().size() };
+
+	std::lock_guard<std::mutex> lock(sRegistryMutex);
+	return ARAdd(sRegistryMeshes, hash, mesh, key);
+}
+
+
+void AssetRegistry::Prune()
+{
+	std::lock_guard<std::mutex> lock(sRegistryMutex);
+	ARPrune(sRegistryImages);
+	ARPrune(sRegistryMeshes);
+}
+
+
+AssetRegistryStats AssetRegistry::GetStats()
+{
+	std::lock_guard<std::mutex> lock(sRegistryMutex);
+	AssetRegistryStats stats = sRegistryStats;
+	stats.numImages = 0;
+	stats.numMeshes = 0;
+
+	for (const auto& entry : sRegistryImages)
+		stats.numImages += entry.second.asset.expired() ? 0 : 1;
+
+	for (const auto& entry : sRegistryMeshes)
+		stats.numMeshes += entry.second.asset.expired() ? 0 : 1;
+
+	return stats;
+}
+
+
+void AssetRegistry::ResetStats()
+{
+	std::lock_guard<std::mutex> lock(sRegistryMutex);
+	sRegistryStats = AssetRegistryStats{};
+}
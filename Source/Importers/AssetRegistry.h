@@ -0,0 +1,121 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+
+
+#include "Core/Core.h"
+#include <string>
+
+
+
+class Image2D;
+class Mesh;
+struct MeshVert;
+
+
+
+
+
+
+
+// The seed of the content hashes.
+#define ASSET_HASH_SEED 0x52544749
+
+
+
+
+// AssetRegistryStats:
+//     - lookups of the asset registry since it was last reset.
+//
+struct AssetRegistryStats
+{
+	// The image lookups & the number found in the registry.
+	uint32_t numImageLookups;
+	uint32_t numImageHits;
+
+	// The mesh lookups & the number found in the registry.
+	uint32_t numMeshLookups;
+	uint32_t numMeshHits;
+
+	// The number of live registered images & meshes.
+	uint32_t numImages;
+	uint32_t numMeshes;
+
+	// The image & mesh data that wasn't decoded, copied or uploaded again because it was found.
+	uint64_t savedImageBytes;
+	uint64_t savedMeshBytes;
+};
+
+
+
+
+// AssetRegistry:
+//     - Images & meshes keyed by the hash of their content, shared by every scene that loads the same content.
+//     - A hash hit is only shared if the content matches too, images decoded from encoded data are keyed
+//       on a 128 bit hash of it instead of keeping a copy.
+//     - The registry only holds weak references, an asset & its render data live as long as a scene uses it,
+//       loading a scene while another one that shares its assets is alive reuses them without decoding or uploading.
+//     - Thread safe, the importers use it from the loader & decode threads.
+//
+class AssetRegistry
+{
+public:
+	// Return the 64 bit hash of the data.
+	static uint64_t Hash(const void* data, size_t size, uint64_t seed = ASSET_HASH_SEED);
+
+	// Return the hash of a mesh vertices & indices.
+	static uint64_t HashMesh(const Mesh* mesh);
+
+	// Find a live image with the format, size, mips & mip chain of an image.
+	static Ptr<Image2D> FindImage(uint64_t hash, const Image2D* image);
+
+	// Register an image, return the live image already registered with the same content if any.
+	static Ptr<Image2D> AddImage(uint64_t hash, const Ptr<Image2D>& image);
+
+	// Decode an encoded image unless a live image has the same content, decoded images generate their mips.
+	// @param isShared: set to true if the image was found in the registry.
+	// @return the image, null if it can't be decoded.
+	static Ptr<Image2D> LoadImage(const uint8_t* data, size_t size, bool* isShared = nullptr);
+
+	// Load an image file through the registry, the file is mapped & hashed before it is decoded.
+	static Ptr<Image2D> LoadImage(const std::string& file, bool* isShared = nullptr);
+
+	// Find a live mesh with the same vertices & indices.
+	static Ptr<Mesh> FindMesh(uint64_t hash, const MeshVert* vertices, size_t numVertices,
+		const uint32_t* indices, size_t numIndices);
+
+	// Find a live mesh with the content of a mesh.
+	static Ptr<Mesh> FindMesh(uint64_t hash, const Mesh* mesh);
+
+	// Register a mesh, return the live mesh already registered with the same content if any.
+	static Ptr<Mesh> AddMesh(uint64_t hash, const Ptr<Mesh>& mesh);
+
+	// Remove the entries of the assets that were destroyed.
+	static void Prune();
+
+	// Return the stats.
+	static AssetRegistryStats GetStats();
+
+	// Reset the lookup stats.
+	static void ResetStats();
+};
@@ -27,6 +27,10 @@
 #include "Core/Image2D.h"
 #include "Core/Mesh.h"
 #include "Core/Material.h"
+#include "Core/MappedFile.h"
+#include "Core/ParallelFor.h"
+#include "SceneLoader.h"
+#include "AssetRegistry.h"
 
 
 #include "Scene/Scene.h"
@@ -37,21 +41,199 @@
 #define TINYGLTF_IMPLEMENTATION
 #define TINYGLTF_NO_STB_IMAGE
 #define TINYGLTF_NO_STB_IMAGE_WRITE
+#define TINYGLTF_NO_EXTERNAL_IMAGE
 #include "tiny_gltf.h"
 #undef LoadImage
 
 
 
 #include <array>
+#include <chrono>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 
 
 // List of supported gltf extensions.
-static const std::array<std::string, 1> GLTF_EXT_LIST = { ".gltf" };
+static const std::array<std::string, 2> GLTF_EXT_LIST = { ".gltf", ".glb" };
 
 
-std::vector<std::string> gImagesUri;
-std::map< std::string, Ptr<Image2D> > gImagesMap;
+// Binary glTF magic, chunk types & header sizes.
+#define GLB_MAGIC 0x46546C67
+#define GLB_CHUNK_JSON 0x4E4F534A
+#define GLB_CHUNK_BIN 0x004E4942
+#define GLB_HEADER_SIZE 12
+#define GLB_CHUNK_HEADER_SIZE 8
+
+// Replaces the .glb bin buffer in the json given to tinygltf, its data is read from the mapped file.
+#define GLB_BIN_PLACEHOLDER_URI "data:application/octet-stream;base64,AA=="
+
+// Uri given to images embedded in the .glb, they are decoded from the mapped file.
+#define GLB_IMAGE_URI "#glb-image-"
+
+// The number of accessor elements converted per block.
+#define GLTF_ACCESSOR_BLOCK 1024
+
+// The maximum number of threads converting primitives.
+#define GLTF_MAX_CONVERT_THREADS 16
+
+// The maximum number of threads decoding images.
+#define GLTF_MAX_DECODE_THREADS 8
+
+// Scale from glTF units to the scene, applied with the y & z swap to vertices & node transforms.
+#define GLTF_IMPORT_SCALE 0.5f
+
+
+GLTFImportStats GLTFImporter::sStats = GLTFImportStats{};
+EGLTFImportMode GLTFImporter::sImportMode = EGLTFImportMode::Nodes;
+std::vector<std::string> GLTFImporter::sDependencies;
+
+
+
+
+// GLTFBufferData:
+//    - raw bytes of a glTF buffer or buffer view, owned by tinygltf or mapped from a .glb file.
+//
+struct GLTFBufferData
+{
+	// The data.
+	const uint8_t* data;
+
+	// The size in bytes.
+	size_t size;
+};
+
+
+// GLTFImportData:
+//    - data shared while importing a single glTF file.
+//
+struct GLTFImportData
+{
+	// The directory of the imported file.
+	std::string dir;
+
+	// The mapped .glb file, its bin chunk is used in place.
+	MappedFile glbFile;
+
+	// The data of each buffer in the model.
+	std::vector<GLTFBufferData> buffers;
+
+	// Images embedded in the .glb, image index -> buffer view.
+	std::map<int, int> glbImages;
+
+	// The images of the textures by their key, decoded or found in the asset registry.
+	std::map< std::string, Ptr<Image2D> > images;
+};
+
+
+// GLTFAccessorView:
+//    - strided view of the elements of an accessor.
+//
+struct GLTFAccessorView
+{
+	// The first element.
+	const uint8_t* data;
+
+	// The distance between elements in bytes.
+	size_t stride;
+
+	// The number of elements.
+	size_t count;
+
+	// The type & number of components in each element.
+	int componentType;
+	uint32_t numComponents;
+
+	// If true integer components are normalized to [0, 1] or [-1, 1].
+	bool isNormalized;
+};
+
+
+// GLTFMeshPart:
+//    - a mesh converted from the primitives of a glTF mesh, or all meshes when flattened, with the same material.
+//
+struct GLTFMeshPart
+{
+	// The converted mesh.
+	Ptr<Mesh> mesh;
+
+	// The material index in the model.
+	int material;
+
+	// The number of vertices & indices of all its primitives.
+	size_t numVerts;
+	size_t numIndices;
+};
+
+
+// GLTFPrimitiveJob:
+//    - a primitive converted into its range of a part mesh.
+//
+struct GLTFPrimitiveJob
+{
+	// The part mesh.
+	Mesh* mesh;
+
+	// The primitive attributes & indices.
+	GLTFAccessorView position;
+	GLTFAccessorView normal;
+	GLTFAccessorView texCoord;
+	GLTFAccessorView index;
+
+	// Which of the optional views are valid.
+	bool hasNormals;
+	bool hasTexCoords;
+	bool hasIndices;
+
+	// The number of vertices & indices.
+	size_t numVerts;
+	size_t numIndices;
+
+	// The first vertex & index in the mesh.
+	size_t vertexOffset;
+	size_t indexOffset;
+
+	// Bounds of the converted vertices, merged into the mesh bounds.
+	Box bounds;
+};
+
+
+// GLTFNodeInstance:
+//    - a glTF node with a mesh & its world transform in glTF space.
+//
+struct GLTFNodeInstance
+{
+	// The mesh index in the model.
+	int mesh;
+
+	// The node world transform.
+	glm::mat4 transform;
+};
+
+
+// GLTFImageJob:
+//    - an image decoded on a worker thread.
+//
+struct GLTFImageJob
+{
+	// The image key in the images map.
+	std::string key;
+
+	// The image file path, if not embedded.
+	std::string path;
+
+	// The encoded image data embedded in the .glb.
+	GLTFBufferData embedded;
+
+	// The decoded image, null if it failed.
+	Ptr<Image2D> image;
+
+	// True if the image was found in the asset registry, it isn't decoded or uploaded again.
+	bool isShared;
+};
 
 
 
@@ -61,15 +243,316 @@ std::map< std::string, Ptr<Image2D> > gImagesMap;
 
 
 
+// Return the current time in milliseconds.
+static double GetTimeMS()
+{
+	using namespace std::chrono;
+	return duration<double, std::milli>(high_resolution_clock::now().time_since_epoch()).count();
+}
+
+
+// External images aren't read by tinygltf, they are decoded by the importer from their uri.
 bool GLTFLoadImageDataFunction(tinygltf::Image* img, const int image_idx, std::string* err,
 	std::string* warn, int, int,
 	const unsigned char*, int,
 	void* user_pointer)
 {
-	if (image_idx + 1 > gImagesUri.size())
-		gImagesUri.resize(image_idx + 1);
+	return true;
+}
+
+
+// Return the data of a buffer view, false if it is out of its buffer range.
+static bool GLTFGetBufferView(const tinygltf::Model& model, const GLTFImportData& data, int index, GLTFBufferData& outView)
+{
+	if (index < 0 || index >= (int)model.bufferViews.size())
+		return false;
+
+	const tinygltf::BufferView& view = model.bufferViews[index];
+
+	if (view.buffer < 0 || view.buffer >= (int)data.buffers.size())
+		return false;
+
+	const GLTFBufferData& buffer = data.buffers[view.buffer];
+
+	if (view.byteOffset > buffer.size || view.byteLength > buffer.size - view.byteOffset)
+		return false;
+
+	outView.data = buffer.data + view.byteOffset;
+	outView.size = view.byteLength;
+	return true;
+}
+
+
+// Return a strided view of the accessor elements, false if not supported or out of range.
+static bool GLTFGetAccessorView(const tinygltf::Model& model, const GLTFImportData& data, int index, GLTFAccessorView& outView)
+{
+	if (index < 0 || index >= (int)model.accessors.size())
+		return false;
+
+	const tinygltf::Accessor& acc = model.accessors[index];
+
+	// Sparse accessors are not supported.
+	if (acc.sparse.isSparse)
+		return false;
+
+	GLTFBufferData view;
+	if (!GLTFGetBufferView(model, data, acc.bufferView, view))
+		return false;
+
+	int32_t componentSize = tinygltf::GetComponentSizeInBytes((uint32_t)acc.componentType);
+	int32_t numComponents = tinygltf::GetNumComponentsInType((uint32_t)acc.type);
+
+	if (componentSize <= 0 || numComponents <= 0)
+		return false;
+
+	size_t elementSize = (size_t)(componentSize * numComponents);
+	size_t stride = model.bufferViews[acc.bufferView].byteStride;
+	stride = stride ? stride : elementSize;
+
+	// The last element must be inside the buffer view.
+	if (acc.count != 0 && (acc.byteOffset > view.size || (acc.count - 1) * stride + elementSize > view.size - acc.byteOffset))
+		return false;
+
+	outView.data = view.data + acc.byteOffset;
+	outView.stride = stride;
+	outView.count = acc.count;
+	outView.componentType = acc.componentType;
+	outView.numComponents = (uint32_t)numComponents;
+	outView.isNormalized = acc.normalized;
+	return true;
+}
+
+
+// Convert strided elements of type T to floats, missing components are zero.
+template<typename T>
+static void GLTFConvertFloats(const uint8_t* src, const GLTFAccessorView& view, size_t count,
+	uint32_t numComponents, float scale, float* out)
+{
+	uint32_t numSrc = std::min(view.numComponents, numComponents);
+
+	for (size_t i = 0; i < count; ++i, src += view.stride, out += numComponents)
+	{
+		T value[4];
+		memcpy(value, src, sizeof(T) * numSrc);
+
+		for (uint32_t c = 0; c < numSrc; ++c)
+			out[c] = view.isNormalized ? std::max((float)value[c] * scale, -1.0f) : (float)value[c];
+
+		for (uint32_t c = numSrc; c < numComponents; ++c)
+			out[c] = 0.0f;
+	}
+}
+
+
+// Read a block of accessor elements as floats.
+static void GLTFReadFloats(const GLTFAccessorView& view, size_t first, size_t count, uint32_t numComponents, float* out)
+{
+	const uint8_t* src = view.data + first * view.stride;
+
+	switch (view.componentType)
+	{
+	case TINYGLTF_COMPONENT_TYPE_FLOAT:
+		// Tightly packed, copy the whole block.
+		if (view.numComponents == numComponents && view.stride == numComponents * sizeof(float))
+		{
+			memcpy(out, src, count * view.stride);
+			return;
+		}
+
+		GLTFConvertFloats<float>(src, view, count, numComponents, 1.0f, out);
+		break;
+
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+		GLTFConvertFloats<uint8_t>(src, view, count, numComponents, 1.0f / 255.0f, out);
+		break;
+
+	case TINYGLTF_COMPONENT_TYPE_BYTE:
+		GLTFConvertFloats<int8_t>(src, view, count, numComponents, 1.0f / 127.0f, out);
+		break;
+
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+		GLTFConvertFloats<uint16_t>(src, view, count, numComponents, 1.0f / 65535.0f, out);
+		break;
+
+	case TINYGLTF_COMPONENT_TYPE_SHORT:
+		GLTFConvertFloats<int16_t>(src, view, count, numComponents, 1.0f / 32767.0f, out);
+		break;
+
+	default:
+		memset(out, 0, count * numComponents * sizeof(float));
+		break;
+	}
+}
+
+
+// Convert strided indices of type T to uint32.
+template<typename T>
+static void GLTFConvertIndices(const uint8_t* src, size_t stride, size_t count, uint32_t* out)
+{
+	for (size_t i = 0; i < count; ++i, src += stride)
+	{
+		T value;
+		memcpy(&value, src, sizeof(T));
+		out[i] = (uint32_t)value;
+	}
+}
+
+
+// Read a block of accessor elements as indices.
+static void GLTFReadIndices(const GLTFAccessorView& view, size_t first, size_t count, uint32_t* out)
+{
+	const uint8_t* src = view.data + first * view.stride;
+
+	switch (view.componentType)
+	{
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+		if (view.stride == sizeof(uint32_t))
+			memcpy(out, src, count * sizeof(uint32_t));
+		else
+			GLTFConvertIndices<uint32_t>(src, view.stride, count, out);
+		break;
+
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+		GLTFConvertIndices<uint16_t>(src, view.stride, count, out);
+		break;
+
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+		GLTFConvertIndices<uint8_t>(src, view.stride, count, out);
+		break;
+
+	default:
+		memset(out, 0, count * sizeof(uint32_t));
+		break;
+	}
+}
+
+
+// Load a binary glTF, the file is mapped and only its json chunk is parsed by tinygltf,
+// the bin chunk & embedded images are read in place.
+static bool GLTFLoadBinary(tinygltf::TinyGLTF& loader, tinygltf::Model& model, GLTFImportData& data,
+	const std::string& file, std::string& err, std::string& warn)
+{
+	if (!data.glbFile.Open(file))
+	{
+		err = "Failed to map the file.";
+		return false;
+	}
+
+	const uint8_t* fileData = data.glbFile.GetData();
+	size_t fileSize = data.glbFile.GetSize();
+
+	// Header: magic, version & length.
+	uint32_t header[3];
+
+	if (fileSize < GLB_HEADER_SIZE + GLB_CHUNK_HEADER_SIZE)
+	{
+		err = "Invalid glb file size.";
+		return false;
+	}
+
+	memcpy(header, fileData, GLB_HEADER_SIZE);
+
+	if (header[0] != GLB_MAGIC || header[1] != 2 || header[2] > fileSize)
+	{
+		err = "Invalid glb header.";
+		return false;
+	}
+
+	// Chunks: json followed by an optional bin.
+	const char* jsonChunk = nullptr;
+	const uint8_t* binChunk = nullptr;
+	uint32_t jsonSize = 0;
+	uint32_t binSize = 0;
+
+	for (size_t offset = GLB_HEADER_SIZE; offset + GLB_CHUNK_HEADER_SIZE <= header[2];)
+	{
+		uint32_t chunk[2];
+		memcpy(chunk, fileData + offset, GLB_CHUNK_HEADER_SIZE);
+		offset += GLB_CHUNK_HEADER_SIZE;
+
+		if (chunk[0] > header[2] - offset)
+		{
+			err = "Invalid glb chunk length.";
+			return false;
+		}
+
+		if (chunk[1] == GLB_CHUNK_JSON && !jsonChunk)
+		{
+			jsonChunk = (const char*)(fileData + offset);
+			jsonSize = chunk[0];
+		}
+		else if (chunk[1] == GLB_CHUNK_BIN && !binChunk)
+		{
+			binChunk = fileData + offset;
+			binSize = chunk[0];
+		}
+
+		offset += chunk[0];
+	}
+
+	if (!jsonChunk)
+	{
+		err = "Missing glb json chunk.";
+		return false;
+	}
+
+	nlohmann::json doc = nlohmann::json::parse(jsonChunk, jsonChunk + jsonSize, nullptr, false);
+
+	if (doc.is_discarded())
+	{
+		err = "Failed to parse glb json chunk.";
+		return false;
+	}
+
+	// The first buffer without uri is the bin chunk, tinygltf gets a placeholder instead of a copy.
+	bool isBinBuffer = false;
+	auto buffers = doc.find("buffers");
+
+	if (buffers != doc.end() && buffers->is_array() && !buffers->empty()
+		&& (*buffers)[0].find("uri") == (*buffers)[0].end())
+	{
+		size_t byteLength = (*buffers)[0].value("byteLength", (size_t)0);
+
+		if (!binChunk || byteLength > binSize)
+		{
+			err = "Invalid glb bin chunk.";
+			return false;
+		}
+
+		(*buffers)[0]["uri"] = GLB_BIN_PLACEHOLDER_URI;
+		(*buffers)[0]["byteLength"] = 1;
+		isBinBuffer = true;
+	}
+
+	// Images in buffer views are decoded from the mapped file when used.
+	auto images = doc.find("images");
+
+	if (images != doc.end() && images->is_array())
+	{
+		for (size_t i = 0; i < images->size(); ++i)
+		{
+			nlohmann::json& image = (*images)[i];
+			auto bufferView = image.find("bufferView");
+
+			if (bufferView == image.end() || !bufferView->is_number_integer())
+				continue;
+
+			data.glbImages[(int)i] = bufferView->get<int>();
+			image.erase(bufferView);
+			image["uri"] = GLB_IMAGE_URI + std::to_string(i);
+		}
+	}
+
+	std::string json = doc.dump();
+
+	if (!loader.LoadASCIIFromString(&model, &err, &warn, json.c_str(), (unsigned int)json.size(), data.dir))
+		return false;
+
+	data.buffers.resize(model.buffers.size(), GLTFBufferData{ nullptr, 0 });
+
+	if (isBinBuffer)
+		data.buffers[0] = GLTFBufferData{ binChunk, binSize };
 
-	gImagesUri[image_idx] = img->uri;
 	return true;
 }
 
@@ -104,46 +587,364 @@ bool GLTFImporter::IsSupported(const std::string& file)
 
 
 
-Ptr<Image2D> GLTFLoadImage(const tinygltf::TextureInfo& imgInfo, const std::string& dir)
+// Return the key of the image used by a texture in the images map, empty if it has no image.
+static std::string GLTFGetImageKey(const tinygltf::Model& model, const GLTFImportData& data,
+	const tinygltf::TextureInfo& texInfo)
+{
+	if (texInfo.index < 0 || texInfo.index >= (int)model.textures.size())
+		return std::string();
+
+	int imageIdx = model.textures[texInfo.index].source;
+
+	if (imageIdx < 0 || imageIdx >= (int)model.images.size())
+		return std::string();
+
+	if (data.glbImages.count(imageIdx))
+		return GLB_IMAGE_URI + std::to_string(imageIdx);
+
+	// Data uris are not supported.
+	const std::string& uri = model.images[imageIdx].uri;
+	return tinygltf::IsDataURI(uri) ? std::string() : uri;
+}
+
+
+// Add a decode job for the texture image, if it isn't loaded or requested already.
+static void GLTFRequestImage(const tinygltf::Model& model, const GLTFImportData& data,
+	const tinygltf::TextureInfo& texInfo, std::vector<GLTFImageJob>& jobs, std::map<std::string, uint32_t>& requested)
 {
-	if (imgInfo.index < gImagesUri.size() && imgInfo.index >= 0)
+	std::string key = GLTFGetImageKey(model, data, texInfo);
+
+	if (key.empty() || data.images.count(key) || requested.count(key))
+		return;
+
+	GLTFImageJob job;
+	job.key = key;
+	job.embedded = GLTFBufferData{ nullptr, 0 };
+	job.isShared = false;
+
+	auto glbImage = data.glbImages.find(model.textures[texInfo.index].source);
+
+	if (glbImage != data.glbImages.end())
+	{
+		if (!GLTFGetBufferView(model, data, glbImage->second, job.embedded))
+			return;
+	}
+	else
 	{
-		std::string uri = gImagesUri[imgInfo.index];
-		Ptr<Image2D> img;
+		job.path = data.dir + key;
+	}
+
+	requested[key] = (uint32_t)jobs.size();
+	jobs.push_back(job);
+}
+
+
+// Decode the images on worker threads, the calling thread uploads each image as soon as it is decoded.
+static uint32_t GLTFDecodeImages(GLTFImportData& data, std::vector<GLTFImageJob>& jobs)
+{
+	if (jobs.empty())
+		return 0;
+
+	std::mutex mutex;
+	std::condition_variable decodedSignal;
+	std::vector<uint32_t> decoded;
+	std::atomic<bool> isCanceled(false);
+	uint32_t numThreads = 0;
 
-		if (!uri.empty())
+	// The decoder thread is one of the workers, the calling thread uploads.
+	std::thread decoder([&]()
+	{
+		numThreads = ParallelFor((uint32_t)jobs.size(), GLTF_MAX_DECODE_THREADS, [&](uint32_t i)
 		{
-			if (gImagesMap.count(uri))
+			GLTFImageJob& job = jobs[i];
+
+			// Images with the same content as a live one aren't decoded again, none are once canceled.
+			if (!isCanceled)
 			{
-				img = gImagesMap[uri];
+				job.image = job.embedded.data
+					? AssetRegistry::LoadImage(job.embedded.data, job.embedded.size, &job.isShared)
+					: AssetRegistry::LoadImage(job.path, &job.isShared);
 			}
-			else
+
 			{
-				img = std::make_shared<Image2D>();
-				std::string path = dir + uri;
+				std::lock_guard<std::mutex> lock(mutex);
+				decoded.push_back(i);
+			}
+
+			decodedSignal.notify_one();
+		});
+	});
+
+	// Upload in the order the images finish, while the rest are still decoding.
+	std::vector<uint32_t> ready;
+
+	for (size_t numUploaded = 0; numUploaded < jobs.size();)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			decodedSignal.wait(lock, [&decoded]() { return !decoded.empty(); });
+			ready.swap(decoded);
+		}
+
+		// The loader thread leaves the render data to the main thread, shared images already have it.
+		for (uint32_t i : ready)
+		{
+			if (!SceneLoader::IsLoaderThread() && jobs[i].image && !jobs[i].image->GetRenderImage())
+				jobs[i].image->UpdateRenderImage();
+
+			data.images[jobs[i].key] = jobs[i].image;
+		}
+
+		numUploaded += ready.size();
+		ready.clear();
+		SceneLoader::SetProgress(0.1f + 0.4f * (float)numUploaded / (float)jobs.size());
+
+		// Canceled? the workers stop after their current image.
+		if (SceneLoader::IsCanceled())
+		{
+			isCanceled = true;
+			break;
+		}
+	}
+
+	decoder.join();
+	return numThreads;
+}
+
+
+Ptr<Image2D> GLTFLoadImage(const tinygltf::Model& model, const GLTFImportData& data, const tinygltf::TextureInfo& texInfo)
+{
+	std::string key = GLTFGetImageKey(model, data, texInfo);
+	auto iter = data.images.find(key);
+
+	if (iter == data.images.end())
+		return nullptr;
 
-				bool isLoaded = img->LoadImage(path);
+	return iter->second;
+}
+
+
+// Resolve the primitive accessors & count its vertices and indices, false if it can't be converted.
+static bool GLTFPreparePrimitive(const tinygltf::Model& model, const GLTFImportData& data,
+	const tinygltf::Primitive& prim, GLTFPrimitiveJob& outJob)
+{
+	auto position = prim.attributes.find("POSITION");
+	auto normal = prim.attributes.find("NORMAL");
+	auto texCoord = prim.attributes.find("TEXCOORD_0");
+
+	if (position == prim.attributes.end() || !GLTFGetAccessorView(model, data, position->second, outJob.position))
+		return false;
+
+	outJob.numVerts = outJob.position.count;
+
+	outJob.hasNormals = normal != prim.attributes.end() && GLTFGetAccessorView(model, data, normal->second, outJob.normal)
+		&& outJob.normal.count >= outJob.numVerts;
+
+	outJob.hasTexCoords = texCoord != prim.attributes.end() && GLTFGetAccessorView(model, data, texCoord->second, outJob.texCoord)
+		&& outJob.texCoord.count >= outJob.numVerts;
+
+	outJob.hasIndices = prim.indices >= 0;
+
+	if (outJob.hasIndices && !GLTFGetAccessorView(model, data, prim.indices, outJob.index))
+		return false;
+
+	// Non-indexed primitives use their vertices in order.
+	outJob.numIndices = ((outJob.hasIndices ? outJob.index.count : outJob.numVerts) / 3) * 3;
+	return true;
+}
+
+
+// Convert a primitive into its preallocated range of the material mesh, attributes are converted in blocks.
+static void GLTFConvertPrimitive(GLTFPrimitiveJob& job)
+{
+	// Vertex Data...
+	MeshVert* verts = job.mesh->GetVertices().data() + job.vertexOffset;
+
+	glm::vec3 blockPositions[GLTF_ACCESSOR_BLOCK];
+	glm::vec3 blockNormals[GLTF_ACCESSOR_BLOCK];
+	glm::vec2 blockTexCoords[GLTF_ACCESSOR_BLOCK];
+
+	for (size_t first = 0; first < job.numVerts; first += GLTF_ACCESSOR_BLOCK)
+	{
+		size_t count = std::min<size_t>(job.numVerts - first, GLTF_ACCESSOR_BLOCK);
+
+		GLTFReadFloats(job.position, first, count, 3, &blockPositions[0].x);
+
+		if (job.hasNormals)
+			GLTFReadFloats(job.normal, first, count, 3, &blockNormals[0].x);
+
+		if (job.hasTexCoords)
+			GLTFReadFloats(job.texCoord, first, count, 2, &blockTexCoords[0].x);
 
-				if (!isLoaded || img->GetSize().x == 0 || img->GetSize().y == 0)
-					img = nullptr;
+		for (size_t i = 0; i < count; ++i)
+		{
+			const glm::vec3& p = blockPositions[i];
+			const glm::vec3& n = blockNormals[i];
+
+			MeshVert& vx = verts[first + i];
+			vx.position = glm::vec3(p.x, p.z, p.y) * GLTF_IMPORT_SCALE;
+			vx.normal = job.hasNormals ? glm::vec3(n.x, n.z, n.y) : glm::vec3(0.0f, 0.0f, 1.0f);
+			vx.texCoord = job.hasTexCoords ? blockTexCoords[i] : glm::vec2(0.0f);
+
+			job.bounds.Add(vx.position);
+		}
+	}
+
+
+	// Indices...
+	const uint32_t vertexBase = (uint32_t)job.vertexOffset;
+	uint32_t* indices = job.mesh->GetIndices().data() + job.indexOffset;
+
+	if (job.hasIndices)
+		GLTFReadIndices(job.index, 0, job.numIndices, indices);
+
+	for (size_t i = 0; i < job.numIndices; i += 3)
+	{
+		uint32_t index0 = job.hasIndices ? indices[i + 0] : (uint32_t)(i + 0);
+		uint32_t index1 = job.hasIndices ? indices[i + 1] : (uint32_t)(i + 1);
+		uint32_t index2 = job.hasIndices ? indices[i + 2] : (uint32_t)(i + 2);
+
+		// Flipped winding, y & z are swapped.
+		indices[i + 0] = vertexBase + index0;
+		indices[i + 1] = vertexBase + index2;
+		indices[i + 2] = vertexBase + index1;
+	}
+}
+
+
+// Convert all the primitive jobs on worker threads, largest first.
+static uint32_t GLTFConvertPrimitives(std::vector<GLTFPrimitiveJob>& jobs)
+{
+	std::vector<uint32_t> order(jobs.size());
+
+	for (uint32_t i = 0; i < (uint32_t)order.size(); ++i)
+		order[i] = i;
+
+	std::sort(order.begin(), order.end(), [&jobs](uint32_t a, uint32_t b)
+		{
+			return jobs[a].numVerts + jobs[a].numIndices > jobs[b].numVerts + jobs[b].numIndices;
+		});
+
+	return ParallelFor((uint32_t)order.size(), GLTF_MAX_CONVERT_THREADS, [&jobs, &order](uint32_t i)
+		{
+			GLTFConvertPrimitive(jobs[order[i]]);
+		});
+}
+
+
+// Return the local transform of a node, from its matrix or its translation, rotation & scale.
+static glm::mat4 GLTFGetNodeMatrix(const tinygltf::Node& node)
+{
+	glm::mat4 mtx(1.0f);
 
-				img->SetGenMips(true);
-				gImagesMap[uri] = img;
+	// Column major, same as glm.
+	if (node.matrix.size() == 16)
+	{
+		for (int i = 0; i < 16; ++i)
+			mtx[i / 4][i % 4] = (float)node.matrix[i];
+
+		return mtx;
+	}
+
+	if (node.translation.size() == 3)
+		mtx = glm::translate(mtx, glm::vec3(node.translation[0], node.translation[1], node.translation[2]));
+
+	if (node.rotation.size() == 4)
+		mtx = mtx * glm::toMat4(glm::quat((float)node.rotation[3], (float)node.rotation[0], (float)node.rotation[1], (float)node.rotation[2]));
+
+	if (node.scale.size() == 3)
+		mtx = glm::scale(mtx, glm::vec3(node.scale[0], node.scale[1], node.scale[2]));
+
+	return mtx;
+}
+
+
+// Convert a glTF world transform to the scene, y & z are swapped and scaled like the vertices.
+static glm::mat4 GLTFToSceneMatrix(const glm::mat4& mtx)
+{
+	// Swapping y & z is its own inverse.
+	const glm::mat4 swap(
+		1.0f, 0.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, 1.0f, 0.0f,
+		0.0f, 1.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, 0.0f, 1.0f);
+
+	glm::mat4 toScene = glm::scale(glm::mat4(1.0f), glm::vec3(GLTF_IMPORT_SCALE)) * swap;
+	glm::mat4 fromScene = swap * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f / GLTF_IMPORT_SCALE));
+
+	return toScene * mtx * fromScene;
+}
+
+
+// Collect the nodes with a mesh in the hierarchy of a node, the parent transforms are applied to their children.
+static void GLTFTraverseNode(const tinygltf::Model& model, int index, const glm::mat4& parent,
+	std::vector<bool>& visited, std::vector<GLTFNodeInstance>& outInstances)
+{
+	// Invalid or cyclic hierarchy.
+	if (index < 0 || index >= (int)model.nodes.size() || visited[index])
+		return;
+
+	visited[index] = true;
+
+	const tinygltf::Node& node = model.nodes[index];
+	glm::mat4 world = parent * GLTFGetNodeMatrix(node);
+
+	if (node.mesh >= 0 && node.mesh < (int)model.meshes.size())
+		outInstances.push_back(GLTFNodeInstance{ node.mesh, world });
+
+	for (int child : node.children)
+		GLTFTraverseNode(model, child, world, visited, outInstances);
+}
+
+
+// Collect the nodes with a mesh in the default scene, or in all root nodes if the model has no scenes.
+static void GLTFCollectNodes(const tinygltf::Model& model, std::vector<GLTFNodeInstance>& outInstances)
+{
+	std::vector<int> roots;
+	int sceneIdx = model.defaultScene >= 0 ? model.defaultScene : 0;
+
+	if (sceneIdx < (int)model.scenes.size())
+	{
+		roots = model.scenes[sceneIdx].nodes;
+	}
+	else
+	{
+		std::vector<bool> isChild(model.nodes.size(), false);
+
+		for (const tinygltf::Node& node : model.nodes)
+		{
+			for (int child : node.children)
+			{
+				if (child >= 0 && child < (int)isChild.size())
+					isChild[child] = true;
 			}
+		}
 
-			if (img)
-				return img;
+		for (int i = 0; i < (int)isChild.size(); ++i)
+		{
+			if (!isChild[i])
+				roots.push_back(i);
 		}
 	}
 
-	return nullptr;
+	std::vector<bool> visited(model.nodes.size(), false);
+
+	for (int root : roots)
+		GLTFTraverseNode(model, root, glm::mat4(1.0f), visited, outInstances);
 }
 
 
 bool GLTFImporter::Import(Scene* scene, const std::string& file)
 {
+	double startTime = GetTimeMS();
+	double stageTime = startTime;
+	sStats = GLTFImportStats{};
+	sDependencies.clear();
+
 	std::string nfile = GISystem::NormalizePath(file);
-	std::string dir = GISystem::GetDirectory(nfile);
+
+	GLTFImportData data;
+	data.dir = GISystem::GetDirectory(nfile);
 
 	// Model Data...
 	tinygltf::Model model;
@@ -155,33 +956,87 @@ bool GLTFImporter::Import(Scene* scene, const std::string& file)
 	loader.SetImageLoader(&GLTFLoadImageDataFunction, nullptr);
 
 	// Load Model From File...
-	if (!loader.LoadASCIIFromFile(&model, &err, &warn, nfile))
+	bool isLoaded = false;
+
+	if (GISystem::GetFileExtension(nfile) == ".glb")
+		isLoaded = GLTFLoadBinary(loader, model, data, nfile, err, warn);
+	else
+		isLoaded = loader.LoadASCIIFromFile(&model, &err, &warn, nfile);
+
+	if (!isLoaded)
 	{
-		LOGE("Failed to import GLTF file(%s).", file.c_str());
+		LOGE("Failed to import GLTF file(%s): %s", file.c_str(), err.c_str());
 		return false;
 	}
 
+	// Buffers not mapped from the file are owned by tinygltf.
+	data.buffers.resize(model.buffers.size(), GLTFBufferData{ nullptr, 0 });
+
+	for (size_t i = 0; i < model.buffers.size(); ++i)
+	{
+		if (!data.buffers[i].data)
+			data.buffers[i] = GLTFBufferData{ model.buffers[i].data.data(), model.buffers[i].data.size() };
+
+		// External buffer?
+		const std::string& uri = model.buffers[i].uri;
+
+		if (!uri.empty() && !tinygltf::IsDataURI(uri))
+			sDependencies.push_back(data.dir + uri);
+	}
+
+
+	sStats.parseTime = (float)(GetTimeMS() - stageTime);
+	stageTime = GetTimeMS();
+	SceneLoader::SetProgress(0.1f);
+
+	if (SceneLoader::IsCanceled())
+		return false;
+
+
+	// Decode & upload all the material textures up front.
+	{
+		std::vector<GLTFImageJob> imageJobs;
+		std::map<std::string, uint32_t> requested;
+
+		for (const tinygltf::Material& mat : model.materials)
+		{
+			GLTFRequestImage(model, data, mat.pbrMetallicRoughness.baseColorTexture, imageJobs, requested);
+			GLTFRequestImage(model, data, mat.pbrMetallicRoughness.metallicRoughnessTexture, imageJobs, requested);
+		}
+
+		for (const GLTFImageJob& job : imageJobs)
+		{
+			if (!job.path.empty())
+				sDependencies.push_back(job.path);
+		}
+
+		sStats.numImages = (uint32_t)imageJobs.size();
+		sStats.numDecodeThreads = GLTFDecodeImages(data, imageJobs);
+
+		for (const GLTFImageJob& job : imageJobs)
+			sStats.numSharedImages += job.isShared ? 1 : 0;
+	}
+
+	if (SceneLoader::IsCanceled())
+		return false;
+
 
 	//
-	std::vector< Ptr<Mesh> > meshes;
 	std::vector< Ptr<Material> > materails;
 
-	// Mesh <-> Materail
+	// Materails...
 	for (size_t im = 0; im < model.materials.size(); ++im)
 	{
 		const tinygltf::Material& mat = model.materials[im];
 
-		Mesh* mesh = new Mesh();
-		meshes.emplace_back(mesh);
-
 		Material* material = new Material();
 		materails.emplace_back(material);
 
 		// Load Textures...
 		const tinygltf::TextureInfo tex1 = mat.pbrMetallicRoughness.baseColorTexture;
 		const tinygltf::TextureInfo tex2 = mat.pbrMetallicRoughness.metallicRoughnessTexture;
-		material->SetColorTexture(GLTFLoadImage(tex1, dir));
-		material->SetRoughnessMetallic(GLTFLoadImage(tex2, dir));
+		material->SetColorTexture(GLTFLoadImage(model, data, tex1));
+		material->SetRoughnessMetallic(GLTFLoadImage(model, data, tex2));
 
 		material->SetColor(glm::vec4(
 			mat.pbrMetallicRoughness.baseColorFactor[0],
@@ -193,139 +1048,155 @@ bool GLTFImporter::Import(Scene* scene, const std::string& file)
 			mat.emissiveFactor[0],
 			mat.emissiveFactor[1],
 			mat.emissiveFactor[2], 0.0f));
+	}
 
+	sStats.textureTime = (float)(GetTimeMS() - stageTime);
+	stageTime = GetTimeMS();
 
-		// Load Mesh Data...
-		for (size_t is = 0; is < model.meshes.size(); ++is)
-		{
-			const tinygltf::Mesh& ms = model.meshes[is];
 
-			// Load Primitive Data
-			for (size_t ip = 0; ip < ms.primitives.size(); ++ip)
-			{
-				const tinygltf::Primitive& prim = ms.primitives[ip];
+	// Bucket the triangle primitives by material in a single pass, each gets a range of its part mesh.
+	// Flattened, all glTF meshes are merged into the same parts.
+	bool isFlatten = sImportMode == EGLTFImportMode::Flatten;
 
-				// Not this material?
-				if (prim.material != im)
-					continue;
+	std::vector<GLTFPrimitiveJob> jobs;
+	std::vector<GLTFMeshPart> parts;
+	std::vector< std::vector<uint32_t> > meshParts(isFlatten ? 1 : model.meshes.size());
+	std::map<std::pair<int, int>, uint32_t> partsMap;
 
+	for (size_t im = 0; im < model.meshes.size(); ++im)
+	{
+		for (const tinygltf::Primitive& prim : model.meshes[im].primitives)
+		{
+			bool isTriangles = prim.mode == -1 || prim.mode == TINYGLTF_MODE_TRIANGLES;
 
+			if (!isTriangles || prim.material < 0 || prim.material >= (int)materails.size())
+				continue;
 
-				const float* positions = nullptr;
-				const float* normals = nullptr;
-				const float* texCoords = nullptr;
-				const uint16_t* indices_s = nullptr;
-				const uint32_t* indices_i = nullptr;
+			GLTFPrimitiveJob job;
 
+			if (!GLTFPreparePrimitive(model, data, prim, job))
+				continue;
 
-				// Positions...
-				const tinygltf::Accessor& accPosition = model.accessors[(prim.attributes.find("POSITION"))->second];
-				{
-					const tinygltf::BufferView& bufferViewPos = model.bufferViews[accPosition.bufferView];
-					const tinygltf::Buffer& bufferPos = model.buffers[bufferViewPos.buffer];
-					positions = reinterpret_cast<const float*>(&bufferPos.data[bufferViewPos.byteOffset + accPosition.byteOffset]);
-				}
+			int meshIdx = isFlatten ? 0 : (int)im;
+			auto part = partsMap.find(std::make_pair(meshIdx, prim.material));
 
-				// Normals...
-				{
-					const tinygltf::Accessor& accNormal = model.accessors[(prim.attributes.find("NORMAL"))->second];
-					const tinygltf::BufferView& bufferViewNormal = model.bufferViews[accNormal.bufferView];
-					const tinygltf::Buffer& bufferNormal = model.buffers[bufferViewNormal.buffer];
-					normals = reinterpret_cast<const float*>(&bufferNormal.data[bufferViewNormal.byteOffset + accNormal.byteOffset]);
-				}
+			if (part == partsMap.end())
+			{
+				part = partsMap.emplace(std::make_pair(meshIdx, prim.material), (uint32_t)parts.size()).first;
+				meshParts[meshIdx].push_back((uint32_t)parts.size());
+				parts.push_back(GLTFMeshPart{ Ptr<Mesh>(new Mesh()), prim.material, 0, 0 });
+			}
 
-				// TexCoords...
-				{
-					const tinygltf::Accessor& accTexCoord = model.accessors[(prim.attributes.find("TEXCOORD_0"))->second];
-					const tinygltf::BufferView& bufferViewTexCoord = model.bufferViews[accTexCoord.bufferView];
-					const tinygltf::Buffer& bufferTexCoord = model.buffers[bufferViewTexCoord.buffer];
-					texCoords = reinterpret_cast<const float*>(&bufferTexCoord.data[bufferViewTexCoord.byteOffset + accTexCoord.byteOffset]);
-				}
+			GLTFMeshPart& meshPart = parts[part->second];
+			job.mesh = meshPart.mesh.get();
+			job.vertexOffset = meshPart.numVerts;
+			job.indexOffset = meshPart.numIndices;
+			meshPart.numVerts += job.numVerts;
+			meshPart.numIndices += job.numIndices;
+			jobs.push_back(job);
+		}
+	}
 
-				// Indices...
-				const tinygltf::Accessor& accIndex = model.accessors[prim.indices];
-				{
-					const tinygltf::BufferView& bufferViewIndex = model.bufferViews[accIndex.bufferView];
-					const tinygltf::Buffer& bufferIndex = model.buffers[bufferViewIndex.buffer];
+	// Allocate each mesh once, the jobs write to their own ranges.
+	for (GLTFMeshPart& part : parts)
+	{
+		part.mesh->GetVertices().resize(part.numVerts);
+		part.mesh->GetIndices().resize(part.numIndices);
+		sStats.numVertices += (uint32_t)part.numVerts;
+		sStats.numIndices += (uint32_t)part.numIndices;
+	}
 
-					if (accIndex.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
-						indices_s = reinterpret_cast<const uint16_t*>(&bufferIndex.data[bufferViewIndex.byteOffset]);
+	sStats.numPrimitives = (uint32_t)jobs.size();
+	sStats.numThreads = GLTFConvertPrimitives(jobs);
 
-					if (accIndex.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT)
-						indices_i = reinterpret_cast<const uint32_t*>(&bufferIndex.data[bufferViewIndex.byteOffset]);
-				}
+	for (const GLTFPrimitiveJob& job : jobs)
+		job.mesh->GetBounds().Add(job.bounds);
 
-				std::vector<uint32_t> indicesMap;
-				indicesMap.resize(accPosition.count);
+	// Meshes with the same content as a live one share it & its render mesh.
+	for (GLTFMeshPart& part : parts)
+	{
+		uint64_t hash = AssetRegistry::HashMesh(part.mesh.get());
+		Ptr<Mesh> shared = AssetRegistry::FindMesh(hash, part.mesh.get());
 
+		if (shared)
+		{
+			part.mesh = shared;
+			++sStats.numSharedMeshes;
+		}
+		else
+		{
+			part.mesh = AssetRegistry::AddMesh(hash, part.mesh);
+		}
+	}
 
-				// Vertex Data...
-				for (size_t i = 0; i < accPosition.count; ++i)
-				{
-					MeshVert vx;
-					vx.position.x = positions[i * 3 + 0];
-					vx.position.z = positions[i * 3 + 1];
-					vx.position.y = positions[i * 3 + 2];
-					vx.position *= 0.5f;
+	sStats.convertTime = (float)(GetTimeMS() - stageTime);
+	stageTime = GetTimeMS();
+	SceneLoader::SetProgress(0.7f);
 
-					vx.normal.x = normals[i * 3 + 0];
-					vx.normal.z = normals[i * 3 + 1];
-					vx.normal.y = normals[i * 3 + 2];
+	if (SceneLoader::IsCanceled())
+		return false;
 
-					vx.texCoord.x = texCoords[i * 2 + 0];
-					vx.texCoord.y = texCoords[i * 2 + 1];
 
-					mesh->GetBounds().Add(vx.position);
-					mesh->GetVertices().push_back(vx);
+	// Create & Update the render data once, the loader thread leaves it to the main thread & shared meshes have it.
+	if (!SceneLoader::IsLoaderThread())
+	{
+		for (GLTFMeshPart& part : parts)
+		{
+			if (!part.mesh->GetRenderMesh())
+				part.mesh->UpdateRenderMesh();
+		}
 
-					indicesMap[i] = (uint32_t)mesh->GetVertices().size() - 1;
-				}
+		for (Ptr<Material>& material : materails)
+			material->UpdateRenderMaterial();
+	}
 
+	// A MeshNode per glTF node with its world transform, nodes using the same glTF mesh share its
+	// meshes and are drawn as instances of them. Flattened, a single MeshNode with all the parts.
+	std::vector<GLTFNodeInstance> instances;
 
-				// Indices...
-				for (size_t i = 0; i < accIndex.count; i+=3)
-				{
-					uint32_t index0 = indices_i == nullptr ? indices_s[i+0] : indices_i[i+0];
-					uint32_t index1 = indices_i == nullptr ? indices_s[i+1] : indices_i[i+1];
-					uint32_t index2 = indices_i == nullptr ? indices_s[i+2] : indices_i[i+2];
+	if (isFlatten)
+		instances.push_back(GLTFNodeInstance{ 0, glm::mat4(1.0f) });
+	else
+		GLTFCollectNodes(model, instances);
 
-					index0 = indicesMap[index0];
-					index1 = indicesMap[index1];
-					index2 = indicesMap[index2];
+	std::vector< Ptr<MeshNode> > nodes;
 
-					mesh->GetIndices().push_back(index0);
-					mesh->GetIndices().push_back(index2);
-					mesh->GetIndices().push_back(index1);
-				}
+	for (const GLTFNodeInstance& instance : instances)
+	{
+		const std::vector<uint32_t>& nodeParts = meshParts[instance.mesh];
 
+		if (nodeParts.empty())
+			continue;
 
-			}
-		}
-	}
+		Ptr<MeshNode> node = Ptr<MeshNode>( new MeshNode() );
+		node->SetTransform(Transform(GLTFToSceneMatrix(instance.transform)));
 
+		for (uint32_t i = 0; i < (uint32_t)nodeParts.size(); ++i)
+		{
+			const GLTFMeshPart& part = parts[nodeParts[i]];
+			node->SetMesh(i, part.mesh);
+			node->SetMaterial(i, materails[part.material]);
+		}
 
-	// Create a new MeshNode and add it to the scene.
-	Ptr<MeshNode> node = Ptr<MeshNode>( new MeshNode() );
+		nodes.push_back(node);
+	}
 
-	int32_t gcount = 0;
+	sStats.numNodes = (uint32_t)nodes.size();
 
-	for (uint32_t i = 0; i < (uint32_t)meshes.size(); ++i)
-	{
-		//if (materails[i]->GetColorTexture() == nullptr)
-		//	continue;
 
-		meshes[i]->UpdateRenderMesh(); // Create & Update RenderMesh.
-		materails[i]->UpdateRenderMaterial();
-		node->SetMesh(gcount, meshes[i]);
-		node->SetMaterial(gcount, materails[i]);
+	sStats.uploadTime = (float)(GetTimeMS() - stageTime);
+	SceneLoader::SetProgress(0.8f);
 
-		++gcount;
-	}
+	for (Ptr<MeshNode>& node : nodes)
+		scene->AddNode(node);
 
+	sStats.totalTime = (float)(GetTimeMS() - startTime);
 
-	scene->AddNode(node);
+	LOGI("Imported GLTF file(%s) in %.1f ms: Parse %.1f ms, Textures %.1f ms (%d images on %d threads), "
+		"Convert %.1f ms (%d primitives on %d threads), Upload %.1f ms, %d nodes, Shared %d images & %d meshes.",
+		file.c_str(), sStats.totalTime, sStats.parseTime, sStats.textureTime, sStats.numImages, sStats.numDecodeThreads,
+		sStats.convertTime, sStats.numPrimitives, sStats.numThreads, sStats.uploadTime, sStats.numNodes,
+		sStats.numSharedImages, sStats.numSharedMeshes);
 
-	gImagesUri.clear();
-	gImagesMap.clear();
 	return true;
 }
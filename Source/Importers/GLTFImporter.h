@@ -27,6 +27,7 @@
 
 #include "Core/Core.h"
 #include <string>
+#include <vector>
 
 
 
@@ -37,11 +38,65 @@ class Mesh;
 
 
 
+// How the glTF scene is imported.
+enum class EGLTFImportMode
+{
+	// A MeshNode per glTF node with a mesh, glTF meshes used by many nodes are shared & instanced.
+	Nodes,
+
+	// A single MeshNode with a mesh per material, all primitives are merged once ignoring the nodes.
+	Flatten
+};
+
+
+
+
+
+// GLTFImportStats:
+//     - timings of the last import in milliseconds.
+//
+struct GLTFImportStats
+{
+	// Reading & parsing the file.
+	float parseTime;
+
+	// Decoding & uploading the material textures.
+	float textureTime;
+
+	// Converting the geometry into the material meshes.
+	float convertTime;
+
+	// Creating the render meshes & materials.
+	float uploadTime;
+
+	// The whole import.
+	float totalTime;
+
+	// The number of mesh nodes created.
+	uint32_t numNodes;
+
+	// The number of converted primitives & threads used.
+	uint32_t numPrimitives;
+	uint32_t numThreads;
+
+	// The number of decoded images & threads used.
+	uint32_t numImages;
+	uint32_t numDecodeThreads;
+
+	// The number of vertices & indices in all meshes.
+	uint32_t numVertices;
+	uint32_t numIndices;
+
+	// The number of images & meshes found in the asset registry.
+	uint32_t numSharedImages;
+	uint32_t numSharedMeshes;
+};
+
 
 
 
 // GLTFImporter:
-//     - Import .gltf files.
+//     - Import .gltf & .glb files.
 //
 class GLTFImporter
 {
@@ -52,5 +107,25 @@ public:
 	// Import GLTF models into the scene.
 	static bool Import(Scene* scene, const std::string& file);
 
+	// Return the stats of the last import.
+	static inline const GLTFImportStats& GetStats() { return sStats; }
+
+	// Return the files read by the last import besides the imported file, external buffers & images.
+	static inline const std::vector<std::string>& GetDependencies() { return sDependencies; }
+
+	// Set/Get how the glTF scenes are imported, used by the next imports.
+	static inline void SetImportMode(EGLTFImportMode mode) { sImportMode = mode; }
+	static inline EGLTFImportMode GetImportMode() { return sImportMode; }
+
+private:
+	// The import mode.
+	static EGLTFImportMode sImportMode;
+
+	// Stats of the last import.
+	static GLTFImportStats sStats;
+
+	// The files read by the last import besides the imported file.
+	static std::vector<std::string> sDependencies;
+
 };
 
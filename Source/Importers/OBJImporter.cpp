@@ -19,13 +19,1067 @@
 // SOFTWARE.
 
 
+#include "OBJImporter.h"
+#include "SceneLoader.h"
+#include "AssetRegistry.h"
+#include "Core/GISystem.h"
+#include "Core/Image2D.h"
+#include "Core/Mesh.h"
+#include "Core/Material.h"
+#include "Core/MappedFile.h"
+#include "Core/ParallelFor.h"
 
 
+#include "Scene/Scene.h"
+#include "Scene/MeshNode.h"
 
-#include "OBJImporter.h"
 
 
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
+
+
+
+#include <array>
+#include <map>
+#include <fstream>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <thread>
+
+
+
+// List of supported obj extensions.
+static const std::array<std::string, 1> OBJ_EXT_LIST = { ".obj" };
+
+
+// The maximum number of threads parsing chunks & building meshes.
+#define OBJ_MAX_THREADS 16
+
+// The number of chunks per thread, smaller chunks balance the threads better.
+#define OBJ_CHUNKS_PER_THREAD 4
+
+// The minimum size of a chunk in bytes.
+#define OBJ_MIN_CHUNK_SIZE (256 * 1024)
+
+// The maximum number of threads decoding images.
+#define OBJ_MAX_DECODE_THREADS 8
+
+// No vertex in the vertex table.
+#define OBJ_NO_VERTEX 0xFFFFFFFFu
+
+
+
+OBJImportStats OBJImporter::sStats = OBJImportStats{};
+std::vector<std::string> OBJImporter::sDependencies;
+
+
+// Powers of ten exactly representable as a double.
+static const double OBJ_POW10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+
+
+
+// The type of an obj line.
+enum class EOBJLineType : uint32_t
+{
+	// Comments, groups, smoothing & anything not imported.
+	Other,
+
+	// v, vt & vn.
+	Position,
+	TexCoord,
+	Normal,
+
+	// f
+	Face,
+
+	// usemtl & mtllib.
+	UseMaterial,
+	MaterialLib
+};
+
+
+
+
+// OBJCorner:
+//    - a face corner, the 0-based index of its position, texture coordinate & normal, -1 if it has none.
+//
+struct OBJCorner
+{
+	int32_t position;
+	int32_t texCoord;
+	int32_t normal;
+
+	// Compare.
+	inline bool operator==(const OBJCorner& other) const
+	{
+		return position == other.position && texCoord == other.texCoord && normal == other.normal;
+	}
+};
+
+
+// OBJVertexTable:
+//    - the vertices built for a mesh, chained by their position & keyed by the corner each vertex was built from.
+//
+struct OBJVertexTable
+{
+	// The first position of the mesh & the first vertex of each position from it.
+	int32_t firstPosition;
+	std::vector<uint32_t> heads;
+
+	// The next vertex with the same position & the corner of each vertex.
+	std::vector<uint32_t> next;
+	std::vector<OBJCorner> corners;
+
+	// Return the vertex of a corner, OBJ_NO_VERTEX if it has none.
+	inline uint32_t Find(const OBJCorner& corner) const
+	{
+		uint32_t vertex = heads[corner.position - firstPosition];
+
+		while (vertex != OBJ_NO_VERTEX && !(corners[vertex] == corner))
+			vertex = next[vertex];
+
+		return vertex;
+	}
+
+	// Add the vertex of a corner, return its index.
+	inline uint32_t Add(const OBJCorner& corner)
+	{
+		uint32_t& head = heads[corner.position - firstPosition];
+		uint32_t vertex = (uint32_t)corners.size();
+
+		next.push_back(head);
+		corners.push_back(corner);
+		head = vertex;
+
+		return vertex;
+	}
+};
+
+
+// OBJChunk:
+//    - a line aligned range of the file, counted then parsed by a single thread.
+//
+struct OBJChunk
+{
+	// The range of the chunk in the file.
+	const char* begin;
+	const char* end;
+
+	// The number of positions, texture coordinates & normals in the chunk.
+	uint32_t numPositions;
+	uint32_t numTexCoords;
+	uint32_t numNormals;
+
+	// The index of the first position, texture coordinate & normal of the chunk in the file.
+	uint32_t firstPosition;
+	uint32_t firstTexCoord;
+	uint32_t firstNormal;
+
+	// The last material used in the chunk, if it uses one.
+	std::string lastMaterial;
+	bool hasMaterial;
+
+	// The material libraries of the chunk.
+	std::vector<std::string> materialLibs;
+
+	// The materials used by the chunk, the first one is the material in use at its start.
+	std::vector<std::string> materials;
+
+	// The triangle corners of each chunk material.
+	std::vector< std::vector<OBJCorner> > triangles;
+
+	// The number of triangles & the faces skipped for invalid indices.
+	uint32_t numTriangles;
+	uint32_t numInvalidFaces;
+};
+
+
+// OBJMeshJob:
+//    - the triangles of a material from all the chunks, merged into its mesh.
+//
+struct OBJMeshJob
+{
+	// The material name.
+	std::string material;
+
+	// The triangle corners of each chunk using the material, in file order.
+	std::vector<const std::vector<OBJCorner>*> triangles;
+	size_t numCorners;
+
+	// The built mesh.
+	Ptr<Mesh> mesh;
+};
+
+
+// OBJImportData:
+//    - data shared while importing a single obj file.
+//
+struct OBJImportData
+{
+	// The directory of the imported file.
+	std::string dir;
+
+	// The mapped file.
+	MappedFile file;
+
+	// The file chunks in order.
+	std::vector<OBJChunk> chunks;
+
+	// The positions, texture coordinates & normals of the file, each chunk writes its own range.
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec2> texCoords;
+	std::vector<glm::vec3> normals;
+
+	// The material libraries of the file.
+	std::vector<std::string> materialLibs;
+
+	// A mesh job for each material used by the triangles.
+	std::vector<OBJMeshJob> meshes;
+};
+
+
+
+
+// --- -- - -- --- --- -- - -- --- --- -- - -- --- --- -- - -- --- --- -- - -- --- --- -- - -- --- 
+
+
+
+static double GetTimeMS()
+{
+	using namespace std::chrono;
+	return duration<double, std::milli>(high_resolution_clock::now().time_since_epoch()).count();
+}
+
+
+static inline const char* OBJSkipSpaces(const char* p, const char* end)
+{
+	while (p < end && (*p == ' ' || *p == '\t'))
+		++p;
+
+	return p;
+}
+
+
+static inline bool OBJIsDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+
+// Return true if the line starts with the keyword followed by a space.
+static inline bool OBJIsKeyword(const char* p, const char* end, const char* keyword, size_t length)
+{
+	return (size_t)(end - p) > length && memcmp(p, keyword, length) == 0 && (p[length] == ' ' || p[length] == '\t');
+}
+
+
+// Return the type of the line & move p after its keyword, both passes use it to see the same lines.
+static inline EOBJLineType OBJGetLineType(const char*& p, const char* end)
+{
+	p = OBJSkipSpaces(p, end);
+
+	if (end - p < 2)
+		return EOBJLineType::Other;
+
+	if (p[0] == 'v')
+	{
+		if (p[1] == ' ' || p[1] == '\t')
+		{
+			p += 1;
+			return EOBJLineType::Position;
+		}
+
+		if (OBJIsKeyword(p, end, "vt", 2))
+		{
+			p += 2;
+			return EOBJLineType::TexCoord;
+		}
+
+		if (OBJIsKeyword(p, end, "vn", 2))
+		{
+			p += 2;
+			return EOBJLineType::Normal;
+		}
+	}
+	else if (p[0] == 'f' && (p[1] == ' ' || p[1] == '\t'))
+	{
+		p += 1;
+		return EOBJLineType::Face;
+	}
+	else if (OBJIsKeyword(p, end, "usemtl", 6))
+	{
+		p += 6;
+		return EOBJLineType::UseMaterial;
+	}
+	else if (OBJIsKeyword(p, end, "mtllib", 6))
+	{
+		p += 6;
+		return EOBJLineType::MaterialLib;
+	}
+
+	return EOBJLineType::Other;
+}
+
+
+// Return the rest of the line without its surrounding spaces.
+static std::string OBJGetName(const char* p, const char* end)
+{
+	p = OBJSkipSpaces(p, end);
+
+	while (end > p && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r'))
+		--end;
+
+	return std::string(p, end);
+}
+
+
+// Parse a float, return the end of the parsed number.
+static inline const char* OBJParseFloat(const char* p, const char* end, float& value)
+{
+	p = OBJSkipSpaces(p, end);
+
+	bool isNegative = false;
+
+	if (p < end && (*p == '-' || *p == '+'))
+		isNegative = *p++ == '-';
+
+	double mantissa = 0.0;
+	int32_t exponent = 0;
+
+	for (; p < end && OBJIsDigit(*p); ++p)
+		mantissa = mantissa * 10.0 + (double)(*p - '0');
+
+	if (p < end && *p == '.')
+	{
+		for (++p; p < end && OBJIsDigit(*p); ++p)
+		{
+			mantissa = mantissa * 10.0 + (double)(*p - '0');
+			--exponent;
+		}
+	}
+
+	if (p < end && (*p == 'e' || *p == 'E'))
+	{
+		++p;
+		bool isNegativeExp = false;
+
+		if (p < end && (*p == '-' || *p == '+'))
+			isNegativeExp = *p++ == '-';
+
+		int32_t exp = 0;
+
+		for (; p < end && OBJIsDigit(*p); ++p)
+			exp = std::min(exp * 10 + (*p - '0'), 1000);
+
+		exponent += isNegativeExp ? -exp : exp;
+	}
+
+	int32_t absExponent = std::abs(exponent);
+	double scale = absExponent <= 22 ? OBJ_POW10[absExponent] : std::pow(10.0, (double)absExponent);
+	double result = exponent < 0 ? mantissa / scale : mantissa * scale;
+
+	value = (float)(isNegative ? -result : result);
+	return p;
+}
+
+
+// Parse an integer, return the end of the parsed number.
+static inline const char* OBJParseInt(const char* p, const char* end, int32_t& value)
+{
+	bool isNegative = false;
+
+	if (p < end && (*p == '-' || *p == '+'))
+		isNegative = *p++ == '-';
+
+	int64_t result = 0;
+
+	for (; p < end && OBJIsDigit(*p); ++p)
+		result = std::min(result * 10 + (*p - '0'), (int64_t)INT32_MAX);
+
+	value = (int32_t)(isNegative ? -result : result);
+	return p;
+}
+
+
+// Resolve a 1-based or negative relative index to 0-based, zero means no index.
+// @param count: the number of elements before the face.
+// @param total: the number of elements in the file.
+static inline bool OBJResolveIndex(int32_t index, uint32_t count, size_t total, int32_t& outIndex)
+{
+	if (index == 0)
+	{
+		outIndex = -1;
+		return true;
+	}
+
+	int64_t resolved = index > 0 ? (int64_t)index - 1 : (int64_t)count + index;
+	outIndex = (int32_t)resolved;
+
+	return resolved >= 0 && resolved < (int64_t)total;
+}
+
+
+// Split the mapped file into chunks that start & end at line boundaries.
+static void OBJSplitChunks(OBJImportData& data, uint32_t numChunks)
+{
+	const char* begin = reinterpret_cast<const char*>(data.file.GetData());
+	const char* end = begin + data.file.GetSize();
+	const size_t size = data.file.GetSize();
+
+	for (const char* chunkBegin = begin; chunkBegin < end;)
+	{
+		uint32_t index = (uint32_t)data.chunks.size();
+		const char* chunkEnd = index + 1 >= numChunks ? end : std::max(begin + size * (index + 1) / numChunks, chunkBegin);
+
+		// The chunk ends after the line it ends in.
+		const char* eol = static_cast<const char*>(memchr(chunkEnd, '\n', (size_t)(end - chunkEnd)));
+		chunkEnd = eol ? eol + 1 : end;
+
+		data.chunks.emplace_back();
+		data.chunks.back().begin = chunkBegin;
+		data.chunks.back().end = chunkEnd;
+		chunkBegin = chunkEnd;
+	}
+}
+
+
+// First pass, count the chunk attributes & find its materials so the chunks can be parsed in place.
+static void OBJCountChunk(OBJChunk& chunk)
+{
+	for (const char* line = chunk.begin; line < chunk.end;)
+	{
+		const char* eol = static_cast<const char*>(memchr(line, '\n', (size_t)(chunk.end - line)));
+		eol = eol ? eol : chunk.end;
+
+		const char* p = line;
+
+		switch (OBJGetLineType(p, eol))
+		{
+		case EOBJLineType::Position: ++chunk.numPositions; break;
+		case EOBJLineType::TexCoord: ++chunk.numTexCoords; break;
+		case EOBJLineType::Normal: ++chunk.numNormals; break;
+
+		case EOBJLineType::UseMaterial:
+			chunk.lastMaterial = OBJGetName(p, eol);
+			chunk.hasMaterial = true;
+			break;
+
+		case EOBJLineType::MaterialLib:
+			chunk.materialLibs.push_back(OBJGetName(p, eol));
+			break;
+
+		default:
+			break;
+		}
+
+		line = eol + 1;
+	}
+}
+
+
+// Second pass, parse the chunk attributes into their range of the file arrays & fan triangulate its faces.
+static void OBJParseChunk(OBJImportData& data, OBJChunk& chunk)
+{
+	// The attributes before the current line in the file, relative indices are resolved with them.
+	uint32_t numPositions = chunk.firstPosition;
+	uint32_t numTexCoords = chunk.firstTexCoord;
+	uint32_t numNormals = chunk.firstNormal;
+
+	uint32_t material = 0;
+	chunk.triangles.resize(chunk.materials.size());
+
+	std::vector<OBJCorner> face;
+
+	for (const char* line = chunk.begin; line < chunk.end;)
+	{
+		const char* eol = static_cast<const char*>(memchr(line, '\n', (size_t)(chunk.end - line)));
+		eol = eol ? eol : chunk.end;
+
+		const char* p = line;
+
+		switch (OBJGetLineType(p, eol))
+		{
+		case EOBJLineType::Position:
+		{
+			glm::vec3& position = data.positions[numPositions++];
+			p = OBJParseFloat(p, eol, position.x);
+			p = OBJParseFloat(p, eol, position.y);
+			p = OBJParseFloat(p, eol, position.z);
+		}
+		break;
+
+		case EOBJLineType::TexCoord:
+		{
+			glm::vec2& texCoord = data.texCoords[numTexCoords++];
+			p = OBJParseFloat(p, eol, texCoord.x);
+			p = OBJParseFloat(p, eol, texCoord.y);
+		}
+		break;
+
+		case EOBJLineType::Normal:
+		{
+			glm::vec3& normal = data.normals[numNormals++];
+			p = OBJParseFloat(p, eol, normal.x);
+			p = OBJParseFloat(p, eol, normal.y);
+			p = OBJParseFloat(p, eol, normal.z);
+		}
+		break;
+
+		case EOBJLineType::Face:
+		{
+			// Corners: v, v/vt, v//vn or v/vt/vn.
+			face.clear();
+			bool isValid = true;
+
+			for (p = OBJSkipSpaces(p, eol); p < eol && (OBJIsDigit(*p) || *p == '-' || *p == '+'); p = OBJSkipSpaces(p, eol))
+			{
+				int32_t v = 0, vt = 0, vn = 0;
+				p = OBJParseInt(p, eol, v);
+
+				if (p < eol && *p == '/')
+				{
+					if (++p < eol && *p != '/')
+						p = OBJParseInt(p, eol, vt);
+
+					if (p < eol && *p == '/')
+						p = OBJParseInt(p + 1, eol, vn);
+				}
+
+				OBJCorner corner;
+				isValid &= OBJResolveIndex(v, numPositions, data.positions.size(), corner.position) && corner.position >= 0;
+				isValid &= OBJResolveIndex(vt, numTexCoords, data.texCoords.size(), corner.texCoord);
+				isValid &= OBJResolveIndex(vn, numNormals, data.normals.size(), corner.normal);
+				face.push_back(corner);
+			}
+
+			if (!isValid || face.size() < 3)
+			{
+				++chunk.numInvalidFaces;
+				break;
+			}
+
+			std::vector<OBJCorner>& triangles = chunk.triangles[material];
+
+			for (size_t i = 2; i < face.size(); ++i)
+			{
+				triangles.push_back(face[0]);
+				triangles.push_back(face[i - 1]);
+				triangles.push_back(face[i]);
+			}
+
+			chunk.numTriangles += (uint32_t)face.size() - 2;
+		}
+		break;
+
+		case EOBJLineType::UseMaterial:
+		{
+			std::string name = OBJGetName(p, eol);
+			auto iter = std::find(chunk.materials.begin(), chunk.materials.end(), name);
+			material = (uint32_t)(iter - chunk.materials.begin());
+
+			if (iter == chunk.materials.end())
+			{
+				chunk.materials.push_back(name);
+				chunk.triangles.resize(chunk.materials.size());
+			}
+		}
+		break;
+
+		default:
+			break;
+		}
+
+		line = eol + 1;
+	}
+}
+
+
+// Map & parse the file in line aligned chunks, the triangles of each material are then collected into a mesh job.
+static bool OBJParse(OBJImportData& data, const std::string& file, OBJImportStats& stats)
+{
+	if (!data.file.Open(file))
+		return false;
+
+	stats.fileSize = data.file.GetSize();
+
+	uint32_t maxThreads = std::min(std::max(std::thread::hardware_concurrency(), 1u), (uint32_t)OBJ_MAX_THREADS);
+	uint32_t numChunks = (uint32_t)std::min<uint64_t>(stats.fileSize / OBJ_MIN_CHUNK_SIZE, maxThreads * OBJ_CHUNKS_PER_THREAD);
+	OBJSplitChunks(data, std::max(numChunks, 1u));
+
+	// First Pass...
+	ParallelFor((uint32_t)data.chunks.size(), maxThreads, [&data](uint32_t i) { OBJCountChunk(data.chunks[i]); });
+
+	// Each chunk starts after the attributes of the chunks before it & with the material they used last.
+	std::string material;
+
+	for (OBJChunk& chunk : data.chunks)
+	{
+		chunk.firstPosition = stats.numPositions;
+		chunk.firstTexCoord = stats.numTexCoords;
+		chunk.firstNormal = stats.numNormals;
+		chunk.materials.push_back(material);
+
+		stats.numPositions += chunk.numPositions;
+		stats.numTexCoords += chunk.numTexCoords;
+		stats.numNormals += chunk.numNormals;
+
+		if (chunk.hasMaterial)
+			material = chunk.lastMaterial;
+
+		data.materialLibs.insert(data.materialLibs.end(), chunk.materialLibs.begin(), chunk.materialLibs.end());
+	}
+
+	data.positions.resize(stats.numPositions);
+	data.texCoords.resize(stats.numTexCoords);
+	data.normals.resize(stats.numNormals);
+
+	// Second Pass...
+	stats.numChunks = (uint32_t)data.chunks.size();
+	stats.numThreads = ParallelFor((uint32_t)data.chunks.size(), maxThreads, [&data](uint32_t i) { OBJParseChunk(data, data.chunks[i]); });
+
+	// Collect the triangles of each material in file order.
+	std::map<std::string, uint32_t> meshesMap;
+
+	for (const OBJChunk& chunk : data.chunks)
+	{
+		stats.numTriangles += chunk.numTriangles;
+		stats.numInvalidFaces += chunk.numInvalidFaces;
+
+		for (size_t i = 0; i < chunk.materials.size(); ++i)
+		{
+			if (chunk.triangles[i].empty())
+				continue;
+
+			auto iter = meshesMap.find(chunk.materials[i]);
+
+			if (iter == meshesMap.end())
+			{
+				iter = meshesMap.emplace(chunk.materials[i], (uint32_t)data.meshes.size()).first;
+				data.meshes.emplace_back();
+				data.meshes.back().material = chunk.materials[i];
+				data.meshes.back().numCorners = 0;
+			}
+
+			OBJMeshJob& job = data.meshes[iter->second];
+			job.triangles.push_back(&chunk.triangles[i]);
+			job.numCorners += chunk.triangles[i].size();
+		}
+	}
+
+	return true;
+}
+
+
+// Merge the triangles of a material into its mesh, corners with the same attributes share a vertex.
+static void OBJBuildMesh(const OBJImportData& data, OBJMeshJob& job)
+{
+	std::vector<MeshVert>& verts = job.mesh->GetVertices();
+	std::vector<uint32_t>& indices = job.mesh->GetIndices();
+	indices.resize(job.numCorners);
+
+	// The range of positions used by the mesh, the vertices are chained by their position in it.
+	int32_t minPosition = INT32_MAX;
+	int32_t maxPosition = 0;
+
+	for (const std::vector<OBJCorner>* triangles : job.triangles)
+	{
+		for (const OBJCorner& corner : *triangles)
+		{
+			minPosition = std::min(minPosition, corner.position);
+			maxPosition = std::max(maxPosition, corner.position);
+		}
+	}
+
+	OBJVertexTable table;
+	table.firstPosition = minPosition;
+	table.heads.assign((size_t)(maxPosition - minPosition) + 1, OBJ_NO_VERTEX);
+
+	// Vertices without a normal, they accumulate the normals of their triangles.
+	std::vector<uint32_t> smoothVerts;
+	size_t numIndices = 0;
+
+	for (const std::vector<OBJCorner>* triangles : job.triangles)
+	{
+		for (size_t i = 0; i < triangles->size(); i += 3)
+		{
+			uint32_t triangle[3];
+			bool isSmooth = false;
+
+			for (uint32_t k = 0; k < 3; ++k)
+			{
+				const OBJCorner& corner = (*triangles)[i + k];
+				triangle[k] = table.Find(corner);
+				isSmooth |= corner.normal < 0;
+
+				if (triangle[k] != OBJ_NO_VERTEX)
+					continue;
+
+				triangle[k] = table.Add(corner);
+
+				// y & z are swapped & the texture coordinates start at the top.
+				const glm::vec3& p = data.positions[corner.position];
+
+				MeshVert vx;
+				vx.position = glm::vec3(p.x, p.z, p.y);
+				vx.normal = glm::vec3(0.0f);
+				vx.texCoord = glm::vec2(0.0f);
+
+				if (corner.normal >= 0)
+				{
+					const glm::vec3& n = data.normals[corner.normal];
+					vx.normal = glm::vec3(n.x, n.z, n.y);
+				}
+				else
+				{
+					smoothVerts.push_back(triangle[k]);
+				}
+
+				if (corner.texCoord >= 0)
+					vx.texCoord = glm::vec2(data.texCoords[corner.texCoord].x, 1.0f - data.texCoords[corner.texCoord].y);
+
+				verts.push_back(vx);
+				job.mesh->GetBounds().Add(vx.position);
+			}
+
+			// Flipped winding, y & z are swapped.
+			indices[numIndices++] = triangle[0];
+			indices[numIndices++] = triangle[2];
+			indices[numIndices++] = triangle[1];
+
+			if (!isSmooth)
+				continue;
+
+			// Area weighted normal of the flipped triangle.
+			const glm::vec3& p0 = verts[triangle[0]].position;
+			glm::vec3 normal = glm::cross(verts[triangle[2]].position - p0, verts[triangle[1]].position - p0);
+
+			for (uint32_t k = 0; k < 3; ++k)
+			{
+				if ((*triangles)[i + k].normal < 0)
+					verts[triangle[k]].normal += normal;
+			}
+		}
+	}
+
+	for (uint32_t index : smoothVerts)
+	{
+		float length = glm::length(verts[index].normal);
+		verts[index].normal = length > 0.0f ? verts[index].normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+	}
+
+	verts.shrink_to_fit();
+}
+
+
+// Build the material meshes on worker threads, largest first.
+static uint32_t OBJBuildMeshes(OBJImportData& data, OBJImportStats& stats)
+{
+	std::vector<uint32_t> order(data.meshes.size());
+
+	for (uint32_t i = 0; i < (uint32_t)order.size(); ++i)
+	{
+		order[i] = i;
+		data.meshes[i].mesh = Ptr<Mesh>(new Mesh());
+	}
+
+	std::sort(order.begin(), order.end(), [&data](uint32_t a, uint32_t b)
+		{
+			return data.meshes[a].numCorners > data.meshes[b].numCorners;
+		});
+
+	uint32_t numThreads = ParallelFor((uint32_t)order.size(), OBJ_MAX_THREADS, [&data, &order](uint32_t i)
+		{
+			OBJBuildMesh(data, data.meshes[order[i]]);
+		});
+
+	for (const OBJMeshJob& job : data.meshes)
+	{
+		stats.numVertices += (uint32_t)job.mesh->GetVertices().size();
+		stats.numIndices += (uint32_t)job.mesh->GetIndices().size();
+	}
+
+	stats.numMeshes = (uint32_t)data.meshes.size();
+	return numThreads;
+}
+
+
+// Load the material libraries of the file.
+static void OBJLoadMaterialLibs(const OBJImportData& data, std::map<std::string, int>& materialsMap,
+	std::vector<tinyobj::material_t>& materials)
+{
+	for (const std::string& lib : data.materialLibs)
+	{
+		std::ifstream stream(data.dir + lib);
+
+		if (!stream.is_open())
+		{
+			LOGW("Failed to open OBJ material library(%s).", (data.dir + lib).c_str());
+			continue;
+		}
+
+		std::string warn;
+		std::string err;
+		tinyobj::LoadMtl(&materialsMap, &materials, &stream, &warn, &err);
+
+		if (!err.empty())
+			LOGW("OBJ material library(%s): %s", lib.c_str(), err.c_str());
+	}
+}
+
+
+
+// --- -- - -- --- --- -- - -- --- --- -- - -- --- --- -- - -- --- --- -- - -- --- --- -- - -- --- 
+
+
+
+bool OBJImporter::IsSupported(const std::string& file)
+{
+	std::string ext = GISystem::GetFileExtension(file);
+
+	if (ext.empty())
+		return false;
+
+	for (uint32_t i = 0; i < OBJ_EXT_LIST.size(); ++i)
+	{
+		if (OBJ_EXT_LIST[i] == ext)
+			return true;
+	}
+
+	return false;
+}
+
+
+bool OBJImporter::Import(Scene* scene, const std::string& file)
+{
+	double startTime = GetTimeMS();
+	double stageTime = startTime;
+	sStats = OBJImportStats{};
+	sDependencies.clear();
+
+	std::string nfile = GISystem::NormalizePath(file);
+
+	OBJImportData data;
+	data.dir = GISystem::GetDirectory(nfile);
+
+	// Geometry...
+	if (!OBJParse(data, nfile, sStats))
+	{
+		LOGE("Failed to import OBJ file(%s).", file.c_str());
+		return false;
+	}
+
+	if (data.meshes.empty())
+	{
+		LOGE("Failed to import OBJ file(%s): it has no triangles.", file.c_str());
+		return false;
+	}
+
+	sStats.parseTime = (float)(GetTimeMS() - stageTime);
+	stageTime = GetTimeMS();
+	SceneLoader::SetProgress(0.4f);
+
+	if (SceneLoader::IsCanceled())
+		return false;
+
+	OBJBuildMeshes(data, sStats);
+
+	sStats.buildTime = (float)(GetTimeMS() - stageTime);
+	stageTime = GetTimeMS();
+	SceneLoader::SetProgress(0.6f);
+
+	if (SceneLoader::IsCanceled())
+		return false;
+
+
+	// Materials & their color textures...
+	std::map<std::string, int> mtlMap;
+	std::vector<tinyobj::material_t> mtlMaterials;
+	OBJLoadMaterialLibs(data, mtlMap, mtlMaterials);
+
+	for (const std::string& lib : data.materialLibs)
+		sDependencies.push_back(data.dir + lib);
+
+	std::vector<const tinyobj::material_t*> meshMtls(data.meshes.size(), nullptr);
+	std::map< std::string, Ptr<Image2D> > images;
+	std::vector<std::string> imagePaths;
+
+	for (size_t i = 0; i < data.meshes.size(); ++i)
+	{
+		auto iter = mtlMap.find(data.meshes[i].material);
+
+		if (iter == mtlMap.end() || iter->second < 0 || iter->second >= (int)mtlMaterials.size())
+			continue;
+
+		meshMtls[i] = &mtlMaterials[iter->second];
+		const std::string& texture = meshMtls[i]->diffuse_texname;
+
+		if (!texture.empty() && images.emplace(texture, nullptr).second)
+			imagePaths.push_back(texture);
+	}
+
+	// Decode the images, images with the same content as a live one aren't decoded again.
+	std::vector< Ptr<Image2D> > decoded(imagePaths.size());
+	std::vector<uint8_t> isShared(imagePaths.size(), 0);
+
+	ParallelFor((uint32_t)imagePaths.size(), OBJ_MAX_DECODE_THREADS, [&](uint32_t i)
+		{
+			bool shared = false;
+			decoded[i] = AssetRegistry::LoadImage(GISystem::NormalizePath(data.dir + imagePaths[i]), &shared);
+			isShared[i] = shared ? 1 : 0;
+		});
+
+	for (size_t i = 0; i < imagePaths.size(); ++i)
+	{
+		sDependencies.push_back(GISystem::NormalizePath(data.dir + imagePaths[i]));
+		images[imagePaths[i]] = decoded[i];
+		sStats.numImages += decoded[i] ? 1 : 0;
+		sStats.numSharedImages += isShared[i];
+
+		// The loader thread leaves the render data to the main thread, shared images already have it.
+		if (!SceneLoader::IsLoaderThread() && decoded[i] && !decoded[i]->GetRenderImage())
+			decoded[i]->UpdateRenderImage();
+	}
+
+	std::vector< Ptr<Material> > materials(data.meshes.size());
+
+	for (size_t i = 0; i < data.meshes.size(); ++i)
+	{
+		materials[i] = Ptr<Material>(new Material());
+
+		// Faces without a material library entry keep the default material.
+		const tinyobj::material_t* mtl = meshMtls[i];
+
+		if (!mtl)
+			continue;
+
+		// The diffuse texture is used as it is, the diffuse color is for untextured materials.
+		Ptr<Image2D> texture = mtl->diffuse_texname.empty() ? nullptr : images[mtl->diffuse_texname];
+		glm::vec3 color = texture ? glm::vec3(1.0f) : glm::vec3(mtl->diffuse[0], mtl->diffuse[1], mtl->diffuse[2]);
+
+		materials[i]->SetColorTexture(texture);
+		materials[i]->SetColor(glm::vec4(color, mtl->dissolve));
+		materials[i]->SetEmission(glm::vec4(mtl->emission[0], mtl->emission[1], mtl->emission[2], 0.0f));
+	}
+
+	sStats.textureTime = (float)(GetTimeMS() - stageTime);
+	stageTime = GetTimeMS();
+	SceneLoader::SetProgress(0.7f);
+
+	if (SceneLoader::IsCanceled())
+		return false;
+
+
+	// Create a new MeshNode and add it to the scene.
+	Ptr<MeshNode> node = Ptr<MeshNode>(new MeshNode());
+
+	for (uint32_t i = 0; i < (uint32_t)data.meshes.size(); ++i)
+	{
+		// Meshes with the same content as a live one share it & its render mesh.
+		Ptr<Mesh> mesh = data.meshes[i].mesh;
+		uint64_t hash = AssetRegistry::HashMesh(mesh.get());
+		Ptr<Mesh> shared = AssetRegistry::FindMesh(hash, mesh.get());
+
+		if (shared)
+		{
+			mesh = shared;
+			++sStats.numSharedMeshes;
+		}
+		else
+		{
+			mesh = AssetRegistry::AddMesh(hash, mesh);
+		}
+
+		// Create & Update RenderMesh, the loader thread leaves it to the main thread.
+		if (!SceneLoader::IsLoaderThread())
+		{
+			if (!mesh->GetRenderMesh())
+				mesh->UpdateRenderMesh();
+
+			materials[i]->UpdateRenderMaterial();
+		}
+
+		node->SetMesh(i, mesh);
+		node->SetMaterial(i, materials[i]);
+	}
+
+	sStats.uploadTime = (float)(GetTimeMS() - stageTime);
+	SceneLoader::SetProgress(0.8f);
+
+	scene->AddNode(node);
+
+	sStats.totalTime = (float)(GetTimeMS() - startTime);
+
+	LOGI("Imported OBJ file(%s) in %.1f ms: Parse %.1f ms (%d chunks on %d threads, %.1f MB/s), Build %.1f ms "
+		"(%d meshes, %d triangles, %d vertices), Textures %.1f ms (%d images), Upload %.1f ms, Shared %d images & %d meshes.",
+		file.c_str(), sStats.totalTime, sStats.parseTime, sStats.numChunks, sStats.numThreads,
+		sStats.parseTime > 0.0f ? (float)sStats.fileSize / (1024.0f * 1024.0f) / (sStats.parseTime * 0.001f) : 0.0f,
+		sStats.buildTime, sStats.numMeshes, sStats.numTriangles, sStats.numVertices, sStats.textureTime, sStats.numImages,
+		sStats.uploadTime, sStats.numSharedImages, sStats.numSharedMeshes);
+
+	if (sStats.numInvalidFaces != 0)
+		LOGW("OBJ file(%s) has %d faces with invalid indices, they were skipped.", file.c_str(), sStats.numInvalidFaces);
+
+	return true;
+}
+
+
+OBJBenchmarkStats OBJImporter::Benchmark(const std::string& file)
+{
+	OBJBenchmarkStats stats = OBJBenchmarkStats{};
+	std::string nfile = GISystem::NormalizePath(file);
+
+	// Single threaded tinyobjloader, it parses & triangulates the faces.
+	{
+		tinyobj::attrib_t attrib;
+		std::vector<tinyobj::shape_t> shapes;
+		std::vector<tinyobj::material_t> materials;
+		std::string warn;
+		std::string err;
+
+		double startTime = GetTimeMS();
+
+		if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, nfile.c_str(), GISystem::GetDirectory(nfile).c_str()))
+		{
+			LOGE("OBJ benchmark failed to load file(%s): %s", file.c_str(), err.c_str());
+			return stats;
+		}
+
+		stats.tinyobjTime = (float)(GetTimeMS() - startTime);
+	}
+
+	// The importer geometry, parsing the chunks & building the material meshes without textures or render data.
+	{
+		OBJImportData data;
+		OBJImportStats importStats = OBJImportStats{};
+
+		double startTime = GetTimeMS();
+
+		if (!OBJParse(data, nfile, importStats))
+		{
+			LOGE("OBJ benchmark failed to import file(%s).", file.c_str());
+			return stats;
+		}
+
+		OBJBuildMeshes(data, importStats);
 
+		stats.importTime = (float)(GetTimeMS() - startTime);
+		stats.numThreads = importStats.numThreads;
+		stats.fileSize = importStats.fileSize;
+	}
 
+	float sizeMB = (float)stats.fileSize / (1024.0f * 1024.0f);
+	stats.tinyobjRate = stats.tinyobjTime > 0.0f ? sizeMB / (stats.tinyobjTime * 0.001f) : 0.0f;
+	stats.importRate = stats.importTime > 0.0f ? sizeMB / (stats.importTime * 0.001f) : 0.0f;
 
+	LOGI("OBJ benchmark(%s) %.1f MB: tinyobjloader %.1f ms (%.1f MB/s), importer %.1f ms (%.1f MB/s) on %d threads, %.2fx.",
+		file.c_str(), sizeMB, stats.tinyobjTime, stats.tinyobjRate, stats.importTime, stats.importRate, stats.numThreads,
+		stats.importTime > 0.0f ? stats.tinyobjTime / stats.importTime : 0.0f);
 
+	return stats;
+}
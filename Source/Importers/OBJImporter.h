@@ -19,12 +19,126 @@
 // SOFTWARE.
 
 
-
-
 #pragma once
 
 
 
 
 #include "Core/Core.h"
+#include <string>
+#include <vector>
+
+
+
+class Scene;
+
+
+
+
+
+
+
+// OBJImportStats:
+//     - timings of the last import in milliseconds.
+//
+struct OBJImportStats
+{
+	// Mapping the file & parsing its chunks.
+	float parseTime;
+
+	// Merging the chunks into the material meshes.
+	float buildTime;
+
+	// Loading the material library & decoding its textures.
+	float textureTime;
+
+	// Creating the render meshes & materials.
+	float uploadTime;
+
+	// The whole import.
+	float totalTime;
+
+	// The number of line aligned chunks & the threads parsing them.
+	uint32_t numChunks;
+	uint32_t numThreads;
+
+	// The number of positions, texture coordinates & normals in the file.
+	uint32_t numPositions;
+	uint32_t numTexCoords;
+	uint32_t numNormals;
+
+	// The number of triangles & the number of faces that were skipped for invalid indices.
+	uint32_t numTriangles;
+	uint32_t numInvalidFaces;
+
+	// The number of unique vertices & indices in all meshes.
+	uint32_t numVertices;
+	uint32_t numIndices;
+
+	// The number of material meshes & decoded images.
+	uint32_t numMeshes;
+	uint32_t numImages;
+
+	// The number of images & meshes found in the asset registry.
+	uint32_t numSharedImages;
+	uint32_t numSharedMeshes;
+
+	// The file size in bytes.
+	uint64_t fileSize;
+};
+
+
+// OBJBenchmarkStats:
+//     - the geometry load of the importer vs a single threaded tinyobjloader load of the same file.
+//
+struct OBJBenchmarkStats
+{
+	// The tinyobjloader load & the importer parse & build, in milliseconds.
+	float tinyobjTime;
+	float importTime;
+
+	// The throughput of each in MB/s.
+	float tinyobjRate;
+	float importRate;
+
+	// The number of importer threads.
+	uint32_t numThreads;
+
+	// The file size in bytes.
+	uint64_t fileSize;
+};
+
+
+
+
+// OBJImporter:
+//     - Import .obj files with their .mtl material libraries.
+//     - The file is mapped & split into line aligned chunks parsed in parallel, the chunks are then merged
+//       into a mesh per material with deduplicated vertices.
+//
+class OBJImporter
+{
+public:
+	// Return true if the extension supported by this importer.
+	static bool IsSupported(const std::string& file);
+
+	// Import OBJ models into the scene.
+	static bool Import(Scene* scene, const std::string& file);
+
+	// Benchmark loading the file geometry against a single threaded tinyobjloader load.
+	static OBJBenchmarkStats Benchmark(const std::string& file);
+
+	// Return the stats of the last import.
+	static inline const OBJImportStats& GetStats() { return sStats; }
+
+	// Return the files read by the last import besides the imported file, material libraries & images.
+	static inline const std::vector<std::string>& GetDependencies() { return sDependencies; }
+
+private:
+	// Stats of the last import.
+	static OBJImportStats sStats;
+
+	// The files read by the last import besides the imported file.
+	static std::vector<std::string> sDependencies;
 
+};
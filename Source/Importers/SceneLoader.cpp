@@ -0,0 +1,353 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+
+
+
+#include "SceneLoader.h"
+#include "GLTFImporter.h"
+#include "OBJImporter.h"
+#include "ScenePackage.h"
+#include "Application.h"
+#include "Core/Image2D.h"
+#include "Core/Mesh.h"
+#include "Core/Material.h"
+#include "Scene/Scene.h"
+#include "Scene/MeshNode.h"
+#include "Render/Renderer.h"
+#include "Render/VKInterface/VKIDevice.h"
+#include "Render/VKInterface/VKIUploadManager.h"
+
+
+#include <chrono>
+#include <set>
+
+
+
+
+// The loader of the calling thread, null if it isn't a loader thread.
+static thread_local SceneLoader* tLoader = nullptr;
+
+
+
+
+// Return the current time in milliseconds.
+static double GetTimeMS()
+{
+	using namespace std::chrono;
+	return duration<double, std::milli>(high_resolution_clock::now().time_since_epoch()).count();
+}
+
+
+
+
+
+
+// --- -- - -- --- --- -- - -- --- --- -- - -- --- --- -- - -- --- --- -- - -- --- ---
+
+
+
+
+SceneLoader::SceneLoader()
+	: mState(ESceneLoadState::None)
+	, mIsCanceled(false)
+	, mIsImported(false)
+	, mIsSuccess(false)
+	, mProgress(0.0f)
+	, mNumCreated(0)
+	, mUploadHandle(0)
+	, mStartTime(0.0)
+	, mLoadTime(0.0f)
+{
+
+}
+
+
+SceneLoader::~SceneLoader()
+{
+	mNextFile.clear();
+	mIsCanceled = true;
+
+	if (mThread.joinable())
+		mThread.join();
+
+	ResetScene();
+}
+
+
+void SceneLoader::Load(const std::string& file)
+{
+	if (IsLoading())
+	{
+		mNextFile = file;
+		Cancel();
+		return;
+	}
+
+	Start(file);
+}
+
+
+void SceneLoader::Cancel()
+{
+	if (!IsLoading())
+		return;
+
+	mIsCanceled = true;
+
+	// Creating render data on the main thread? stop right away, the loader thread stops at its next check.
+	if (mState == ESceneLoadState::Uploading)
+	{
+		ResetScene();
+		mState = ESceneLoadState::Canceled;
+		LOGI("Canceled loading scene(%s).", mFile.c_str());
+	}
+}
+
+
+bool SceneLoader::IsLoading() const
+{
+	return mState == ESceneLoadState::Importing || mState == ESceneLoadState::Uploading;
+}
+
+
+Ptr<Scene> SceneLoader::Update()
+{
+	if (mState == ESceneLoadState::Importing && mIsImported)
+		FinishImport();
+
+	if (mState == ESceneLoadState::Uploading && CreateRenderData())
+	{
+		mState = ESceneLoadState::Done;
+		mLoadTime = (float)(GetTimeMS() - mStartTime);
+		LOGI("Loaded scene(%s) in %.1f ms.", mFile.c_str(), mLoadTime);
+
+		mImages.clear();
+		mMeshes.clear();
+		mMaterials.clear();
+		mNumCreated = 0;
+		mUploadHandle = 0;
+
+		// The render thread is done with the current scene before it is swapped.
+		Application::Get().GetRenderer()->FlushRenderThread();
+
+		Ptr<Scene> scene = mScene;
+		mScene.reset();
+		return scene;
+	}
+
+	// Load the next file once the canceled load stopped.
+	if (!IsLoading() && !mNextFile.empty())
+	{
+		std::string file;
+		file.swap(mNextFile);
+		Start(file);
+	}
+
+	return nullptr;
+}
+
+
+void SceneLoader::Start(const std::string& file)
+{
+	CHECK(!IsLoading() && !mThread.joinable());
+	LOGI("Loading scene... (%s)", file.c_str());
+
+	mFile = file;
+	mState = ESceneLoadState::Importing;
+	mIsCanceled = false;
+	mIsImported = false;
+	mIsSuccess = false;
+	mProgress = 0.0f;
+	mStartTime = GetTimeMS();
+
+	mScene = Ptr<Scene>(new Scene());
+	mThread = std::thread(&SceneLoader::ImportThread, this);
+}
+
+
+void SceneLoader::ImportThread()
+{
+	tLoader = this;
+
+	// Imported scenes are cooked into a package loaded the next time...
+	bool isSuccess = false;
+
+	if (GLTFImporter::IsSupported(mFile) || OBJImporter::IsSupported(mFile) || ScenePackage::IsSupported(mFile))
+		isSuccess = ScenePackage::Import(mScene.get(), mFile);
+
+	mIsSuccess = isSuccess;
+	tLoader = nullptr;
+
+	// The main thread takes the scene once this is set.
+	mIsImported = true;
+}
+
+
+void SceneLoader::FinishImport()
+{
+	mThread.join();
+
+	if (mIsCanceled)
+	{
+		ResetScene();
+		mState = ESceneLoadState::Canceled;
+		LOGI("Canceled loading scene(%s).", mFile.c_str());
+		return;
+	}
+
+	if (!mIsSuccess)
+	{
+		ResetScene();
+		mState = ESceneLoadState::Failed;
+		LOGE("Failed to load scene(%s).", mFile.c_str());
+		return;
+	}
+
+	CollectRenderData();
+	mState = ESceneLoadState::Uploading;
+}
+
+
+void SceneLoader::CollectRenderData()
+{
+	std::set<const void*> collected;
+
+	for (Node* node : mScene->GetRenderable())
+	{
+		if (node->GetType() != ENodeType::MeshNode)
+			continue;
+
+		MeshNode* meshNode = static_cast<MeshNode*>(node);
+
+		for (uint32_t i = 0; i < meshNode->GetNumMeshes(); ++i)
+		{
+			Mesh* mesh = meshNode->GetMesh(i);
+			Material* material = meshNode->GetMaterial(i);
+
+			if (mesh && !mesh->GetRenderMesh() && collected.insert(mesh).second)
+				mMeshes.push_back(mesh);
+
+			if (!material || material->GetRenderMaterial() || !collected.insert(material).second)
+				continue;
+
+			// The material textures are created before the materials using them.
+			Image2D* textures[2] = { material->GetColorTexture().get(), material->GetRoughnessMetallic().get() };
+
+			for (Image2D* texture : textures)
+			{
+				if (texture && !texture->GetRenderImage() && collected.insert(texture).second)
+					mImages.push_back(texture);
+			}
+
+			mMaterials.push_back(material);
+		}
+	}
+
+	mNumCreated = 0;
+	mUploadHandle = 0;
+}
+
+
+bool SceneLoader::CreateRenderData()
+{
+	// The render data isn't used by the render thread until the scene is swapped, it is created without flushing it.
+	VKIUploadManager* uploader = Application::Get().GetRenderer()->GetVKDevice()->GetUploader();
+	size_t numTotal = mImages.size() + mMeshes.size() + mMaterials.size();
+
+	// All created? wait for the uploads so the scene is swapped in fully resident.
+	if (mNumCreated == numTotal)
+		return uploader->IsComplete(mUploadHandle);
+
+	double startTime = GetTimeMS();
+
+	while (mNumCreated < numTotal && GetTimeMS() - startTime < SCENE_LOADER_FRAME_BUDGET_MS)
+	{
+		size_t i = mNumCreated++;
+
+		if (i < mImages.size())
+		{
+			mImages[i]->UpdateRenderImage();
+			continue;
+		}
+
+		i -= mImages.size();
+
+		if (i < mMeshes.size())
+		{
+			mMeshes[i]->UpdateRenderMesh();
+			continue;
+		}
+
+		i -= mMeshes.size();
+		mMaterials[i]->UpdateRenderMaterial();
+	}
+
+	float created = (float)mNumCreated / (float)numTotal;
+	mProgress = SCENE_LOADER_IMPORT_PROGRESS + (1.0f - SCENE_LOADER_IMPORT_PROGRESS) * created;
+
+	if (mNumCreated != numTotal)
+		return false;
+
+	// The uploads recorded so far include all of ours.
+	mUploadHandle = uploader->GetLastHandle();
+	return uploader->IsComplete(mUploadHandle);
+}
+
+
+void SceneLoader::ResetScene()
+{
+	if (mScene)
+	{
+		// Render data was created? the render thread should be done with its frames before it is destroyed.
+		if (mNumCreated != 0)
+			Application::Get().GetRenderer()->FlushRenderThread();
+
+		mScene->Destroy();
+		mScene.reset();
+	}
+
+	mImages.clear();
+	mMeshes.clear();
+	mMaterials.clear();
+	mNumCreated = 0;
+	mUploadHandle = 0;
+}
+
+
+bool SceneLoader::IsLoaderThread()
+{
+	return tLoader != nullptr;
+}
+
+
+bool SceneLoader::IsCanceled()
+{
+	return tLoader != nullptr && tLoader->mIsCanceled;
+}
+
+
+void SceneLoader::SetProgress(float progress)
+{
+	if (tLoader)
+		tLoader->mProgress = progress * SCENE_LOADER_IMPORT_PROGRESS;
+}
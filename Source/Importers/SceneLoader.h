@@ -0,0 +1,189 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+
+#pragma once
+
+
+
+#include "Core/Core.h"
+
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+
+
+class Scene;
+class Image2D;
+class Mesh;
+class Material;
+
+
+
+
+// The CPU time in milliseconds spent creating render data each frame once a scene is imported.
+#define SCENE_LOADER_FRAME_BUDGET_MS 4.0
+
+// The part of the progress done by the import, the rest is creating the render data.
+#define SCENE_LOADER_IMPORT_PROGRESS 0.9f
+
+
+
+
+// The state of a scene load.
+enum class ESceneLoadState : uint32_t
+{
+	// Nothing loaded.
+	None,
+
+	// Importing the scene file on the loader thread.
+	Importing,
+
+	// Creating the scene render data on the main thread.
+	Uploading,
+
+	// The scene was loaded & returned.
+	Done,
+
+	// The import failed.
+	Failed,
+
+	// The load was canceled.
+	Canceled
+};
+
+
+
+
+// SceneLoader:
+//    - Load scenes on a loader thread without blocking the main & render threads, the importers skip
+//      creating render data when called by the loader thread.
+//    - Once imported, the render data is created by the main thread between frames under a time budget while
+//      the render thread keeps rendering, the uploads go through the upload manager & the scene is returned
+//      once all of them are complete.
+//    - The render thread is flushed once, when the loaded scene is returned to be swapped in.
+//    - Only one scene is loaded at a time, loading another one cancel the current load first.
+//
+class SceneLoader
+{
+public:
+	// Construct.
+	SceneLoader();
+
+	// Destruct, cancel the current load & wait for the loader thread.
+	~SceneLoader();
+
+	// Start loading a scene file, the current load is canceled & the file is loaded after it stops.
+	void Load(const std::string& file);
+
+	// Cancel the current load.
+	void Cancel();
+
+	// Update the load, called by the main thread between frames.
+	// @return the loaded scene once it is ready to be rendered, null otherwise.
+	Ptr<Scene> Update();
+
+	// Return true if a scene is being loaded.
+	bool IsLoading() const;
+
+	// Return the state of the last load.
+	inline ESceneLoadState GetState() const { return mState; }
+
+	// Return the progress of the current load in [0, 1].
+	inline float GetProgress() const { return mProgress; }
+
+	// Return the file of the current load.
+	inline const std::string& GetFile() const { return mFile; }
+
+	// Return the time of the last load in milliseconds, from start to the scene returned.
+	inline float GetLoadTime() const { return mLoadTime; }
+
+public:
+	// Return true if called by a loader thread, the importers then leave the render data to the main thread.
+	static bool IsLoaderThread();
+
+	// Return true if the load of the calling loader thread is canceled, the importers then stop early.
+	static bool IsCanceled();
+
+	// Set the import progress of the calling loader thread, ignored by other threads.
+	static void SetProgress(float progress);
+
+private:
+	// Start loading a file on the loader thread.
+	void Start(const std::string& file);
+
+	// The loader thread import.
+	void ImportThread();
+
+	// Wait for the loader thread & take its result.
+	void FinishImport();
+
+	// Collect the scene objects that need render data.
+	void CollectRenderData();
+
+	// Create the render data of the collected objects until the frame budget is spent.
+	// @return true if all of them are created & their uploads are complete.
+	bool CreateRenderData();
+
+	// Destroy the scene being loaded.
+	void ResetScene();
+
+private:
+	// The loader thread.
+	std::thread mThread;
+
+	// The scene being loaded & its file.
+	Ptr<Scene> mScene;
+	std::string mFile;
+
+	// File to load once the canceled load stops.
+	std::string mNextFile;
+
+	// The state of the current load.
+	ESceneLoadState mState;
+
+	// Set by the main thread to stop the load.
+	std::atomic<bool> mIsCanceled;
+
+	// Set by the loader thread when it is done & the result of the import.
+	std::atomic<bool> mIsImported;
+	bool mIsSuccess;
+
+	// The progress of the current load.
+	std::atomic<float> mProgress;
+
+	// The scene objects that need render data & the number already created.
+	std::vector<Image2D*> mImages;
+	std::vector<Mesh*> mMeshes;
+	std::vector<Material*> mMaterials;
+	size_t mNumCreated;
+
+	// The last upload handle once all the render data is created.
+	uint64_t mUploadHandle;
+
+	// The time the load started & the time the last load took.
+	double mStartTime;
+	float mLoadTime;
+};
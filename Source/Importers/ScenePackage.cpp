@@ -0,0 +1,1002 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+
+
+
+#include "ScenePackage.h"
+#include "GLTFImporter.h"
+#include "OBJImporter.h"
+#include "SceneLoader.h"
+#include "AssetRegistry.h"
+#include "Core/GISystem.h"
+#include "Core/Image2D.h"
+#include "Core/Mesh.h"
+#include "Core/Material.h"
+#include "Core/MappedFile.h"
+#include "Core/Transform.h"
+#include "Core/BlockCompression.h"
+#include "Core/ParallelFor.h"
+#include "Scene/Scene.h"
+#include "Scene/MeshNode.h"
+
+
+
+#include <vector>
+#include <map>
+#include <fstream>
+#include <chrono>
+#include <cstdio>
+#include <algorithm>
+
+
+
+
+
+// The package magic "RGPK" & version, packages of other versions are cooked again.
+#define SCENE_PACKAGE_MAGIC 0x4B504752
+#define SCENE_PACKAGE_VERSION 6
+
+// The package file extension.
+#define SCENE_PACKAGE_EXT ".rtgipak"
+
+// Alignment of every blob & table in the package.
+#define SCENE_PACKAGE_ALIGNMENT 16
+
+// Index of a missing image.
+#define SCENE_PACKAGE_NO_IMAGE -1
+
+// If true RGBA images are cooked block compressed, BC1 if they are opaque & BC3 otherwise.
+#define SCENE_PACKAGE_COMPRESS_IMAGES 1
+
+// The max number of threads encoding images while cooking.
+#define SCENE_PACKAGE_MAX_ENCODE_THREADS 16
+
+// Dependency flags, the file existed when cooked & its path is relative to the source directory.
+#define SCENE_PACKAGE_DEPENDENCY_FOUND 0x1
+#define SCENE_PACKAGE_DEPENDENCY_RELATIVE 0x2
+
+
+
+
+// The package header at the start of the file.
+struct ScenePackageHeader
+{
+	// Magic & version.
+	uint32_t magic;
+	uint32_t version;
+
+	// The size of the whole package.
+	uint64_t fileSize;
+
+	// The cold import time of the source in milliseconds.
+	float coldTime;
+
+	// The block compression throughput in million texels per second & the average PSNR in dB.
+	float encodeRate;
+	float encodePSNR;
+
+	// The mode the source was imported with, the glTF import mode for glTF sources.
+	uint32_t importMode;
+
+	// The size of the images & the size they would have as RGBA.
+	uint64_t imageBytes;
+	uint64_t rawImageBytes;
+
+	// The number of records in each table.
+	uint32_t numImages;
+	uint32_t numMaterials;
+	uint32_t numMeshes;
+	uint32_t numNodes;
+	uint32_t numParts;
+	uint32_t numDependencies;
+
+	// The offset of each table.
+	uint64_t imagesOffset;
+	uint64_t materialsOffset;
+	uint64_t meshesOffset;
+	uint64_t nodesOffset;
+	uint64_t partsOffset;
+	uint64_t dependenciesOffset;
+};
+
+
+// An image & its mip chain laid out as Image2D::ComputeMipChain does.
+struct ScenePackageImage
+{
+	// The image size.
+	int32_t width;
+	int32_t height;
+
+	// The image EImageFormat.
+	uint32_t format;
+
+	// The number of mips in the chain.
+	uint32_t numMips;
+
+	// Non-zero if the image is in sRGB color space.
+	uint32_t isSRGB;
+
+	// The mip chain blob.
+	uint32_t dataSize;
+	uint64_t dataOffset;
+
+	// The content hash of the image & its mip chain in the asset registry.
+	uint64_t hash;
+};
+
+
+// A material & the index of its images.
+struct ScenePackageMaterial
+{
+	// The base & emission colors.
+	float color[4];
+	float emission[4];
+
+	// The color & roughness metallic images, SCENE_PACKAGE_NO_IMAGE if it has none.
+	int32_t colorImage;
+	int32_t roughnessMetallicImage;
+};
+
+
+// A mesh vertex & index blobs in the render layout.
+struct ScenePackageMesh
+{
+	// The MeshVert blob.
+	uint64_t vertexOffset;
+	uint32_t numVertices;
+
+	// The uint32_t indices blob.
+	uint32_t numIndices;
+	uint64_t indexOffset;
+
+	// The mesh bounds.
+	float boundsMin[3];
+	float boundsMax[3];
+
+	// The content hash of the vertices & indices in the asset registry.
+	uint64_t hash;
+};
+
+
+// A mesh node, its parts are a range of the parts table.
+struct ScenePackageNode
+{
+	// The node transform matrix, column major.
+	float matrix[16];
+
+	// The node parts range.
+	uint32_t firstPart;
+	uint32_t numParts;
+};
+
+
+// A mesh node part, the mesh & the material it is drawn with.
+struct ScenePackagePart
+{
+	uint32_t mesh;
+	uint32_t material;
+};
+
+
+// A file the package was cooked from, the source first then the files its import read.
+struct ScenePackageDependency
+{
+	// The path chars blob.
+	uint64_t pathOffset;
+	uint32_t pathSize;
+
+	// SCENE_PACKAGE_DEPENDENCY_* flags.
+	uint32_t flags;
+
+	// The file size & write time when cooked, zero if it wasn't found.
+	uint64_t size;
+	uint64_t time;
+};
+
+
+// The vertex blobs are uploaded as they are, they must match the render mesh layout.
+static_assert(sizeof(MeshVert) == 32, "The package vertex layout doesn't match MeshVert.");
+
+
+
+
+// An image encoded while cooking.
+struct ScenePackageImageJob
+{
+	// The source image.
+	const Image2D* image;
+
+	// The cooked format & mip chain.
+	EImageFormat format;
+	uint32_t numMips;
+	std::vector<uint8_t> chain;
+
+	// The size of the RGBA mip chain & its number of texels.
+	uint64_t rawSize;
+	uint64_t numTexels;
+
+	// The PSNR of the first mip, zero if it isn't compressed.
+	float psnr;
+
+	// The content hash of the cooked image.
+	uint64_t hash;
+};
+
+
+// Data collected while cooking a scene.
+struct ScenePackageCookData
+{
+	// The package file & the current write offset.
+	std::ofstream fs;
+	uint64_t offset;
+
+	// The cooked records.
+	std::vector<ScenePackageImage> images;
+	std::vector<ScenePackageMaterial> materials;
+	std::vector<ScenePackageMesh> meshes;
+	std::vector<ScenePackageNode> nodes;
+	std::vector<ScenePackagePart> parts;
+	std::vector<ScenePackageDependency> dependencies;
+
+	// Map the scene data to its record index.
+	std::map<const Image2D*, int32_t> imagesMap;
+	std::map<const Material*, uint32_t> materialsMap;
+	std::map<const Mesh*, uint32_t> meshesMap;
+
+	// The images to encode, in the same order as their records.
+	std::vector<ScenePackageImageJob> imageJobs;
+};
+
+
+
+
+
+ScenePackageStats ScenePackage::sStats = ScenePackageStats{};
+
+
+
+// --- -- - -- --- --- -- - -- --- --- -- - -- --- --- -- - -- --- --- -- - -- --- ---
+
+
+
+
+static double GetTimeMS()
+{
+	using namespace std::chrono;
+	return duration<double, std::milli>(high_resolution_clock::now().time_since_epoch()).count();
+}
+
+
+// Get the size & write time of a file, zero if it doesn't exist.
+static bool SPGetFileState(const std::string& file, uint64_t& outSize, uint64_t& outTime)
+{
+	outSize = 0;
+	outTime = 0;
+
+	return GISystem::GetFileInfo(file, outSize, outTime);
+}
+
+
+// Write an aligned blob to the package, return its offset.
+static uint64_t SPWrite(ScenePackageCookData& data, const void* src, uint64_t size)
+{
+	static const char padding[SCENE_PACKAGE_ALIGNMENT] = {};
+
+	uint64_t offset = ALIGN_SIZE(data.offset, (uint64_t)SCENE_PACKAGE_ALIGNMENT);
+	data.fs.write(padding, (std::streamsize)(offset - data.offset));
+	data.fs.write((const char*)src, (std::streamsize)size);
+	data.offset = offset + size;
+
+	return offset;
+}
+
+
+// Return true if a range is inside the package.
+static bool SPIsInRange(uint64_t fileSize, uint64_t offset, uint64_t size)
+{
+	return offset <= fileSize && size <= fileSize - offset;
+}
+
+
+// Return a table of the mapped package, null if it is out of its range.
+template<class T>
+static const T* SPGetTable(const MappedFile& mapped, uint64_t offset, uint32_t count)
+{
+	if (offset % SCENE_PACKAGE_ALIGNMENT != 0 || !SPIsInRange(mapped.GetSize(), offset, (uint64_t)count * sizeof(T)))
+		return nullptr;
+
+	return reinterpret_cast<const T*>(mapped.GetData() + offset);
+}
+
+
+// Add an image to be encoded, return its index.
+static int32_t SPCookImage(ScenePackageCookData& data, const Image2D* img)
+{
+	if (!img)
+		return SCENE_PACKAGE_NO_IMAGE;
+
+	auto iter = data.imagesMap.find(img);
+
+	if (iter != data.imagesMap.end())
+		return iter->second;
+
+	// Only images with their cpu data can be cooked.
+	bool isSupported = img->GetFormat() == EImageFormat::R || img->GetFormat() == EImageFormat::RGBA;
+
+	if (!isSupported || !img->GetImgData().IsValid() || img->GetNumMips() != 1)
+	{
+		data.imagesMap[img] = SCENE_PACKAGE_NO_IMAGE;
+		return SCENE_PACKAGE_NO_IMAGE;
+	}
+
+	ScenePackageImageJob job;
+	job.image = img;
+	job.format = img->GetFormat();
+	job.numMips = 1;
+	job.rawSize = 0;
+	job.numTexels = 0;
+	job.psnr = 0.0f;
+	job.hash = 0;
+
+	int32_t index = (int32_t)data.imageJobs.size();
+	data.imageJobs.push_back(job);
+	data.imagesMap[img] = index;
+
+	return index;
+}
+
+
+// Build the mip chain of an image & block compress it.
+static void SPEncodeImage(ScenePackageImageJob& job)
+{
+	const Image2D* img = job.image;
+	const glm::ivec2& size = img->GetSize();
+
+	job.numMips = img->BuildMipChain(job.chain);
+	job.rawSize = Image2D::ComputeMipChain(EImageFormat::RGBA, size, job.numMips, nullptr);
+
+	for (uint32_t i = 0; i < job.numMips; ++i)
+		job.numTexels += (uint64_t)std::max(size.x >> i, 1) * (uint64_t)std::max(size.y >> i, 1);
+
+	if (!SCENE_PACKAGE_COMPRESS_IMAGES || job.format != EImageFormat::RGBA)
+		return;
+
+	// Opaque? the alpha isn't needed.
+	bool isOpaque = true;
+	const uint8_t* pixels = job.chain.data();
+
+	for (uint64_t i = 0; i < (uint64_t)size.x * size.y && isOpaque; ++i)
+		isOpaque = pixels[i * 4 + 3] == 255;
+
+	job.format = isOpaque ? EImageFormat::BC1 : EImageFormat::BC3;
+
+	std::vector<uint8_t> blocks(Image2D::ComputeMipChain(job.format, size, job.numMips, nullptr));
+	BCCompressMipChain(job.format, size, job.numMips, job.chain.data(), blocks.data());
+	job.psnr = BCComputePSNR(job.format, size, job.chain.data(), blocks.data());
+	job.chain.swap(blocks);
+}
+
+
+// Hash the cooked image, its description seeds the hash of its mip chain.
+static void SPHashImage(ScenePackageImageJob& job)
+{
+	const glm::ivec2& size = job.image->GetSize();
+	uint64_t desc[4] = { (uint64_t)job.format, job.image->IsSRGB() ? 1u : 0u, (uint64_t)size.x, (uint64_t)size.y };
+
+	job.hash = AssetRegistry::Hash(job.chain.data(), job.chain.size(), AssetRegistry::Hash(desc, sizeof(desc)));
+}
+
+
+// Encode the images on worker threads, return the number of threads used.
+static uint32_t SPEncodeImages(std::vector<ScenePackageImageJob>& jobs)
+{
+	return ParallelFor((uint32_t)jobs.size(), SCENE_PACKAGE_MAX_ENCODE_THREADS, [&jobs](uint32_t i)
+		{
+			SPEncodeImage(jobs[i]);
+			SPHashImage(jobs[i]);
+		});
+}
+
+
+// Cook a material, return its index.
+static uint32_t SPCookMaterial(ScenePackageCookData& data, Material* mat)
+{
+	auto iter = data.materialsMap.find(mat);
+
+	if (iter != data.materialsMap.end())
+		return iter->second;
+
+	ScenePackageMaterial rec{};
+	memcpy(rec.color, &mat->GetColor()[0], sizeof(rec.color));
+	memcpy(rec.emission, &mat->GetEmission()[0], sizeof(rec.emission));
+	rec.colorImage = SPCookImage(data, mat->GetColorTexture().get());
+	rec.roughnessMetallicImage = SPCookImage(data, mat->GetRoughnessMetallic().get());
+
+	uint32_t index = (uint32_t)data.materials.size();
+	data.materials.push_back(rec);
+	data.materialsMap[mat] = index;
+
+	return index;
+}
+
+
+// Cook a mesh vertices & indices, return its index.
+static uint32_t SPCookMesh(ScenePackageCookData& data, const Mesh* mesh)
+{
+	auto iter = data.meshesMap.find(mesh);
+
+	if (iter != data.meshesMap.end())
+		return iter->second;
+
+	const std::vector<MeshVert>& verts = mesh->GetVertices();
+	const std::vector<uint32_t>& indices = mesh->GetIndices();
+
+	ScenePackageMesh rec{};
+	rec.numVertices = (uint32_t)verts.size();
+	rec.numIndices = (uint32_t)indices.size();
+	rec.vertexOffset = SPWrite(data, verts.data(), verts.size() * sizeof(MeshVert));
+	rec.indexOffset = SPWrite(data, indices.data(), indices.size() * sizeof(uint32_t));
+	memcpy(rec.boundsMin, &mesh->GetBounds().GetMin()[0], sizeof(rec.boundsMin));
+	memcpy(rec.boundsMax, &mesh->GetBounds().GetMax()[0], sizeof(rec.boundsMax));
+	rec.hash = AssetRegistry::HashMesh(mesh);
+
+	uint32_t index = (uint32_t)data.meshes.size();
+	data.meshes.push_back(rec);
+	data.meshesMap[mesh] = index;
+
+	return index;
+}
+
+
+// Return the mode a source is imported with, packages cooked with another mode are out of date.
+static uint32_t SPGetImportMode(const std::string& source)
+{
+	if (GLTFImporter::IsSupported(source))
+		return (uint32_t)GLTFImporter::GetImportMode();
+
+	return 0;
+}
+
+
+// Cook a dependency, its path is relative to the source directory if it is in it.
+static void SPCookDependency(ScenePackageCookData& data, const std::string& dir, const std::string& file)
+{
+	std::string path = GISystem::NormalizePath(file);
+
+	ScenePackageDependency rec{};
+	rec.flags = SPGetFileState(path, rec.size, rec.time) ? SCENE_PACKAGE_DEPENDENCY_FOUND : 0;
+
+	if (!dir.empty() && path.compare(0, dir.size(), dir) == 0)
+	{
+		path = path.substr(dir.size());
+		rec.flags |= SCENE_PACKAGE_DEPENDENCY_RELATIVE;
+	}
+
+	rec.pathSize = (uint32_t)path.size();
+	rec.pathOffset = SPWrite(data, path.data(), path.size());
+	data.dependencies.push_back(rec);
+}
+
+
+// Return true if the files the package was cooked from didn't change since.
+static bool SPIsUpToDate(const MappedFile& mapped, const std::string& dir,
+	const ScenePackageDependency* dependencies, uint32_t numDependencies)
+{
+	// Cooked without its source?
+	if (numDependencies == 0)
+		return false;
+
+	for (uint32_t i = 0; i < numDependencies; ++i)
+	{
+		const ScenePackageDependency& rec = dependencies[i];
+		std::string path(reinterpret_cast<const char*>(mapped.GetData() + rec.pathOffset), rec.pathSize);
+
+		if (rec.flags & SCENE_PACKAGE_DEPENDENCY_RELATIVE)
+			path = dir + path;
+
+		uint64_t size = 0;
+		uint64_t time = 0;
+		bool isFound = SPGetFileState(path, size, time);
+
+		if (isFound != ((rec.flags & SCENE_PACKAGE_DEPENDENCY_FOUND) != 0) || size != rec.size || time != rec.time)
+			return false;
+	}
+
+	return true;
+}
+
+
+// Validate the records of a mapped package before anything is created from it.
+static bool SPValidate(const MappedFile& mapped, const ScenePackageHeader& header,
+	const ScenePackageImage* images, const ScenePackageMaterial* materials, const ScenePackageMesh* meshes,
+	const ScenePackageNode* nodes, const ScenePackagePart* parts, const ScenePackageDependency* dependencies)
+{
+	if (!images || !materials || !meshes || !nodes || !parts || !dependencies)
+		return false;
+
+	uint64_t fileSize = mapped.GetSize();
+
+	for (uint32_t i = 0; i < header.numImages; ++i)
+	{
+		const ScenePackageImage& rec = images[i];
+		EImageFormat format = (EImageFormat)rec.format;
+
+		bool isSupported = format == EImageFormat::R || format == EImageFormat::RGBA
+			|| format == EImageFormat::BC1 || format == EImageFormat::BC3 || format == EImageFormat::BC5;
+
+		if (!isSupported)
+			return false;
+
+		if (rec.width <= 0 || rec.height <= 0 || rec.numMips == 0 || rec.numMips > IMAGE2D_MAX_MIPS
+			|| rec.numMips > Image2D::GetMaxMips(glm::ivec2(rec.width, rec.height)))
+			return false;
+
+		if (!SPIsInRange(fileSize, rec.dataOffset, rec.dataSize)
+			|| Image2D::ComputeMipChain(format, glm::ivec2(rec.width, rec.height), rec.numMips, nullptr) > rec.dataSize)
+			return false;
+	}
+
+	for (uint32_t i = 0; i < header.numMaterials; ++i)
+	{
+		const ScenePackageMaterial& rec = materials[i];
+
+		if (rec.colorImage < SCENE_PACKAGE_NO_IMAGE || rec.colorImage >= (int32_t)header.numImages
+			|| rec.roughnessMetallicImage < SCENE_PACKAGE_NO_IMAGE || rec.roughnessMetallicImage >= (int32_t)header.numImages)
+			return false;
+	}
+
+	for (uint32_t i = 0; i < header.numMeshes; ++i)
+	{
+		const ScenePackageMesh& rec = meshes[i];
+
+		if (!SPIsInRange(fileSize, rec.vertexOffset, (uint64_t)rec.numVertices * sizeof(MeshVert))
+			|| !SPIsInRange(fileSize, rec.indexOffset, (uint64_t)rec.numIndices * sizeof(uint32_t)))
+			return false;
+	}
+
+	for (uint32_t i = 0; i < header.numNodes; ++i)
+	{
+		if (!SPIsInRange(header.numParts, nodes[i].firstPart, nodes[i].numParts))
+			return false;
+	}
+
+	for (uint32_t i = 0; i < header.numParts; ++i)
+	{
+		if (parts[i].mesh >= header.numMeshes || parts[i].material >= header.numMaterials)
+			return false;
+	}
+
+	for (uint32_t i = 0; i < header.numDependencies; ++i)
+	{
+		if (!SPIsInRange(fileSize, dependencies[i].pathOffset, dependencies[i].pathSize))
+			return false;
+	}
+
+	return true;
+}
+
+
+
+// --- -- - -- --- --- -- - -- --- --- -- - -- --- --- -- - -- --- --- -- - -- --- ---
+
+
+
+
+bool ScenePackage::IsSupported(const std::string& file)
+{
+	std::string ext = GISystem::GetFileExtension(file);
+	return ext == SCENE_PACKAGE_EXT;
+}
+
+
+std::string ScenePackage::GetPackagePath(const std::string& source)
+{
+	std::string nfile = GISystem::NormalizePath(source);
+	return GISystem::GetDirectory(nfile) + GISystem::GetFileName(nfile, false) + SCENE_PACKAGE_EXT;
+}
+
+
+bool ScenePackage::Import(Scene* scene, const std::string& file)
+{
+	// Forget the assets of the scenes destroyed since the last import.
+	AssetRegistry::Prune();
+
+	if (IsSupported(file))
+		return Load(scene, file);
+
+	std::string package = GetPackagePath(file);
+
+	// Cooked package up to date with its source & dependencies?
+	if (Load(scene, package, file))
+	{
+		LOGI("Startup: cooked %.1f ms vs cold %.1f ms (%.1fx).", sStats.totalTime, sStats.coldTime,
+			sStats.totalTime > 0.0f ? sStats.coldTime / sStats.totalTime : 0.0f);
+
+		return true;
+	}
+
+	if (SceneLoader::IsCanceled())
+		return false;
+
+	// Cold import, then cook the imported scene for the next time.
+	double startTime = GetTimeMS();
+	bool isSuccess = false;
+	std::vector<std::string> dependencies;
+
+	if (GLTFImporter::IsSupported(file))
+	{
+		isSuccess = GLTFImporter::Import(scene, file);
+		dependencies = GLTFImporter::GetDependencies();
+	}
+	else if (OBJImporter::IsSupported(file))
+	{
+		isSuccess = OBJImporter::Import(scene, file);
+		dependencies = OBJImporter::GetDependencies();
+	}
+
+	if (!isSuccess || SceneLoader::IsCanceled())
+		return false;
+
+	float coldTime = (float)(GetTimeMS() - startTime);
+	double cookTime = GetTimeMS();
+
+	if (Cook(scene, package, file, dependencies, coldTime))
+	{
+		LOGI("Cooked scene package(%s) in %.1f ms, cold import %.1f ms.", package.c_str(),
+			(float)(GetTimeMS() - cookTime), coldTime);
+	}
+
+	SceneLoader::SetProgress(1.0f);
+	return true;
+}
+
+
+bool ScenePackage::Load(Scene* scene, const std::string& file, const std::string& source)
+{
+	double startTime = GetTimeMS();
+	double stageTime = startTime;
+
+	// The loader thread leaves the render data to the main thread.
+	bool isRenderData = !SceneLoader::IsLoaderThread();
+
+	// The mapping is shared by the images, their mips are streamed from it while they exist.
+	Ptr<MappedFile> mappedFile(new MappedFile());
+	const MappedFile& mapped = *mappedFile;
+
+	if (!mappedFile->Open(file))
+		return false;
+
+	// Header...
+	ScenePackageHeader header;
+
+	if (mapped.GetSize() < sizeof(ScenePackageHeader))
+	{
+		LOGW("Invalid scene package(%s).", file.c_str());
+		return false;
+	}
+
+	memcpy(&header, mapped.GetData(), sizeof(ScenePackageHeader));
+
+	if (header.magic != SCENE_PACKAGE_MAGIC || header.version != SCENE_PACKAGE_VERSION
+		|| header.fileSize != mapped.GetSize())
+	{
+		LOGW("Scene package(%s) is out of date.", file.c_str());
+		return false;
+	}
+
+	// Tables...
+	const ScenePackageImage* imageRecs = SPGetTable<ScenePackageImage>(mapped, header.imagesOffset, header.numImages);
+	const ScenePackageMaterial* materialRecs = SPGetTable<ScenePackageMaterial>(mapped, header.materialsOffset, header.numMaterials);
+	const ScenePackageMesh* meshRecs = SPGetTable<ScenePackageMesh>(mapped, header.meshesOffset, header.numMeshes);
+	const ScenePackageNode* nodeRecs = SPGetTable<ScenePackageNode>(mapped, header.nodesOffset, header.numNodes);
+	const ScenePackagePart* partRecs = SPGetTable<ScenePackagePart>(mapped, header.partsOffset, header.numParts);
+	const ScenePackageDependency* dependencyRecs = SPGetTable<ScenePackageDependency>(mapped,
+		header.dependenciesOffset, header.numDependencies);
+
+	if (!SPValidate(mapped, header, imageRecs, materialRecs, meshRecs, nodeRecs, partRecs, dependencyRecs))
+	{
+		LOGW("Invalid scene package(%s).", file.c_str());
+		return false;
+	}
+
+	// Imported with another mode or any of the files it was cooked from changed?
+	if (!source.empty() && (header.importMode != SPGetImportMode(source)
+		|| !SPIsUpToDate(mapped, GISystem::GetDirectory(GISystem::NormalizePath(source)), dependencyRecs, header.numDependencies)))
+	{
+		LOGW("Scene package(%s) is out of date.", file.c_str());
+		return false;
+	}
+
+	sStats = ScenePackageStats{};
+	sStats.coldTime = header.coldTime;
+	sStats.encodeRate = header.encodeRate;
+	sStats.encodePSNR = header.encodePSNR;
+	sStats.imageBytes = header.imageBytes;
+	sStats.rawImageBytes = header.rawImageBytes;
+	sStats.fileSize = header.fileSize;
+	sStats.numImages = header.numImages;
+	sStats.numMaterials = header.numMaterials;
+	sStats.numMeshes = header.numMeshes;
+	sStats.numNodes = header.numNodes;
+	sStats.mapTime = (float)(GetTimeMS() - stageTime);
+	stageTime = GetTimeMS();
+
+
+	// Images, the mip chains are copied to staging straight from the mapped file, only the low mips
+	// are uploaded now & the pages of the high mips are read once the texture streamer needs them.
+	// Images already loaded by a live scene are shared with their render data.
+	std::vector< Ptr<Image2D> > images(header.numImages);
+
+	for (uint32_t i = 0; i < header.numImages; ++i)
+	{
+		const ScenePackageImage& rec = imageRecs[i];
+
+		Ptr<Image2D> image(new Image2D());
+		image->WrapMipChain((EImageFormat)rec.format, glm::ivec2(rec.width, rec.height), rec.isSRGB != 0,
+			rec.numMips, mapped.GetData() + rec.dataOffset, rec.dataSize, mappedFile);
+
+		images[i] = AssetRegistry::FindImage(rec.hash, image.get());
+
+		if (images[i])
+		{
+			++sStats.numSharedImages;
+			continue;
+		}
+
+		images[i] = AssetRegistry::AddImage(rec.hash, image);
+
+		if (isRenderData && !images[i]->GetRenderImage())
+			images[i]->UpdateRenderImage();
+	}
+
+	SceneLoader::SetProgress(0.3f);
+
+	if (SceneLoader::IsCanceled())
+		return false;
+
+	sStats.imageTime = (float)(GetTimeMS() - stageTime);
+	stageTime = GetTimeMS();
+
+
+	// Materials...
+	std::vector< Ptr<Material> > materials(header.numMaterials);
+
+	for (uint32_t i = 0; i < header.numMaterials; ++i)
+	{
+		const ScenePackageMaterial& rec = materialRecs[i];
+
+		materials[i] = Ptr<Material>(new Material());
+		materials[i]->SetColor(glm::vec4(rec.color[0], rec.color[1], rec.color[2], rec.color[3]));
+		materials[i]->SetEmission(glm::vec4(rec.emission[0], rec.emission[1], rec.emission[2], rec.emission[3]));
+
+		if (rec.colorImage != SCENE_PACKAGE_NO_IMAGE)
+			materials[i]->SetColorTexture(images[rec.colorImage]);
+
+		if (rec.roughnessMetallicImage != SCENE_PACKAGE_NO_IMAGE)
+			materials[i]->SetRoughnessMetallic(images[rec.roughnessMetallicImage]);
+
+		if (isRenderData)
+			materials[i]->UpdateRenderMaterial();
+	}
+
+
+	// Meshes, the blobs are already in the render layout & meshes already loaded by a live scene are shared.
+	std::vector< Ptr<Mesh> > meshes(header.numMeshes);
+
+	for (uint32_t i = 0; i < header.numMeshes; ++i)
+	{
+		const ScenePackageMesh& rec = meshRecs[i];
+		const MeshVert* verts = reinterpret_cast<const MeshVert*>(mapped.GetData() + rec.vertexOffset);
+		const uint32_t* indices = reinterpret_cast<const uint32_t*>(mapped.GetData() + rec.indexOffset);
+
+		meshes[i] = AssetRegistry::FindMesh(rec.hash, verts, rec.numVertices, indices, rec.numIndices);
+
+		if (meshes[i])
+		{
+			++sStats.numSharedMeshes;
+			continue;
+		}
+
+		Ptr<Mesh> mesh(new Mesh());
+		mesh->GetVertices().assign(verts, verts + rec.numVertices);
+		mesh->GetIndices().assign(indices, indices + rec.numIndices);
+		mesh->GetBounds() = Box(glm::vec3(rec.boundsMin[0], rec.boundsMin[1], rec.boundsMin[2]),
+			glm::vec3(rec.boundsMax[0], rec.boundsMax[1], rec.boundsMax[2]));
+
+		meshes[i] = AssetRegistry::AddMesh(rec.hash, mesh);
+
+		if (isRenderData && !meshes[i]->GetRenderMesh())
+			meshes[i]->UpdateRenderMesh();
+	}
+
+	SceneLoader::SetProgress(0.9f);
+
+	if (SceneLoader::IsCanceled())
+		return false;
+
+
+	// Nodes...
+	for (uint32_t i = 0; i < header.numNodes; ++i)
+	{
+		const ScenePackageNode& rec = nodeRecs[i];
+
+		glm::mat4 mtx;
+		memcpy(&mtx[0][0], rec.matrix, sizeof(rec.matrix));
+
+		Ptr<MeshNode> node = Ptr<MeshNode>(new MeshNode());
+		node->SetTransform(Transform(mtx));
+
+		for (uint32_t ip = 0; ip < rec.numParts; ++ip)
+		{
+			const ScenePackagePart& part = partRecs[rec.firstPart + ip];
+			node->SetMesh(ip, meshes[part.mesh]);
+			node->SetMaterial(ip, materials[part.material]);
+		}
+
+		scene->AddNode(node);
+	}
+
+	sStats.meshTime = (float)(GetTimeMS() - stageTime);
+	sStats.totalTime = (float)(GetTimeMS() - startTime);
+
+	SceneLoader::SetProgress(1.0f);
+
+	LOGI("Loaded scene package(%s) in %.1f ms: Map %.1f ms, Images %.1f ms (%d, %d shared), Meshes %.1f ms (%d meshes, %d shared, %d nodes).",
+		file.c_str(), sStats.totalTime, sStats.mapTime, sStats.imageTime, sStats.numImages, sStats.numSharedImages,
+		sStats.meshTime, sStats.numMeshes, sStats.numSharedMeshes, sStats.numNodes);
+
+	return true;
+}
+
+
+bool ScenePackage::Cook(Scene* scene, const std::string& file, const std::string& source,
+	const std::vector<std::string>& dependencies, float coldTime)
+{
+	ScenePackageCookData data;
+	data.offset = 0;
+	data.fs.open(file, std::ios::out | std::ios::binary | std::ios::trunc);
+
+	if (!data.fs.is_open())
+	{
+		LOGW("Failed to cook scene package(%s).", file.c_str());
+		return false;
+	}
+
+	// The header is written again once the tables offsets are known.
+	ScenePackageHeader header{};
+	SPWrite(data, &header, sizeof(ScenePackageHeader));
+
+	for (Node* node : scene->GetRenderable())
+	{
+		if (node->GetType() != ENodeType::MeshNode)
+			continue;
+
+		MeshNode* meshNode = static_cast<MeshNode*>(node);
+
+		ScenePackageNode rec{};
+		memcpy(rec.matrix, &meshNode->GetTransform().GetMatrix()[0][0], sizeof(rec.matrix));
+		rec.firstPart = (uint32_t)data.parts.size();
+
+		for (uint32_t i = 0; i < meshNode->GetNumMeshes(); ++i)
+		{
+			Mesh* mesh = meshNode->GetMesh(i);
+			Material* mat = meshNode->GetMaterial(i);
+
+			if (!mesh || !mat)
+				continue;
+
+			ScenePackagePart part;
+			part.mesh = SPCookMesh(data, mesh);
+			part.material = SPCookMaterial(data, mat);
+			data.parts.push_back(part);
+		}
+
+		rec.numParts = (uint32_t)data.parts.size() - rec.firstPart;
+		data.nodes.push_back(rec);
+	}
+
+	// Images...
+	double encodeTime = GetTimeMS();
+	uint32_t numThreads = SPEncodeImages(data.imageJobs);
+	encodeTime = GetTimeMS() - encodeTime;
+
+	uint64_t numTexels = 0;
+	uint32_t numCompressed = 0;
+	float totalPSNR = 0.0f;
+
+	for (ScenePackageImageJob& job : data.imageJobs)
+	{
+		ScenePackageImage rec{};
+		rec.width = job.image->GetSize().x;
+		rec.height = job.image->GetSize().y;
+		rec.format = (uint32_t)job.format;
+		rec.isSRGB = job.image->IsSRGB() ? 1 : 0;
+		rec.numMips = job.numMips;
+		rec.dataSize = (uint32_t)job.chain.size();
+		rec.dataOffset = SPWrite(data, job.chain.data(), job.chain.size());
+		rec.hash = job.hash;
+		data.images.push_back(rec);
+
+		header.imageBytes += job.chain.size();
+		header.rawImageBytes += job.rawSize;
+		numTexels += job.numTexels;
+
+		if (job.format != job.image->GetFormat())
+		{
+			totalPSNR += job.psnr;
+			++numCompressed;
+		}
+
+		// Written, free it before the next one.
+		std::vector<uint8_t>().swap(job.chain);
+	}
+
+	header.encodeRate = encodeTime > 0.0 ? (float)((double)numTexels / (encodeTime * 1000.0)) : 0.0f;
+	header.encodePSNR = numCompressed != 0 ? totalPSNR / (float)numCompressed : 0.0f;
+
+	LOGI("Encoded %d images (%d compressed) on %d threads in %.1f ms: %.1f MTexel/s, PSNR %.2f dB, %.1f MB from %.1f MB.",
+		(uint32_t)data.images.size(), numCompressed, numThreads, (float)encodeTime, header.encodeRate, header.encodePSNR,
+		(float)header.imageBytes / (1024.0f * 1024.0f), (float)header.rawImageBytes / (1024.0f * 1024.0f));
+
+
+	// Dependencies, the source first...
+	std::string dir = GISystem::GetDirectory(GISystem::NormalizePath(source));
+	SPCookDependency(data, dir, source);
+
+	for (const std::string& dependency : dependencies)
+		SPCookDependency(data, dir, dependency);
+
+
+	// Tables...
+	header.magic = SCENE_PACKAGE_MAGIC;
+	header.version = SCENE_PACKAGE_VERSION;
+	header.importMode = SPGetImportMode(source);
+	header.coldTime = coldTime;
+	header.numImages = (uint32_t)data.images.size();
+	header.numMaterials = (uint32_t)data.materials.size();
+	header.numMeshes = (uint32_t)data.meshes.size();
+	header.numNodes = (uint32_t)data.nodes.size();
+	header.numParts = (uint32_t)data.parts.size();
+	header.numDependencies = (uint32_t)data.dependencies.size();
+	header.imagesOffset = SPWrite(data, data.images.data(), data.images.size() * sizeof(ScenePackageImage));
+	header.materialsOffset = SPWrite(data, data.materials.data(), data.materials.size() * sizeof(ScenePackageMaterial));
+	header.meshesOffset = SPWrite(data, data.meshes.data(), data.meshes.size() * sizeof(ScenePackageMesh));
+	header.nodesOffset = SPWrite(data, data.nodes.data(), data.nodes.size() * sizeof(ScenePackageNode));
+	header.partsOffset = SPWrite(data, data.parts.data(), data.parts.size() * sizeof(ScenePackagePart));
+	header.dependenciesOffset = SPWrite(data, data.dependencies.data(), data.dependencies.size() * sizeof(ScenePackageDependency));
+	header.fileSize = data.offset;
+
+	data.fs.seekp(0);
+	data.fs.write((const char*)&header, sizeof(ScenePackageHeader));
+	data.fs.close();
+
+	if (data.fs.fail())
+	{
+		LOGW("Failed to write scene package(%s).", file.c_str());
+		std::remove(file.c_str());
+		return false;
+	}
+
+	return true;
+}
+
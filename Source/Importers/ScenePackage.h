@@ -0,0 +1,124 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+
+
+
+#pragma once
+
+
+
+#include "Core/Core.h"
+#include <string>
+#include <vector>
+
+
+
+class Scene;
+
+
+
+
+
+
+
+// ScenePackageStats:
+//     - stats of the last cooked scene load, timings in milliseconds.
+//
+struct ScenePackageStats
+{
+	// Mapping & validating the package.
+	float mapTime;
+
+	// Uploading the images with their mip chains.
+	float imageTime;
+
+	// Creating the meshes, materials & nodes.
+	float meshTime;
+
+	// The whole cooked load.
+	float totalTime;
+
+	// The cold import time recorded when the package was cooked.
+	float coldTime;
+
+	// The block compression throughput in million texels per second & average PSNR in dB, recorded when cooked.
+	float encodeRate;
+	float encodePSNR;
+
+	// The size of the images in the package & the size they would have as RGBA.
+	uint64_t imageBytes;
+	uint64_t rawImageBytes;
+
+	// The number of records loaded from the package.
+	uint32_t numImages;
+	uint32_t numMaterials;
+	uint32_t numMeshes;
+	uint32_t numNodes;
+
+	// The number of images & meshes found in the asset registry instead of loaded from the package.
+	uint32_t numSharedImages;
+	uint32_t numSharedMeshes;
+
+	// The package size in bytes.
+	uint64_t fileSize;
+};
+
+
+
+
+// ScenePackage:
+//     - Cooked .rtgipak scene, a versioned package of the scene images with their block compressed mip chains, materials,
+//       mesh vertices & indices in the render layout and the mesh nodes.
+//     - The package is memory mapped, loading it is mostly uploading its blobs.
+//     - The package records the size & write time of its source & the files the source import read & the import mode,
+//       it is cooked again once one of them changes.
+//
+class ScenePackage
+{
+public:
+	// Return true if the file is a scene package.
+	static bool IsSupported(const std::string& file);
+
+	// Return the path of the package cooked from a source scene file.
+	static std::string GetPackagePath(const std::string& source);
+
+	// Load the cooked package of a source scene file if it is valid, otherwise import the source & cook it.
+	static bool Import(Scene* scene, const std::string& file);
+
+	// Load a package into the scene, if source isn't empty the package must be up to date with it & its dependencies.
+	static bool Load(Scene* scene, const std::string& file, const std::string& source = std::string());
+
+	// Cook the mesh nodes of the scene imported from source into a package.
+	// @param dependencies: the files read by the import besides the source.
+	static bool Cook(Scene* scene, const std::string& file, const std::string& source,
+		const std::vector<std::string>& dependencies, float coldTime);
+
+	// Return the stats of the last cooked load.
+	static inline const ScenePackageStats& GetStats() { return sStats; }
+
+private:
+	// Stats of the last cooked load.
+	static ScenePackageStats sStats;
+
+};
+
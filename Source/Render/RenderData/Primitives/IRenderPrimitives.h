@@ -29,6 +29,7 @@
 
 
 class VKICommandBuffer;
+class VKIBuffer;
 
 
 
@@ -45,5 +46,26 @@ public:
 
 	// Draw the mesh.
 	virtual void Draw(VKICommandBuffer* cmdBuffer) = 0;
+
+	// Draw the mesh using a draw command from the indirect buffer at offset.
+	virtual void DrawIndirect(VKICommandBuffer* cmdBuffer, VKIBuffer* indirect, uint32_t offset) { Draw(cmdBuffer); }
+
+	// Draw multiple instances of the mesh.
+	virtual void DrawInstanced(VKICommandBuffer* cmdBuffer, uint32_t firstInstance, uint32_t numInstances) { Draw(cmdBuffer); }
+
+	// Bind the vertex & index buffers, used to skip rebinding between draws of the same primitive.
+	virtual void BindBuffers(VKICommandBuffer* cmdBuffer) { }
+
+	// Draw multiple instances, the buffers must be already bound by BindBuffers.
+	virtual void DrawInstancedBound(VKICommandBuffer* cmdBuffer, uint32_t firstInstance, uint32_t numInstances)
+	{
+		DrawInstanced(cmdBuffer, firstInstance, numInstances);
+	}
+
+	// Draw using a draw command from the indirect buffer, the buffers must be already bound by BindBuffers.
+	virtual void DrawIndirectBound(VKICommandBuffer* cmdBuffer, VKIBuffer* indirect, uint32_t offset)
+	{
+		DrawIndirect(cmdBuffer, indirect, offset);
+	}
 };
 
@@ -57,6 +57,9 @@ public:
 	// Draw the mesh.
 	virtual void Draw(VKICommandBuffer* cmdBuffer) override;
 
+	// Draw multiple instances of the mesh.
+	virtual void DrawInstanced(VKICommandBuffer* cmdBuffer, uint32_t firstInstance, uint32_t numInstances) override;
+
 private:
 	// Vertex Buffer.
 	UniquePtr<VKIBuffer> mVertBuffer;
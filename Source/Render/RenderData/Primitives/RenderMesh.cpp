@@ -52,6 +52,27 @@ RenderMesh::~RenderMesh()
 
 
 void RenderMesh::Draw(VKICommandBuffer* cmdBuffer)
+{
+	BindBuffers(cmdBuffer);
+	DrawInstancedBound(cmdBuffer, 0, 1);
+}
+
+
+void RenderMesh::DrawIndirect(VKICommandBuffer* cmdBuffer, VKIBuffer* indirect, uint32_t offset)
+{
+	BindBuffers(cmdBuffer);
+	DrawIndirectBound(cmdBuffer, indirect, offset);
+}
+
+
+void RenderMesh::DrawInstanced(VKICommandBuffer* cmdBuffer, uint32_t firstInstance, uint32_t numInstances)
+{
+	BindBuffers(cmdBuffer);
+	DrawInstancedBound(cmdBuffer, firstInstance, numInstances);
+}
+
+
+void RenderMesh::BindBuffers(VKICommandBuffer* cmdBuffer)
 {
 	VkCommandBuffer cmd = cmdBuffer->GetCurrent();
 
@@ -62,9 +83,18 @@ void RenderMesh::Draw(VKICommandBuffer* cmdBuffer)
 
 	// Bind Index Buffer.
 	vkCmdBindIndexBuffer(cmd, mIdxBuffer->Get(), 0, VK_INDEX_TYPE_UINT32);
+}
 
-	// Draw...
-	vkCmdDrawIndexed(cmd, mNumIndices, 1, 0, 0, 0);
+
+void RenderMesh::DrawInstancedBound(VKICommandBuffer* cmdBuffer, uint32_t firstInstance, uint32_t numInstances)
+{
+	vkCmdDrawIndexed(cmdBuffer->GetCurrent(), mNumIndices, numInstances, 0, 0, firstInstance);
+}
+
+
+void RenderMesh::DrawIndirectBound(VKICommandBuffer* cmdBuffer, VKIBuffer* indirect, uint32_t offset)
+{
+	vkCmdDrawIndexedIndirect(cmdBuffer->GetCurrent(), indirect->Get(), offset, 1, sizeof(VkDrawIndexedIndirectCommand));
 }
 
 
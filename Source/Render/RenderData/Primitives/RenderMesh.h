@@ -54,6 +54,24 @@ public:
 	// Draw the mesh.
 	virtual void Draw(VKICommandBuffer* cmdBuffer) override;
 
+	// Draw the mesh using a draw command from the indirect buffer at offset.
+	virtual void DrawIndirect(VKICommandBuffer* cmdBuffer, VKIBuffer* indirect, uint32_t offset) override;
+
+	// Draw multiple instances of the mesh.
+	virtual void DrawInstanced(VKICommandBuffer* cmdBuffer, uint32_t firstInstance, uint32_t numInstances) override;
+
+	// Bind the vertex & index buffers.
+	virtual void BindBuffers(VKICommandBuffer* cmdBuffer) override;
+
+	// Draw multiple instances, the buffers must be already bound.
+	virtual void DrawInstancedBound(VKICommandBuffer* cmdBuffer, uint32_t firstInstance, uint32_t numInstances) override;
+
+	// Draw using a draw command from the indirect buffer, the buffers must be already bound.
+	virtual void DrawIndirectBound(VKICommandBuffer* cmdBuffer, VKIBuffer* indirect, uint32_t offset) override;
+
+	// Return the number of indices.
+	inline uint32_t GetNumIndices() const { return mNumIndices; }
+
 private:
 	// Vertex Buffer.
 	UniquePtr<VKIBuffer> mVertBuffer;
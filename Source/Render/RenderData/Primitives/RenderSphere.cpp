@@ -70,6 +70,23 @@ void RenderSphere::Draw(VKICommandBuffer* cmdBuffer)
 }
 
 
+void RenderSphere::DrawInstanced(VKICommandBuffer* cmdBuffer, uint32_t firstInstance, uint32_t numInstances)
+{
+	VkCommandBuffer cmd = cmdBuffer->GetCurrent();
+
+	// Bind Vertex Buffer.
+	VkBuffer buffer = mVertBuffer->Get();
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(cmd, 0, 1, &buffer, &offset);
+
+	// Bind Index Buffer.
+	vkCmdBindIndexBuffer(cmd, mIdxBuffer->Get(), 0, VK_INDEX_TYPE_UINT32);
+
+	// Draw...
+	vkCmdDrawIndexed(cmd, mNumIndices, numInstances, 0, 0, firstInstance);
+}
+
+
 void RenderSphere::UpdateData(uint32_t seg)
 {
 	Renderer* renderer = Application::Get().GetRenderer();
@@ -24,16 +24,23 @@
 
 #include "RenderImage.h"
 #include "Core/Image2D.h"
+#include "Core/BlockCompression.h"
 #include "Application.h"
 #include "Render/Renderer.h"
+#include "Render/RenderTextureStreamer.h"
 
 
 #include "Render/VKInterface/VKIDevice.h"
 #include "Render/VKInterface/VKIBuffer.h"
 #include "Render/VKInterface/VKIImage.h"
+#include "Render/VKInterface/VKIUploadManager.h"
+#include "Render/VKInterface/VKIMipGenerator.h"
 
 
-#include <cmath>
+#include "glm/common.hpp"
+
+
+#include <vector>
 
 
 
@@ -47,6 +54,15 @@ VkFormat ToVKFormat(EImageFormat format, bool isSRGB)
 
 	case EImageFormat::RGBA:
 		return isSRGB ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+
+	case EImageFormat::BC1:
+		return isSRGB ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+
+	case EImageFormat::BC3:
+		return isSRGB ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+
+	case EImageFormat::BC5:
+		return VK_FORMAT_BC5_UNORM_BLOCK;
 	}
 
 	CHECK(0 && "Unsupported.");
@@ -64,7 +80,16 @@ VkFormat ToVKFormat(EImageFormat format, bool isSRGB)
 
 
 RenderImage::RenderImage()
-	: mImgBuffer(nullptr)
+	: mDevice(nullptr)
+	, mUploadHandle(0)
+	, mSource(nullptr)
+	, mSize(0)
+	, mNumMips(1)
+	, mFirstMip(0)
+	, mVersion(0)
+	, mPendingMip(0)
+	, mPendingHandle(0)
+	, mStreamSlot(0)
 {
 
 }
@@ -72,17 +97,21 @@ RenderImage::RenderImage()
 
 RenderImage::~RenderImage()
 {
+	if (mSource)
+	{
+		Application::Get().GetRenderer()->GetTextureStreamer()->RemoveImage(this);
+	}
+
+	if (mPendingImage)
+	{
+		mPendingImage->Destroy();
+	}
+
 	if (mImage)
 	{
 		mSampler->Destroy();
 		mView->Destroy();
 		mImage->Destroy();
-
-		if (mImgBuffer)
-		{
-			mImgBuffer->Destroy();
-			delete mImgBuffer;
-		}
 	}
 }
 
@@ -90,74 +119,184 @@ RenderImage::~RenderImage()
 void RenderImage::SetData(Image2D* img)
 {
 	mDevice = Application::Get().GetRenderer()->GetVKDevice();
-	VkExtent2D size = { (uint32_t)img->GetSize().x, (uint32_t)img->GetSize().y };
-	uint32_t mipLevels = !img->IsGenMips() ? 1
-		: static_cast<uint32_t>(std::floor(std::log2(std::max(size.width, size.height)))) + 1;
+	mSize = img->GetSize();
+
+	// Precomputed mip chain? only upload the low mips, the texture streamer uploads the rest when needed.
+	if (img->GetNumMips() > 1)
+	{
+		RenderTextureStreamer* streamer = Application::Get().GetRenderer()->GetTextureStreamer();
+
+		mSource = img;
+		mNumMips = img->GetNumMips();
+		mFirstMip = RenderTextureStreamer::GetInitialMip(mSize, mNumMips);
+		CreateMipChain(mFirstMip, mImage, mUploadHandle);
+
+		streamer->AddImage(this);
+		return;
+	}
+
+	VkExtent2D size = { (uint32_t)mSize.x, (uint32_t)mSize.y };
+	mNumMips = !img->IsGenMips() ? 1 : Image2D::GetMaxMips(mSize);
 
 	// Pixel Info...
+	EImageFormat imgFormat = img->GetFormat();
 	VkDeviceSize imgSize = img->GetImgData().GetSize();
 	const uint8_t* imgData = img->GetImgData().GetData();
 
+	VkFormat format = ToVKFormat(imgFormat, img->IsSRGB());
+	VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+
+	// Mips generated by compute need storage, sRGB images are stored as UNORM & only viewed as sRGB.
+	VkFormat storageFormat = mDevice->GetUploader()->GetMipGenerator()->GetStorageFormat(format);
 
-	// New Staging?
-	if (!mImgBuffer)
+	mImage = UniquePtr<VKIImage>(new VKIImage());
+	mImage->SetImageInfo(VK_IMAGE_TYPE_2D, format, size, VK_IMAGE_LAYOUT_UNDEFINED);
+	mImage->SetMipLevels(mNumMips);
+
+	if (mNumMips > 1 && storageFormat != VK_FORMAT_UNDEFINED)
 	{
-		mImgBuffer = new VKIBuffer();
-		mImgBuffer->SetSize(imgSize);
-		mImgBuffer->SetUsage(VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-		mImgBuffer->SetMemoryProperties(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-		mImgBuffer->CreateBuffer(mDevice);
+		mImage->SetStorageFormat(storageFormat);
+		usage |= VK_IMAGE_USAGE_STORAGE_BIT;
 	}
 
+	mImage->SetUsage(usage);
+	mImage->Create(mDevice);
 
-	// Update Data...
-	mImgBuffer->UpdateData(0, imgSize, imgData);
+	// Upload, mips are generated on the graphics queue once the copy is done.
+	mUploadHandle = mDevice->GetUploader()->UploadImage(mImage.get(), imgData, imgSize);
+}
 
 
-	mImage = UniquePtr<VKIImage>(new VKIImage());
-	mImage->SetImageInfo(VK_IMAGE_TYPE_2D, ToVKFormat(img->GetFormat(), img->IsSRGB()), size, VK_IMAGE_LAYOUT_UNDEFINED);
-	mImage->SetMipLevels(mipLevels);
-	mImage->SetUsage(VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
-	mImage->Create(mDevice);
+void RenderImage::CreateMipChain(uint32_t firstMip, UniquePtr<VKIImage>& outImage, VKIUploadHandle& outHandle)
+{
+	uint32_t offsets[IMAGE2D_MAX_MIPS];
+	Image2D::ComputeMipChain(mSource->GetFormat(), mSize, mNumMips, offsets);
+
+	// The mips from firstMip are laid out as the full chain of an image the size of firstMip.
+	glm::ivec2 mipSize = glm::max(mSize >> (int32_t)firstMip, glm::ivec2(1));
+	uint32_t mipLevels = mNumMips - firstMip;
+
+	EImageFormat imgFormat = mSource->GetFormat();
+	const uint8_t* imgData = mSource->GetImgData().GetData() + offsets[firstMip];
+	VkDeviceSize imgSize = mSource->GetImgData().GetSize() - offsets[firstMip];
+
+	// Block compressed images are decompressed if the device can't sample them.
+	std::vector<uint8_t> decompressed;
+
+	if (GetUploadFormat() != imgFormat)
+	{
+		decompressed.resize(Image2D::ComputeMipChain(EImageFormat::RGBA, mipSize, mipLevels, nullptr));
+		BCDecompressMipChain(imgFormat, mipSize, mipLevels, imgData, decompressed.data());
+
+		imgFormat = EImageFormat::RGBA;
+		imgSize = decompressed.size();
+		imgData = decompressed.data();
+	}
+
+	VkExtent2D size = { (uint32_t)mipSize.x, (uint32_t)mipSize.y };
+	VkFormat format = ToVKFormat(imgFormat, mSource->IsSRGB());
+
+	outImage = UniquePtr<VKIImage>(new VKIImage());
+	outImage->SetImageInfo(VK_IMAGE_TYPE_2D, format, size, VK_IMAGE_LAYOUT_UNDEFINED);
+	outImage->SetMipLevels(mipLevels);
+	outImage->SetUsage(VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+	outImage->Create(mDevice);
+
+	// Upload all the mips as they are.
+	VkDeviceSize mipOffsets[IMAGE2D_MAX_MIPS];
+	Image2D::ComputeMipChain(imgFormat, mipSize, mipLevels, offsets);
+
+	for (uint32_t i = 0; i < mipLevels; ++i)
+		mipOffsets[i] = offsets[i];
+
+	outHandle = mDevice->GetUploader()->UploadImageMips(outImage.get(), imgData, imgSize, mipOffsets);
+}
+
+
+EImageFormat RenderImage::GetUploadFormat() const
+{
+	EImageFormat format = mSource->GetFormat();
+
+	if (GetImgBlockSize(format) != 0 && !mDevice->IsTextureCompressionBC())
+		return EImageFormat::RGBA;
+
+	return format;
+}
 
 
-	// Transient Command...
-	VkCommandBuffer cmd = mDevice->BeginTransientCmd();
-	
-	mImage->TransitionImageLayout(cmd, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT);
-	mImage->UpdateImage(cmd, mImgBuffer);
+uint64_t RenderImage::GetMipChainBytes(uint32_t firstMip) const
+{
+	CHECK(mSource && "Only streamed images are tracked.");
+	glm::ivec2 mipSize = glm::max(mSize >> (int32_t)firstMip, glm::ivec2(1));
+	return Image2D::ComputeMipChain(GetUploadFormat(), mipSize, mNumMips - firstMip, nullptr);
+}
+
+
+void RenderImage::StreamMips(uint32_t firstMip)
+{
+	CHECK(mSource && !mPendingImage);
+	CHECK(firstMip < mNumMips);
 
-	if (mipLevels > 1)
-		mImage->GeneratMipmaps(cmd);
-	else
-		mImage->TransitionImageLayout(cmd, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT);
+	if (firstMip == mFirstMip)
+		return;
 
-	mDevice->EndTransientCmd(cmd, Delegate<>::CreateMemberRaw(this, &RenderImage::DestroyStaging));
+	mPendingMip = firstMip;
+	CreateMipChain(firstMip, mPendingImage, mPendingHandle);
 }
 
 
-void RenderImage::DestroyStaging()
+bool RenderImage::UpdateStreaming()
 {
-	mImgBuffer->Destroy();
-	delete mImgBuffer;
-	mImgBuffer = nullptr;
+	if (!mPendingImage || !mDevice->GetUploader()->IsComplete(mPendingHandle))
+		return false;
+
+	// Frames still using the current image are done before the deletion queue destroy it.
+	mSampler->Destroy();
+	mView->Destroy();
+	mImage->Destroy();
+
+	mImage = std::move(mPendingImage);
+	mView = MakeView(mImage.get());
+	mSampler = MakeSampler(mImage.get());
+	mUploadHandle = mPendingHandle;
+	mFirstMip = mPendingMip;
+	++mVersion;
+
+	return true;
 }
 
 
 void RenderImage::CreateView()
 {
-	mView = UniquePtr<VKIImageView>(new VKIImageView());
-	mView->SetType(VK_IMAGE_VIEW_TYPE_2D);
-	mView->SetViewInfo(VK_IMAGE_ASPECT_COLOR_BIT, 0, mImage->GetMipLevels(), 0, 1);
-	mView->Create(mDevice, mImage.get());
+	mView = MakeView(mImage.get());
 }
 
+
 void RenderImage::CreateSampler()
 {
-	mSampler = UniquePtr<VKISampler>(new VKISampler());
-	mSampler->SetAddressMode(VK_SAMPLER_ADDRESS_MODE_REPEAT);
-	mSampler->SetFilter(VK_FILTER_LINEAR, VK_FILTER_LINEAR);
-	mSampler->SetMipmap(mImage->GetMipLevels() > 1 ? VK_SAMPLER_MIPMAP_MODE_LINEAR : VK_SAMPLER_MIPMAP_MODE_NEAREST,
-		0.0, (float)mImage->GetMipLevels(), 0.0f);
-	mSampler->CreateSampler(mDevice);
+	mSampler = MakeSampler(mImage.get());
+}
+
+
+UniquePtr<VKIImageView> RenderImage::MakeView(VKIImage* image) const
+{
+	UniquePtr<VKIImageView> view = UniquePtr<VKIImageView>(new VKIImageView());
+	view->SetType(VK_IMAGE_VIEW_TYPE_2D);
+	view->SetViewInfo(VK_IMAGE_ASPECT_COLOR_BIT, 0, image->GetMipLevels(), 0, 1);
+	view->Create(mDevice, image);
+
+	return view;
+}
+
+
+UniquePtr<VKISampler> RenderImage::MakeSampler(VKIImage* image) const
+{
+	UniquePtr<VKISampler> sampler = UniquePtr<VKISampler>(new VKISampler());
+	sampler->SetAddressMode(VK_SAMPLER_ADDRESS_MODE_REPEAT);
+	sampler->SetFilter(VK_FILTER_LINEAR, VK_FILTER_LINEAR);
+	sampler->SetMipmap(image->GetMipLevels() > 1 ? VK_SAMPLER_MIPMAP_MODE_LINEAR : VK_SAMPLER_MIPMAP_MODE_NEAREST,
+		0.0, (float)image->GetMipLevels(), 0.0f);
+	sampler->CreateSampler(mDevice);
+
+	return sampler;
 }
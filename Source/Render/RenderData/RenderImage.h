@@ -27,6 +27,7 @@
 
 
 #include "Core/Core.h"
+#include "Render/VKInterface/VKIUploadManager.h"
 #include "glm/vec2.hpp"
 
 
@@ -36,6 +37,7 @@ class Image2D;
 class VKIImage;
 class VKIImageView;
 class VKISampler;
+enum class EImageFormat : uint32_t;
 
 
 
@@ -43,9 +45,14 @@ class VKISampler;
 
 // RenderImage:
 //   - Mange image render data.
+//   - Images with a precomputed mip chain are streamed, they start with their low mips & the texture
+//     streamer changes the first resident mip by uploading a new image that replace the current one.
 //
 class RenderImage
 {
+	// Friend...
+	friend class RenderTextureStreamer;
+
 public:
 	// Construct.
 	RenderImage();
@@ -68,10 +75,48 @@ public:
 	// Return this image sampler.
 	VKISampler* GetSampler() { return mSampler.get(); }
 
+	// Return the handle of the image data upload.
+	inline VKIUploadHandle GetUploadHandle() const { return mUploadHandle; }
+
+	// Return the version of the image, incremented every time the streamed image is replaced.
+	inline uint32_t GetVersion() const { return mVersion; }
+
+	// Return true if the mips of the image are streamed.
+	inline bool IsStreamed() const { return mSource != nullptr; }
+
+	// Return the size of the full image & the number of mips in its full mip chain.
+	inline const glm::ivec2& GetSize() const { return mSize; }
+	inline uint32_t GetNumMips() const { return mNumMips; }
+
+	// Return the first mip of the chain that is resident, zero if all mips are.
+	inline uint32_t GetFirstMip() const { return mFirstMip; }
+
+	// Return true if a streamed image is waiting for its upload to complete.
+	inline bool IsStreaming() const { return mPendingImage != nullptr; }
+
+	// Return the first mip of the image being streamed.
+	inline uint32_t GetPendingMip() const { return mPendingMip; }
+
+	// Return the size in bytes of the mips [firstMip, numMips) in video memory.
+	uint64_t GetMipChainBytes(uint32_t firstMip) const;
+
+	// Stream a new image with the mips [firstMip, numMips), it replace the current one once uploaded.
+	void StreamMips(uint32_t firstMip);
+
+	// Replace the current image with the streamed one if its upload is complete.
+	// @return true if the image was replaced.
+	bool UpdateStreaming();
 
 private:
-	// Destroy Staging after it was submited & finished.
-	void DestroyStaging();
+	// Create an image with the mips [firstMip, numMips) of the source mip chain & upload them.
+	void CreateMipChain(uint32_t firstMip, UniquePtr<VKIImage>& outImage, VKIUploadHandle& outHandle);
+
+	// Create a view/sampler for all the mips of an image.
+	UniquePtr<VKIImageView> MakeView(VKIImage* image) const;
+	UniquePtr<VKISampler> MakeSampler(VKIImage* image) const;
+
+	// Return the format the source mip chain is uploaded with.
+	EImageFormat GetUploadFormat() const;
 
 private:
 	// Device used to create this render image.
@@ -86,7 +131,27 @@ private:
 	// The Vulkan Sampler.
 	UniquePtr<VKISampler> mSampler;
 
-	// A Staging buffer used to update the image.
-	class VKIBuffer* mImgBuffer;
-};
+	// The handle of the image data upload.
+	VKIUploadHandle mUploadHandle;
+
+	// The image with its mip chain streamed from, null if the image isn't streamed.
+	Image2D* mSource;
+
+	// The size & number of mips of the full image.
+	glm::ivec2 mSize;
+	uint32_t mNumMips;
 
+	// The first resident mip of the current image.
+	uint32_t mFirstMip;
+
+	// The version of the image, incremented when the streamed image replace the current one.
+	uint32_t mVersion;
+
+	// The image being streamed, its first mip & the handle of its upload.
+	UniquePtr<VKIImage> mPendingImage;
+	uint32_t mPendingMip;
+	VKIUploadHandle mPendingHandle;
+
+	// The index of the image in the texture streamer images.
+	uint32_t mStreamSlot;
+};
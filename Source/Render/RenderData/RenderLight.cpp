@@ -26,7 +26,6 @@
 #include "Render/RendererPipeline.h"
 #include "Render/RenderStageLightProbes.h"
 #include "Render/RenderData/Shaders/RenderShader.h"
-#include "Render/RenderData/Primitives/RenderSphere.h"
 #include "RenderTypes.h"
 
 #include "Render/VKInterface/VKIImage.h"
@@ -74,7 +73,8 @@ void RenderLightProbe::Create()
 	{
 		mIrradiance = UniquePtr<VKIImage>(new VKIImage());
 		mIrradiance->SetImageInfo(VK_IMAGE_TYPE_2D, VK_FORMAT_R16G16B16A16_SFLOAT, size, VK_IMAGE_LAYOUT_UNDEFINED);
-		mIrradiance->SetUsage(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+		mIrradiance->SetUsage(VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+		mIrradiance->SetComputeShared(true);
 		mIrradiance->SetLayers(6, true);
 		mIrradiance->Create(device);
 
@@ -90,12 +90,11 @@ void RenderLightProbe::Create()
 		mSampler[0]->SetFilter(VK_FILTER_LINEAR, VK_FILTER_LINEAR);
 		mSampler[0]->CreateSampler(device);
 
-		// Framebuffer for pre-filter pass
-		mIrradianceFB = UniquePtr<VKIFramebuffer>(new VKIFramebuffer());
-		mIrradianceFB->SetSize(size);
-		mIrradianceFB->SetLayers(6);
-		mIrradianceFB->SetImgView(0, mView[0].get());
-		mIrradianceFB->CreateFrameBuffer(device, rpipeline->GetStageLightProbes()->GetIrradianceFilterPass());
+		// Storage View for the irradiance filter.
+		mStorageView = UniquePtr<VKIImageView>(new VKIImageView());
+		mStorageView->SetType(VK_IMAGE_VIEW_TYPE_2D_ARRAY);
+		mStorageView->SetViewInfo(VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 6);
+		mStorageView->Create(device, mIrradiance.get());
 	}
 
 
@@ -104,6 +103,7 @@ void RenderLightProbe::Create()
 		mRadiance = UniquePtr<VKIImage>(new VKIImage());
 		mRadiance->SetImageInfo(VK_IMAGE_TYPE_2D, VK_FORMAT_R16G16B16A16_SFLOAT, size, VK_IMAGE_LAYOUT_UNDEFINED);
 		mRadiance->SetUsage(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+		mRadiance->SetComputeShared(true);
 		mRadiance->SetLayers(6, true);
 		mRadiance->Create(device);
 
@@ -119,12 +119,12 @@ void RenderLightProbe::Create()
 		mSampler[1]->SetFilter(VK_FILTER_LINEAR, VK_FILTER_LINEAR);
 		mSampler[1]->CreateSampler(device);
 
-		// Framebuffer for pre-filter pass
+		// Framebuffer for the capture pass.
 		mRadianceFB = UniquePtr<VKIFramebuffer>(new VKIFramebuffer());
 		mRadianceFB->SetSize(size);
 		mRadianceFB->SetLayers(6);
 		mRadianceFB->SetImgView(0, mView[1].get());
-		mRadianceFB->CreateFrameBuffer(device, rpipeline->GetStageLightProbes()->GetIrradianceFilterPass());
+		mRadianceFB->CreateFrameBuffer(device, rpipeline->GetStageLightProbes()->GetCaptureCubePass());
 	}
 
 
@@ -150,8 +150,7 @@ void RenderLightProbe::Create()
 		mVisualizeSet->SetLayout(rpipeline->GetStageLightProbes()->GetVisualizeShader()->GetLayout());
 		mVisualizeSet->CreateDescriptorSet(device, Renderer::NUM_CONCURRENT_FRAMES);
 
-		mVisualizeSet->AddDescriptor(RenderShader::COMMON_BLOCK_BINDING, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-			VK_SHADER_STAGE_ALL, rpipeline->GetUniforms().common->GetBuffers());
+		rpipeline->AddCommonToDescSet(mVisualizeSet.get());
 
 		mVisualizeSet->AddDescriptor(10, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
 			VK_SHADER_STAGE_FRAGMENT_BIT, mView[0].get(), mSampler[0].get());
@@ -165,18 +164,15 @@ void RenderLightProbe::Create()
 
 	{
 		mIrradianceFilterSet = UniquePtr<VKIDescriptorSet>(new VKIDescriptorSet());
-		mIrradianceFilterSet->SetLayout(rpipeline->GetStageLightProbes()->GetIrradianceFilterShader()->GetLayout());
-		mIrradianceFilterSet->CreateDescriptorSet(device, Renderer::NUM_CONCURRENT_FRAMES);
+		mIrradianceFilterSet->SetLayout(rpipeline->GetStageLightProbes()->GetIrradianceFilterLayout());
+		mIrradianceFilterSet->CreateDescriptorSet(device, 1);
 
-		mIrradianceFilterSet->AddDescriptor(RenderShader::COMMON_BLOCK_BINDING, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-			VK_SHADER_STAGE_ALL, rpipeline->GetUniforms().common->GetBuffers());
-
-		mIrradianceFilterSet->AddDescriptor(1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_GEOMETRY_BIT,
-			renderer->GetSphere()->GetSphereUnifrom()->GetBuffers());
-
-		mIrradianceFilterSet->AddDescriptor(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT,
+		mIrradianceFilterSet->AddDescriptor(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT,
 			mView[1].get(), mSampler[1].get());
 
+		mIrradianceFilterSet->AddDescriptor(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT,
+			mStorageView.get(), nullptr);
+
 		mIrradianceFilterSet->UpdateSets();
 	}
 }
@@ -187,7 +183,7 @@ void RenderLightProbe::Destroy()
 	mIrradiance->Destroy();
 	mView[0]->Destroy();
 	mSampler[0]->Destroy();
-	mIrradianceFB->Destroy();
+	mStorageView->Destroy();
 
 	mRadiance->Destroy();
 	mView[1]->Destroy();
@@ -285,7 +281,8 @@ void RenderIrradianceVolume::Create()
 	{
 		mIrradiance = UniquePtr<VKIImage>(new VKIImage());
 		mIrradiance->SetImageInfo(VK_IMAGE_TYPE_2D, VK_FORMAT_R16G16B16A16_SFLOAT, size, VK_IMAGE_LAYOUT_UNDEFINED);
-		mIrradiance->SetUsage(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+		mIrradiance->SetUsage(VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+		mIrradiance->SetComputeShared(true);
 		mIrradiance->SetLayers(numLayers, true);
 		mIrradiance->Create(device);
 
@@ -301,12 +298,11 @@ void RenderIrradianceVolume::Create()
 		mSampler[0]->SetFilter(VK_FILTER_LINEAR, VK_FILTER_LINEAR);
 		mSampler[0]->CreateSampler(device);
 
-		// Framebuffer for pre-filter pass
-		mIrradianceFB = UniquePtr<VKIFramebuffer>(new VKIFramebuffer());
-		mIrradianceFB->SetSize(size);
-		mIrradianceFB->SetLayers(numLayers);
-		mIrradianceFB->SetImgView(0, mView[0].get());
-		mIrradianceFB->CreateFrameBuffer(device, rpipeline->GetStageLightProbes()->GetIrradianceFilterPass());
+		// Storage View for the irradiance filter.
+		mStorageView = UniquePtr<VKIImageView>(new VKIImageView());
+		mStorageView->SetType(VK_IMAGE_VIEW_TYPE_2D_ARRAY);
+		mStorageView->SetViewInfo(VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, numLayers);
+		mStorageView->Create(device, mIrradiance.get());
 	}
 
 
@@ -315,6 +311,7 @@ void RenderIrradianceVolume::Create()
 		mRadiance = UniquePtr<VKIImage>(new VKIImage());
 		mRadiance->SetImageInfo(VK_IMAGE_TYPE_2D, VK_FORMAT_R16G16B16A16_SFLOAT, size, VK_IMAGE_LAYOUT_UNDEFINED);
 		mRadiance->SetUsage(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+		mRadiance->SetComputeShared(true);
 		mRadiance->SetLayers(numLayers, true);
 		mRadiance->Create(device);
 
@@ -330,12 +327,12 @@ void RenderIrradianceVolume::Create()
 		mSampler[1]->SetFilter(VK_FILTER_LINEAR, VK_FILTER_LINEAR);
 		mSampler[1]->CreateSampler(device);
 
-		// Framebuffer for pre-filter pass
+		// Framebuffer for the capture pass.
 		mRadianceFB = UniquePtr<VKIFramebuffer>(new VKIFramebuffer());
 		mRadianceFB->SetSize(size);
 		mRadianceFB->SetLayers(numLayers);
 		mRadianceFB->SetImgView(0, mView[1].get());
-		mRadianceFB->CreateFrameBuffer(device, rpipeline->GetStageLightProbes()->GetIrradianceFilterPass());
+		mRadianceFB->CreateFrameBuffer(device, rpipeline->GetStageLightProbes()->GetCaptureCubePass());
 	}
 
 
@@ -358,18 +355,15 @@ void RenderIrradianceVolume::Create()
 
 	{
 		mIrradianceFilterSet = UniquePtr<VKIDescriptorSet>(new VKIDescriptorSet());
-		mIrradianceFilterSet->SetLayout(rpipeline->GetStageLightProbes()->GetIrradianceArrayFilterShader()->GetLayout());
-		mIrradianceFilterSet->CreateDescriptorSet(device, Renderer::NUM_CONCURRENT_FRAMES);
+		mIrradianceFilterSet->SetLayout(rpipeline->GetStageLightProbes()->GetIrradianceFilterLayout());
+		mIrradianceFilterSet->CreateDescriptorSet(device, 1);
 
-		mIrradianceFilterSet->AddDescriptor(RenderShader::COMMON_BLOCK_BINDING, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-			VK_SHADER_STAGE_ALL, rpipeline->GetUniforms().common->GetBuffers());
-
-		mIrradianceFilterSet->AddDescriptor(1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_GEOMETRY_BIT,
-			renderer->GetSphere()->GetSphereUnifrom()->GetBuffers());
-
-		mIrradianceFilterSet->AddDescriptor(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT,
+		mIrradianceFilterSet->AddDescriptor(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT,
 			mView[1].get(), mSampler[1].get());
 
+		mIrradianceFilterSet->AddDescriptor(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT,
+			mStorageView.get(), nullptr);
+
 		mIrradianceFilterSet->UpdateSets();
 	}
 }
@@ -380,7 +374,7 @@ void RenderIrradianceVolume::Destroy()
 	mIrradiance->Destroy();
 	mView[0]->Destroy();
 	mSampler[0]->Destroy();
-	mIrradianceFB->Destroy();
+	mStorageView->Destroy();
 
 	mRadiance->Destroy();
 	mView[1]->Destroy();
@@ -85,7 +85,6 @@ public:
 
 	// Return irradiance data...
 	inline VKIImage* GetIrradiance() const { return mIrradiance.get(); }
-	inline VKIFramebuffer* GetIrradianceFB() const { return mIrradianceFB.get(); }
 	inline VKIImageView* GetIrradianceView() const { return mView[0].get(); }
 	inline VKISampler* GetIrradianceSampler() const { return mSampler[0].get(); }
 
@@ -101,8 +100,8 @@ public:
 	// Return descriptor set used for visualizing this light probe.
 	VKIDescriptorSet* GetVisualizeDescSet() const { return mVisualizeSet.get(); }
 
-	// Return descriptor set used for rendering radiance cube map.
-	VKIDescriptorSet* GetRadianceDescSet() const { return mIrradianceFilterSet.get(); }
+	// Return descriptor set used for filtering the radiance cube map into the irradiance.
+	VKIDescriptorSet* GetIrradianceFilterSet() const { return mIrradianceFilterSet.get(); }
 
 private:
 	// Flag used to check if its dirty and need updating.
@@ -120,8 +119,8 @@ private:
 	// Image View for Irradiance[1] & Radiance[0].
 	UniquePtr<VKIImageView> mView[2];
 
-	// Framebuffer for irradiance target.
-	UniquePtr<VKIFramebuffer> mIrradianceFB;
+	// Storage view of the irradiance faces, written by the irradiance filter.
+	UniquePtr<VKIImageView> mStorageView;
 
 	// Framebuffer for Radiance target.
 	UniquePtr<VKIFramebuffer> mRadianceFB;
@@ -183,7 +182,6 @@ public:
 
 	// Return irradiance data...
 	inline VKIImage* GetIrradiance() const { return mIrradiance.get(); }
-	inline VKIFramebuffer* GetIrradianceFB() const { return mIrradianceFB.get(); }
 	inline VKIImageView* GetIrradianceView() const { return mView[0].get(); }
 	inline VKISampler* GetIrradianceSampler() const { return mSampler[0].get(); }
 
@@ -196,8 +194,8 @@ public:
 	// Return lighting descriptor set used for light proble lighting shader.
 	VKIDescriptorSet* GetLightingDescSet() const { return mLightingSet.get(); }
 
-	// Return descriptor set used for rendering radiance cube map.
-	VKIDescriptorSet* GetRadianceDescSet() const { return mIrradianceFilterSet.get(); }
+	// Return descriptor set used for filtering the radiance cube map into the irradiance.
+	VKIDescriptorSet* GetIrradianceFilterSet() const { return mIrradianceFilterSet.get(); }
 
 	// Return the total number of light probes in the volume.
 	uint32_t GetNumProbes();
@@ -236,8 +234,8 @@ private:
 	// Image View for Irradiance[1] & Radiance[0].
 	UniquePtr<VKIImageView> mView[2];
 
-	// Framebuffer for irradiance target.
-	UniquePtr<VKIFramebuffer> mIrradianceFB;
+	// Storage view of the irradiance faces, written by the irradiance filter.
+	UniquePtr<VKIImageView> mStorageView;
 
 	// Framebuffer for Radiance target.
 	UniquePtr<VKIFramebuffer> mRadianceFB;
@@ -23,8 +23,10 @@
 
 
 #include "RenderScene.h"
+#include "RenderSnapshot.h"
 #include "Core/Mesh.h"
 #include "Core/Material.h"
+#include "Core/OcclusionRasterizer.h"
 #include "Application.h"
 
 #include "Scene/Scene.h"
@@ -35,6 +37,7 @@
 #include "Render/Renderer.h"
 #include "Render/RendererPipeline.h"
 #include "Render/RenderStageLightProbes.h"
+#include "Render/RenderStageOcclusion.h"
 #include "Render/RenderData/RenderShadow.h"
 #include "Render/RenderData/Primitives/RenderMesh.h"
 #include "Render/RenderData/Primitives/RenderSphere.h"
@@ -42,18 +45,53 @@
 #include "Render/RenderData/Shaders/RenderMaterial.h"
 #include "Render/RenderData/Shaders/RenderShader.h"
 #include "Render/RenderData/Shaders/RenderUniform.h"
+#include "Render/RenderData/Shaders/RenderFrameAllocator.h"
 #include "Render/RenderData/Shaders/RenderShaderBlocks.h"
 #include "Render/RenderData/RenderLight.h"
 
 
 #include "Render/VKInterface/VKICommandBuffer.h"
+#include "Render/VKInterface/VKIBuffer.h"
 #include "Render/VKInterface/VKIDescriptor.h"
 #include "Render/VKInterface/VKIGraphicsPipeline.h"
 
 
+#include <algorithm>
+#include <chrono>
 
 
-#define MAX_NUM_MATERIAL_UNIFORMS 512
+
+
+#define MAX_NUM_HELPERS 32768
+
+
+// Draw Sort Key Layout.
+#define SORT_KEY_PIPELINE_SHIFT 56
+#define SORT_KEY_MATERIAL_SHIFT 40
+#define SORT_KEY_MESH_SHIFT 24
+
+
+
+
+// Return the current time in milliseconds.
+static double GetTimeMS()
+{
+	using namespace std::chrono;
+	return duration<double, std::milli>(high_resolution_clock::now().time_since_epoch()).count();
+}
+
+
+// Insert a global memory barrier.
+static void RSBarrier(VKICommandBuffer* cmdBuffer, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess,
+	VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = srcAccess;
+	barrier.dstAccessMask = dstAccess;
+
+	vkCmdPipelineBarrier(cmdBuffer->GetCurrent(), srcStage, dstStage, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
 
 
 
@@ -69,7 +107,11 @@ void RDEnvironment::Reset()
 	mSelectedLightProbe = nullptr;
 	isLightProbeEnabled = false;
 	isLightProbeHelpers = false;
+	isHelperImpostors = false;
 	isLightProbeVisualize = false;
+	isOcclusionCulling = false;
+	isSoftwareOcclusion = false;
+	time = 0.0f;
 }
 
 
@@ -82,10 +124,14 @@ void RDEnvironment::Reset()
 
 RenderScene::RenderScene()
 	: mScene(nullptr)
+	, mInstanceIndices(nullptr)
 	, mHasDirtyLightProbe(false)
 	, mHasDirtyIrradianceVolume(false)
-	, mDynamicMatDataCount(0)
+	, mInstanceDataCount(0)
+	, mHelperDataCount(0)
 {
+	mDrawStats = RDDrawStats{};
+	mLastDrawStats = RDDrawStats{};
 
 }
 
@@ -101,12 +147,19 @@ void RenderScene::Initialize()
 	Renderer* renderer = Application::Get().GetRenderer();
 
 	mTransformUniform = UniquePtr<RenderUniform>(new RenderUniform());
-	mTransformUniform->Create(renderer, sizeof(GUniform::CommonBlock), true);
+	mTransformUniform->SetStorage(true);
+	mTransformUniform->Create(renderer, sizeof(GUniform::InstanceData) * MAX_NUM_INSTANCES, false);
+	mInstanceData.resize(MAX_NUM_INSTANCES);
 
-	uint32_t matUniformSize = ALIGN_SIZE(sizeof(MaterialData), 64) * MAX_NUM_MATERIAL_UNIFORMS;
-	mMaterialUniform = UniquePtr<RenderUniform>(new RenderUniform());
-	mMaterialUniform->Create(renderer, matUniformSize, true);
-	mDynamicMatData.resize(matUniformSize);
+	mInstanceIndices = renderer->GetInstanceIndices();
+	mSoftwareIndices.resize(MAX_NUM_INSTANCES);
+	mSoftwareVisibility.resize(MAX_NUM_INSTANCES / 32, 0);
+
+
+	mHelperUniform = UniquePtr<RenderUniform>(new RenderUniform());
+	mHelperUniform->SetStorage(true);
+	mHelperUniform->Create(renderer, sizeof(GUniform::HelperInstanceData) * MAX_NUM_HELPERS, false);
+	mHelperData.resize(MAX_NUM_HELPERS);
 
 	mRSphere = UniquePtr<RenderSphere>(new RenderSphere());
 	mRSphere->UpdateData(8);
@@ -114,6 +167,9 @@ void RenderScene::Initialize()
 	mRBox = UniquePtr<RenderBox>(new RenderBox());
 	mRBox->UpdateData();
 
+	mOcclusionRasterizer = UniquePtr<OcclusionRasterizer>(new OcclusionRasterizer());
+	mOcclusionRasterizer->Initialize(OCCLUSION_RASTER_WIDTH, OCCLUSION_RASTER_HEIGHT);
+
 	CreateSunData();
 
 }
@@ -148,7 +204,7 @@ void RenderScene::CreateSunData()
 void RenderScene::Destroy()
 {
 	mTransformUniform->Destroy();
-	mMaterialUniform->Destroy();
+	mHelperUniform->Destroy();
 	mSunShadow->Destroy();
 	mSunLightingSet->Destroy();
 	mRSphere.reset();
@@ -156,16 +212,16 @@ void RenderScene::Destroy()
 }
 
 
-void RenderScene::BuildRenderScene(Scene* scene)
+void RenderScene::BuildRenderScene(const RDFrameSnapshot* snapshot)
 {
 	// View...
-	CollectSceneView(scene);
+	SetView(snapshot->view, snapshot->proj, snapshot->nearFar, snapshot->viewPos, snapshot->viewDir);
 
 	// Lights
-	CollectSceneLights(scene);
+	CollectSceneLights(snapshot);
 
-	// Collect Renderable Nodes.
-	TraverseScene(scene);
+	// Collect Renderable Instances.
+	TraverseScene(snapshot);
 
 }
 
@@ -178,25 +234,51 @@ void RenderScene::Reset()
 	mEnvironment.Reset();
 	mLightProbes.clear();
 	mIrradianceVolumes.clear();
-	mDynamicMatDataCount = 0;
 
 
 	for (size_t i = 0; i < mPrimitives.size(); ++i)
 		delete mPrimitives[i];
 	mPrimitives.clear();
+	mPrimitivesMap.clear();
+	mOccluders.clear();
+	mInstanceDataCount = 0;
 
 	for (size_t i = 0; i < mPrimitivesHelpers.size(); ++i)
 		delete mPrimitivesHelpers[i];
 	mPrimitivesHelpers.clear();
+	mPrimitivesHelpersMap.clear();
+	mHelperDataCount = 0;
+
+	mMeshIds.clear();
+	mMaterialIds.clear();
+	mMaterialData.clear();
+	mSortedPrimitives.clear();
+
+	// The stats of the frame we are done with.
+	mLastDrawStats = mDrawStats;
+	mDrawStats = RDDrawStats{};
 }
 
 
-RDScenePrimitive* RenderScene::AddNewPrimitive(IRenderPrimitives* primitive, const glm::mat4& transform)
+RDScenePrimitive* RenderScene::AddNewPrimitive(IRenderPrimitives* primitive, RenderMaterial* material,
+	const glm::mat4& transform, const Box& bounds)
 {
-	RDScenePrimitive* rdPrim = new RDScenePrimitive();
-	rdPrim->primitive = primitive;
-	rdPrim->transform = transform;
-	mPrimitives.emplace_back(rdPrim);
+	RDScenePrimitive*& rdPrim = mPrimitivesMap[std::make_pair(primitive, material)];
+
+	if (!rdPrim)
+	{
+		rdPrim = new RDScenePrimitive();
+		rdPrim->primitive = primitive;
+		rdPrim->materail = material;
+		rdPrim->objectId = (uint32_t)mPrimitives.size();
+		mPrimitives.emplace_back(rdPrim);
+
+		mMeshIds.emplace(primitive, (uint32_t)mMeshIds.size());
+	}
+
+	rdPrim->instances.emplace_back(transform);
+	rdPrim->instancesBounds.emplace_back(bounds);
+	rdPrim->bounds.Add(bounds);
 
 	return rdPrim;
 }
@@ -205,12 +287,20 @@ RDScenePrimitive* RenderScene::AddNewPrimitive(IRenderPrimitives* primitive, con
 RDScenePrimitiveHelper* RenderScene::AddNewHelper(IRenderPrimitives* primitive, const glm::vec4& pos,
 	const glm::vec4& scale, const glm::vec4& color)
 {
-	RDScenePrimitiveHelper* rdPrim = new RDScenePrimitiveHelper();
-	rdPrim->primitive = primitive;
-	rdPrim->position = pos;
-	rdPrim->scale = scale;
-	rdPrim->color = color;
-	mPrimitivesHelpers.emplace_back(rdPrim);
+	RDScenePrimitiveHelper*& rdPrim = mPrimitivesHelpersMap[primitive];
+
+	if (!rdPrim)
+	{
+		rdPrim = new RDScenePrimitiveHelper();
+		rdPrim->primitive = primitive;
+		mPrimitivesHelpers.emplace_back(rdPrim);
+	}
+
+	GUniform::HelperInstanceData data;
+	data.position = pos;
+	data.scale = scale;
+	data.color = color;
+	rdPrim->instances.emplace_back(data);
 
 	return rdPrim;
 }
@@ -218,25 +308,39 @@ RDScenePrimitiveHelper* RenderScene::AddNewHelper(IRenderPrimitives* primitive,
 
 void RenderScene::CollectSceneView(Scene* scene)
 {
-	glm::mat4 view = scene->GetCamera().GetViewTransform();
-	glm::mat4 proj = scene->GetCamera().GetProjection();
+	glm::vec2 nearFar;
+	scene->GetCamera().GetZPlane(nearFar.x, nearFar.y);
+
+	SetView(scene->GetCamera().GetViewTransform(), scene->GetCamera().GetProjection(), nearFar,
+		scene->GetCamera().GetViewPos(), scene->GetCamera().GetViewDir());
+}
+
+
+void RenderScene::SetView(const glm::mat4& view, const glm::mat4& proj, const glm::vec2& nearFar,
+	const glm::vec3& viewPos, const glm::vec3& viewDir)
+{
 	mViewProj = proj * view;
 	mViewProjInv = glm::inverse(mViewProj);
-	scene->GetCamera().GetZPlane(mNearFar.x, mNearFar.y);
-
-	mViewPos = scene->GetCamera().GetViewPos();
-	mViewDir = scene->GetCamera().GetViewDir();
+	mNearFar = nearFar;
+	mViewPos = viewPos;
+	mViewDir = viewDir;
 }
 
 
-void RenderScene::AddLightProbe(Node* node)
+void RenderScene::AddLightProbe(const RDSnapshotLightProbe& probe)
 {
+	RenderLightProbe* rprobe = probe.probe;
+
+	// Apply the captured state even while disabled so dirty requests are not lost.
+	rprobe->SetPosition(probe.position);
+	rprobe->SetRadius(probe.radius);
+
+	if (probe.dirty != 0)
+		rprobe->SetDirty(probe.dirty);
+
 	if (!mEnvironment.isLightProbeEnabled)
 		return;
 
-	LightProbeNode* probe = static_cast<LightProbeNode*>(node);
-	RenderLightProbe* rprobe = probe->GetRenderLightProbe();
-
 	// Not Invalid LightProbe?
 	if (rprobe->GetDirty() != INVALID_INDEX)
 	{
@@ -250,9 +354,9 @@ void RenderScene::AddLightProbe(Node* node)
 		AddNewHelper(mRSphere.get(),
 			glm::vec4(rprobe->GetPosition(), 0.0f),
 			glm::vec4(0.1f),
-			probe->IsSelected() ? glm::vec4(1.0f, 1.0f, 0.0f, 1.0f) : glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
+			probe.isSelected ? glm::vec4(1.0f, 1.0f, 0.0f, 1.0f) : glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
 
-		if (probe->IsSelected())
+		if (probe.isSelected)
 		{
 			mEnvironment.mSelectedLightProbe = rprobe;
 
@@ -266,14 +370,15 @@ void RenderScene::AddLightProbe(Node* node)
 }
 
 
-void RenderScene::AddIrradianceVolume(Node* node)
+void RenderScene::AddIrradianceVolume(const RDSnapshotIrradianceVolume& volume)
 {
-	if (!mEnvironment.isLightProbeEnabled)
-		return;
+	RenderIrradianceVolume* rVolume = volume.volume;
 
+	if (volume.dirty != 0)
+		rVolume->SetDirty(volume.dirty);
 
-	IrradianceVolumeNode* irrVolume = static_cast<IrradianceVolumeNode*>(node);
-	RenderIrradianceVolume* rVolume = irrVolume->GetRenderIrradianceVolume();
+	if (!mEnvironment.isLightProbeEnabled)
+		return;
 
 	// Not Invalid Irradiance Volume?
 	if (rVolume->GetDirty() != INVALID_INDEX)
@@ -302,114 +407,378 @@ void RenderScene::AddIrradianceVolume(Node* node)
 }
 
 
-void RenderScene::CollectSceneLights(Scene* scene)
+void RenderScene::CollectSceneLights(const RDFrameSnapshot* snapshot)
 {
-	// The Sun...
-	glm::vec3 sunDir = scene->GetGlobal().GetSunDir();
-	mEnvironment.sunDir = glm::vec4(sunDir, 0.0f);
-
-	mEnvironment.sunColorAndPower = glm::vec4(scene->GetGlobal().GetSunColor(),
-		scene->GetGlobal().GetSunPower());
-
+	// The Sun & render flags...
+	mEnvironment = snapshot->environment;
 
+	glm::vec3 sunDir = glm::vec3(mEnvironment.sunDir);
 	glm::mat4 sunView = Transform::LookAt(-sunDir, glm::vec3(0.0f), abs(sunDir.z) < 0.9 ? Transform::UP : Transform::FORWARD * glm::sign(sunDir.z));
 	//glm::mat4 sunProj = Transform::Ortho(1200.0f, -1200.0f, 1200.0f, -1200.0f, -10000.0f, 2000.0f);
 
-	glm::vec3 sceneExtent = scene->GetBounds().Extent() * 1.2f;
+	glm::vec3 sceneExtent = snapshot->sceneBounds.Extent() * 1.2f;
 	float sceneLen = glm::length(sceneExtent) * 7.6f;
 	glm::mat4 sunProj = Transform::Ortho(sceneExtent.x, -sceneExtent.x, sceneExtent.y, -sceneExtent.y, -sceneLen, sceneLen * 0.2);
 
 	mSunShadow->SetShadowMatrix(sunProj * sunView);
 
 	// Flag sun shadow as dirty.
-	mSunShadow->SetDirty(scene->GetGlobal().HasDirtyFlag(ESceneGlobalDirtyFlag::DirtySun));
-	scene->GetGlobal().ClearDirtyFlag(ESceneGlobalDirtyFlag::DirtySun);
+	mSunShadow->SetDirty(snapshot->isSunDirty);
+
+
+	// Light Probes...
+	for (const RDSnapshotLightProbe& probe : snapshot->lightProbes)
+		AddLightProbe(probe);
+
+	// Irradiance Volumes...
+	for (const RDSnapshotIrradianceVolume& volume : snapshot->irradianceVolumes)
+		AddIrradianceVolume(volume);
 
+}
+
+
+void RenderScene::TraverseScene(const RDFrameSnapshot* snapshot)
+{
+	// Collect Render Primitives...
+	for (const RDSnapshotInstance& instance : snapshot->instances)
+	{
+		// New Instance...
+		auto newPrim = AddNewPrimitive(instance.primitive, instance.material, instance.transform, instance.bounds);
+
+		// Already added by another instance?
+		if (newPrim->instances.size() > 1)
+			continue;
+
+		newPrim->numIndices = instance.mesh->GetRenderMesh()->GetNumIndices();
+		newPrim->mesh = instance.mesh;
+
+		// Material used this frame.
+		if (mMaterialIds.emplace(instance.material, (uint32_t)mMaterialIds.size()).second)
+			mMaterialData.emplace_back(instance.materialData);
+	}
+
+
+	BuildInstances();
+	BuildHelpers();
+	SortPrimitives();
 
-	mEnvironment.isLightProbeEnabled = scene->GetGlobal().isLightProbeEnabled;
-	mEnvironment.isLightProbeHelpers = scene->GetGlobal().isLightProbeHelpers;
-	mEnvironment.isLightProbeVisualize = scene->GetGlobal().isLightProbeVisualize;
+	if (mEnvironment.isSoftwareOcclusion)
+		SelectOccluders();
+}
 
 
-	// Lights & Light Probes...
-	for (auto& node : scene->GetLights())
+void RenderScene::BuildInstances()
+{
+	for (RDScenePrimitive* prim : mPrimitives)
 	{
-		switch (node->GetType())
+		uint32_t count = (uint32_t)prim->instances.size();
+
+		if (mInstanceDataCount + count > MAX_NUM_INSTANCES)
 		{
-		case ENodeType::LightProbe:
-			AddLightProbe(node);
-			break;
+			LOGW("Render Scene reached the maximum number of instances(%d).", MAX_NUM_INSTANCES);
+			count = MAX_NUM_INSTANCES - mInstanceDataCount;
+		}
+
+		prim->firstInstance = mInstanceDataCount;
+		prim->numInstances = count;
+		prim->visibleFirstInstance = prim->firstInstance;
+		prim->numVisibleInstances = count;
 
-		case ENodeType::IrradianceVolume:
-			AddIrradianceVolume(node);
-			break;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			GUniform::InstanceData& data = mInstanceData[mInstanceDataCount++];
+			data.modelMatrix = prim->instances[i];
+			data.normalMatrix = glm::transpose(glm::inverse(prim->instances[i]));
 		}
 	}
+}
+
+
+void RenderScene::SortPrimitives()
+{
+	double startTime = GetTimeMS();
+
+	// Build the keys...
+	mSortItems.resize(mPrimitives.size());
+
+	for (uint32_t i = 0; i < mPrimitives.size(); ++i)
+	{
+		RDScenePrimitive* prim = mPrimitives[i];
+
+		uint64_t pipeline = (uint64_t)prim->materail->GetType() & 0xFF;
+		uint64_t material = (uint64_t)mMaterialIds[prim->materail] & 0xFFFF;
+		uint64_t mesh = (uint64_t)mMeshIds[prim->primitive] & 0xFFFF;
+
+		prim->sortKey = (pipeline << SORT_KEY_PIPELINE_SHIFT)
+			| (material << SORT_KEY_MATERIAL_SHIFT)
+			| (mesh << SORT_KEY_MESH_SHIFT);
+
+		mSortItems[i].key = prim->sortKey;
+		mSortItems[i].value = i;
+	}
 
+	RadixSort64(mSortItems, mSortTemp);
 
+	// Reorder the primitives, the occlusion stage indexes its objects by the primitive object id instead.
+	mSortedPrimitives.resize(mPrimitives.size());
+
+	for (uint32_t i = 0; i < mSortItems.size(); ++i)
+		mSortedPrimitives[i] = mPrimitives[mSortItems[i].value];
+
+	mPrimitives.swap(mSortedPrimitives);
+
+	mDrawStats.sortTime = (float)(GetTimeMS() - startTime);
 }
 
 
-void RenderScene::TraverseScene(Scene* scene)
+void RenderScene::BindDrawPipeline(VKICommandBuffer* cmdBuffer, RenderShader* shader, RDDrawState& state)
 {
-	// Collect Render Primitives...
-	for (const auto& node : scene->GetRenderable())
+	shader->Bind(cmdBuffer);
+	++mDrawStats.numPipelineBinds;
+
+	state.material = nullptr;
+	state.buffers = nullptr;
+}
+
+
+void RenderScene::BindDrawState(VKICommandBuffer* cmdBuffer, uint32_t frame, const RDScenePrimitive* prim,
+	bool isMaterial, RDDrawState& state)
+{
+	// Material...
+	if (isMaterial)
+	{
+		if (state.material != prim->materail)
+		{
+			prim->materail->Bind(cmdBuffer, frame);
+			state.material = prim->materail;
+			++mDrawStats.numMaterialBinds;
+		}
+		else
+		{
+			++mDrawStats.numRedundantBinds;
+		}
+	}
+
+	// Vertex & Index Buffers...
+	if (state.buffers != prim->primitive)
+	{
+		prim->primitive->BindBuffers(cmdBuffer);
+		state.buffers = prim->primitive;
+		++mDrawStats.numBufferBinds;
+	}
+	else
+	{
+		++mDrawStats.numRedundantBinds;
+	}
+
+	++mDrawStats.numDraws;
+}
+
+
+void RenderScene::BuildHelpers()
+{
+	for (RDScenePrimitiveHelper* helper : mPrimitivesHelpers)
+	{
+		uint32_t count = (uint32_t)helper->instances.size();
+
+		if (mHelperDataCount + count > MAX_NUM_HELPERS)
+		{
+			LOGW("Render Scene reached the maximum number of helpers(%d).", MAX_NUM_HELPERS);
+			count = MAX_NUM_HELPERS - mHelperDataCount;
+		}
+
+		helper->firstInstance = mHelperDataCount;
+		helper->numInstances = count;
+
+		for (uint32_t i = 0; i < count; ++i)
+			mHelperData[mHelperDataCount++] = helper->instances[i];
+	}
+}
+
+
+void RenderScene::SelectOccluders()
+{
+	// Candidates, simple meshes only.
+	for (RDScenePrimitive* prim : mPrimitives)
 	{
-		const Transform& tr = node->GetTransform();
+		if (!prim->mesh || !prim->bounds.IsValid())
+			continue;
+
+		if (prim->mesh->GetIndices().size() / 3 > OCCLUSION_OCCLUDER_MAX_TRIANGLES)
+			continue;
+
+		mOccluders.emplace_back(prim);
+	}
 
-		// Based Renderable Type...
-		switch (node->GetType())
+	// Keep the largest ones.
+	std::sort(mOccluders.begin(), mOccluders.end(), [](const RDScenePrimitive* a, const RDScenePrimitive* b)
 		{
-		case ENodeType::MeshNode:
+			return glm::dot(a->bounds.Extent(), a->bounds.Extent()) > glm::dot(b->bounds.Extent(), b->bounds.Extent());
+		});
+
+	if (mOccluders.size() > OCCLUSION_MAX_OCCLUDERS)
+		mOccluders.resize(OCCLUSION_MAX_OCCLUDERS);
+}
+
+
+void RenderScene::CullOccluded(VKICommandBuffer* cmdBuffer, const glm::mat4& viewProj, RenderStageOcclusion* occlusion)
+{
+	if (!mEnvironment.isSoftwareOcclusion)
+	{
+		for (RDScenePrimitive* prim : mPrimitives)
 		{
-			const MeshNode* meshNode = static_cast<const MeshNode*>(node);
+			prim->visibleFirstInstance = INSTANCE_REGION_ALL * MAX_NUM_INSTANCES + prim->firstInstance;
+			prim->numVisibleInstances = prim->numInstances;
+		}
+
+		return;
+	}
+
+	// Occluders...
+	mOcclusionRasterizer->Begin(viewProj);
+
+	for (RDScenePrimitive* prim : mOccluders)
+	{
+		for (uint32_t i = 0; i < prim->numInstances; ++i)
+			mOcclusionRasterizer->RenderOccluder(prim->mesh, prim->instances[i]);
+	}
 
-			for (uint32_t i = 0; i < meshNode->GetNumMeshes(); ++i)
-			{
-				Mesh* mesh = meshNode->GetMesh(i);
+	mOcclusionRasterizer->End();
 
-				// New...
-				IRenderPrimitives* primitive = mesh->GetRenderMesh();
-				auto newPrim = AddNewPrimitive(primitive, tr.GetMatrix());
 
-				//
-				newPrim->materail = meshNode->GetMaterial(i)->GetRenderMaterial();
-				newPrim->materail->mDynamicOffset = (int32_t)mDynamicMatDataCount;
-				*((MaterialData*)(mDynamicMatData.data() + ALIGN_SIZE(sizeof(MaterialData), 64) * mDynamicMatDataCount)) = *newPrim->materail->mMatData;
+	// Test every instance, the visible ones are compacted at the start of their primitive range.
+	std::fill(mSoftwareVisibility.begin(), mSoftwareVisibility.end(), 0u);
 
-				++mDynamicMatDataCount;
-			}
+	for (RDScenePrimitive* prim : mPrimitives)
+	{
+		prim->visibleFirstInstance = INSTANCE_REGION_SOFTWARE * MAX_NUM_INSTANCES + prim->firstInstance;
+		prim->numVisibleInstances = 0;
+
+		for (uint32_t i = 0; i < prim->numInstances; ++i)
+		{
+			const Box& bounds = prim->instancesBounds[i];
+
+			if (bounds.IsValid() && !mOcclusionRasterizer->TestBox(bounds))
+				continue;
+
+			uint32_t index = prim->firstInstance + i;
+			mSoftwareIndices[prim->firstInstance + prim->numVisibleInstances++] = index;
+			mSoftwareVisibility[index / 32] |= 1u << (index % 32);
 		}
-			break;
+	}
 
-		} // End of Node Type Switch.
+	mOcclusionRasterizer->EndTests();
 
-	} // End of Renderable loop.
 
+	// The occlusion stage combines the visibility mask with its own culling & compacts the instances itself.
+	if ((occlusion && occlusion->IsEnabled()) || mInstanceDataCount == 0)
+		return;
+
+	// The draws of the previous view must be done reading the software region before we overwrite it.
+	RSBarrier(cmdBuffer, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+	mInstanceIndices->CmdUpdate(cmdBuffer, INSTANCE_REGION_SOFTWARE * MAX_NUM_INSTANCES * sizeof(uint32_t),
+		mInstanceDataCount * sizeof(uint32_t), mSoftwareIndices.data());
+
+	RSBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+		VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
 }
 
 
 void RenderScene::UpdateUniforms(uint32_t frame)
 {
-	if (mDynamicMatDataCount > 0)
+	RenderFrameAllocator* allocator = Application::Get().GetRenderer()->GetFrameAllocator();
+
+	// Materials Data...
+	for (const auto& iter : mMaterialIds)
+	{
+		RenderFrameAllocation allocation = allocator->Push(&mMaterialData[iter.second], sizeof(MaterialData));
+
+		// Out of frame memory? the draws of the material are skipped this frame.
+		iter.first->mDynamicOffset = allocation.IsValid() ? allocation.offset : INVALID_UINDEX;
+	}
+
+	if (mInstanceDataCount > 0)
+	{
+		mTransformUniform->Update(frame, 0,
+			mInstanceDataCount * sizeof(GUniform::InstanceData),
+			mInstanceData.data());
+	}
+
+	if (mHelperDataCount > 0)
 	{
-		mMaterialUniform->Update(frame, 0,
-			mDynamicMatDataCount * ALIGN_SIZE(sizeof(MaterialData), 64),
-			mDynamicMatData.data());
+		mHelperUniform->Update(frame, 0,
+			mHelperDataCount * sizeof(GUniform::HelperInstanceData),
+			mHelperData.data());
 	}
 
 }
 
 
-void RenderScene::DrawSceneDeferred(VKICommandBuffer* cmdBuffer, uint32_t frame)
+void RenderScene::DrawSceneDeferred(VKICommandBuffer* cmdBuffer, uint32_t frame, RenderStageOcclusion* occlusion)
 {
+	RDDrawState state;
 	RenderShader* shader = RenderMaterial::GetShader(ERenderMaterialType::Opaque);
-	shader->Bind(cmdBuffer);
+	BindDrawPipeline(cmdBuffer, shader, state);
+
+	// Occlusion Culling...
+	if (occlusion && occlusion->IsEnabled())
+	{
+		for (uint32_t i = 0; i < mPrimitives.size(); ++i)
+		{
+			// All the instances culled by software occlusion culling? or no material data this frame.
+			if (mPrimitives[i]->numVisibleInstances == 0 || !mPrimitives[i]->materail->HasFrameData())
+				continue;
+
+			BindDrawState(cmdBuffer, frame, mPrimitives[i], true, state);
+			mPrimitives[i]->primitive->DrawIndirectBound(cmdBuffer, occlusion->GetIndirectBuffer(),
+				occlusion->GetDrawOffset(1, mPrimitives[i]->objectId));
+		}
+
+		return;
+	}
+
+	for (uint32_t i = 0; i < mPrimitives.size(); ++i)
+	{
+		if (mPrimitives[i]->numVisibleInstances == 0 || !mPrimitives[i]->materail->HasFrameData())
+			continue;
+
+		BindDrawState(cmdBuffer, frame, mPrimitives[i], true, state);
+		mPrimitives[i]->primitive->DrawInstancedBound(cmdBuffer, mPrimitives[i]->visibleFirstInstance,
+			mPrimitives[i]->numVisibleInstances);
+	}
+
+}
+
+
+void RenderScene::DrawSceneDepth(VKICommandBuffer* cmdBuffer, uint32_t frame, const glm::mat4& viewProj,
+	RenderStageOcclusion* occlusion)
+{
+	RDDrawState state;
+	RenderShader* shader = RenderMaterial::GetDirShadowShader(ERenderMaterialType::Opaque);
+	BindDrawPipeline(cmdBuffer, shader, state);
+	shader->GetDescriptorSet()->Bind(cmdBuffer, frame, shader->GetPipeline());
+
+	// Depth only, same as directional shadow with the view transform.
+	GUniform::ShadowConstantBlock shadowConstant;
+	shadowConstant.shadowMatrix = viewProj;
+	shadowConstant.lightPos = glm::vec4(mViewPos, 1.0f);
+
+	vkCmdPushConstants(cmdBuffer->GetCurrent(),
+		shader->GetPipeline()->GetLayout(),
+		VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+		0, sizeof(GUniform::ShadowConstantBlock), &shadowConstant);
+
 
 	for (uint32_t i = 0; i < mPrimitives.size(); ++i)
 	{
-		mPrimitives[i]->materail->Bind(cmdBuffer, frame);
-		mPrimitives[i]->primitive->Draw(cmdBuffer);
+		if (mPrimitives[i]->numVisibleInstances == 0)
+			continue;
+
+		BindDrawState(cmdBuffer, frame, mPrimitives[i], false, state);
+		mPrimitives[i]->primitive->DrawIndirectBound(cmdBuffer, occlusion->GetIndirectBuffer(),
+			occlusion->GetDrawOffset(0, mPrimitives[i]->objectId));
 	}
 
 }
@@ -417,8 +786,9 @@ void RenderScene::DrawSceneDeferred(VKICommandBuffer* cmdBuffer, uint32_t frame)
 
 void RenderScene::DrawSceneShadow(VKICommandBuffer* cmdBuffer, uint32_t frame, IRenderShadow* shadow)
 {
+	RDDrawState state;
 	RenderShader* shader = RenderMaterial::GetDirShadowShader(ERenderMaterialType::Opaque);
-	shader->Bind(cmdBuffer);
+	BindDrawPipeline(cmdBuffer, shader, state);
 	shader->GetDescriptorSet()->Bind(cmdBuffer, frame, shader->GetPipeline());
 
 	// Shadow Input Constants...
@@ -432,9 +802,11 @@ void RenderScene::DrawSceneShadow(VKICommandBuffer* cmdBuffer, uint32_t frame, I
 		0, sizeof(GUniform::ShadowConstantBlock), &shadowConstant);
 
 
+	// All the instances, the all instances region is at the start of the instance indices.
 	for (uint32_t i = 0; i < mPrimitives.size(); ++i)
 	{
-		mPrimitives[i]->primitive->Draw(cmdBuffer);
+		BindDrawState(cmdBuffer, frame, mPrimitives[i], false, state);
+		mPrimitives[i]->primitive->DrawInstancedBound(cmdBuffer, mPrimitives[i]->firstInstance, mPrimitives[i]->numInstances);
 	}
 
 }
@@ -445,22 +817,37 @@ void RenderScene::DrawHelpers(VKICommandBuffer* cmdBuffer, uint32_t frame)
 	if (mPrimitivesHelpers.empty())
 		return;
 
-	RenderShader* shader = RenderMaterial::SPHERE_HELPER_SHADER.get();
-	shader->Bind(cmdBuffer);
-	shader->GetDescriptorSet()->Bind(cmdBuffer, frame, shader->GetPipeline());
-
-	GUniform::SphereHelperBlock helperBlock;
+	RenderShader* boundShader = nullptr;
 
 	for (uint32_t i = 0; i < mPrimitivesHelpers.size(); ++i)
 	{
-		helperBlock.position = mPrimitivesHelpers[i]->position;
-		helperBlock.scale = mPrimitivesHelpers[i]->scale;
-		helperBlock.color = mPrimitivesHelpers[i]->color;
+		RDScenePrimitiveHelper* helper = mPrimitivesHelpers[i];
+
+		if (helper->numInstances == 0)
+			continue;
+
+		// Spheres as impostors?
+		bool isImpostor = mEnvironment.isHelperImpostors && helper->primitive == mRSphere.get();
+
+		RenderShader* shader = isImpostor ? RenderMaterial::SPHERE_IMPOSTOR_SHADER.get()
+			: RenderMaterial::SPHERE_HELPER_SHADER.get();
 
-		vkCmdPushConstants(cmdBuffer->GetCurrent(), shader->GetPipeline()->GetLayout(),
-			VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-			0, sizeof(helperBlock), &helperBlock);
+		if (shader != boundShader)
+		{
+			shader->Bind(cmdBuffer);
+			shader->GetDescriptorSet()->Bind(cmdBuffer, frame, shader->GetPipeline());
+			boundShader = shader;
+		}
 
-		mPrimitivesHelpers[i]->primitive->Draw(cmdBuffer);
+		// Draw all the helpers of this primitive...
+		if (isImpostor)
+		{
+			// A quad for each instance, generated in the vertex shader.
+			vkCmdDraw(cmdBuffer->GetCurrent(), 6, helper->numInstances, 0, helper->firstInstance);
+		}
+		else
+		{
+			helper->primitive->DrawInstanced(cmdBuffer, helper->firstInstance, helper->numInstances);
+		}
 	}
 }
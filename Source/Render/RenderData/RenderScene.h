@@ -24,16 +24,23 @@
 
 
 #include "Core/Core.h"
+#include "Core/Box.h"
+#include "Core/Material.h"
+#include "Core/RadixSort.h"
+#include "Shaders/RenderShaderBlocks.h"
 #include "glm/vec3.hpp"
 #include "glm/matrix.hpp"
 
 #include <vector>
+#include <map>
 
 
 
 
 class Scene;
 class Node;
+class Mesh;
+class OcclusionRasterizer;
 class IRenderPrimitives;
 class RenderUniform;
 class IRenderShadow;
@@ -41,40 +48,115 @@ class RenderDirShadow;
 class RenderLightProbe;
 class RenderIrradianceVolume;
 class RenderMaterial;
+class RenderShader;
 class RenderSphere;
 class RenderBox;
 class VKICommandBuffer;
+class VKIBuffer;
 class VKIImage;
 class VKIFramebuffer;
 class VKIDescriptorSet;
+class RenderStageOcclusion;
+struct RDFrameSnapshot;
+struct RDSnapshotLightProbe;
+struct RDSnapshotIrradianceVolume;
 
 
 
 
 
 
-// a single primitive referneced by the render scene.
+// a single primitive referneced by the render scene, all its instances are drawn with a single draw.
 struct RDScenePrimitive
 {
 	// The Primitive to draw.
 	IRenderPrimitives* primitive;
 
-	// Primitive World Transform.
-	glm::mat4 transform;
+	// The World Transform of each instance.
+	std::vector<glm::mat4> instances;
+
+	// The World Bounds of each instance.
+	std::vector<Box> instancesBounds;
+
+	// The first instance in the scene instance buffer & the number of instances to draw.
+	uint32_t firstInstance;
+	uint32_t numInstances;
+
+	// The first instance index & the number of instances visible by the current view in the instance indices buffer,
+	// software occlusion culling compacts the visible instances, otherwise it is the range of all the instances.
+	uint32_t visibleFirstInstance;
+	uint32_t numVisibleInstances;
 
 	// The Primitive Materail.
 	RenderMaterial* materail;
+
+	// Primitive World Bounds, including all instances, culling uses the bounds of each instance.
+	Box bounds;
+
+	// The number of indices to draw.
+	uint32_t numIndices;
+
+	// The mesh of the primitive, used as an occluder for software occlusion culling.
+	const Mesh* mesh;
+
+	// The draw sort key, Pipeline[63:56] Material[55:40] Mesh[39:24], unique for each primitive & material.
+	uint64_t sortKey;
+
+	// The index of the primitive before sorting, follows the snapshot order so it is stable across frames
+	// while the scene doesn't change, used to index the occlusion culling objects & their visibility history.
+	uint32_t objectId;
 };
 
 
 
-// Primitive Helper
+// The bound state while recording draws, used to skip redundant binds.
+struct RDDrawState
+{
+	// The bound material, null for passes without materials.
+	RenderMaterial* material;
+
+	// The primitive with bound vertex & index buffers.
+	IRenderPrimitives* buffers;
+};
+
+
+
+// Draw submission stats of a frame, accumulated over all the scene draws.
+struct RDDrawStats
+{
+	// The number of draw calls.
+	uint32_t numDraws;
+
+	// The number of pipeline binds.
+	uint32_t numPipelineBinds;
+
+	// The number of material descriptor set binds.
+	uint32_t numMaterialBinds;
+
+	// The number of vertex & index buffers binds.
+	uint32_t numBufferBinds;
+
+	// The number of binds skipped because they match the bound state.
+	uint32_t numRedundantBinds;
+
+	// Time to build & sort the draw keys in milliseconds.
+	float sortTime;
+};
+
+
+
+// Primitive Helper, all the helpers of the same primitive are drawn with a single instanced draw.
 struct RDScenePrimitiveHelper
 {
+	// The Primitive to draw.
 	IRenderPrimitives* primitive;
-	glm::vec4 position;
-	glm::vec4 scale;
-	glm::vec4 color;
+
+	// The data of each helper instance.
+	std::vector<GUniform::HelperInstanceData> instances;
+
+	// The first instance in the helpers instance buffer & the number of instances to draw.
+	uint32_t firstInstance;
+	uint32_t numInstances;
 };
 
 
@@ -99,6 +181,18 @@ struct RDEnvironment
 	bool isLightProbeHelpers;
 	bool isLightProbeVisualize;
 
+	// Draw sphere helpers as screen aligned quads with analytic sphere shading.
+	bool isHelperImpostors;
+
+	// Cull occluded primitives using the depth pyramid.
+	bool isOcclusionCulling;
+
+	// Cull occluded primitives on the CPU before recording draw commands.
+	bool isSoftwareOcclusion;
+
+	// The application time of the frame.
+	float time;
+
 	// Reset the environment data.
 	void Reset();
 };
@@ -127,14 +221,20 @@ public:
 	// Destroy the render scene.
 	void Destroy();
 
-	// Build the render scene data from scene.
-	void BuildRenderScene(Scene* scene);
+	// Build the render scene data from a frame snapshot of the scene.
+	void BuildRenderScene(const RDFrameSnapshot* snapshot);
+
+	// Collect the view data from the scene, can be called again to update the view before uniforms are updated.
+	void CollectSceneView(Scene* scene);
 
 	// Reset the scene data.
 	void Reset();
 
-	// Draw the scene.
-	void DrawSceneDeferred(VKICommandBuffer* cmdBuffer, uint32_t frame);
+	// Draw the scene, using the final draw commands of occlusion culling if enabled.
+	void DrawSceneDeferred(VKICommandBuffer* cmdBuffer, uint32_t frame, RenderStageOcclusion* occlusion = nullptr);
+
+	// Draw the depth of primitives visible last frame for occlusion culling depth pre-pass.
+	void DrawSceneDepth(VKICommandBuffer* cmdBuffer, uint32_t frame, const glm::mat4& viewProj, RenderStageOcclusion* occlusion);
 
 	// Draw the scene for shadow pass.
 	void DrawSceneShadow(VKICommandBuffer* cmdBuffer, uint32_t frame, IRenderShadow* shadow);
@@ -142,6 +242,19 @@ public:
 	//
 	void DrawHelpers(VKICommandBuffer* cmdBuffer, uint32_t frame);
 
+	// Cull instances occluded by the scene occluders for a view using the software rasterizer, the visible instances
+	// are compacted into the software region of the instance indices unless the occlusion stage draws them.
+	void CullOccluded(VKICommandBuffer* cmdBuffer, const glm::mat4& viewProj, RenderStageOcclusion* occlusion);
+
+	// Return the instances visibility mask of the last software occlusion culling, a bit for each instance.
+	inline const std::vector<uint32_t>& GetSoftwareVisibility() const { return mSoftwareVisibility; }
+
+	// Return the software occlusion rasterizer.
+	inline OcclusionRasterizer* GetOcclusionRasterizer() const { return mOcclusionRasterizer.get(); }
+
+	// Return the primitives in the render scene.
+	inline const std::vector<RDScenePrimitive*>& GetPrimitives() const { return mPrimitives; }
+
 	// Return Render Environment.
 	inline RDEnvironment GetEnvironment() const { return mEnvironment; }
 
@@ -162,7 +275,15 @@ public:
 
 	// Return uniform.
 	inline RenderUniform* GetTransformUniform() { return mTransformUniform.get(); }
-	inline RenderUniform* GetMatUniform() { return mMaterialUniform.get(); }
+
+	// Return the number of instances in the instance buffer.
+	inline uint32_t GetNumInstances() const { return mInstanceDataCount; }
+
+	// Return the helpers instance uniform.
+	inline RenderUniform* GetHelperUniform() { return mHelperUniform.get(); }
+
+	// Return the draw stats of the last frame.
+	inline const RDDrawStats& GetDrawStats() const { return mLastDrawStats; }
 
 	// Update Dynamic Uniforms.
 	void UpdateUniforms(uint32_t frame);
@@ -184,30 +305,51 @@ public:
 	VKIDescriptorSet* GetSunLightDescSet() const { return mSunLightingSet.get(); }
 
 private:
-	// Add new primitive to be rendered by the scene.
-	RDScenePrimitive* AddNewPrimitive(IRenderPrimitives* primitive, const glm::mat4& transform);
+	// Add new instance to be rendered by the scene, instances of the same primitive & material share the same scene primitive.
+	RDScenePrimitive* AddNewPrimitive(IRenderPrimitives* primitive, RenderMaterial* material, const glm::mat4& transform,
+		const Box& bounds);
+
+	// Assign instances ranges & build the instance data.
+	void BuildInstances();
+
+	// Build the draw sort keys & sort the primitives to minimize state changes.
+	void SortPrimitives();
 
-	// Add new primitive helper to be rendered by the scene.
+	// Bind the pipeline of a pass & reset the bound state.
+	void BindDrawPipeline(VKICommandBuffer* cmdBuffer, RenderShader* shader, RDDrawState& state);
+
+	// Bind the material & buffers of a primitive, skipping the ones matching the bound state.
+	void BindDrawState(VKICommandBuffer* cmdBuffer, uint32_t frame, const RDScenePrimitive* prim,
+		bool isMaterial, RDDrawState& state);
+
+	// Add new helper instance to be rendered by the scene, helpers of the same primitive are batched together.
 	RDScenePrimitiveHelper* AddNewHelper(IRenderPrimitives* primitive, const glm::vec4& pos, const glm::vec4& scale,
 		const glm::vec4& color);
 
-	// Collect the view data from the scene.
-	void CollectSceneView(Scene* scene);
+	// Assign helpers instances ranges & build the helpers instance data.
+	void BuildHelpers();
+
+	// Set the view & projection of the scene.
+	void SetView(const glm::mat4& view, const glm::mat4& proj, const glm::vec2& nearFar,
+		const glm::vec3& viewPos, const glm::vec3& viewDir);
 
-	// Collect lights from the scene.
-	void CollectSceneLights(Scene* scene);
+	// Collect lights from the snapshot.
+	void CollectSceneLights(const RDFrameSnapshot* snapshot);
 
-	// Collect render data from nodes.
-	void TraverseScene(Scene* scene);
+	// Collect render data from the snapshot instances.
+	void TraverseScene(const RDFrameSnapshot* snapshot);
+
+	// Select the primitives used as occluders for software occlusion culling.
+	void SelectOccluders();
 
 	// Create the sun render data.
 	void CreateSunData();
 
 	// Add light probe to be rendered with the scene.
-	void AddLightProbe(Node* node);
+	void AddLightProbe(const RDSnapshotLightProbe& probe);
 
 	// Add irradiance volume to be rendered with the scene.
-	void AddIrradianceVolume(Node* node);
+	void AddIrradianceVolume(const RDSnapshotIrradianceVolume& volume);
 
 private:
 	// The scene we want to render.
@@ -215,8 +357,38 @@ private:
 
 	// List of all primitive that will be drawn in the scene.
 	std::vector<RDScenePrimitive*> mPrimitives;
+
+	// Map primitive & material to its scene primitive for batching instances.
+	std::map< std::pair<IRenderPrimitives*, RenderMaterial*>, RDScenePrimitive* > mPrimitivesMap;
+
+	// The ids of meshes used in the draw sort keys.
+	std::map<IRenderPrimitives*, uint32_t> mMeshIds;
+
+	// The materials used this frame & their ids, the material data is written to the frame allocator.
+	std::map<RenderMaterial*, uint32_t> mMaterialIds;
+
+	// The data of the materials used this frame, by material id.
+	std::vector<MaterialData> mMaterialData;
+
+	// Draw sort items & scratch buffers.
+	std::vector<RadixSortItem> mSortItems;
+	std::vector<RadixSortItem> mSortTemp;
+	std::vector<RDScenePrimitive*> mSortedPrimitives;
+
+	// Draw Stats of the current & last frame.
+	RDDrawStats mDrawStats;
+	RDDrawStats mLastDrawStats;
 	std::vector<RDScenePrimitiveHelper*> mPrimitivesHelpers;
 
+	// Map primitive to its helper batch.
+	std::map<IRenderPrimitives*, RDScenePrimitiveHelper*> mPrimitivesHelpersMap;
+
+	// The primitives used as occluders for software occlusion culling.
+	std::vector<RDScenePrimitive*> mOccluders;
+
+	// Software occlusion culling rasterizer.
+	UniquePtr<OcclusionRasterizer> mOcclusionRasterizer;
+
 	// The scene global environment data
 	RDEnvironment mEnvironment;
 
@@ -235,11 +407,26 @@ private:
 	// View Direction.
 	glm::vec3 mViewDir;
 
-	// Transfrom Uniform.
+	// Transfrom Uniform, the instances data of all primitives.
 	UniquePtr<RenderUniform> mTransformUniform;
 
-	// Material Uniform.
-	UniquePtr<RenderUniform> mMaterialUniform;
+	// Instance Data.
+	std::vector<GUniform::InstanceData> mInstanceData;
+	uint32_t mInstanceDataCount;
+
+	// The renderer instance indices, the software region is written by software occlusion culling.
+	VKIBuffer* mInstanceIndices;
+
+	// The visible instances compacted by software occlusion culling & their visibility mask.
+	std::vector<uint32_t> mSoftwareIndices;
+	std::vector<uint32_t> mSoftwareVisibility;
+
+	// Helpers Uniform, the instances data of all helpers.
+	UniquePtr<RenderUniform> mHelperUniform;
+
+	// Helpers Instance Data.
+	std::vector<GUniform::HelperInstanceData> mHelperData;
+	uint32_t mHelperDataCount;
 
 	// The Sun Shadow.
 	UniquePtr<RenderDirShadow> mSunShadow;
@@ -261,8 +448,4 @@ private:
 	UniquePtr<RenderSphere> mRSphere;
 	UniquePtr<RenderBox> mRBox;
 
-	// Dynamic Materail Data.
-	std::vector<uint8_t> mDynamicMatData;
-	uint32_t mDynamicMatDataCount;
-
 };
@@ -0,0 +1,149 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "RenderSnapshot.h"
+#include "Core/Mesh.h"
+#include "Core/Material.h"
+#include "Application.h"
+
+#include "Scene/Scene.h"
+#include "Scene/MeshNode.h"
+#include "Scene/LightProbeNode.h"
+#include "Scene/IrradianceVolumeNode.h"
+
+#include "Render/RenderData/Primitives/RenderMesh.h"
+#include "Render/RenderData/Shaders/RenderMaterial.h"
+
+
+
+
+
+
+void RDFrameSnapshot::Capture(Scene* scene)
+{
+	// View...
+	view = scene->GetCamera().GetViewTransform();
+	proj = scene->GetCamera().GetProjection();
+	scene->GetCamera().GetZPlane(nearFar.x, nearFar.y);
+	viewPos = scene->GetCamera().GetViewPos();
+	viewDir = scene->GetCamera().GetViewDir();
+
+	// The Sun...
+	environment.Reset();
+	environment.sunDir = glm::vec4(scene->GetGlobal().GetSunDir(), 0.0f);
+	environment.sunColorAndPower = glm::vec4(scene->GetGlobal().GetSunColor(),
+		scene->GetGlobal().GetSunPower());
+	environment.time = Application::Get().GetAppTime();
+
+	sceneBounds = scene->GetBounds();
+	isSunDirty = scene->GetGlobal().HasDirtyFlag(ESceneGlobalDirtyFlag::DirtySun);
+	scene->GetGlobal().ClearDirtyFlag(ESceneGlobalDirtyFlag::DirtySun);
+
+	environment.isLightProbeEnabled = scene->GetGlobal().isLightProbeEnabled;
+	environment.isLightProbeHelpers = scene->GetGlobal().isLightProbeHelpers;
+	environment.isHelperImpostors = scene->GetGlobal().isHelperImpostors;
+	environment.isLightProbeVisualize = scene->GetGlobal().isLightProbeVisualize;
+	environment.isOcclusionCulling = scene->GetGlobal().isOcclusionCulling;
+	environment.isSoftwareOcclusion = scene->GetGlobal().isSoftwareOcclusion;
+
+
+	// Lights & Light Probes...
+	lightProbes.clear();
+	irradianceVolumes.clear();
+
+	for (auto& node : scene->GetLights())
+	{
+		switch (node->GetType())
+		{
+		case ENodeType::LightProbe:
+		{
+			LightProbeNode* probe = static_cast<LightProbeNode*>(node);
+
+			RDSnapshotLightProbe snapProbe;
+			snapProbe.probe = probe->GetRenderLightProbe();
+			snapProbe.position = probe->GetPosition();
+			snapProbe.radius = probe->GetRadius();
+			snapProbe.dirty = probe->TakeDirty();
+			snapProbe.isSelected = probe->IsSelected();
+			lightProbes.emplace_back(snapProbe);
+		}
+			break;
+
+		case ENodeType::IrradianceVolume:
+		{
+			IrradianceVolumeNode* volume = static_cast<IrradianceVolumeNode*>(node);
+
+			RDSnapshotIrradianceVolume snapVolume;
+			snapVolume.volume = volume->GetRenderIrradianceVolume();
+			snapVolume.dirty = volume->TakeDirty();
+			irradianceVolumes.emplace_back(snapVolume);
+		}
+			break;
+		}
+	}
+
+
+	// Renderable Instances...
+	instances.clear();
+
+	for (const auto& node : scene->GetRenderable())
+	{
+		const Transform& tr = node->GetTransform();
+
+		// Based Renderable Type...
+		switch (node->GetType())
+		{
+		case ENodeType::MeshNode:
+		{
+			const MeshNode* meshNode = static_cast<const MeshNode*>(node);
+
+			for (uint32_t i = 0; i < meshNode->GetNumMeshes(); ++i)
+			{
+				Mesh* mesh = meshNode->GetMesh(i);
+				Material* material = meshNode->GetMaterial(i);
+
+				RDSnapshotInstance instance;
+				instance.primitive = mesh->GetRenderMesh();
+				instance.material = material->GetRenderMaterial();
+				instance.materialData = material->GetData();
+				instance.mesh = mesh;
+				instance.transform = tr.GetMatrix();
+				instance.bounds = mesh->GetBounds().Transform(instance.transform);
+				instances.emplace_back(instance);
+			}
+		}
+			break;
+
+		} // End of Node Type Switch.
+
+	} // End of Renderable loop.
+
+}
+
+
+void RDFrameSnapshot::Reset()
+{
+	instances.clear();
+	lightProbes.clear();
+	irradianceVolumes.clear();
+	environment.Reset();
+	ui.Clear();
+}
@@ -0,0 +1,158 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+
+#include "Core/Core.h"
+#include "Core/Box.h"
+#include "Core/Material.h"
+#include "RenderScene.h"
+#include "UI/RenderImGUI.h"
+#include "Render/Renderer.h"
+#include "glm/vec2.hpp"
+#include "glm/vec3.hpp"
+#include "glm/matrix.hpp"
+
+#include <vector>
+
+
+
+
+class Scene;
+class Mesh;
+class IRenderPrimitives;
+class RenderMaterial;
+class RenderLightProbe;
+class RenderIrradianceVolume;
+
+
+
+
+
+
+// A single renderable instance captured from the scene.
+struct RDSnapshotInstance
+{
+	// The primitive & material to draw the instance with.
+	IRenderPrimitives* primitive;
+	RenderMaterial* material;
+
+	// The material data, copied as the main thread can change it while the frame is rendered.
+	MaterialData materialData;
+
+	// The mesh of the primitive, used as an occluder for software occlusion culling.
+	const Mesh* mesh;
+
+	// The instance world transform.
+	glm::mat4 transform;
+
+	// The instance world bounds.
+	Box bounds;
+};
+
+
+
+// A light probe captured from the scene.
+struct RDSnapshotLightProbe
+{
+	// The render data of the light probe.
+	RenderLightProbe* probe;
+
+	// The probe position & radius, applied to the render data by the render thread.
+	glm::vec3 position;
+	float radius;
+
+	// The dirty value requested since the last captured frame, zero if none.
+	uint32_t dirty;
+
+	// True if the probe node is selected.
+	bool isSelected;
+};
+
+
+
+// An irradiance volume captured from the scene.
+struct RDSnapshotIrradianceVolume
+{
+	// The render data of the irradiance volume.
+	RenderIrradianceVolume* volume;
+
+	// The dirty value requested since the last captured frame, zero if none.
+	uint32_t dirty;
+};
+
+
+
+
+
+
+// RDFrameSnapshot:
+//    - the scene, view & ui state of a single frame, captured by the main thread and read only by the render thread.
+//    - render objects referenced by the snapshot are owned by the scene, the scene is only destroyed after the
+//      render thread is flushed.
+//    - the main thread state of the render objects is copied, after they are created the render objects
+//      are only changed by the render thread.
+//
+struct RDFrameSnapshot
+{
+	// The view & projection of the scene camera.
+	glm::mat4 view;
+	glm::mat4 proj;
+
+	// Near & Far clip plane.
+	glm::vec2 nearFar;
+
+	// The view position & direction.
+	glm::vec3 viewPos;
+	glm::vec3 viewDir;
+
+	// The scene environment, sun & render flags.
+	RDEnvironment environment;
+
+	// The scene bounds, used to fit the sun shadow.
+	Box sceneBounds;
+
+	// True if the sun changed since the last captured frame.
+	bool isSunDirty;
+
+	// The renderable instances of the scene.
+	std::vector<RDSnapshotInstance> instances;
+
+	// The light probes & irradiance volumes of the scene.
+	std::vector<RDSnapshotLightProbe> lightProbes;
+	std::vector<RDSnapshotIrradianceVolume> irradianceVolumes;
+
+	// The ui draw data of the frame.
+	RDUIDrawData ui;
+
+	// The frame settings when the frame was submitted.
+	RendererFrameSettings frame;
+
+	// The time input was sampled for this frame, used to measure the frame latency.
+	double inputTime;
+
+	// Capture the scene state, called by the main thread after the scene is updated.
+	void Capture(Scene* scene);
+
+	// Reset the snapshot data & free the ui draw data.
+	void Reset();
+};
@@ -31,6 +31,25 @@
 #define LIGHT_PROBES_TARGET_SIZE 256
 #define IRRADIANCE_VOLUME_TARGET_SIZE 128
 
+#define RENDER_SCALE_STEPS 32.0f
+
+#define MAX_NUM_INSTANCES 16384
+
+// Regions of the scene instance indices buffer, each one has MAX_NUM_INSTANCES indices.
+#define INSTANCE_REGION_ALL 0
+#define INSTANCE_REGION_SOFTWARE 1
+#define INSTANCE_REGION_PRE_PASS 2
+#define INSTANCE_REGION_FINAL 3
+#define INSTANCE_NUM_REGIONS 4
+
+#define OCCLUSION_MAX_OBJECTS 4096
+#define OCCLUSION_MAX_VIEWS 7
+
+#define OCCLUSION_RASTER_WIDTH 256
+#define OCCLUSION_RASTER_HEIGHT 128
+#define OCCLUSION_MAX_OCCLUDERS 32
+#define OCCLUSION_OCCLUDER_MAX_TRIANGLES 1024
+
 
 
 
@@ -126,7 +145,10 @@ enum class ERenderShaderInputType
 	Uniform,
 
 	// Dynamic Uniform that can be offsetted dynamically.
-	DynamicUniform
+	DynamicUniform,
+
+	// Storage Buffer.
+	StorageBuffer
 };
 
 
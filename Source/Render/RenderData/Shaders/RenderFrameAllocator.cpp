@@ -0,0 +1,146 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+
+#include "RenderFrameAllocator.h"
+#include "Render/Renderer.h"
+
+
+#include "Render/VKInterface/VKIDevice.h"
+#include "Render/VKInterface/VKIInstance.h"
+#include "Render/VKInterface/VKIBuffer.h"
+
+
+#include <cstring>
+#include <algorithm>
+
+
+
+
+
+
+RenderFrameAllocator::RenderFrameAllocator()
+	: mFrameSize(0)
+	, mAlignment(256)
+	, mFrameStart(0)
+	, mHead(0)
+	, mNumFrames(0)
+{
+	mStats = RenderFrameAllocatorStats{};
+	mLastStats = RenderFrameAllocatorStats{};
+}
+
+
+RenderFrameAllocator::~RenderFrameAllocator()
+{
+
+}
+
+
+void RenderFrameAllocator::Create(Renderer* owner, uint32_t frameSize)
+{
+	VKIDevice* device = owner->GetVKDevice();
+
+	// Alignment that works for both uniform & storage dynamic offsets.
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(device->GetInstance()->GetPhysicalDevice(), &properties);
+
+	mAlignment = (uint32_t)std::max(properties.limits.minUniformBufferOffsetAlignment,
+		properties.limits.minStorageBufferOffsetAlignment);
+
+	mNumFrames = Renderer::NUM_CONCURRENT_FRAMES;
+	mFrameSize = ALIGN_SIZE(frameSize, mAlignment);
+
+	mBuffer = UniquePtr<VKIBuffer>(new VKIBuffer());
+	mBuffer->SetSize(mFrameSize * mNumFrames);
+	mBuffer->SetUsage(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	mBuffer->SetMemoryProperties(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	mBuffer->CreateBuffer(device);
+
+	CHECK(mBuffer->GetMapped() && "Frame allocator buffer must be mapped.");
+}
+
+
+void RenderFrameAllocator::Destroy()
+{
+	mBuffer->Destroy();
+	mBuffer.reset();
+}
+
+
+void RenderFrameAllocator::BeginFrame(uint32_t frame)
+{
+	CHECK(frame < mNumFrames);
+
+	// Stats of the previous frame.
+	mStats.usedBytes = mHead;
+	mStats.peakBytes = std::max(mLastStats.peakBytes, mHead);
+	mLastStats = mStats;
+	mStats = RenderFrameAllocatorStats{};
+
+	mFrameStart = frame * mFrameSize;
+	mHead = 0;
+}
+
+
+RenderFrameAllocation RenderFrameAllocator::Allocate(uint32_t size)
+{
+	RenderFrameAllocation allocation{};
+	uint32_t alignedSize = ALIGN_SIZE(size, mAlignment);
+
+	// Overflow?
+	if (mHead + alignedSize > mFrameSize)
+	{
+		// Report only the first overflow in a frame.
+		if (mStats.numOverflows == 0)
+			LOGE("Frame allocator overflow, frame size(%d), requested(%d).", mFrameSize, size);
+
+		++mStats.numOverflows;
+		return allocation;
+	}
+
+	allocation.offset = mFrameStart + mHead;
+	allocation.data = mBuffer->GetMapped() + allocation.offset;
+
+	mHead += alignedSize;
+	++mStats.numAllocations;
+
+	return allocation;
+}
+
+
+RenderFrameAllocation RenderFrameAllocator::Push(const void* data, uint32_t size)
+{
+	RenderFrameAllocation allocation = Allocate(size);
+
+	if (allocation.IsValid())
+		memcpy(allocation.data, data, size);
+
+	return allocation;
+}
+
+
+std::vector<VKIBuffer*> RenderFrameAllocator::GetBuffers() const
+{
+	return std::vector<VKIBuffer*>(mNumFrames, mBuffer.get());
+}
+
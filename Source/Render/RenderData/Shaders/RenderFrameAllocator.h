@@ -0,0 +1,142 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#pragma once
+
+
+
+
+#include "Core/Core.h"
+
+
+#include <vector>
+
+
+
+
+class Renderer;
+class VKIBuffer;
+
+
+
+
+
+// A suballocation from the frame allocator.
+struct RenderFrameAllocation
+{
+	// The mapped memory of the allocation, null if the allocation failed.
+	uint8_t* data;
+
+	// Offset from the start of the allocator buffer, used as dynamic offset.
+	uint32_t offset;
+
+	// Return true if the allocation succeeded.
+	inline bool IsValid() const { return data != nullptr; }
+};
+
+
+
+// Frame allocator usage stats of the last frame.
+struct RenderFrameAllocatorStats
+{
+	// The number of bytes used by the frame.
+	uint32_t usedBytes;
+
+	// The peak of used bytes over all frames.
+	uint32_t peakBytes;
+
+	// The number of allocations.
+	uint32_t numAllocations;
+
+	// The number of allocations that failed because the frame is full.
+	uint32_t numOverflows;
+};
+
+
+
+
+// RenderFrameAllocator:
+//    - Linear allocator for per-frame uniform & dynamic data in a single persistently mapped buffer.
+//    - The buffer is split into a region for each concurrent frame, a region is reset when its frame begins.
+//    - Allocations are aligned to the device minimum uniform/storage offset alignment.
+//
+class RenderFrameAllocator
+{
+public:
+	// Construct.
+	RenderFrameAllocator();
+
+	// Destruct.
+	~RenderFrameAllocator();
+
+	// Create the buffer with a region of frameSize bytes for each concurrent frame.
+	void Create(Renderer* owner, uint32_t frameSize);
+
+	// Destroy the buffer.
+	void Destroy();
+
+	// Reset the region of the frame, the frame must be done on the GPU.
+	void BeginFrame(uint32_t frame);
+
+	// Allocate size bytes from the current frame.
+	// @return an invalid allocation if the frame is full, whatever uses it must be skipped this frame.
+	RenderFrameAllocation Allocate(uint32_t size);
+
+	// Allocate & copy data into the current frame.
+	RenderFrameAllocation Push(const void* data, uint32_t size);
+
+	// Return the buffer.
+	inline VKIBuffer* GetBuffer() const { return mBuffer.get(); }
+
+	// Return the buffer for each concurrent frame, used to create descriptor sets.
+	std::vector<VKIBuffer*> GetBuffers() const;
+
+	// Return the allocations alignment.
+	inline uint32_t GetAlignment() const { return mAlignment; }
+
+	// Return the stats of the last frame.
+	inline const RenderFrameAllocatorStats& GetStats() const { return mLastStats; }
+
+private:
+	// The Buffer.
+	UniquePtr<VKIBuffer> mBuffer;
+
+	// The size of each frame region.
+	uint32_t mFrameSize;
+
+	// The allocations alignment.
+	uint32_t mAlignment;
+
+	// The start of the current frame region.
+	uint32_t mFrameStart;
+
+	// The offset of the next allocation from the start of the current frame region.
+	uint32_t mHead;
+
+	// The number of concurrent frames.
+	uint32_t mNumFrames;
+
+	// Stats of the current & last frame.
+	RenderFrameAllocatorStats mStats;
+	RenderFrameAllocatorStats mLastStats;
+};
+
@@ -27,6 +27,7 @@
 #include "RenderShader.h"
 #include "RenderUniform.h"
 #include "RenderShaderBlocks.h"
+#include "RenderFrameAllocator.h"
 
 
 #include "Application.h"
@@ -38,6 +39,8 @@
 #include "Render/VKInterface/VKIDescriptor.h"
 #include "Render/VKInterface/VKICommandBuffer.h"
 #include "Render/VKInterface/VKIGraphicsPipeline.h"
+#include "Render/VKInterface/VKIDevice.h"
+#include "Render/VKInterface/VKIUploadManager.h"
 
 
 
@@ -50,6 +53,9 @@ Ptr<RenderShader> RenderMaterial::SHADOW_DIR_SHADER[2];
 Ptr<RenderShader> RenderMaterial::SHADOW_OMNI_SHADER[2];
 
 Ptr<RenderShader> RenderMaterial::SPHERE_HELPER_SHADER;
+Ptr<RenderShader> RenderMaterial::SPHERE_IMPOSTOR_SHADER;
+
+const uint32_t RenderMaterial::ALL_SETS_RESIDENT = (1u << Renderer::NUM_CONCURRENT_FRAMES) - 1u;
 
 
 
@@ -60,7 +66,6 @@ Ptr<RenderShader> RenderMaterial::SPHERE_HELPER_SHADER;
 void RenderMaterial::SetupMaterialShaders(Renderer* renderer, RenderUniform* transformUniform)
 {
 	VkExtent2D swExtent = renderer->GetVKSwapChain()->GetExtent();
-	RenderUniform* commonUniform = renderer->GetPipeline()->GetUniforms().common.get();
 
 	// Opaque...
 	{
@@ -77,10 +82,14 @@ void RenderMaterial::SetupMaterialShaders(Renderer* renderer, RenderUniform* tra
 		OPAQUE_SHADER->SetViewport(0, 0, swExtent.width, swExtent.height);
 		OPAQUE_SHADER->SetViewportDynamic(true);
 		OPAQUE_SHADER->SetDepth(true, true);
+		OPAQUE_SHADER->SetDepthLessOrEqual(true); // Objects drawn in the occlusion depth pre-pass.
 
-		OPAQUE_SHADER->AddInput(RenderShader::COMMON_BLOCK_BINDING, ERenderShaderInputType::Uniform,
+		OPAQUE_SHADER->AddInput(RenderShader::COMMON_BLOCK_BINDING, ERenderShaderInputType::DynamicUniform,
 			ERenderShaderStage::AllStages);
 
+		OPAQUE_SHADER->AddInput(1, ERenderShaderInputType::StorageBuffer, ERenderShaderStage::Vertex);
+		OPAQUE_SHADER->AddInput(2, ERenderShaderInputType::StorageBuffer, ERenderShaderStage::Vertex);
+
 		OPAQUE_SHADER->AddInput(3, ERenderShaderInputType::DynamicUniform, ERenderShaderStage::Fragment);
 		OPAQUE_SHADER->AddInput(4, ERenderShaderInputType::ImageSampler, ERenderShaderStage::Fragment);
 		OPAQUE_SHADER->AddInput(5, ERenderShaderInputType::ImageSampler, ERenderShaderStage::Fragment);
@@ -101,9 +110,12 @@ void RenderMaterial::SetupMaterialShaders(Renderer* renderer, RenderUniform* tra
 		SHADOW_DIR_SHADER[0]->SetViewportDynamic(true);
 		SHADOW_DIR_SHADER[0]->SetDepth(true, true);
 
-		SHADOW_DIR_SHADER[0]->AddInput(RenderShader::COMMON_BLOCK_BINDING, ERenderShaderInputType::Uniform,
+		SHADOW_DIR_SHADER[0]->AddInput(RenderShader::COMMON_BLOCK_BINDING, ERenderShaderInputType::DynamicUniform,
 			ERenderShaderStage::AllStages);
 
+		SHADOW_DIR_SHADER[0]->AddInput(1, ERenderShaderInputType::StorageBuffer, ERenderShaderStage::Vertex);
+		SHADOW_DIR_SHADER[0]->AddInput(2, ERenderShaderInputType::StorageBuffer, ERenderShaderStage::Vertex);
+
 		SHADOW_DIR_SHADER[0]->AddPushConstant(0, 0, sizeof(GUniform::ShadowConstantBlock),
 			ERenderShaderStage::Vertex | ERenderShaderStage::Fragment);
 
@@ -113,8 +125,11 @@ void RenderMaterial::SetupMaterialShaders(Renderer* renderer, RenderUniform* tra
 		VKIDescriptorSet* SHADOW_DIR_DESCSET = SHADOW_DIR_SHADER[0]->CreateDescriptorSet();
 		SHADOW_DIR_DESCSET->SetLayout(SHADOW_DIR_SHADER[0]->GetLayout());
 		SHADOW_DIR_DESCSET->CreateDescriptorSet(renderer->GetVKDevice(), Renderer::NUM_CONCURRENT_FRAMES);
-		SHADOW_DIR_DESCSET->AddDescriptor(RenderShader::COMMON_BLOCK_BINDING, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-			VK_SHADER_STAGE_ALL, commonUniform->GetBuffers());
+		renderer->GetPipeline()->AddCommonToDescSet(SHADOW_DIR_DESCSET);
+		SHADOW_DIR_DESCSET->AddDescriptor(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			VK_SHADER_STAGE_VERTEX_BIT, transformUniform->GetBuffers());
+		SHADOW_DIR_DESCSET->AddDescriptor(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT,
+			std::vector<VKIBuffer*>(Renderer::NUM_CONCURRENT_FRAMES, renderer->GetInstanceIndices()));
 		SHADOW_DIR_DESCSET->UpdateSets();
 
 
@@ -128,9 +143,12 @@ void RenderMaterial::SetupMaterialShaders(Renderer* renderer, RenderUniform* tra
 		SHADOW_OMNI_SHADER[0]->SetViewportDynamic(true);
 		SHADOW_OMNI_SHADER[0]->SetDepth(true, true);
 
-		SHADOW_OMNI_SHADER[0]->AddInput(RenderShader::COMMON_BLOCK_BINDING, ERenderShaderInputType::Uniform,
+		SHADOW_OMNI_SHADER[0]->AddInput(RenderShader::COMMON_BLOCK_BINDING, ERenderShaderInputType::DynamicUniform,
 			ERenderShaderStage::AllStages);
 
+		SHADOW_OMNI_SHADER[0]->AddInput(1, ERenderShaderInputType::StorageBuffer, ERenderShaderStage::Vertex);
+		SHADOW_OMNI_SHADER[0]->AddInput(2, ERenderShaderInputType::StorageBuffer, ERenderShaderStage::Vertex);
+
 		SHADOW_OMNI_SHADER[0]->AddPushConstant(0, 0, sizeof(GUniform::ShadowConstantBlock),
 			ERenderShaderStage::Vertex | ERenderShaderStage::Fragment);
 
@@ -148,7 +166,6 @@ void RenderMaterial::SetupMaterialShaders(Renderer* renderer, RenderUniform* tra
 void RenderMaterial::SetupSphereHelperShader(Renderer* renderer)
 {
 	VkExtent2D swExtent = renderer->GetVKSwapChain()->GetExtent();
-	RenderUniform* commonUniform = renderer->GetPipeline()->GetUniforms().common.get();
 
 	// Shader...
 	SPHERE_HELPER_SHADER = UniquePtr<RenderShader>(new RenderShader());
@@ -163,7 +180,7 @@ void RenderMaterial::SetupSphereHelperShader(Renderer* renderer)
 	SPHERE_HELPER_SHADER->SetBlending(0, ERenderBlendFactor::SrcAlpha, ERenderBlendFactor::OneMinusSrcAlpha,
 		ERenderBlendOp::Add);
 
-	SPHERE_HELPER_SHADER->AddInput(RenderShader::COMMON_BLOCK_BINDING, ERenderShaderInputType::Uniform,
+	SPHERE_HELPER_SHADER->AddInput(RenderShader::COMMON_BLOCK_BINDING, ERenderShaderInputType::DynamicUniform,
 		ERenderShaderStage::AllStages);
 
 	SPHERE_HELPER_SHADER->AddInput(1, ERenderShaderInputType::ImageSampler,
@@ -178,8 +195,8 @@ void RenderMaterial::SetupSphereHelperShader(Renderer* renderer)
 	SPHERE_HELPER_SHADER->AddInput(4, ERenderShaderInputType::ImageSampler,
 		ERenderShaderStage::Fragment);
 
-	SPHERE_HELPER_SHADER->AddPushConstant(0, 0, sizeof(GUniform::SphereHelperBlock), 
-		ERenderShaderStage::Vertex | ERenderShaderStage::Fragment);
+	SPHERE_HELPER_SHADER->AddInput(5, ERenderShaderInputType::StorageBuffer,
+		ERenderShaderStage::Vertex);
 
 
 	SPHERE_HELPER_SHADER->Create();
@@ -192,8 +209,59 @@ void RenderMaterial::SetupSphereHelperShader(Renderer* renderer)
 
 	renderer->GetPipeline()->AddGBufferToDescSet(SPHERE_HELPER_DESCSET);
 
+	SPHERE_HELPER_DESCSET->AddDescriptor(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		VK_SHADER_STAGE_VERTEX_BIT, renderer->GetHelperUniform()->GetBuffers());
+
 	SPHERE_HELPER_DESCSET->UpdateSets();
 
+
+
+	// Impostor Shader...
+	SPHERE_IMPOSTOR_SHADER = UniquePtr<RenderShader>(new RenderShader());
+	SPHERE_IMPOSTOR_SHADER->SetDomain(ERenderShaderDomain::Screen);
+	SPHERE_IMPOSTOR_SHADER->SetRenderPass(renderer->GetPipeline()->GetLightingPass());
+	SPHERE_IMPOSTOR_SHADER->SetShader(ERenderShaderStage::Vertex, SHADERS_DIRECTORY "SphereVert_Impostor.spv");
+	SPHERE_IMPOSTOR_SHADER->SetShader(ERenderShaderStage::Fragment, SHADERS_DIRECTORY "SphereFrag_Impostor.spv");
+	SPHERE_IMPOSTOR_SHADER->SetViewport(glm::ivec4(0, 0, swExtent.width, swExtent.height));
+	SPHERE_IMPOSTOR_SHADER->SetViewportDynamic(true);
+	SPHERE_IMPOSTOR_SHADER->SetWireframe(false);
+	SPHERE_IMPOSTOR_SHADER->SetBlendingEnabled(0, true);
+	SPHERE_IMPOSTOR_SHADER->SetBlending(0, ERenderBlendFactor::SrcAlpha, ERenderBlendFactor::OneMinusSrcAlpha,
+		ERenderBlendOp::Add);
+
+	SPHERE_IMPOSTOR_SHADER->AddInput(RenderShader::COMMON_BLOCK_BINDING, ERenderShaderInputType::DynamicUniform,
+		ERenderShaderStage::AllStages);
+
+	SPHERE_IMPOSTOR_SHADER->AddInput(1, ERenderShaderInputType::ImageSampler,
+		ERenderShaderStage::Fragment);
+
+	SPHERE_IMPOSTOR_SHADER->AddInput(2, ERenderShaderInputType::ImageSampler,
+		ERenderShaderStage::Fragment);
+
+	SPHERE_IMPOSTOR_SHADER->AddInput(3, ERenderShaderInputType::ImageSampler,
+		ERenderShaderStage::Fragment);
+
+	SPHERE_IMPOSTOR_SHADER->AddInput(4, ERenderShaderInputType::ImageSampler,
+		ERenderShaderStage::Fragment);
+
+	SPHERE_IMPOSTOR_SHADER->AddInput(5, ERenderShaderInputType::StorageBuffer,
+		ERenderShaderStage::Vertex);
+
+	SPHERE_IMPOSTOR_SHADER->Create();
+
+	// Descriptor Set
+	VKIDescriptorSet* SPHERE_IMPOSTOR_DESCSET = SPHERE_IMPOSTOR_SHADER->CreateDescriptorSet();
+	SPHERE_IMPOSTOR_DESCSET->SetLayout(SPHERE_IMPOSTOR_SHADER->GetLayout());
+
+	SPHERE_IMPOSTOR_DESCSET->CreateDescriptorSet(renderer->GetVKDevice(), Renderer::NUM_CONCURRENT_FRAMES);
+
+	renderer->GetPipeline()->AddGBufferToDescSet(SPHERE_IMPOSTOR_DESCSET);
+
+	SPHERE_IMPOSTOR_DESCSET->AddDescriptor(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		VK_SHADER_STAGE_VERTEX_BIT, renderer->GetHelperUniform()->GetBuffers());
+
+	SPHERE_IMPOSTOR_DESCSET->UpdateSets();
+
 }
 
 
@@ -205,6 +273,7 @@ void RenderMaterial::DestroyMaterialShaders()
 	SHADOW_OMNI_SHADER[0]->Destroy();
 
 	SPHERE_HELPER_SHADER->Destroy();
+	SPHERE_IMPOSTOR_SHADER->Destroy();
 }
 
 
@@ -255,6 +324,7 @@ RenderShader* RenderMaterial::GetLProbeShader(ERenderMaterialType type)
 
 RenderMaterial::RenderMaterial(ERenderMaterialType type)
 	: mType(type)
+	, mResidentSets(0)
 	, mDynamicOffset(0)
 {
 
@@ -268,13 +338,29 @@ RenderMaterial::~RenderMaterial()
 
 
 
-void RenderMaterial::Setup(MaterialData* data, RenderImage* colorImage, RenderImage* roughnessMetallicImage)
+void RenderMaterial::Setup(RenderImage* colorImage, RenderImage* roughnessMetallicImage)
 {
 	Renderer* renderer = Application::Get().GetRenderer();
 
-	mMatData = data;
 	mTextures[0] = colorImage ? colorImage : renderer->GetDefaultImage(0)->GetRenderImage();
 	mTextures[1] = roughnessMetallicImage ? roughnessMetallicImage : renderer->GetDefaultImage(1)->GetRenderImage();
+	mTextureVersions[0] = mTextures[0]->GetVersion();
+	mTextureVersions[1] = mTextures[1]->GetVersion();
+
+	// Textures still uploading are replaced by the default images until they are complete.
+	VKIUploadManager* uploader = renderer->GetVKDevice()->GetUploader();
+	bool isComplete = uploader->IsComplete(mTextures[0]->GetUploadHandle())
+		&& uploader->IsComplete(mTextures[1]->GetUploadHandle());
+
+	RenderImage* setTextures[2] = { mTextures[0], mTextures[1] };
+
+	if (!isComplete)
+	{
+		setTextures[0] = renderer->GetDefaultImage(0)->GetRenderImage();
+		setTextures[1] = renderer->GetDefaultImage(1)->GetRenderImage();
+	}
+
+	mResidentSets = isComplete ? ALL_SETS_RESIDENT : 0;
 
 	switch (mType)
 	{
@@ -284,18 +370,24 @@ void RenderMaterial::Setup(MaterialData* data, RenderImage* colorImage, RenderIm
 		mDescriptorSet->SetLayout(OPAQUE_SHADER->GetLayout());
 		mDescriptorSet->CreateDescriptorSet(renderer->GetVKDevice(), Renderer::NUM_CONCURRENT_FRAMES);
 
-		mDescriptorSet->AddDescriptor(RenderShader::COMMON_BLOCK_BINDING, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-			VK_SHADER_STAGE_ALL, renderer->GetPipeline()->GetUniforms().common->GetBuffers());
+		renderer->GetPipeline()->AddCommonToDescSet(mDescriptorSet.get());
+
+		mDescriptorSet->AddDescriptor(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			VK_SHADER_STAGE_VERTEX_BIT, renderer->GetTransformUniform()->GetBuffers());
+
+		mDescriptorSet->AddDescriptor(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT,
+			std::vector<VKIBuffer*>(Renderer::NUM_CONCURRENT_FRAMES, renderer->GetInstanceIndices()));
 
 		mDescriptorSet->AddDescriptor(3, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
-			VK_SHADER_STAGE_FRAGMENT_BIT, renderer->GetMaterialUniform()->GetBuffers(),
-			0, ALIGN_SIZE(sizeof(MaterialData), 64));
+			VK_SHADER_STAGE_FRAGMENT_BIT, renderer->GetFrameAllocator()->GetBuffers(),
+			0, sizeof(MaterialData));
+		mDescriptorSet->SetDynamicOffset(3, &mDynamicOffset);
 
 		mDescriptorSet->AddDescriptor(4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-			VK_SHADER_STAGE_FRAGMENT_BIT, mTextures[0]->GetView(), mTextures[0]->GetSampler());
+			VK_SHADER_STAGE_FRAGMENT_BIT, setTextures[0]->GetView(), setTextures[0]->GetSampler());
 
 		mDescriptorSet->AddDescriptor(5, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-			VK_SHADER_STAGE_FRAGMENT_BIT, mTextures[1]->GetView(), mTextures[1]->GetSampler());
+			VK_SHADER_STAGE_FRAGMENT_BIT, setTextures[1]->GetView(), setTextures[1]->GetSampler());
 
 		mDescriptorSet->UpdateSets();
 	}
@@ -306,18 +398,38 @@ void RenderMaterial::Setup(MaterialData* data, RenderImage* colorImage, RenderIm
 
 void RenderMaterial::Bind(VKICommandBuffer* cmdBuffer, uint32_t frame)
 {
-	VkPipelineLayout layout = VK_NULL_HANDLE;
+	// Streamed textures replaced? every frame set is updated again once it is bound.
+	if (mTextures[0]->GetVersion() != mTextureVersions[0] || mTextures[1]->GetVersion() != mTextureVersions[1])
+	{
+		mTextureVersions[0] = mTextures[0]->GetVersion();
+		mTextureVersions[1] = mTextures[1]->GetVersion();
+		mResidentSets = 0;
+	}
+
+	if (mResidentSets != ALL_SETS_RESIDENT)
+		UpdateResidency(frame);
 
 	switch (mType)
 	{
 	case ERenderMaterialType::Opaque:
-		layout = OPAQUE_SHADER->GetPipeline()->GetLayout();
+		mDescriptorSet->Bind(cmdBuffer, frame, OPAQUE_SHADER->GetPipeline());
 		break;
 	}
+}
+
+
+void RenderMaterial::UpdateResidency(uint32_t frame)
+{
+	if (mResidentSets & (1u << frame))
+		return;
+
+	VKIUploadManager* uploader = Application::Get().GetRenderer()->GetVKDevice()->GetUploader();
 
-	std::array<uint32_t, 1> dynamicOffsets = { (uint32_t)mDynamicOffset * ALIGN_SIZE(sizeof(MaterialData), 64) };
+	if (!uploader->IsComplete(mTextures[0]->GetUploadHandle()) || !uploader->IsComplete(mTextures[1]->GetUploadHandle()))
+		return;
 
-	VkDescriptorSet descSet = mDescriptorSet->Get(frame);
-	vkCmdBindDescriptorSets(cmdBuffer->GetCurrent(), VK_PIPELINE_BIND_POINT_GRAPHICS,
-		layout, 0, 1, &descSet, (uint32_t)dynamicOffsets.size(), dynamicOffsets.data());
+	// The set of this frame isn't used by the GPU while the frame is recorded.
+	mDescriptorSet->UpdateImage(frame, 4, mTextures[0]->GetView(), mTextures[0]->GetSampler());
+	mDescriptorSet->UpdateImage(frame, 5, mTextures[1]->GetView(), mTextures[1]->GetSampler());
+	mResidentSets |= 1u << frame;
 }
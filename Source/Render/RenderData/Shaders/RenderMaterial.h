@@ -38,7 +38,6 @@ class VKIDescriptorSet;
 class VKIImageView;
 class VKISampler;
 class VKICommandBuffer;
-struct MaterialData;
 
 
 
@@ -60,11 +59,24 @@ public:
 	~RenderMaterial();
 
 	// Setup the render material.
-	void Setup(MaterialData* data, RenderImage* colorImage, RenderImage* roughnessMetallicImage);
+	void Setup(RenderImage* colorImage, RenderImage* roughnessMetallicImage);
 
-	//
+	// Bind the material set of the frame, textures that finished uploading or got replaced by the texture
+	// streamer are updated in the set first.
 	void Bind(VKICommandBuffer* cmdBuffer, uint32_t frame);
 
+	// Return true if all the material textures are uploaded & used by every frame set.
+	inline bool IsResident() const { return mResidentSets == ALL_SETS_RESIDENT; }
+
+	// Return the material type.
+	inline ERenderMaterialType GetType() const { return mType; }
+
+	// Return true if the material data is in the frame allocator, false if the frame ran out of memory.
+	inline bool HasFrameData() const { return mDynamicOffset != INVALID_UINDEX; }
+
+	// Return a material texture, [0] Color & [1] Roughness & Metallic.
+	inline RenderImage* GetTexture(uint32_t index) const { return mTextures[index]; }
+
 public:
 	// Setup The material shaders used by the material system.
 	static void SetupMaterialShaders(Renderer* renderer, RenderUniform* transformUniform);
@@ -81,6 +93,9 @@ private:
 	//
 	static void SetupSphereHelperShader(Renderer* renderer);
 
+	// Use the uploaded textures in the set of this frame once they are all complete.
+	void UpdateResidency(uint32_t frame);
+
 private:
 	// Opaque Material Shader.
 	static Ptr<RenderShader> OPAQUE_SHADER;
@@ -95,6 +110,9 @@ public:
 	// Shader for drawing helper sphere.
 	static Ptr<RenderShader> SPHERE_HELPER_SHADER;
 
+	// Shader for drawing helper sphere as screen aligned quads.
+	static Ptr<RenderShader> SPHERE_IMPOSTOR_SHADER;
+
 private:
 	// The Shader type.
 	ERenderMaterialType mType;
@@ -107,11 +125,17 @@ private:
 	//  [1] Roughness & Metallic.
 	RenderImage* mTextures[2];
 
-public:
-	// Materail Data, used to update the materail unifrom.
-	MaterialData* mMatData;
+	// The version of the textures used by the frame sets, streamed textures change it when replaced.
+	uint32_t mTextureVersions[2];
+
+	// Bit per frame set that uses the material textures instead of the placeholders.
+	uint32_t mResidentSets;
 
-	// Dynamic Offset of this material in the uniform buffer.
-	int32_t mDynamicOffset;
+	// All the frame sets use the material textures.
+	static const uint32_t ALL_SETS_RESIDENT;
+
+public:
+	// Dynamic Offset of this material data in the frame allocator buffer.
+	uint32_t mDynamicOffset;
 };
 
@@ -190,6 +190,10 @@ void RenderShader::AddInput(uint32_t binding, ERenderShaderInputType inputType,
 	case ERenderShaderInputType::DynamicUniform:
 		mDescLayout->AddBinding(binding, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, ToStageBits(stages), count);
 		break;
+
+	case ERenderShaderInputType::StorageBuffer:
+		mDescLayout->AddBinding(binding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, ToStageBits(stages), count);
+		break;
 	}
 }
 
@@ -294,6 +298,12 @@ void RenderShader::SetDepth(bool isEnabled, bool isWrite)
 }
 
 
+void RenderShader::SetDepthLessOrEqual(bool isLessOrEqual)
+{
+	mPipeline->SetDepthOp(isLessOrEqual ? VK_COMPARE_OP_LESS_OR_EQUAL : VK_COMPARE_OP_LESS);
+}
+
+
 void RenderShader::SetBlendingEnabled(uint32_t index, bool isEnabled)
 {
 	mPipeline->SetBlendingEnabled(index, isEnabled, VKI_COLOR_ALL_COMPONENTS);
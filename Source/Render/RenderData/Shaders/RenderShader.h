@@ -121,6 +121,9 @@ public:
 	// Enable/Disable depth test and depth write.
 	void SetDepth(bool isEnabled, bool isWrite);
 
+	// Pass the depth test for equal depth too, for passes drawn over a depth pre-pass.
+	void SetDepthLessOrEqual(bool isLessOrEqual);
+
 	// Enable/Disable blending for a specific attachment index.
 	void SetBlendingEnabled(uint32_t index, bool isEnabled);
 
@@ -91,6 +91,18 @@ namespace GUniform
 
 
 
+	// Per-Instance data of instanced meshes.
+	struct InstanceData
+	{
+		// Model Transformation Matrix.
+		glm::mat4 modelMatrix;
+
+		// Normal Transformation Matrix.
+		glm::mat4 normalMatrix;
+	};
+
+
+
 	// Data used for shadow pass.
 	struct ShadowConstantBlock
 	{
@@ -104,8 +116,8 @@ namespace GUniform
 
 
 
-	// Data used for shadow pass.
-	struct SphereHelperBlock
+	// Data of a single helper instance, W of position is used as a flag for drawing occluded helpers.
+	struct HelperInstanceData
 	{
 		glm::vec4 position;
 		glm::vec4 scale;
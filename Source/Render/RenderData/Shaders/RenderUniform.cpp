@@ -32,6 +32,7 @@
 RenderUniform::RenderUniform()
 	: mIsTransferDst(false)
 	, mIsDynamic(false)
+	, mIsStorage(false)
 {
 
 }
@@ -56,13 +57,15 @@ void RenderUniform::Create(Renderer* owner, uint32_t size, bool isDynamic)
 		mBuffers[i]->SetMemoryProperties(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
 			VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 
+		VkBufferUsageFlags usage = mIsStorage ? VK_BUFFER_USAGE_STORAGE_BUFFER_BIT : VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+
 		if (mIsTransferDst)
 		{
-			mBuffers[i]->SetUsage(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+			mBuffers[i]->SetUsage(usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
 		}
 		else
 		{
-			mBuffers[i]->SetUsage(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+			mBuffers[i]->SetUsage(usage);
 		}
 
 		mBuffers[i]->CreateBuffer(owner->GetVKDevice());
@@ -115,3 +118,9 @@ void RenderUniform::SetTransferDst(bool value)
 {
 	mIsTransferDst = value;
 }
+
+
+void RenderUniform::SetStorage(bool value)
+{
+	mIsStorage = value;
+}
@@ -57,6 +57,9 @@ public:
 	// Set this uniform buffer usage as transfer dst.
 	void SetTransferDst(bool value);
 
+	// Set this uniform buffer to be used as a storage buffer instead of uniform buffer.
+	void SetStorage(bool value);
+
 	// Create Uniform.
 	void Create(Renderer* owner, uint32_t size, bool isDynamic);
 
@@ -84,5 +87,8 @@ private:
 
 	// if true the buffer usage include transfer dst.
 	bool mIsTransferDst;
+
+	// if true the buffer is used as storage buffer.
+	bool mIsStorage;
 };
 
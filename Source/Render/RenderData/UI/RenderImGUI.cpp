@@ -56,6 +56,21 @@ public:
 
 
 
+void RDUIDrawData::Clear()
+{
+  for (ImDrawList* drawList : drawLists)
+    IM_DELETE(drawList);
+
+  drawLists.clear();
+}
+
+
+
+// --- -- - -- --- --- -- - -- --- --- -- - -- --- --- -- - -- --- --- -- - -- --- --- -- - -- --- 
+
+
+
+
 RenderImGUI::RenderImGUI()
 {
 
@@ -209,7 +224,7 @@ void RenderImGUI::UploadFonts()
 
 
 
-void RenderImGUI::RenderFrame(uint32_t imgIndex, uint32_t frame)
+void RenderImGUI::BuildFrame(RDUIDrawData& uiData)
 {
   // Start the Dear ImGui frame
   ImGui_ImplVulkan_NewFrame();
@@ -224,12 +239,26 @@ void RenderImGUI::RenderFrame(uint32_t imgIndex, uint32_t frame)
   // Rendering
   ImGui::Render();
 
+  // Copy the draw lists, ImGui reuses them in the next frame while this one is recorded.
+  ImDrawData* drawData = ImGui::GetDrawData();
+  uiData.Clear();
+  uiData.displayPos = glm::vec2(drawData->DisplayPos.x, drawData->DisplayPos.y);
+  uiData.displaySize = glm::vec2(drawData->DisplaySize.x, drawData->DisplaySize.y);
+  uiData.framebufferScale = glm::vec2(drawData->FramebufferScale.x, drawData->FramebufferScale.y);
+
+  for (int i = 0; i < drawData->CmdListsCount; ++i)
+    uiData.drawLists.emplace_back(drawData->CmdLists[i]->CloneOutput());
+}
+
+
+void RenderImGUI::RenderFrame(const RDUIDrawData& uiData, uint32_t imgIndex, uint32_t frame)
+{
   // Frame Rendering....
-  RecordFrameCommands(imgIndex, frame);
+  RecordFrameCommands(uiData, imgIndex, frame);
 }
 
 
-void RenderImGUI::RecordFrameCommands(uint32_t imgIndex, uint32_t frame)
+void RenderImGUI::RecordFrameCommands(const RDUIDrawData& uiData, uint32_t imgIndex, uint32_t frame)
 {
   mCmdBuffer->SetCurrent(frame);
   VkCommandBuffer cmd = mCmdBuffer->GetCurrent();
@@ -246,8 +275,23 @@ void RenderImGUI::RecordFrameCommands(uint32_t imgIndex, uint32_t frame)
   glm::ivec4 viewport(0, 0, mSwapchain->GetExtent().width, mSwapchain->GetExtent().height);
   mRenderPass->Begin(mCmdBuffer.get(), mSwapchain->GetFrameBuffer(imgIndex), viewport);
 
+  // The draw data of the ui copy.
+  ImDrawData drawData;
+  drawData.Valid = true;
+  drawData.CmdLists = uiData.drawLists.empty() ? nullptr : const_cast<ImDrawList**>(uiData.drawLists.data());
+  drawData.CmdListsCount = (int)uiData.drawLists.size();
+  drawData.DisplayPos = ImVec2(uiData.displayPos.x, uiData.displayPos.y);
+  drawData.DisplaySize = ImVec2(uiData.displaySize.x, uiData.displaySize.y);
+  drawData.FramebufferScale = ImVec2(uiData.framebufferScale.x, uiData.framebufferScale.y);
+
+  for (ImDrawList* drawList : uiData.drawLists)
+  {
+    drawData.TotalVtxCount += drawList->VtxBuffer.Size;
+    drawData.TotalIdxCount += drawList->IdxBuffer.Size;
+  }
+
   // Record Imgui Draw Data and draw funcs into command buffer
-  ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), cmd);
+  ImGui_ImplVulkan_RenderDrawData(&drawData, cmd);
 
   mRenderPass->End(mCmdBuffer.get());
 
@@ -25,7 +25,9 @@
 
 
 #include "Core/Core.h"
+#include "glm/vec2.hpp"
 
+#include <vector>
 
 
 
@@ -36,6 +38,27 @@ class VKISwapChain;
 class VKICommandBuffer;
 class VKIRenderPass;
 class ImGUIDescriptorPool;
+struct ImDrawList;
+
+
+
+
+
+
+// A copy of the ImGui draw data of a frame, built on the main thread & recorded on the render thread.
+struct RDUIDrawData
+{
+	// Clones of the ImGui draw lists, owned by the draw data.
+	std::vector<ImDrawList*> drawLists;
+
+	// The display position, size & framebuffer scale of the frame.
+	glm::vec2 displayPos;
+	glm::vec2 displaySize;
+	glm::vec2 framebufferScale;
+
+	// Delete the draw lists.
+	void Clear();
+};
 
 
 
@@ -60,15 +83,18 @@ public:
 	// Destroy ImGui.
 	void Destroy();
 
-	// Render an ImGui frame and record the draw commands in the command buffer.
-	void RenderFrame(uint32_t imgIndex, uint32_t frame);
+	// Build an ImGui frame with the user ui & copy its draw data, called on the main thread.
+	void BuildFrame(RDUIDrawData& uiData);
+
+	// Record the draw commands of a built ui frame in the command buffer.
+	void RenderFrame(const RDUIDrawData& uiData, uint32_t imgIndex, uint32_t frame);
 
 	// Return the ui command buffers.
 	VKICommandBuffer* GetCmdBuffer() { return mCmdBuffer.get(); }
 
 private:
 	// record the draw commands in the command buffer.
-	void RecordFrameCommands(uint32_t imgIndex, uint32_t frame);
+	void RecordFrameCommands(const RDUIDrawData& uiData, uint32_t imgIndex, uint32_t frame);
 
 	// Setup vulkan object for ui.
 	void SetupVulkan();
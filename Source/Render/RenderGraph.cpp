@@ -0,0 +1,504 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "RenderGraph.h"
+#include "RenderData/RenderTypes.h"
+
+
+#include "VKInterface/VKIDevice.h"
+#include "VKInterface/VKIImage.h"
+#include "VKInterface/VKICommandBuffer.h"
+#include "VKInterface/VKIDeletionQueue.h"
+
+
+#include <algorithm>
+
+
+
+
+// Accesses that write memory, only those need to be made available by a barrier.
+static const VkAccessFlags RENDER_GRAPH_WRITE_ACCESS = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+	| VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+	| VK_ACCESS_SHADER_WRITE_BIT
+	| VK_ACCESS_TRANSFER_WRITE_BIT;
+
+
+
+// Return true if the usage writes the resource.
+static inline bool IsWriteUsage(ERenderGraphUsage usage)
+{
+	return usage == ERenderGraphUsage::ColorAttachment || usage == ERenderGraphUsage::DepthAttachment;
+}
+
+
+
+
+
+
+RenderGraph::RenderGraph()
+	: mDevice(nullptr)
+	, mSrcStage(0)
+	, mDstStage(0)
+{
+	mStats = RenderGraphStats{};
+	mFrameStats = RenderGraphStats{};
+}
+
+
+RenderGraph::~RenderGraph()
+{
+
+}
+
+
+uint32_t RenderGraph::ImportTarget(const std::string& name, StageRenderTarget* target,
+	VkImageAspectFlagBits aspect, bool isOutput)
+{
+	RenderGraphResource res{};
+	res.name = name;
+	res.target = target;
+	res.desc.aspect = aspect;
+	res.isTransient = false;
+	res.isOutput = isOutput;
+	res.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	mResources.emplace_back(res);
+	return (uint32_t)mResources.size() - 1;
+}
+
+
+uint32_t RenderGraph::AddTransient(const std::string& name, StageRenderTarget* target, const RenderGraphTargetDesc& desc)
+{
+	RenderGraphResource res{};
+	res.name = name;
+	res.target = target;
+	res.desc = desc;
+	res.isTransient = true;
+	res.isOutput = false;
+	res.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	mResources.emplace_back(res);
+	return (uint32_t)mResources.size() - 1;
+}
+
+
+uint32_t RenderGraph::AddPass(const std::string& name, bool isSideEffect)
+{
+	RenderGraphPass pass{};
+	pass.name = name;
+	pass.isSideEffect = isSideEffect;
+	pass.isCulled = false;
+
+	mPasses.emplace_back(pass);
+	return (uint32_t)mPasses.size() - 1;
+}
+
+
+void RenderGraph::Read(uint32_t pass, uint32_t resource, ERenderGraphUsage usage)
+{
+	CHECK(pass < mPasses.size() && resource < mResources.size());
+	CHECK(!IsWriteUsage(usage));
+	mPasses[pass].accesses.emplace_back(RenderGraphAccess{ resource, usage, false });
+}
+
+
+void RenderGraph::Write(uint32_t pass, uint32_t resource, ERenderGraphUsage usage, bool isDiscard)
+{
+	CHECK(pass < mPasses.size() && resource < mResources.size());
+	CHECK(IsWriteUsage(usage));
+	mPasses[pass].accesses.emplace_back(RenderGraphAccess{ resource, usage, isDiscard });
+}
+
+
+void RenderGraph::Compile(VKIDevice* device, VkExtent2D size)
+{
+	mDevice = device;
+
+	CullPasses();
+	ComputeLifetimes();
+
+	// Transients of the graph size.
+	for (RenderGraphResource& res : mResources)
+	{
+		if (!res.isTransient || res.firstPass == INVALID_UINDEX)
+			continue;
+
+		res.target->image = UniquePtr<VKIImage>(new VKIImage());
+		res.target->image->SetUsage(res.desc.usage);
+		res.target->image->SetImageInfo(VK_IMAGE_TYPE_2D, res.desc.format, size, VK_IMAGE_LAYOUT_UNDEFINED);
+		res.target->image->SetAliased(true);
+		res.target->image->Create(mDevice);
+		res.memReq = res.target->image->GetMemoryRequirements();
+	}
+
+	CreateTransients();
+
+	LOGI("RenderGraph: %d passes, %d culled, %d transients in %d blocks, %d KB aliased into %d KB.",
+		mStats.numPasses, mStats.numCulledPasses, mStats.numTransients, mStats.numMemoryBlocks,
+		(uint32_t)(mStats.transientBytes / 1024), (uint32_t)(mStats.allocatedBytes / 1024));
+}
+
+
+void RenderGraph::CullPasses()
+{
+	// Resources whose content is needed by a later pass or outside the graph.
+	std::vector<bool> isNeeded(mResources.size(), false);
+
+	for (size_t i = 0; i < mResources.size(); ++i)
+		isNeeded[i] = mResources[i].isOutput;
+
+	mStats.numPasses = (uint32_t)mPasses.size();
+	mStats.numCulledPasses = 0;
+
+	// Walk back from the last pass, a pass is kept if it has side effects or writes a needed resource.
+	for (int32_t ip = (int32_t)mPasses.size() - 1; ip >= 0; --ip)
+	{
+		RenderGraphPass& pass = mPasses[ip];
+		pass.isCulled = !pass.isSideEffect;
+
+		for (const RenderGraphAccess& access : pass.accesses)
+		{
+			if (!IsWriteUsage(access.usage) || !isNeeded[access.resource])
+				continue;
+
+			pass.isCulled = false;
+			break;
+		}
+
+		if (pass.isCulled)
+		{
+			LOGI("RenderGraph: Culled pass %s.", pass.name.c_str());
+			++mStats.numCulledPasses;
+			continue;
+		}
+
+		// Content discarded by this pass isn't needed from earlier passes, its reads are.
+		for (const RenderGraphAccess& access : pass.accesses)
+		{
+			if (IsWriteUsage(access.usage) && access.isDiscard)
+				isNeeded[access.resource] = false;
+		}
+
+		for (const RenderGraphAccess& access : pass.accesses)
+		{
+			if (!IsWriteUsage(access.usage) || !access.isDiscard)
+				isNeeded[access.resource] = true;
+		}
+	}
+}
+
+
+void RenderGraph::ComputeLifetimes()
+{
+	for (RenderGraphResource& res : mResources)
+	{
+		res.firstPass = INVALID_UINDEX;
+		res.lastPass = 0;
+	}
+
+	for (uint32_t ip = 0; ip < (uint32_t)mPasses.size(); ++ip)
+	{
+		if (mPasses[ip].isCulled)
+			continue;
+
+		for (const RenderGraphAccess& access : mPasses[ip].accesses)
+		{
+			RenderGraphResource& res = mResources[access.resource];
+
+			// The content of a transient doesn't survive aliasing, it must be discarded by its first pass.
+			if (res.isTransient && res.firstPass == INVALID_UINDEX)
+			{
+				CHECK(access.isDiscard && "Transient target used before being written.");
+			}
+
+			res.firstPass = std::min(res.firstPass, ip);
+			res.lastPass = std::max(res.lastPass, ip);
+		}
+	}
+}
+
+
+void RenderGraph::CreateTransients()
+{
+	// Largest first, each transient goes to the first block with no overlapping lifetimes.
+	std::vector<uint32_t> transients;
+
+	for (uint32_t i = 0; i < (uint32_t)mResources.size(); ++i)
+	{
+		if (mResources[i].isTransient && mResources[i].firstPass != INVALID_UINDEX)
+			transients.emplace_back(i);
+	}
+
+	std::sort(transients.begin(), transients.end(), [this](uint32_t a, uint32_t b) {
+		return mResources[a].memReq.size > mResources[b].memReq.size;
+	});
+
+	mStats.numTransients = (uint32_t)transients.size();
+	mStats.transientBytes = 0;
+
+	for (uint32_t ir : transients)
+	{
+		const RenderGraphResource& res = mResources[ir];
+		mStats.transientBytes += res.memReq.size;
+
+		RenderGraphMemory* block = nullptr;
+
+		for (RenderGraphMemory& candidate : mMemory)
+		{
+			if (!(candidate.typeBits & res.memReq.memoryTypeBits))
+				continue;
+
+			bool isOverlap = false;
+
+			for (uint32_t other : candidate.resources)
+			{
+				const RenderGraphResource& ores = mResources[other];
+
+				if (res.firstPass <= ores.lastPass && ores.firstPass <= res.lastPass)
+				{
+					isOverlap = true;
+					break;
+				}
+			}
+
+			if (!isOverlap)
+			{
+				block = &candidate;
+				break;
+			}
+		}
+
+		if (!block)
+		{
+			mMemory.emplace_back(RenderGraphMemory{});
+			block = &mMemory.back();
+			block->memory = VK_NULL_HANDLE;
+			block->size = 0;
+			block->typeBits = res.memReq.memoryTypeBits;
+		}
+
+		block->typeBits &= res.memReq.memoryTypeBits;
+		block->size = std::max(block->size, res.memReq.size);
+		block->resources.emplace_back(ir);
+	}
+
+
+	// Allocate the blocks & bind their resources, all resources in a block share its state.
+	mStats.numMemoryBlocks = (uint32_t)mMemory.size();
+	mStats.allocatedBytes = 0;
+
+	for (RenderGraphMemory& block : mMemory)
+	{
+		VkMemoryAllocateInfo memInfo{};
+		memInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		memInfo.allocationSize = block.size;
+		memInfo.memoryTypeIndex = mDevice->FindMemory(block.typeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		CHECK(memInfo.memoryTypeIndex != VK_MAX_MEMORY_TYPES && "Failed to find memory.");
+
+		VkResult result = vkAllocateMemory(mDevice->Get(), &memInfo, nullptr, &block.memory);
+		CHECK(result == VK_SUCCESS);
+
+		mStats.allocatedBytes += block.size;
+		mStates.emplace_back(RenderGraphState{ 0, 0, INVALID_UINDEX });
+
+		for (uint32_t ir : block.resources)
+		{
+			RenderGraphResource& res = mResources[ir];
+			res.state = (uint32_t)mStates.size() - 1;
+			res.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			res.target->image->BindMemory(block.memory, 0);
+
+			res.target->view = UniquePtr<VKIImageView>(new VKIImageView());
+			res.target->view->SetType(VK_IMAGE_VIEW_TYPE_2D);
+			res.target->view->SetViewInfo(res.desc.aspect, 0, 1, 0, 1);
+			res.target->view->Create(mDevice, res.target->image.get());
+
+			res.target->sampler = UniquePtr<VKISampler>(new VKISampler());
+			res.target->sampler->SetFilter(res.desc.filter, res.desc.filter);
+			res.target->sampler->SetAddressMode(VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+			res.target->sampler->CreateSampler(mDevice);
+		}
+	}
+
+
+	// Imported targets own their memory.
+	for (RenderGraphResource& res : mResources)
+	{
+		if (res.isTransient)
+			continue;
+
+		mStates.emplace_back(RenderGraphState{ 0, 0, (uint32_t)(&res - mResources.data()) });
+		res.state = (uint32_t)mStates.size() - 1;
+		res.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	}
+}
+
+
+void RenderGraph::Destroy()
+{
+	for (RenderGraphMemory& block : mMemory)
+	{
+		for (uint32_t ir : block.resources)
+		{
+			mResources[ir].target->Destroy();
+			mResources[ir].target->Reset();
+		}
+
+		// Freed once the frames using the aliased images are done.
+		mDevice->GetDeletionQueue()->Push(block.memory);
+	}
+
+	mMemory.clear();
+	mStates.clear();
+}
+
+
+void RenderGraph::BeginFrame()
+{
+	mStats.numBarrierBatches = mFrameStats.numBarrierBatches;
+	mStats.numImageBarriers = mFrameStats.numImageBarriers;
+	mStats.numSkippedBarriers = mFrameStats.numSkippedBarriers;
+	mFrameStats = RenderGraphStats{};
+}
+
+
+bool RenderGraph::BeginPass(VKICommandBuffer* cmdBuffer, uint32_t pass)
+{
+	if (mPasses[pass].isCulled)
+		return false;
+
+	for (const RenderGraphAccess& access : mPasses[pass].accesses)
+		AddBarrier(access);
+
+	FlushBarriers(cmdBuffer);
+	return true;
+}
+
+
+void RenderGraph::SetAccess(uint32_t resource, ERenderGraphUsage usage)
+{
+	RenderGraphResource& res = mResources[resource];
+	RenderGraphState& state = mStates[res.state];
+
+	GetUsageInfo(usage, res.layout, state.stage, state.access);
+	state.owner = resource;
+}
+
+
+void RenderGraph::AddBarrier(const RenderGraphAccess& access)
+{
+	RenderGraphResource& res = mResources[access.resource];
+	RenderGraphState& state = mStates[res.state];
+
+	VkImageLayout layout;
+	VkPipelineStageFlags stage;
+	VkAccessFlags accessMask;
+	GetUsageInfo(access.usage, layout, stage, accessMask);
+
+	// Another aliased resource took the memory, only a pass discarding the content can take it back.
+	bool isOwner = state.owner == access.resource;
+	CHECK((isOwner || access.isDiscard) && "Reading a transient target whose memory was aliased.");
+
+	// Reads after reads in the same layout only need to extend the stages waited on by the next write.
+	if (isOwner && res.layout == layout && !(accessMask & RENDER_GRAPH_WRITE_ACCESS)
+		&& !(state.access & RENDER_GRAPH_WRITE_ACCESS))
+	{
+		state.stage |= stage;
+		state.access |= accessMask;
+		++mFrameStats.numSkippedBarriers;
+		return;
+	}
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = state.access & RENDER_GRAPH_WRITE_ACCESS;
+	barrier.dstAccessMask = accessMask;
+	barrier.oldLayout = access.isDiscard ? VK_IMAGE_LAYOUT_UNDEFINED : res.layout;
+	barrier.newLayout = layout;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = res.target->image->Get();
+	barrier.subresourceRange.aspectMask = res.desc.aspect;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+
+	mBarriers.emplace_back(barrier);
+	mSrcStage |= state.stage ? state.stage : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+	mDstStage |= stage;
+
+	res.layout = layout;
+	state.stage = stage;
+	state.access = accessMask;
+	state.owner = access.resource;
+}
+
+
+void RenderGraph::FlushBarriers(VKICommandBuffer* cmdBuffer)
+{
+	if (mBarriers.empty())
+		return;
+
+	vkCmdPipelineBarrier(cmdBuffer->GetCurrent(), mSrcStage, mDstStage, 0,
+		0, nullptr,
+		0, nullptr,
+		(uint32_t)mBarriers.size(), mBarriers.data());
+
+	++mFrameStats.numBarrierBatches;
+	mFrameStats.numImageBarriers += (uint32_t)mBarriers.size();
+
+	mBarriers.clear();
+	mSrcStage = 0;
+	mDstStage = 0;
+}
+
+
+void RenderGraph::GetUsageInfo(ERenderGraphUsage usage, VkImageLayout& outLayout,
+	VkPipelineStageFlags& outStage, VkAccessFlags& outAccess)
+{
+	switch (usage)
+	{
+	case ERenderGraphUsage::ColorAttachment:
+		outLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		outStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		outAccess = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		break;
+
+	case ERenderGraphUsage::DepthAttachment:
+		outLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		outStage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		outAccess = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		break;
+
+	case ERenderGraphUsage::SampledFragment:
+		outLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		outStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		outAccess = VK_ACCESS_SHADER_READ_BIT;
+		break;
+
+	case ERenderGraphUsage::SampledCompute:
+		outLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		outStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		outAccess = VK_ACCESS_SHADER_READ_BIT;
+		break;
+	}
+}
@@ -0,0 +1,309 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+
+
+
+#include "Core/Core.h"
+#include "vulkan/vulkan.h"
+
+
+#include <vector>
+#include <string>
+
+
+
+
+struct StageRenderTarget;
+class VKIDevice;
+class VKICommandBuffer;
+
+
+
+
+
+// How a pass uses a render graph resource, each usage maps to a layout, pipeline stages & access.
+enum class ERenderGraphUsage : uint32_t
+{
+	// Written as color attachment.
+	ColorAttachment,
+
+	// Written as depth attachment.
+	DepthAttachment,
+
+	// Sampled by a fragment shader.
+	SampledFragment,
+
+	// Sampled by a compute shader.
+	SampledCompute
+};
+
+
+
+// Description of a transient target created by the render graph.
+struct RenderGraphTargetDesc
+{
+	// The image format.
+	VkFormat format;
+
+	// The image usage.
+	VkImageUsageFlags usage;
+
+	// The aspect of the view.
+	VkImageAspectFlagBits aspect;
+
+	// The sampler filter.
+	VkFilter filter;
+};
+
+
+
+// Render graph stats, barriers are counted for the last frame.
+struct RenderGraphStats
+{
+	// The number of declared passes.
+	uint32_t numPasses;
+
+	// The number of passes culled because nothing uses their output.
+	uint32_t numCulledPasses;
+
+	// The number of transient targets.
+	uint32_t numTransients;
+
+	// The number of memory blocks the transient targets are aliased into.
+	uint32_t numMemoryBlocks;
+
+	// The memory needed by the transient targets without aliasing.
+	VkDeviceSize transientBytes;
+
+	// The memory allocated for the transient targets.
+	VkDeviceSize allocatedBytes;
+
+	// The number of pipeline barrier commands recorded.
+	uint32_t numBarrierBatches;
+
+	// The number of image barriers recorded.
+	uint32_t numImageBarriers;
+
+	// The number of accesses that didn't need a barrier.
+	uint32_t numSkippedBarriers;
+};
+
+
+
+
+// A resource access by a pass.
+struct RenderGraphAccess
+{
+	// The resource index.
+	uint32_t resource;
+
+	// The resource usage.
+	ERenderGraphUsage usage;
+
+	// The pass overwrite the entire resource, its previous content is discarded.
+	bool isDiscard;
+};
+
+
+// A declared pass.
+struct RenderGraphPass
+{
+	// The pass name.
+	std::string name;
+
+	// The pass resources accesses.
+	std::vector<RenderGraphAccess> accesses;
+
+	// The pass has effects outside the graph & is never culled.
+	bool isSideEffect;
+
+	// The pass was culled by the last compile.
+	bool isCulled;
+};
+
+
+// A declared resource.
+struct RenderGraphResource
+{
+	// The resource name.
+	std::string name;
+
+	// The target of the resource, created by the graph for transients.
+	StageRenderTarget* target;
+
+	// Transient target description, only the aspect is used by imported targets.
+	RenderGraphTargetDesc desc;
+
+	// True if the target is created by the graph.
+	bool isTransient;
+
+	// True if the resource is used outside the graph after the last pass.
+	bool isOutput;
+
+	// The first & last pass using the resource.
+	uint32_t firstPass;
+	uint32_t lastPass;
+
+	// The index of the tracked state, aliased transients share the same state.
+	uint32_t state;
+
+	// The current layout of the resource.
+	VkImageLayout layout;
+
+	// The memory requirements of transients.
+	VkMemoryRequirements memReq;
+};
+
+
+// The tracked state of the memory of one or more resources.
+struct RenderGraphState
+{
+	// The stages of the last accesses.
+	VkPipelineStageFlags stage;
+
+	// The last accesses.
+	VkAccessFlags access;
+
+	// The resource that currently own the memory content.
+	uint32_t owner;
+};
+
+
+// Memory shared by aliased transients.
+struct RenderGraphMemory
+{
+	// The device memory.
+	VkDeviceMemory memory;
+
+	// The memory size.
+	VkDeviceSize size;
+
+	// The memory type bits supported by all the resources.
+	uint32_t typeBits;
+
+	// The resources aliased in this block.
+	std::vector<uint32_t> resources;
+};
+
+
+
+
+// RenderGraph:
+//    - Passes declare the targets they read & write, the graph culls passes with unused outputs.
+//    - Transient targets are created by the graph, the ones with non-overlapping lifetimes share memory.
+//    - Barriers are computed from the tracked state of each target and batched per pass.
+//    - Passes are still recorded by their owner, BeginPass is called before recording a pass.
+//
+class RenderGraph
+{
+public:
+	// Construct.
+	RenderGraph();
+
+	// Destruct.
+	~RenderGraph();
+
+	// Add a target created & destroyed outside the graph.
+	uint32_t ImportTarget(const std::string& name, StageRenderTarget* target, VkImageAspectFlagBits aspect, bool isOutput);
+
+	// Add a target created by the graph when compiled, its memory may be aliased with other transients.
+	uint32_t AddTransient(const std::string& name, StageRenderTarget* target, const RenderGraphTargetDesc& desc);
+
+	// Add a new pass, passes are expected to execute in the same order they are added.
+	uint32_t AddPass(const std::string& name, bool isSideEffect);
+
+	// Declare a pass reading a resource.
+	void Read(uint32_t pass, uint32_t resource, ERenderGraphUsage usage);
+
+	// Declare a pass writing a resource, discard if the pass overwrite the entire resource.
+	void Write(uint32_t pass, uint32_t resource, ERenderGraphUsage usage, bool isDiscard);
+
+	// Cull unused passes, compute lifetimes & create the transient targets.
+	void Compile(VKIDevice* device, VkExtent2D size);
+
+	// Destroy the transient targets & their memory.
+	void Destroy();
+
+	// Start a new frame, barriers stats of the previous frame become available.
+	void BeginFrame();
+
+	// Record the barriers needed by a pass, return false if the pass was culled.
+	bool BeginPass(VKICommandBuffer* cmdBuffer, uint32_t pass);
+
+	// Set the state of a resource after it was accessed outside the graph.
+	void SetAccess(uint32_t resource, ERenderGraphUsage usage);
+
+	// Return true if the pass was culled.
+	inline bool IsCulled(uint32_t pass) const { return mPasses[pass].isCulled; }
+
+	// Return the graph stats.
+	inline const RenderGraphStats& GetStats() const { return mStats; }
+
+private:
+	// Cull passes with no side effects whose output is never used.
+	void CullPasses();
+
+	// Compute the lifetime of each resource from the passes using it.
+	void ComputeLifetimes();
+
+	// Create transient images & alias their memory.
+	void CreateTransients();
+
+	// Add the barrier needed by an access to the current batch.
+	void AddBarrier(const RenderGraphAccess& access);
+
+	// Record the current batch of barriers.
+	void FlushBarriers(VKICommandBuffer* cmdBuffer);
+
+	// Return the layout, stages & access of a usage.
+	static void GetUsageInfo(ERenderGraphUsage usage, VkImageLayout& outLayout,
+		VkPipelineStageFlags& outStage, VkAccessFlags& outAccess);
+
+private:
+	// The device used to create transients.
+	VKIDevice* mDevice;
+
+	// The declared passes.
+	std::vector<RenderGraphPass> mPasses;
+
+	// The declared resources.
+	std::vector<RenderGraphResource> mResources;
+
+	// The tracked states.
+	std::vector<RenderGraphState> mStates;
+
+	// The memory of aliased transients.
+	std::vector<RenderGraphMemory> mMemory;
+
+	// The current batch of barriers.
+	std::vector<VkImageMemoryBarrier> mBarriers;
+
+	// The stages of the current batch of barriers.
+	VkPipelineStageFlags mSrcStage;
+	VkPipelineStageFlags mDstStage;
+
+	// Stats of the last frame & the barriers count of the current frame.
+	RenderGraphStats mStats;
+	RenderGraphStats mFrameStats;
+};
@@ -0,0 +1,199 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "RenderPassCache.h"
+#include "VKInterface/VKIDevice.h"
+#include "VKInterface/VKICommandBuffer.h"
+#include "VKInterface/VKIRenderPass.h"
+#include "VKInterface/VKIDescriptor.h"
+
+
+#include <chrono>
+#include <algorithm>
+
+
+
+
+// FNV-1a 64 bit constants.
+#define PASS_CACHE_HASH_OFFSET 14695981039346656037ull
+#define PASS_CACHE_HASH_PRIME 1099511628211ull
+
+
+
+
+// Return the current time in milliseconds.
+static double GetTimeMS()
+{
+	using namespace std::chrono;
+	return duration<double, std::milli>(high_resolution_clock::now().time_since_epoch()).count();
+}
+
+
+
+
+
+
+RenderPassCacheKey::RenderPassCacheKey()
+	: mHash(PASS_CACHE_HASH_OFFSET)
+{
+
+}
+
+
+void RenderPassCacheKey::Add(const void* data, size_t size)
+{
+	const uint8_t* bytes = (const uint8_t*)data;
+
+	for (size_t i = 0; i < size; ++i)
+	{
+		mHash ^= bytes[i];
+		mHash *= PASS_CACHE_HASH_PRIME;
+	}
+}
+
+
+void RenderPassCacheKey::AddDescriptorSet(const VKIDescriptorSet* descSet, uint32_t index)
+{
+	Add(descSet->Get(index));
+	Add(descSet->GetVersion());
+
+	uint32_t dynamicOffsets[MAX_DYNAMIC_OFFSETS];
+	uint32_t numOffsets = descSet->GetDynamicOffsets(dynamicOffsets);
+	Add(dynamicOffsets, numOffsets * sizeof(uint32_t));
+}
+
+
+
+// --- -- - -- --- --- -- - -- --- --- -- - -- --- --- -- - -- --- --- -- - -- --- --- -- - -- --- 
+// - --- -- - -- --- --- -- - -- --- --- -- - -- --- --- -- - -- --- --- -- - -- --- --- -- - -- - 
+
+
+
+RenderPassCache::RenderPassCache()
+	: mDevice(nullptr)
+	, mNumFrames(0)
+	, mIsEnabled(true)
+	, mRecordStart(0.0)
+{
+	mStats = RenderPassCacheStats{};
+	mLastStats = RenderPassCacheStats{};
+}
+
+
+RenderPassCache::~RenderPassCache()
+{
+
+}
+
+
+void RenderPassCache::Create(VKIDevice* device, uint32_t numFrames)
+{
+	mDevice = device;
+	mNumFrames = numFrames;
+}
+
+
+void RenderPassCache::Destroy()
+{
+	for (auto& pass : mPasses)
+		pass.cmdBuffer->Destroy();
+
+	mPasses.clear();
+}
+
+
+uint32_t RenderPassCache::AddPass(const std::string& name)
+{
+	RenderCachedPass pass;
+	pass.name = name;
+	pass.keys.resize(mNumFrames, RENDER_PASS_CACHE_NEVER);
+
+	// Secondary command buffers from the draw command pool, they are only recorded with the draw commands.
+	pass.cmdBuffer = UniquePtr<VKICommandBuffer>(new VKICommandBuffer());
+	pass.cmdBuffer->CreateCmdBuffer(mDevice, mDevice->GetCmdPool(), mNumFrames, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+
+	mPasses.emplace_back(std::move(pass));
+	return (uint32_t)mPasses.size() - 1;
+}
+
+
+void RenderPassCache::BeginFrame()
+{
+	mLastStats = mStats;
+	mStats = RenderPassCacheStats{};
+}
+
+
+VKICommandBuffer* RenderPassCache::Begin(uint32_t pass, uint32_t frame, uint64_t key, VKIRenderPass* renderPass)
+{
+	RenderCachedPass& cachedPass = mPasses[pass];
+
+	// Same inputs as the last render of this frame?
+	if (mIsEnabled && key != RENDER_PASS_CACHE_NEVER && cachedPass.keys[frame] == key)
+	{
+		++mStats.numCached;
+		return nullptr;
+	}
+
+	cachedPass.keys[frame] = mIsEnabled ? key : RENDER_PASS_CACHE_NEVER;
+	cachedPass.cmdBuffer->SetCurrent(frame);
+	mRecordStart = GetTimeMS();
+
+	// Record again, the frame finished executing its last commands.
+	VkCommandBufferInheritanceInfo inheritanceInfo{};
+	inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritanceInfo.renderPass = renderPass->Get();
+	inheritanceInfo.subpass = 0;
+	inheritanceInfo.framebuffer = VK_NULL_HANDLE;
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+	beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+	VkResult result = vkBeginCommandBuffer(cachedPass.cmdBuffer->GetCurrent(), &beginInfo);
+	CHECK(result == VK_SUCCESS);
+
+	return cachedPass.cmdBuffer.get();
+}
+
+
+void RenderPassCache::End(uint32_t pass, uint32_t frame)
+{
+	vkEndCommandBuffer(mPasses[pass].cmdBuffer->Get(frame));
+
+	++mStats.numRecorded;
+	mStats.recordTime += (float)(GetTimeMS() - mRecordStart);
+}
+
+
+void RenderPassCache::Execute(VKICommandBuffer* cmdBuffer, uint32_t pass, uint32_t frame)
+{
+	VkCommandBuffer secondary = mPasses[pass].cmdBuffer->Get(frame);
+	vkCmdExecuteCommands(cmdBuffer->GetCurrent(), 1, &secondary);
+}
+
+
+void RenderPassCache::Invalidate()
+{
+	for (auto& pass : mPasses)
+		std::fill(pass.keys.begin(), pass.keys.end(), RENDER_PASS_CACHE_NEVER);
+}
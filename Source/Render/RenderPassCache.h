@@ -0,0 +1,177 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+
+
+
+#include "Core/Core.h"
+#include "vulkan/vulkan.h"
+
+
+#include <vector>
+#include <string>
+
+
+
+
+class VKIDevice;
+class VKICommandBuffer;
+class VKIRenderPass;
+class VKIDescriptorSet;
+
+
+
+
+
+// Passes recorded with this key are never cached.
+#define RENDER_PASS_CACHE_NEVER 0
+
+
+
+
+// Build the key of a cached pass from the inputs its commands depend on.
+class RenderPassCacheKey
+{
+public:
+	// Construct.
+	RenderPassCacheKey();
+
+	// Add raw input data.
+	void Add(const void* data, size_t size);
+
+	// Add an input value.
+	template<class T>
+	inline void Add(const T& value) { Add(&value, sizeof(T)); }
+
+	// Add a descriptor set of a frame, its version & its current dynamic offsets.
+	void AddDescriptorSet(const VKIDescriptorSet* descSet, uint32_t index);
+
+	// Return the key.
+	inline uint64_t Get() const { return mHash == RENDER_PASS_CACHE_NEVER ? 1 : mHash; }
+
+private:
+	// FNV-1a hash of the inputs.
+	uint64_t mHash;
+};
+
+
+
+// Pass cache stats of the last frame.
+struct RenderPassCacheStats
+{
+	// The number of passes executed from their cached commands.
+	uint32_t numCached;
+
+	// The number of passes recorded again.
+	uint32_t numRecorded;
+
+	// The CPU time spent recording passes in milliseconds.
+	float recordTime;
+};
+
+
+
+// A pass with its commands recorded into secondary command buffers, one for each concurrent frame.
+struct RenderCachedPass
+{
+	// The pass name.
+	std::string name;
+
+	// The secondary command buffers.
+	UniquePtr<VKICommandBuffer> cmdBuffer;
+
+	// The key of the commands recorded for each frame.
+	std::vector<uint64_t> keys;
+};
+
+
+
+
+// RenderPassCache:
+//    - Record the commands of passes into secondary command buffers & reuse them in the next renders
+//      of the same frame while the pass inputs are unchanged.
+//    - The inputs are tracked by a key built each render from pipelines, descriptor sets versions,
+//      dynamic offsets & viewports, the commands are recorded again when it change.
+//    - A cached pass must be executed in a render pass began with secondary command buffers contents.
+//
+class RenderPassCache
+{
+public:
+	// Construct.
+	RenderPassCache();
+
+	// Destruct.
+	~RenderPassCache();
+
+	// Create the cache for a number of concurrent frames.
+	void Create(VKIDevice* device, uint32_t numFrames);
+
+	// Destroy the cache.
+	void Destroy();
+
+	// Add a pass to the cache, return its index.
+	uint32_t AddPass(const std::string& name);
+
+	// Start the stats of a new frame.
+	void BeginFrame();
+
+	// Return the command buffer to record the pass commands into if they are not cached for this key,
+	// or null if the commands cached for this frame can be executed again.
+	VKICommandBuffer* Begin(uint32_t pass, uint32_t frame, uint64_t key, VKIRenderPass* renderPass);
+
+	// End recording the pass commands.
+	void End(uint32_t pass, uint32_t frame);
+
+	// Execute the pass commands of a frame.
+	void Execute(VKICommandBuffer* cmdBuffer, uint32_t pass, uint32_t frame);
+
+	// Invalidate the cached commands of all passes.
+	void Invalidate();
+
+	// Enable/Disable caching, the passes are still recorded into secondary command buffers every render.
+	inline void SetEnabled(bool isEnabled) { mIsEnabled = isEnabled; }
+	inline bool IsEnabled() const { return mIsEnabled; }
+
+	// Return the stats of the last frame.
+	inline const RenderPassCacheStats& GetStats() const { return mLastStats; }
+
+private:
+	// The device.
+	VKIDevice* mDevice;
+
+	// The number of concurrent frames.
+	uint32_t mNumFrames;
+
+	// The cached passes.
+	std::vector<RenderCachedPass> mPasses;
+
+	// True if caching is enabled.
+	bool mIsEnabled;
+
+	// The start time of the pass being recorded.
+	double mRecordStart;
+
+	// Stats of the current & last frame.
+	RenderPassCacheStats mStats;
+	RenderPassCacheStats mLastStats;
+};
@@ -28,7 +28,6 @@
 #include "RenderData/RenderScene.h"
 #include "RenderData/RenderShadow.h"
 #include "RenderData/RenderLight.h"
-#include "RenderData/Primitives/RenderSphere.h"
 #include "RenderData/Shaders/RenderShader.h"
 #include "RenderData/Shaders/RenderUniform.h"
 
@@ -41,6 +40,14 @@
 #include "VKInterface/VKICommandBuffer.h"
 #include "VKInterface/VKISwapChain.h"
 #include "VKInterface/VKIGraphicsPipeline.h"
+#include "VKInterface/VKIComputePipeline.h"
+
+
+
+
+
+// The irradiance filter work group size, matches IrradianceFilter.glsl.
+#define IRRADIANCE_FILTER_GROUP_SIZE 8
 
 
 
@@ -60,17 +67,13 @@ RenderStageLightProbes::~RenderStageLightProbes()
 
 
 void RenderStageLightProbes::Initialize(VKIDevice* device, StageRenderTarget hdrTargets[2],
-	StageRenderTarget* dephtTarget, RenderUniform* commonUniform)
+	StageRenderTarget* dephtTarget, RendererPipeline* pipeline)
 {
 	mDevice = device;
-	mCommon = commonUniform;
+	mPipeline = pipeline;
 	mHDRTarget[0] = &hdrTargets[0];
 	mDepth = dephtTarget;
 
-	// The Render Sphere.
-	mSphere = Application::Get().GetRenderer()->GetSphere();
-
-
 	SetupCaptureCubePass();
 	SetupIrradianceFilter();
 	SetupLightingPass();
@@ -84,9 +87,9 @@ void RenderStageLightProbes::Destroy()
 	mCaptureCubeRenderPass->Destroy();
 	mCaptureCubeFB->Destroy();
 	mCaptureCubeShader->Destroy();
-	mIrradianceFilterPass->Destroy();
 	mIrradianceFilter->Destroy();
 	mIrradianceArrayFilter->Destroy();
+	mIrradianceFilterLayout->Destroy();
 	mLightingShader->Destroy();
 	mLightingVolumeShader->Destroy();
 	mVisualizeProbeShader->Destroy();
@@ -131,50 +134,40 @@ void RenderStageLightProbes::RenderCaptureCube(VKICommandBuffer* cmdBuffer, uint
 }
 
 
-void RenderStageLightProbes::FilterIrradiance(VKICommandBuffer* cmdBuffer, uint32_t frame, 
-	RenderLightProbe* lightProbe, const glm::ivec4& viewport)
+void RenderStageLightProbes::FilterIrradiance(VKICommandBuffer* cmdBuffer, RenderLightProbe* lightProbe)
 {
-	lightProbe->GetIrradiance()->TransitionImageLayout(cmdBuffer->GetCurrent(),
-		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT);
+	glm::ivec4 params(LIGHT_PROBES_TARGET_SIZE, 0, 0, 0);
 
-	mIrradianceFilterPass->Begin(cmdBuffer, lightProbe->GetIrradianceFB(), viewport);
 	mIrradianceFilter->Bind(cmdBuffer);
+	lightProbe->GetIrradianceFilterSet()->Bind(cmdBuffer, 0, mIrradianceFilter.get());
 
-	lightProbe->GetRadianceDescSet()->Bind(cmdBuffer, frame, mIrradianceFilter->GetPipeline());
-
-	mSphere->Draw(cmdBuffer);
-	mIrradianceFilterPass->End(cmdBuffer);
-
-	lightProbe->GetIrradiance()->TransitionImageLayout(cmdBuffer->GetCurrent(),
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT);
+	vkCmdPushConstants(cmdBuffer->GetCurrent(),
+		mIrradianceFilter->GetLayout(),
+		VK_SHADER_STAGE_COMPUTE_BIT,
+		0, sizeof(glm::ivec4), &params);
+
+	// One invocation per texel for each of the 6 faces.
+	vkCmdDispatch(cmdBuffer->GetCurrent(),
+		(LIGHT_PROBES_TARGET_SIZE + IRRADIANCE_FILTER_GROUP_SIZE - 1) / IRRADIANCE_FILTER_GROUP_SIZE,
+		(LIGHT_PROBES_TARGET_SIZE + IRRADIANCE_FILTER_GROUP_SIZE - 1) / IRRADIANCE_FILTER_GROUP_SIZE, 6);
 }
 
 
-void RenderStageLightProbes::FilterIrradianceVolume(VKICommandBuffer* cmdBuffer, uint32_t frame,
-	RenderIrradianceVolume* volume, uint32_t probe, const glm::ivec4& viewport)
+void RenderStageLightProbes::FilterIrradianceVolume(VKICommandBuffer* cmdBuffer, RenderIrradianceVolume* volume, uint32_t probe)
 {
-	volume->GetIrradiance()->TransitionImageLayout(cmdBuffer->GetCurrent(),
-		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT);
+	glm::ivec4 params(IRRADIANCE_VOLUME_TARGET_SIZE, (int32_t)probe, 0, 0);
 
-	mIrradianceFilterPass->Begin(cmdBuffer, volume->GetIrradianceFB(), viewport);
 	mIrradianceArrayFilter->Bind(cmdBuffer);
-	volume->GetRadianceDescSet()->Bind(cmdBuffer, frame, mIrradianceArrayFilter->GetPipeline());
-
-	int32_t layer = probe;
+	volume->GetIrradianceFilterSet()->Bind(cmdBuffer, 0, mIrradianceArrayFilter.get());
 
 	vkCmdPushConstants(cmdBuffer->GetCurrent(),
-		mIrradianceArrayFilter->GetPipeline()->GetLayout(),
-		VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_GEOMETRY_BIT,
-		0, sizeof(int32_t), &layer);
-
-
-	mSphere->Draw(cmdBuffer);
+		mIrradianceArrayFilter->GetLayout(),
+		VK_SHADER_STAGE_COMPUTE_BIT,
+		0, sizeof(glm::ivec4), &params);
 
-	mIrradianceFilterPass->End(cmdBuffer);
-
-
-	volume->GetIrradiance()->TransitionImageLayout(cmdBuffer->GetCurrent(),
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT);
+	vkCmdDispatch(cmdBuffer->GetCurrent(),
+		(IRRADIANCE_VOLUME_TARGET_SIZE + IRRADIANCE_FILTER_GROUP_SIZE - 1) / IRRADIANCE_FILTER_GROUP_SIZE,
+		(IRRADIANCE_VOLUME_TARGET_SIZE + IRRADIANCE_FILTER_GROUP_SIZE - 1) / IRRADIANCE_FILTER_GROUP_SIZE, 6);
 }
 
 
@@ -302,7 +295,7 @@ void RenderStageLightProbes::SetupCaptureCubePass()
 	mCaptureCubeShader->SetViewportDynamic(true);
 	mCaptureCubeShader->SetBlendingEnabled(0, false);
 
-	mCaptureCubeShader->AddInput(RenderShader::COMMON_BLOCK_BINDING, ERenderShaderInputType::Uniform,
+	mCaptureCubeShader->AddInput(RenderShader::COMMON_BLOCK_BINDING, ERenderShaderInputType::DynamicUniform,
 		ERenderShaderStage::AllStages);
 
 	mCaptureCubeShader->AddInput(1, ERenderShaderInputType::ImageSampler,
@@ -320,8 +313,7 @@ void RenderStageLightProbes::SetupCaptureCubePass()
 	descriptorSet->SetLayout(mCaptureCubeShader->GetLayout());
 	descriptorSet->CreateDescriptorSet(mDevice, Renderer::NUM_CONCURRENT_FRAMES);
 
-	descriptorSet->AddDescriptor(RenderShader::COMMON_BLOCK_BINDING, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-		VK_SHADER_STAGE_ALL, mCommon->GetBuffers());
+	mPipeline->AddCommonToDescSet(descriptorSet);
 
 	descriptorSet->AddDescriptor(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT,
 		mHDRTarget[0]->view.get(), mHDRTarget[0]->sampler.get());
@@ -335,86 +327,25 @@ void RenderStageLightProbes::SetupCaptureCubePass()
 
 void RenderStageLightProbes::SetupIrradianceFilter()
 {
-	VkExtent2D size = { LIGHT_PROBES_TARGET_SIZE, LIGHT_PROBES_TARGET_SIZE };
-
-
-	// RenderPass...
-	mIrradianceFilterPass = UniquePtr<VKIRenderPass>(new VKIRenderPass());
-	mIrradianceFilterPass->SetColorAttachment(0, VK_FORMAT_R16G16B16A16_SFLOAT,
-		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-		VK_ATTACHMENT_LOAD_OP_DONT_CARE, true);
-
-
-	mIrradianceFilterPass->AddDependency(VK_SUBPASS_EXTERNAL, 0,
-		VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-		VK_ACCESS_MEMORY_READ_BIT,
-		VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
-
-	mIrradianceFilterPass->AddDependency(0, VK_SUBPASS_EXTERNAL,
-		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-		VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-		VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-		VK_ACCESS_MEMORY_READ_BIT);
-
-	mIrradianceFilterPass->CreateRenderPass(mDevice);
-
-
-	// IBLFilter Shader
-	{
-		mIrradianceFilter = UniquePtr<RenderShader>(new RenderShader());
-		mIrradianceFilter->SetDomain(ERenderShaderDomain::Mesh);
-		mIrradianceFilter->SetRenderPass(mIrradianceFilterPass.get());
-		mIrradianceFilter->SetShader(ERenderShaderStage::Vertex, SHADERS_DIRECTORY "SphereVert.spv");
-		mIrradianceFilter->SetShader(ERenderShaderStage::Geometry, SHADERS_DIRECTORY "SphereGeom.spv");
-		mIrradianceFilter->SetShader(ERenderShaderStage::Fragment, SHADERS_DIRECTORY "IBLFilter_Irradiance.spv");
-		mIrradianceFilter->SetViewport(glm::ivec4(0, 0, size.width, size.height));
-		mIrradianceFilter->SetViewportDynamic(true);
-		mIrradianceFilter->SetBlendingEnabled(0, false);
-
-		mIrradianceFilter->AddInput(RenderShader::COMMON_BLOCK_BINDING, ERenderShaderInputType::Uniform,
-			ERenderShaderStage::AllStages);
-
-		mIrradianceFilter->AddInput(1, ERenderShaderInputType::Uniform,
-			ERenderShaderStage::Geometry);
-
-		mIrradianceFilter->AddInput(2, ERenderShaderInputType::ImageSampler,
-			ERenderShaderStage::Fragment);
-
-		mIrradianceFilter->Create();
-	}
-
-
-	// IBLFilter Array Shader
-	{
-		mIrradianceArrayFilter = UniquePtr<RenderShader>(new RenderShader());
-		mIrradianceArrayFilter->SetDomain(ERenderShaderDomain::Mesh);
-		mIrradianceArrayFilter->SetRenderPass(mIrradianceFilterPass.get());
-		mIrradianceArrayFilter->SetShader(ERenderShaderStage::Vertex, SHADERS_DIRECTORY "SphereVert.spv");
-		mIrradianceArrayFilter->SetShader(ERenderShaderStage::Geometry, SHADERS_DIRECTORY "SphereGeom_IrradianceArray.spv");
-		mIrradianceArrayFilter->SetShader(ERenderShaderStage::Fragment, SHADERS_DIRECTORY "IBLFilter_IrradianceArray.spv");
-		mIrradianceArrayFilter->SetViewport(glm::ivec4(0, 0, size.width, size.height));
-		mIrradianceArrayFilter->SetViewportDynamic(true);
-		mIrradianceArrayFilter->SetBlendingEnabled(0, false);
-
-		mIrradianceArrayFilter->AddInput(RenderShader::COMMON_BLOCK_BINDING, ERenderShaderInputType::Uniform,
-			ERenderShaderStage::AllStages);
-
-		mIrradianceArrayFilter->AddInput(1, ERenderShaderInputType::Uniform,
-			ERenderShaderStage::Geometry);
-
-		mIrradianceArrayFilter->AddInput(2, ERenderShaderInputType::ImageSampler,
-			ERenderShaderStage::Fragment);
-
-		mIrradianceArrayFilter->AddPushConstant(0, 0, sizeof(int32_t),
-			ERenderShaderStage::Geometry | ERenderShaderStage::Fragment);
-
-		mIrradianceArrayFilter->Create();
-	}
-	
-
+	// Radiance cube map input & irradiance faces output.
+	mIrradianceFilterLayout = UniquePtr<VKIDescriptorLayout>(new VKIDescriptorLayout());
+	mIrradianceFilterLayout->AddBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT);
+	mIrradianceFilterLayout->AddBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT);
+	mIrradianceFilterLayout->CreateLayout(mDevice);
+
+	// Light Probe Filter.
+	mIrradianceFilter = UniquePtr<VKIComputePipeline>(new VKIComputePipeline());
+	mIrradianceFilter->SetShader(SHADERS_DIRECTORY "IrradianceFilter.spv");
+	mIrradianceFilter->SetDescriptorLayout(mIrradianceFilterLayout.get());
+	mIrradianceFilter->SetPushConstant(0, 0, sizeof(glm::ivec4));
+	mIrradianceFilter->CreatePipeline(mDevice);
+
+	// Irradiance Volume Filter.
+	mIrradianceArrayFilter = UniquePtr<VKIComputePipeline>(new VKIComputePipeline());
+	mIrradianceArrayFilter->SetShader(SHADERS_DIRECTORY "IrradianceFilter_Array.spv");
+	mIrradianceArrayFilter->SetDescriptorLayout(mIrradianceFilterLayout.get());
+	mIrradianceArrayFilter->SetPushConstant(0, 0, sizeof(glm::ivec4));
+	mIrradianceArrayFilter->CreatePipeline(mDevice);
 }
 
 
@@ -430,13 +361,13 @@ void RenderStageLightProbes::SetupLightingPass()
 		mLightingShader->SetRenderPass(rpipeline->GetLightingPass());
 		mLightingShader->SetShader(ERenderShaderStage::Vertex, SHADERS_DIRECTORY "ScreenVert.spv");
 		mLightingShader->SetShader(ERenderShaderStage::Fragment, SHADERS_DIRECTORY "LightingPass_LightProbe.spv");
-		mLightingShader->SetViewport(glm::ivec4(0, 0, 1920.0, 1080.0));
+		mLightingShader->SetViewport(glm::ivec4(0, 0, rpipeline->GetSize()));
 		mLightingShader->SetViewportDynamic(true);
 		mLightingShader->SetBlendingEnabled(0, true);
 		mLightingShader->SetBlending(0, ERenderBlendFactor::SrcAlpha, ERenderBlendFactor::One,
 			ERenderBlendOp::Add);
 
-		mLightingShader->AddInput(RenderShader::COMMON_BLOCK_BINDING, ERenderShaderInputType::Uniform,
+		mLightingShader->AddInput(RenderShader::COMMON_BLOCK_BINDING, ERenderShaderInputType::DynamicUniform,
 			ERenderShaderStage::AllStages);
 
 		mLightingShader->AddInput(1, ERenderShaderInputType::ImageSampler,
@@ -471,7 +402,7 @@ void RenderStageLightProbes::SetupLightingPass()
 		mLightingVolumeShader->SetRenderPass(rpipeline->GetLightingPass());
 		mLightingVolumeShader->SetShader(ERenderShaderStage::Vertex, SHADERS_DIRECTORY "ScreenVert.spv");
 		mLightingVolumeShader->SetShader(ERenderShaderStage::Fragment, SHADERS_DIRECTORY "LightingPass_IrradianceVolume.spv");
-		mLightingVolumeShader->SetViewport(glm::ivec4(0, 0, 1920.0, 1080.0));
+		mLightingVolumeShader->SetViewport(glm::ivec4(0, 0, rpipeline->GetSize()));
 		mLightingVolumeShader->SetViewportDynamic(true);
 		mLightingVolumeShader->SetBlendingEnabled(0, true);
 		mLightingVolumeShader->SetBlending(0, ERenderBlendFactor::One, ERenderBlendFactor::One,
@@ -480,7 +411,7 @@ void RenderStageLightProbes::SetupLightingPass()
 		mLightingVolumeShader->SetBlending(0, ERenderBlendFactor::SrcAlpha, ERenderBlendFactor::OneMinusSrcAlpha,
 			ERenderBlendOp::Add);
 
-		mLightingVolumeShader->AddInput(RenderShader::COMMON_BLOCK_BINDING, ERenderShaderInputType::Uniform,
+		mLightingVolumeShader->AddInput(RenderShader::COMMON_BLOCK_BINDING, ERenderShaderInputType::DynamicUniform,
 			ERenderShaderStage::AllStages);
 
 		mLightingVolumeShader->AddInput(1, ERenderShaderInputType::ImageSampler,
@@ -520,11 +451,11 @@ void RenderStageLightProbes::SetupVisualizePass()
 	mVisualizeProbeShader->SetRenderPass(rpipeline->GetLightingPass());
 	mVisualizeProbeShader->SetShader(ERenderShaderStage::Vertex, SHADERS_DIRECTORY "ScreenVert.spv");
 	mVisualizeProbeShader->SetShader(ERenderShaderStage::Fragment, SHADERS_DIRECTORY "VisualizePass.spv");
-	mVisualizeProbeShader->SetViewport(glm::ivec4(0, 0, 1920.0, 1080.0));
+	mVisualizeProbeShader->SetViewport(glm::ivec4(0, 0, rpipeline->GetSize()));
 	mVisualizeProbeShader->SetViewportDynamic(true);
 	mVisualizeProbeShader->SetBlendingEnabled(0, false);
 
-	mVisualizeProbeShader->AddInput(RenderShader::COMMON_BLOCK_BINDING, ERenderShaderInputType::Uniform,
+	mVisualizeProbeShader->AddInput(RenderShader::COMMON_BLOCK_BINDING, ERenderShaderInputType::DynamicUniform,
 		ERenderShaderStage::AllStages);
 
 	mVisualizeProbeShader->AddInput(10, ERenderShaderInputType::ImageSampler,
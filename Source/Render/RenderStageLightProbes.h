@@ -38,6 +38,7 @@ class RenderScene;
 class RenderUniform;
 class RenderLightProbe;
 class RenderIrradianceVolume;
+class RendererPipeline;
 
 
 class VKIDevice;
@@ -47,6 +48,8 @@ class VKIRenderPass;
 class VKIImageView;
 class VKISampler;
 class VKICommandBuffer;
+class VKIComputePipeline;
+class VKIDescriptorLayout;
 
 
 
@@ -67,7 +70,7 @@ public:
 	~RenderStageLightProbes();
 
 	// Initialize The Pipeline.
-	void Initialize(VKIDevice* device, StageRenderTarget hdrTargets[2], StageRenderTarget* dephtTarget, RenderUniform* commonUniform);
+	void Initialize(VKIDevice* device, StageRenderTarget hdrTargets[2], StageRenderTarget* dephtTarget, RendererPipeline* pipeline);
 
 	// Destroy The Pipeline.
 	void Destroy();
@@ -80,17 +83,19 @@ public:
 	void RenderCaptureCube(VKICommandBuffer* cmdBuffer, uint32_t frame, RenderLightProbe* lightProbe, uint32_t face, const glm::ivec4& viewport);
 	void RenderCaptureCube(VKICommandBuffer* cmdBuffer, uint32_t frame, RenderIrradianceVolume* volume, uint32_t layer, const glm::ivec4& viewport);
 
-	// Pre-Filter Capture Cube map and store the result in lightProbe.
-	void FilterIrradiance(VKICommandBuffer* cmdBuffer, uint32_t frame, RenderLightProbe* lightProbe, const glm::ivec4& viewport);
-	void FilterIrradianceVolume(VKICommandBuffer* cmdBuffer, uint32_t frame, RenderIrradianceVolume* volume, uint32_t probe, const glm::ivec4& viewport);
+	// Pre-Filter Capture Cube map and store the result in lightProbe, the irradiance image must be in the general layout.
+	// The command buffer can be the graphics or the async compute one.
+	void FilterIrradiance(VKICommandBuffer* cmdBuffer, RenderLightProbe* lightProbe);
+	void FilterIrradianceVolume(VKICommandBuffer* cmdBuffer, RenderIrradianceVolume* volume, uint32_t probe);
 
 	// Return the capture cube image.
 	inline VKIImage* GetCaptureCube() { return mCaptureCubeTarget.image.get(); }
 
-	// Return Irradiance Filter Render Pass.
-	inline VKIRenderPass* GetIrradianceFilterPass() { return mIrradianceFilterPass.get(); }
-	inline RenderShader* GetIrradianceFilterShader() { return mIrradianceFilter.get(); }
-	inline RenderShader* GetIrradianceArrayFilterShader() { return mIrradianceArrayFilter.get(); }
+	// Return the capture cube render pass.
+	inline VKIRenderPass* GetCaptureCubePass() { return mCaptureCubeRenderPass.get(); }
+
+	// Return the descriptor layout of the irradiance filter, shared by light probes & irradiance volumes.
+	inline VKIDescriptorLayout* GetIrradianceFilterLayout() { return mIrradianceFilterLayout.get(); }
 
 	// Return the lighting shader used to render light probe.
 	inline RenderShader* GetLightingShader() { return mLightingShader.get(); }
@@ -119,26 +124,23 @@ private:
 	// The Vulkan Device.
 	VKIDevice* mDevice;
 
-	// The Pipeline Common Unifrom.
-	RenderUniform* mCommon;
+	// The Pipeline that own this stage, provide the common block binding.
+	RendererPipeline* mPipeline;
 
 	// The Pipeline HDR Target.
 	StageRenderTarget* mHDRTarget[2];
 	StageRenderTarget* mDepth;
 
-	// The Render Sphere.
-	class RenderSphere* mSphere;
-
 	// Caputre Cube.
 	StageRenderTarget mCaptureCubeTarget;
 	UniquePtr<VKIRenderPass> mCaptureCubeRenderPass;
 	UniquePtr<VKIFramebuffer> mCaptureCubeFB;
 	UniquePtr<RenderShader> mCaptureCubeShader;
 
-	// Irradiance Pass.
-	UniquePtr<VKIRenderPass> mIrradianceFilterPass;
-	UniquePtr<RenderShader> mIrradianceFilter;
-	UniquePtr<RenderShader> mIrradianceArrayFilter;
+	// Irradiance Filter.
+	UniquePtr<VKIDescriptorLayout> mIrradianceFilterLayout;
+	UniquePtr<VKIComputePipeline> mIrradianceFilter;
+	UniquePtr<VKIComputePipeline> mIrradianceArrayFilter;
 
 	// Lighting Stage Pass.
 	UniquePtr<RenderShader> mLightingShader;
@@ -0,0 +1,590 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#include "RenderStageOcclusion.h"
+#include "Application.h"
+#include "Renderer.h"
+#include "RenderData/RenderScene.h"
+
+
+#include "VKInterface/VKIDevice.h"
+#include "VKInterface/VKIImage.h"
+#include "VKInterface/VKIBuffer.h"
+#include "VKInterface/VKIRenderPass.h"
+#include "VKInterface/VKIFramebuffer.h"
+#include "VKInterface/VKIDescriptor.h"
+#include "VKInterface/VKICommandBuffer.h"
+#include "VKInterface/VKIComputePipeline.h"
+
+
+
+
+#define CULL_PHASE_PRE_PASS 0
+#define CULL_PHASE_FINAL 1
+#define CULL_MODE_RESET_DRAWS 0
+#define CULL_MODE_INSTANCES 1
+#define CULL_FLAG_ALWAYS_VISIBLE 1u
+#define CULL_FLAG_SOFTWARE_VISIBILITY 1u
+#define CULL_STATS_COUNT 4
+#define CULL_GROUP_SIZE 64
+#define HIZ_GROUP_SIZE 8
+
+
+
+// A single instance to cull, matches CullObject in OcclusionCull.glsl.
+struct OcclusionCullObject
+{
+	glm::vec4 boundsMin;
+	glm::vec4 boundsMax;
+	glm::uvec4 info;
+};
+
+
+// A single draw of instances, matches CullDraw in OcclusionCull.glsl.
+struct OcclusionCullDraw
+{
+	glm::uvec4 draw;
+};
+
+
+// Depth pyramid build constants, matches HiZBuild.glsl.
+struct HiZBuildConstant
+{
+	glm::ivec4 size;
+	glm::ivec4 params;
+};
+
+
+// Cull constants, matches OcclusionCull.glsl.
+struct OcclusionCullConstant
+{
+	glm::mat4 viewProjMatrix;
+	glm::vec4 hizSize;
+	glm::uvec4 params;
+	glm::uvec4 offsets;
+};
+
+
+
+
+RenderStageOcclusion::RenderStageOcclusion()
+	: mDevice(nullptr)
+	, mDepth(nullptr)
+	, mDepthPass(nullptr)
+	, mSize(0)
+	, mHiZSize(0)
+	, mViewHiZSize(0)
+	, mViewHiZLevels(0)
+	, mNumObjects(0)
+	, mNumDraws(0)
+	, mFrame(0)
+	, mScene(nullptr)
+	, mIsEnabled(false)
+{
+	mViewStats.fill(OcclusionViewStats{});
+}
+
+
+RenderStageOcclusion::~RenderStageOcclusion()
+{
+
+}
+
+
+void RenderStageOcclusion::Initialize(VKIDevice* device, StageRenderTarget* depthTarget, VKIRenderPass* depthPass,
+	const glm::ivec2& size)
+{
+	mDevice = device;
+	mDepth = depthTarget;
+	mDepthPass = depthPass;
+	mSize = size;
+
+	SetupHiZ();
+	SetupBuffers();
+	SetupPipelines();
+
+
+	// Depth Pre-Pass Framebuffer...
+	mDepthFB = UniquePtr<VKIFramebuffer>(new VKIFramebuffer());
+	mDepthFB->SetSize({ (uint32_t)mSize.x, (uint32_t)mSize.y });
+	mDepthFB->SetImgView(0, mDepth->view.get());
+	mDepthFB->CreateFrameBuffer(mDevice, mDepthPass);
+
+
+	// Initial State, depth pyramid in general layout & everything visible last frame.
+	VkCommandBuffer cmd = mDevice->BeginTransientCmd();
+	mHiZ.image->TransitionImageLayout(cmd, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_ASPECT_COLOR_BIT);
+	vkCmdFillBuffer(cmd, mVisibility->Get(), 0, VK_WHOLE_SIZE, 1);
+	mDevice->EndTransientCmd(cmd, Delegate<>());
+}
+
+
+void RenderStageOcclusion::Destroy()
+{
+	mDepthFB->Destroy();
+	mHiZPipeline->Destroy();
+	mCullPipeline->Destroy();
+
+	for (auto& set : mHiZSets)
+		set->Destroy();
+
+	mCullSet->Destroy();
+	mHiZLayout->Destroy();
+	mCullLayout->Destroy();
+
+	for (auto& view : mHiZLevels)
+		view->Destroy();
+
+	mHiZ.Destroy();
+	mVisibility->Destroy();
+	mSoftwareVisibility->Destroy();
+	mIndirect->Destroy();
+
+	for (uint32_t i = 0; i < Renderer::NUM_CONCURRENT_FRAMES; ++i)
+	{
+		mObjects[i]->Destroy();
+		mDraws[i]->Destroy();
+		mStats[i]->Destroy();
+	}
+}
+
+
+void RenderStageOcclusion::SetupHiZ()
+{
+	mHiZSize = glm::max(mSize / 2, glm::ivec2(1));
+	VkExtent2D size = { (uint32_t)mHiZSize.x, (uint32_t)mHiZSize.y };
+	uint32_t levels = (uint32_t)std::floor(std::log2(std::max(mHiZSize.x, mHiZSize.y))) + 1;
+
+	mHiZ.image = UniquePtr<VKIImage>(new VKIImage());
+	mHiZ.image->SetUsage(VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+	mHiZ.image->SetImageInfo(VK_IMAGE_TYPE_2D, VK_FORMAT_R32_SFLOAT, size, VK_IMAGE_LAYOUT_UNDEFINED);
+	mHiZ.image->SetMipLevels(levels);
+	mHiZ.image->Create(mDevice);
+
+	mHiZ.view = UniquePtr<VKIImageView>(new VKIImageView());
+	mHiZ.view->SetType(VK_IMAGE_VIEW_TYPE_2D);
+	mHiZ.view->SetViewInfo(VK_IMAGE_ASPECT_COLOR_BIT, 0, levels, 0, 1);
+	mHiZ.view->Create(mDevice, mHiZ.image.get());
+
+	mHiZ.sampler = UniquePtr<VKISampler>(new VKISampler());
+	mHiZ.sampler->SetFilter(VK_FILTER_NEAREST, VK_FILTER_NEAREST);
+	mHiZ.sampler->SetMipmap(VK_SAMPLER_MIPMAP_MODE_NEAREST, 0.0f, (float)levels, 0.0f);
+	mHiZ.sampler->SetAddressMode(VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+	mHiZ.sampler->CreateSampler(mDevice);
+
+	// Level Views...
+	mHiZLevels.resize(levels);
+
+	for (uint32_t i = 0; i < levels; ++i)
+	{
+		mHiZLevels[i] = UniquePtr<VKIImageView>(new VKIImageView());
+		mHiZLevels[i]->SetType(VK_IMAGE_VIEW_TYPE_2D);
+		mHiZLevels[i]->SetViewInfo(VK_IMAGE_ASPECT_COLOR_BIT, i, 1, 0, 1);
+		mHiZLevels[i]->Create(mDevice, mHiZ.image.get());
+	}
+}
+
+
+void RenderStageOcclusion::SetupBuffers()
+{
+	mObjects.resize(Renderer::NUM_CONCURRENT_FRAMES);
+	mDraws.resize(Renderer::NUM_CONCURRENT_FRAMES);
+	mStats.resize(Renderer::NUM_CONCURRENT_FRAMES);
+	mHasStats.resize(Renderer::NUM_CONCURRENT_FRAMES, false);
+	mObjectsData.resize(MAX_NUM_INSTANCES * sizeof(OcclusionCullObject));
+	mDrawsData.resize(OCCLUSION_MAX_OBJECTS * sizeof(OcclusionCullDraw));
+
+	for (uint32_t i = 0; i < Renderer::NUM_CONCURRENT_FRAMES; ++i)
+	{
+		mObjects[i] = UniquePtr<VKIBuffer>(new VKIBuffer());
+		mObjects[i]->SetSize(MAX_NUM_INSTANCES * sizeof(OcclusionCullObject));
+		mObjects[i]->SetUsage(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+		mObjects[i]->SetMemoryProperties(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		mObjects[i]->CreateBuffer(mDevice);
+
+		mDraws[i] = UniquePtr<VKIBuffer>(new VKIBuffer());
+		mDraws[i]->SetSize(OCCLUSION_MAX_OBJECTS * sizeof(OcclusionCullDraw));
+		mDraws[i]->SetUsage(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+		mDraws[i]->SetMemoryProperties(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		mDraws[i]->CreateBuffer(mDevice);
+
+		mStats[i] = UniquePtr<VKIBuffer>(new VKIBuffer());
+		mStats[i]->SetSize(OCCLUSION_MAX_VIEWS * CULL_STATS_COUNT * sizeof(uint32_t));
+		mStats[i]->SetUsage(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+		mStats[i]->SetMemoryProperties(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		mStats[i]->CreateBuffer(mDevice);
+	}
+
+	mVisibility = UniquePtr<VKIBuffer>(new VKIBuffer());
+	mVisibility->SetSize(OCCLUSION_MAX_VIEWS * MAX_NUM_INSTANCES * sizeof(uint32_t));
+	mVisibility->SetUsage(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+	mVisibility->SetMemoryProperties(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	mVisibility->CreateBuffer(mDevice);
+
+	mSoftwareVisibility = UniquePtr<VKIBuffer>(new VKIBuffer());
+	mSoftwareVisibility->SetSize(MAX_NUM_INSTANCES / 32 * sizeof(uint32_t));
+	mSoftwareVisibility->SetUsage(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+	mSoftwareVisibility->SetMemoryProperties(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	mSoftwareVisibility->CreateBuffer(mDevice);
+
+	mIndirect = UniquePtr<VKIBuffer>(new VKIBuffer());
+	mIndirect->SetSize(2 * OCCLUSION_MAX_OBJECTS * sizeof(VkDrawIndexedIndirectCommand));
+	mIndirect->SetUsage(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+	mIndirect->SetMemoryProperties(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	mIndirect->CreateBuffer(mDevice);
+}
+
+
+void RenderStageOcclusion::SetupPipelines()
+{
+	// Depth Pyramid...
+	{
+		mHiZLayout = UniquePtr<VKIDescriptorLayout>(new VKIDescriptorLayout());
+		mHiZLayout->AddBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT);
+		mHiZLayout->AddBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT);
+		mHiZLayout->AddBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT);
+		mHiZLayout->CreateLayout(mDevice);
+
+		mHiZPipeline = UniquePtr<VKIComputePipeline>(new VKIComputePipeline());
+		mHiZPipeline->SetShader(SHADERS_DIRECTORY "HiZBuild.spv");
+		mHiZPipeline->SetDescriptorLayout(mHiZLayout.get());
+		mHiZPipeline->SetPushConstant(0, 0, sizeof(HiZBuildConstant));
+		mHiZPipeline->CreatePipeline(mDevice);
+
+		// One set for each level, level 0 reads from the depth target.
+		mHiZSets.resize(mHiZLevels.size());
+
+		for (uint32_t i = 0; i < (uint32_t)mHiZLevels.size(); ++i)
+		{
+			VKIImageView* srcLevel = mHiZLevels[i == 0 ? 0 : i - 1].get();
+
+			mHiZSets[i] = UniquePtr<VKIDescriptorSet>(new VKIDescriptorSet());
+			mHiZSets[i]->SetLayout(mHiZLayout.get());
+			mHiZSets[i]->CreateDescriptorSet(mDevice, 1);
+
+			mHiZSets[i]->AddDescriptor(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT,
+				mDepth->view.get(), mDepth->sampler.get());
+
+			mHiZSets[i]->AddDescriptor(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT,
+				srcLevel, nullptr);
+
+			mHiZSets[i]->AddDescriptor(2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT,
+				mHiZLevels[i].get(), nullptr);
+
+			mHiZSets[i]->UpdateSets();
+		}
+	}
+
+
+	// Cull...
+	{
+		mCullLayout = UniquePtr<VKIDescriptorLayout>(new VKIDescriptorLayout());
+		mCullLayout->AddBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);
+		mCullLayout->AddBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);
+		mCullLayout->AddBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);
+		mCullLayout->AddBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);
+		mCullLayout->AddBinding(4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT);
+		mCullLayout->AddBinding(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);
+		mCullLayout->AddBinding(6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);
+		mCullLayout->AddBinding(7, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);
+		mCullLayout->CreateLayout(mDevice);
+
+		mCullPipeline = UniquePtr<VKIComputePipeline>(new VKIComputePipeline());
+		mCullPipeline->SetShader(SHADERS_DIRECTORY "OcclusionCull.spv");
+		mCullPipeline->SetDescriptorLayout(mCullLayout.get());
+		mCullPipeline->SetPushConstant(0, 0, sizeof(OcclusionCullConstant));
+		mCullPipeline->CreatePipeline(mDevice);
+
+		std::vector<VKIBuffer*> objects, draws, stats;
+		std::vector<VKIBuffer*> visibility(Renderer::NUM_CONCURRENT_FRAMES, mVisibility.get());
+		std::vector<VKIBuffer*> indirect(Renderer::NUM_CONCURRENT_FRAMES, mIndirect.get());
+		std::vector<VKIBuffer*> softwareVisibility(Renderer::NUM_CONCURRENT_FRAMES, mSoftwareVisibility.get());
+		std::vector<VKIBuffer*> instanceIndices(Renderer::NUM_CONCURRENT_FRAMES,
+			Application::Get().GetRenderer()->GetInstanceIndices());
+
+		for (uint32_t i = 0; i < Renderer::NUM_CONCURRENT_FRAMES; ++i)
+		{
+			objects.emplace_back(mObjects[i].get());
+			draws.emplace_back(mDraws[i].get());
+			stats.emplace_back(mStats[i].get());
+		}
+
+		mCullSet = UniquePtr<VKIDescriptorSet>(new VKIDescriptorSet());
+		mCullSet->SetLayout(mCullLayout.get());
+		mCullSet->CreateDescriptorSet(mDevice, Renderer::NUM_CONCURRENT_FRAMES);
+		mCullSet->AddDescriptor(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, objects);
+		mCullSet->AddDescriptor(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, visibility);
+		mCullSet->AddDescriptor(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, indirect);
+		mCullSet->AddDescriptor(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, stats);
+
+		mCullSet->AddDescriptor(4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT,
+			mHiZ.view.get(), mHiZ.sampler.get(), VK_IMAGE_LAYOUT_GENERAL, 1);
+
+		mCullSet->AddDescriptor(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, draws);
+		mCullSet->AddDescriptor(6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, instanceIndices);
+		mCullSet->AddDescriptor(7, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, softwareVisibility);
+
+		mCullSet->UpdateSets();
+	}
+}
+
+
+void RenderStageOcclusion::BeginFrame(uint32_t frame, RenderScene* rscene)
+{
+	mFrame = frame;
+	mScene = rscene;
+
+
+	// Read back the stats written the last time this frame was rendered, its fence is already signaled.
+	if (mHasStats[mFrame])
+	{
+		std::array<uint32_t, OCCLUSION_MAX_VIEWS * CULL_STATS_COUNT> stats;
+		mStats[mFrame]->ReadData(0, sizeof(uint32_t) * stats.size(), stats.data());
+
+		for (uint32_t i = 0; i < OCCLUSION_MAX_VIEWS; ++i)
+		{
+			const uint32_t* viewStats = stats.data() + i * CULL_STATS_COUNT;
+
+			// Capture views are only rendered when probes are updated, keep their last capture.
+			if (viewStats[0] + viewStats[1] + viewStats[2] == 0)
+				continue;
+
+			mViewStats[i].visible = viewStats[0];
+			mViewStats[i].occluded = viewStats[1];
+			mViewStats[i].frustumCulled = viewStats[2];
+			mViewStats[i].prePass = viewStats[3];
+		}
+	}
+
+
+	const std::vector<RDScenePrimitive*>& primitives = rscene->GetPrimitives();
+	mNumDraws = (uint32_t)primitives.size();
+	mNumObjects = rscene->GetNumInstances();
+	mIsEnabled = rscene->GetEnvironment().isOcclusionCulling
+		&& mNumObjects > 0 && mNumDraws <= OCCLUSION_MAX_OBJECTS;
+	mHasStats[mFrame] = mIsEnabled;
+
+	if (!mIsEnabled)
+		return;
+
+
+	// Draws & Instances Data...
+	OcclusionCullDraw* draws = reinterpret_cast<OcclusionCullDraw*>(mDrawsData.data());
+	OcclusionCullObject* objects = reinterpret_cast<OcclusionCullObject*>(mObjectsData.data());
+
+	for (const RDScenePrimitive* prim : primitives)
+	{
+		draws[prim->objectId].draw = glm::uvec4(prim->numIndices, prim->firstInstance, 0, 0);
+
+		for (uint32_t i = 0; i < prim->numInstances; ++i)
+		{
+			uint32_t index = prim->firstInstance + i;
+			const Box& bounds = prim->instancesBounds[i];
+
+			OcclusionCullObject& obj = objects[index];
+			obj.info = glm::uvec4(prim->objectId, index, prim->firstInstance, bounds.IsValid() ? 0 : CULL_FLAG_ALWAYS_VISIBLE);
+			obj.boundsMin = glm::vec4(bounds.GetMin(), 1.0f);
+			obj.boundsMax = glm::vec4(bounds.GetMax(), 1.0f);
+		}
+	}
+
+	mDraws[mFrame]->UpdateData(0, mNumDraws * sizeof(OcclusionCullDraw), mDrawsData.data());
+	mObjects[mFrame]->UpdateData(0, mNumObjects * sizeof(OcclusionCullObject), mObjectsData.data());
+}
+
+
+void RenderStageOcclusion::ResetStats(VKICommandBuffer* cmdBuffer)
+{
+	if (!mIsEnabled)
+		return;
+
+	vkCmdFillBuffer(cmdBuffer->GetCurrent(), mStats[mFrame]->Get(), 0, VK_WHOLE_SIZE, 0);
+
+	Barrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+}
+
+
+void RenderStageOcclusion::RenderDepthPrePass(VKICommandBuffer* cmdBuffer, uint32_t view, const glm::mat4& viewProj,
+	const glm::ivec4& viewport)
+{
+	CHECK(mIsEnabled && view < OCCLUSION_MAX_VIEWS);
+
+	// The previous view draws & depth pyramid reads must be done before we overwrite them.
+	Barrier(cmdBuffer,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT);
+
+	UpdateSoftwareVisibility(cmdBuffer);
+	DispatchCull(cmdBuffer, view, CULL_PHASE_PRE_PASS, viewProj);
+
+	Barrier(cmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+		VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT);
+
+
+	// Depth of objects visible last frame...
+	mDepthPass->Begin(cmdBuffer, mDepthFB.get(), viewport);
+	mScene->DrawSceneDepth(cmdBuffer, mFrame, viewProj, this);
+	mDepthPass->End(cmdBuffer);
+
+	BuildHiZ(cmdBuffer, viewport);
+}
+
+
+void RenderStageOcclusion::CullObjects(VKICommandBuffer* cmdBuffer, uint32_t view, const glm::mat4& viewProj)
+{
+	CHECK(mIsEnabled && view < OCCLUSION_MAX_VIEWS);
+
+	DispatchCull(cmdBuffer, view, CULL_PHASE_FINAL, viewProj);
+
+	Barrier(cmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+		VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_HOST_READ_BIT);
+}
+
+
+uint32_t RenderStageOcclusion::GetDrawOffset(uint32_t phase, uint32_t index) const
+{
+	return (phase * OCCLUSION_MAX_OBJECTS + index) * (uint32_t)sizeof(VkDrawIndexedIndirectCommand);
+}
+
+
+void RenderStageOcclusion::BuildHiZ(VKICommandBuffer* cmdBuffer, const glm::ivec4& viewport)
+{
+	mHiZPipeline->Bind(cmdBuffer);
+
+	glm::ivec2 srcSize(viewport.z, viewport.w);
+	glm::ivec2 dstSize = glm::max(srcSize / 2, glm::ivec2(1));
+	mViewHiZSize = dstSize;
+	mViewHiZLevels = 0;
+
+	for (uint32_t i = 0; i < (uint32_t)mHiZLevels.size(); ++i)
+	{
+		// Wait for the previous level.
+		if (i != 0)
+		{
+			Barrier(cmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+		}
+
+		HiZBuildConstant constant;
+		constant.size = glm::ivec4(srcSize, dstSize);
+		constant.params = glm::ivec4(viewport.x, viewport.y, (int32_t)i, 0);
+
+		mHiZSets[i]->Bind(cmdBuffer, 0, mHiZPipeline.get());
+
+		vkCmdPushConstants(cmdBuffer->GetCurrent(),
+			mHiZPipeline->GetLayout(),
+			VK_SHADER_STAGE_COMPUTE_BIT,
+			0, sizeof(HiZBuildConstant), &constant);
+
+		vkCmdDispatch(cmdBuffer->GetCurrent(),
+			(dstSize.x + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE,
+			(dstSize.y + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, 1);
+
+		++mViewHiZLevels;
+
+		// Reached the last level?
+		if (dstSize.x == 1 && dstSize.y == 1)
+			break;
+
+		srcSize = dstSize;
+		dstSize = glm::max(srcSize / 2, glm::ivec2(1));
+	}
+
+	Barrier(cmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+}
+
+
+void RenderStageOcclusion::DispatchCull(VKICommandBuffer* cmdBuffer, uint32_t view, uint32_t phase,
+	const glm::mat4& viewProj)
+{
+	uint32_t region = phase == CULL_PHASE_PRE_PASS ? INSTANCE_REGION_PRE_PASS : INSTANCE_REGION_FINAL;
+	bool isSoftware = mScene->GetEnvironment().isSoftwareOcclusion;
+
+	OcclusionCullConstant constant;
+	constant.viewProjMatrix = viewProj;
+	constant.hizSize = glm::vec4(mViewHiZSize, (float)mViewHiZLevels, 0.0f);
+	constant.params = glm::uvec4(mNumDraws, phase, CULL_MODE_RESET_DRAWS, isSoftware ? CULL_FLAG_SOFTWARE_VISIBILITY : 0);
+	constant.offsets = glm::uvec4(view * MAX_NUM_INSTANCES, phase * OCCLUSION_MAX_OBJECTS, view * CULL_STATS_COUNT,
+		region * MAX_NUM_INSTANCES);
+
+	mCullPipeline->Bind(cmdBuffer);
+	mCullSet->Bind(cmdBuffer, mFrame, mCullPipeline.get());
+
+	// Reset the draw commands of the phase to zero instances...
+	vkCmdPushConstants(cmdBuffer->GetCurrent(),
+		mCullPipeline->GetLayout(),
+		VK_SHADER_STAGE_COMPUTE_BIT,
+		0, sizeof(OcclusionCullConstant), &constant);
+
+	vkCmdDispatch(cmdBuffer->GetCurrent(), (mNumDraws + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+	Barrier(cmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+	// Cull the instances, the visible ones are added to their draw command.
+	constant.params.x = mNumObjects;
+	constant.params.z = CULL_MODE_INSTANCES;
+
+	vkCmdPushConstants(cmdBuffer->GetCurrent(),
+		mCullPipeline->GetLayout(),
+		VK_SHADER_STAGE_COMPUTE_BIT,
+		0, sizeof(OcclusionCullConstant), &constant);
+
+	vkCmdDispatch(cmdBuffer->GetCurrent(), (mNumObjects + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+}
+
+
+void RenderStageOcclusion::UpdateSoftwareVisibility(VKICommandBuffer* cmdBuffer)
+{
+	if (!mScene->GetEnvironment().isSoftwareOcclusion)
+		return;
+
+	const std::vector<uint32_t>& visibility = mScene->GetSoftwareVisibility();
+	uint32_t size = (mNumObjects + 31) / 32 * (uint32_t)sizeof(uint32_t);
+	mSoftwareVisibility->CmdUpdate(cmdBuffer, 0, size, visibility.data());
+
+	Barrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+}
+
+
+void RenderStageOcclusion::Barrier(VKICommandBuffer* cmdBuffer, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess,
+	VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = srcAccess;
+	barrier.dstAccessMask = dstAccess;
+
+	vkCmdPipelineBarrier(cmdBuffer->GetCurrent(),
+		srcStage, dstStage,
+		0,
+		1, &barrier,
+		0, nullptr,
+		0, nullptr);
+}
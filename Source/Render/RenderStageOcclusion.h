@@ -0,0 +1,225 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#pragma once
+
+
+
+#include "Core/Core.h"
+#include "RenderData/RenderTypes.h"
+#include "vulkan/vulkan.h"
+#include "glm/vec4.hpp"
+#include "glm/matrix.hpp"
+
+
+#include <vector>
+#include <array>
+
+
+
+class RenderScene;
+
+
+class VKIDevice;
+class VKIBuffer;
+class VKIImageView;
+class VKIRenderPass;
+class VKIFramebuffer;
+class VKICommandBuffer;
+class VKIComputePipeline;
+class VKIDescriptorLayout;
+class VKIDescriptorSet;
+
+
+
+
+
+
+// Occlusion culling statistics of a single view, counted in instances.
+struct OcclusionViewStats
+{
+	// Number of instances drawn by the view.
+	uint32_t visible;
+
+	// Number of instances inside the view frustum that were occluded.
+	uint32_t occluded;
+
+	// Number of instances outside the view frustum.
+	uint32_t frustumCulled;
+
+	// Number of instances drawn in the depth pre-pass, the instances visible last frame.
+	uint32_t prePass;
+};
+
+
+
+
+
+// RenderStageOcclusion:
+//    - a stage that is part of the pipeline for Hi-Z occlusion culling.
+//    - every instance is culled with its own bounds, the visible instances of a draw are compacted into the
+//      phase region of the instance indices & counted in the instance count of its indirect draw command.
+//    - phase 0 draws the instances visible last frame into the depth target, then build the depth pyramid from it.
+//    - phase 1 test all instances bounds against the depth pyramid and write the final indirect draw commands.
+//
+class RenderStageOcclusion
+{
+public:
+	// Construct.
+	RenderStageOcclusion();
+
+	// Destruct.
+	~RenderStageOcclusion();
+
+	// Initialize the stage.
+	void Initialize(VKIDevice* device, StageRenderTarget* depthTarget, VKIRenderPass* depthPass, const glm::ivec2& size);
+
+	// Destroy the stage.
+	void Destroy();
+
+	// Begin new frame, read back the last stats of this frame and upload the scene draws & instances.
+	void BeginFrame(uint32_t frame, RenderScene* rscene);
+
+	// Reset the stats counters of the current frame.
+	void ResetStats(VKICommandBuffer* cmdBuffer);
+
+	// Phase 0, render the objects visible last frame into the depth target and build the depth pyramid.
+	void RenderDepthPrePass(VKICommandBuffer* cmdBuffer, uint32_t view, const glm::mat4& viewProj, const glm::ivec4& viewport);
+
+	// Phase 1, test all instances against the depth pyramid and write the final draw commands.
+	void CullObjects(VKICommandBuffer* cmdBuffer, uint32_t view, const glm::mat4& viewProj);
+
+	// Return true if culling is enabled for the current frame.
+	inline bool IsEnabled() const { return mIsEnabled; }
+
+	// Return the buffer of the indirect draw commands.
+	inline VKIBuffer* GetIndirectBuffer() const { return mIndirect.get(); }
+
+	// Return the offset of a draw command in the indirect buffer, index is the primitive object id.
+	uint32_t GetDrawOffset(uint32_t phase, uint32_t index) const;
+
+	// Return the last stats read back for a view.
+	inline const OcclusionViewStats& GetViewStats(uint32_t view) const { return mViewStats[view]; }
+
+private:
+	// Setup the depth pyramid image and its views.
+	void SetupHiZ();
+
+	// Setup the buffers used for culling.
+	void SetupBuffers();
+
+	// Setup the compute pipelines and their descriptors.
+	void SetupPipelines();
+
+	// Build the depth pyramid from the depth target.
+	void BuildHiZ(VKICommandBuffer* cmdBuffer, const glm::ivec4& viewport);
+
+	// Dispatch the cull compute for a phase, reset the phase draw commands then cull & compact the instances.
+	void DispatchCull(VKICommandBuffer* cmdBuffer, uint32_t view, uint32_t phase, const glm::mat4& viewProj);
+
+	// Upload the software occlusion visibility of the current view.
+	void UpdateSoftwareVisibility(VKICommandBuffer* cmdBuffer);
+
+	// Insert a global memory barrier.
+	void Barrier(VKICommandBuffer* cmdBuffer, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess,
+		VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+
+private:
+	// The Vulkan Device.
+	VKIDevice* mDevice;
+
+	// The pipeline depth target.
+	StageRenderTarget* mDepth;
+
+	// The depth only pass used for the pre-pass.
+	VKIRenderPass* mDepthPass;
+
+	// Framebuffer for the depth pre-pass.
+	UniquePtr<VKIFramebuffer> mDepthFB;
+
+	// The pipeline targets size.
+	glm::ivec2 mSize;
+
+	// The depth pyramid.
+	StageRenderTarget mHiZ;
+
+	// The depth pyramid level 0 size.
+	glm::ivec2 mHiZSize;
+
+	// The depth pyramid level 0 size & number of levels built for the current view.
+	glm::ivec2 mViewHiZSize;
+	uint32_t mViewHiZLevels;
+
+	// Views for each level in the depth pyramid.
+	std::vector< UniquePtr<VKIImageView> > mHiZLevels;
+
+	// Pipeline, Layout & Sets for building the depth pyramid, one set per level.
+	UniquePtr<VKIComputePipeline> mHiZPipeline;
+	UniquePtr<VKIDescriptorLayout> mHiZLayout;
+	std::vector< UniquePtr<VKIDescriptorSet> > mHiZSets;
+
+	// Pipeline, Layout & Set for culling.
+	UniquePtr<VKIComputePipeline> mCullPipeline;
+	UniquePtr<VKIDescriptorLayout> mCullLayout;
+	UniquePtr<VKIDescriptorSet> mCullSet;
+
+	// Instances bounds & draw data, one for each concurrent frame.
+	std::vector< UniquePtr<VKIBuffer> > mObjects;
+
+	// Draws index count & instances range, one for each concurrent frame.
+	std::vector< UniquePtr<VKIBuffer> > mDraws;
+
+	// Per-View instances visibility from the last frame.
+	UniquePtr<VKIBuffer> mVisibility;
+
+	// Software occlusion culling visibility of the current view, a bit for each instance.
+	UniquePtr<VKIBuffer> mSoftwareVisibility;
+
+	// Indirect draw commands for both phases.
+	UniquePtr<VKIBuffer> mIndirect;
+
+	// Per-View stats counters, one for each concurrent frame.
+	std::vector< UniquePtr<VKIBuffer> > mStats;
+
+	// True if the stats buffer of a frame was written by its last submission.
+	std::vector<bool> mHasStats;
+
+	// The last stats read back for each view.
+	std::array<OcclusionViewStats, OCCLUSION_MAX_VIEWS> mViewStats;
+
+	// Instances & draws data to upload.
+	std::vector<uint8_t> mObjectsData;
+	std::vector<uint8_t> mDrawsData;
+
+	// Number of instances & draws in the current frame.
+	uint32_t mNumObjects;
+	uint32_t mNumDraws;
+
+	// The index of the concurrent frame we are currently rendering.
+	uint32_t mFrame;
+
+	// The scene we are currently rendering.
+	RenderScene* mScene;
+
+	// Culling is enabled for the current frame.
+	bool mIsEnabled;
+};
@@ -0,0 +1,420 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+
+
+
+#include "RenderTextureStreamer.h"
+#include "Core/Mesh.h"
+#include "Core/Frustum.h"
+#include "Render/RenderData/RenderTypes.h"
+#include "Render/RenderData/RenderScene.h"
+#include "Render/RenderData/RenderSnapshot.h"
+#include "Render/RenderData/RenderLight.h"
+#include "Render/RenderData/RenderImage.h"
+#include "Render/RenderData/Shaders/RenderMaterial.h"
+
+
+#include "glm/common.hpp"
+#include "glm/geometric.hpp"
+#include "glm/mat4x4.hpp"
+
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cfloat>
+
+
+
+
+// Return the current time in milliseconds.
+static double GetTimeMS()
+{
+	using namespace std::chrono;
+	return duration<double, std::milli>(high_resolution_clock::now().time_since_epoch()).count();
+}
+
+
+// Return the first mip of a mip chain with a size that fits in maxSize.
+static uint32_t RTSGetMipForSize(const glm::ivec2& size, uint32_t numMips, int32_t maxSize)
+{
+	uint32_t mip = 0;
+
+	while (mip + 1 < numMips && glm::max(size.x >> mip, size.y >> mip) > maxSize)
+		++mip;
+
+	return mip;
+}
+
+
+// Return the distance from a point to a box, zero if it is inside.
+static float RTSDistance(const glm::vec3& p, const Box& box)
+{
+	glm::vec3 d = glm::max(glm::max(box.GetMin() - p, p - box.GetMax()), glm::vec3(0.0f));
+	return glm::length(d);
+}
+
+
+// Return the distance between two boxes, zero if they overlap.
+static float RTSDistance(const Box& a, const Box& b)
+{
+	glm::vec3 d = glm::max(glm::max(a.GetMin() - b.GetMax(), b.GetMin() - a.GetMax()), glm::vec3(0.0f));
+	return glm::length(d);
+}
+
+
+// Return the texture coordinates per world unit of a primitive instance surface.
+static float RTSGetUVDensity(const RDScenePrimitive* prim, uint32_t instance, const Box& bounds)
+{
+	float density = prim->mesh ? prim->mesh->GetUVDensity() : 0.0f;
+
+	if (density > 0.0f)
+	{
+		const glm::mat4& mtx = prim->instances[instance];
+		float scale = (glm::length(glm::vec3(mtx[0])) + glm::length(glm::vec3(mtx[1])) + glm::length(glm::vec3(mtx[2]))) / 3.0f;
+
+		if (scale > 0.0f)
+			return density / scale;
+	}
+
+	// Unknown, assume the texture coordinates span the bounds once.
+	glm::vec3 extent = bounds.Extent();
+	return 0.5f / glm::max(glm::max(extent.x, extent.y), glm::max(extent.z, 0.001f));
+}
+
+
+
+
+
+
+// --- -- - -- --- --- -- - -- --- --- -- - -- --- --- -- - -- --- --- -- - -- --- ---
+
+
+
+
+RenderTextureStreamer::RenderTextureStreamer()
+	: mBudget((uint64_t)RENDER_TEXTURE_STREAMER_BUDGET_MB * 1024 * 1024)
+	, mFrame(0)
+{
+	mStats = RenderTextureStreamerStats{};
+	mStats.budget = mBudget;
+}
+
+
+RenderTextureStreamer::~RenderTextureStreamer()
+{
+	CHECK(mImages.empty() && "Streamed images should be destroyed before the streamer.");
+}
+
+
+void RenderTextureStreamer::AddImage(RenderImage* image)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	image->mStreamSlot = (uint32_t)mImages.size();
+	mImages.push_back(image);
+	mFrameMips.push_back(UINT32_MAX);
+	mRequiredMips.push_back(image->GetFirstMip());
+	mLastUsed.push_back(mFrame);
+	mTargetMips.push_back(image->GetFirstMip());
+}
+
+
+void RenderTextureStreamer::RemoveImage(RenderImage* image)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	uint32_t slot = image->mStreamSlot;
+	uint32_t last = (uint32_t)mImages.size() - 1;
+	CHECK(mImages[slot] == image);
+
+	// Move the last image into the removed slot.
+	mImages[slot] = mImages[last];
+	mFrameMips[slot] = mFrameMips[last];
+	mRequiredMips[slot] = mRequiredMips[last];
+	mLastUsed[slot] = mLastUsed[last];
+	mTargetMips[slot] = mTargetMips[last];
+	mImages[slot]->mStreamSlot = slot;
+
+	mImages.pop_back();
+	mFrameMips.pop_back();
+	mRequiredMips.pop_back();
+	mLastUsed.pop_back();
+	mTargetMips.pop_back();
+}
+
+
+void RenderTextureStreamer::SetBudget(uint64_t budget)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mBudget = budget;
+}
+
+
+uint32_t RenderTextureStreamer::GetInitialMip(const glm::ivec2& size, uint32_t numMips)
+{
+	return RTSGetMipForSize(size, numMips, RENDER_TEXTURE_STREAMER_INITIAL_SIZE);
+}
+
+
+void RenderTextureStreamer::Update(const RenderScene* scene, const RDFrameSnapshot* snapshot, uint32_t screenHeight)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	double startTime = GetTimeMS();
+	++mFrame;
+
+	// Replace the images with the streamed ones that finished uploading.
+	for (RenderImage* image : mImages)
+	{
+		uint32_t prevMip = image->GetFirstMip();
+
+		if (!image->UpdateStreaming())
+			continue;
+
+		if (image->GetFirstMip() < prevMip)
+			++mStats.numStreamedIn;
+		else
+			++mStats.numEvicted;
+	}
+
+	// Required mips, unused images keep theirs for a while before falling back to the initial mips.
+	ComputeRequiredMips(scene, snapshot, screenHeight);
+
+	for (size_t i = 0; i < mImages.size(); ++i)
+	{
+		if (mFrameMips[i] != UINT32_MAX)
+		{
+			mRequiredMips[i] = mFrameMips[i];
+			mLastUsed[i] = mFrame;
+		}
+		else if (mFrame - mLastUsed[i] > RENDER_TEXTURE_STREAMER_KEEP_FRAMES)
+		{
+			mRequiredMips[i] = GetInitialMip(mImages[i]->GetSize(), mImages[i]->GetNumMips());
+		}
+	}
+
+	ComputeTargetMips();
+
+	// Stats...
+	mStats.numImages = (uint32_t)mImages.size();
+	mStats.numPending = 0;
+	mStats.numResident = 0;
+	mStats.numOverBudget = 0;
+	mStats.residentBytes = 0;
+	mStats.pendingBytes = 0;
+	mStats.requiredBytes = 0;
+	mStats.budget = mBudget;
+
+	for (size_t i = 0; i < mImages.size(); ++i)
+	{
+		const RenderImage* image = mImages[i];
+		mStats.residentBytes += image->GetMipChainBytes(image->GetFirstMip());
+		mStats.requiredBytes += image->GetMipChainBytes(mRequiredMips[i]);
+		mStats.numResident += image->GetFirstMip() <= mRequiredMips[i];
+		mStats.numOverBudget += mTargetMips[i] > mRequiredMips[i];
+	}
+
+	RequestMips();
+
+	for (const RenderImage* image : mImages)
+	{
+		if (!image->IsStreaming())
+			continue;
+
+		mStats.pendingBytes += image->GetMipChainBytes(image->GetPendingMip());
+		++mStats.numPending;
+	}
+
+	mStats.updateTime = (float)(GetTimeMS() - startTime);
+}
+
+
+void RenderTextureStreamer::ComputeRequiredMips(const RenderScene* scene, const RDFrameSnapshot* snapshot, uint32_t screenHeight)
+{
+	std::fill(mFrameMips.begin(), mFrameMips.end(), UINT32_MAX);
+
+	if (mImages.empty())
+		return;
+
+	Frustum frustum = Frustum::FromVPMatrix(scene->GetViewProj());
+	const glm::vec3& viewPos = scene->GetViewPos();
+
+	// Pixels per world unit at a distance of one unit from the view & from a probe capturing 90 degree faces.
+	float viewPixels = (float)screenHeight * glm::abs(snapshot->proj[1][1]) * 0.5f;
+	float probePixels = (float)LIGHT_PROBES_TARGET_SIZE * 0.5f;
+
+	const std::vector<RenderLightProbe*>& lightProbes = scene->GetLightProbes();
+	const std::vector<RenderIrradianceVolume*>& volumes = scene->GetIrradianceVolumes();
+	bool hasDirtyProbes = scene->HasDirtyLightProbes();
+	bool hasDirtyVolumes = scene->HasDirtyIrradianceVolume();
+
+	for (const RDScenePrimitive* prim : scene->GetPrimitives())
+	{
+		if (!prim->materail)
+			continue;
+
+		RenderImage* color = prim->materail->GetTexture(0);
+		RenderImage* roughnessMetallic = prim->materail->GetTexture(1);
+
+		if (!color->IsStreamed() && !roughnessMetallic->IsStreamed())
+			continue;
+
+		float uvPerPixel = FLT_MAX;
+
+		// Each instance has its own distance & scale, the primitive textures need the finest of them.
+		for (uint32_t iInst = 0; iInst < (uint32_t)prim->instances.size(); ++iInst)
+		{
+			const Box& bounds = prim->instancesBounds[iInst];
+
+			if (!bounds.IsValid())
+				continue;
+
+			float uvDensity = RTSGetUVDensity(prim, iInst, bounds);
+
+			// Visible by the view?
+			if (frustum.IsInFrustum2D(bounds.Center(), glm::length(bounds.Extent())))
+			{
+				uvPerPixel = glm::min(uvPerPixel, uvDensity * RTSDistance(viewPos, bounds) / viewPixels);
+			}
+
+			// Captured by light probes?
+			for (size_t i = 0; hasDirtyProbes && i < lightProbes.size(); ++i)
+			{
+				if (!lightProbes[i]->GetDirty())
+					continue;
+
+				float distance = RTSDistance(lightProbes[i]->GetPosition(), bounds);
+
+				if (distance <= lightProbes[i]->GetRadius())
+					uvPerPixel = glm::min(uvPerPixel, uvDensity * distance / probePixels);
+			}
+
+			// Captured by irradiance volumes probes?
+			for (size_t i = 0; hasDirtyVolumes && i < volumes.size(); ++i)
+			{
+				if (!volumes[i]->GetDirty())
+					continue;
+
+				Box volume(volumes[i]->GetVolumeStart(), volumes[i]->GetVolumeStart() + volumes[i]->GetVolumeExtent());
+				uvPerPixel = glm::min(uvPerPixel, uvDensity * RTSDistance(volume, bounds) / probePixels);
+			}
+		}
+
+		if (uvPerPixel == FLT_MAX)
+			continue;
+
+		RequireMip(color, uvPerPixel);
+		RequireMip(roughnessMetallic, uvPerPixel);
+	}
+}
+
+
+void RenderTextureStreamer::RequireMip(RenderImage* image, float uvPerPixel)
+{
+	if (!image->IsStreamed())
+		return;
+
+	// The mip sampled at about one texel per pixel.
+	float texelsPerPixel = (float)glm::max(image->GetSize().x, image->GetSize().y) * uvPerPixel;
+	uint32_t mip = 0;
+
+	if (texelsPerPixel > 1.0f)
+		mip = glm::min((uint32_t)floorf(log2f(texelsPerPixel)), image->GetNumMips() - 1);
+
+	uint32_t& frameMip = mFrameMips[image->mStreamSlot];
+	frameMip = glm::min(frameMip, mip);
+}
+
+
+void RenderTextureStreamer::ComputeTargetMips()
+{
+	uint64_t requiredBytes = 0;
+	int32_t maxSize = 1;
+
+	for (size_t i = 0; i < mImages.size(); ++i)
+	{
+		mTargetMips[i] = mRequiredMips[i];
+		requiredBytes += mImages[i]->GetMipChainBytes(mRequiredMips[i]);
+		maxSize = glm::max(maxSize, glm::max(mImages[i]->GetSize().x, mImages[i]->GetSize().y));
+	}
+
+	if (requiredBytes <= mBudget)
+		return;
+
+	// Limit all the images to the same max size, the largest one that fits in the budget.
+	for (int32_t size = maxSize / 2; size >= 1; size /= 2)
+	{
+		uint64_t bytes = 0;
+
+		for (size_t i = 0; i < mImages.size(); ++i)
+		{
+			const RenderImage* image = mImages[i];
+			mTargetMips[i] = glm::max(mRequiredMips[i], RTSGetMipForSize(image->GetSize(), image->GetNumMips(), size));
+			bytes += image->GetMipChainBytes(mTargetMips[i]);
+		}
+
+		if (bytes <= mBudget)
+			break;
+	}
+}
+
+
+void RenderTextureStreamer::RequestMips()
+{
+	uint32_t numRequests = 0;
+	bool isOverBudget = mStats.residentBytes > mBudget;
+
+	// Evict first to free memory for the mips streamed in, images with one extra mip keep it unless
+	// we are over budget to avoid streaming the same mip in & out.
+	for (size_t i = 0; i < mImages.size() && numRequests < RENDER_TEXTURE_STREAMER_MAX_REQUESTS; ++i)
+	{
+		RenderImage* image = mImages[i];
+
+		if (image->IsStreaming() || mTargetMips[i] <= image->GetFirstMip())
+			continue;
+
+		if (isOverBudget || mTargetMips[i] > image->GetFirstMip() + 1)
+		{
+			image->StreamMips(mTargetMips[i]);
+			++numRequests;
+		}
+	}
+
+	// Stream in, the images missing the most mips first.
+	mCandidates.clear();
+
+	for (size_t i = 0; i < mImages.size(); ++i)
+	{
+		if (!mImages[i]->IsStreaming() && mTargetMips[i] < mImages[i]->GetFirstMip())
+			mCandidates.push_back((uint32_t)i);
+	}
+
+	std::sort(mCandidates.begin(), mCandidates.end(), [this](uint32_t a, uint32_t b)
+		{
+			return mImages[a]->GetFirstMip() - mTargetMips[a] > mImages[b]->GetFirstMip() - mTargetMips[b];
+		});
+
+	for (size_t i = 0; i < mCandidates.size() && numRequests < RENDER_TEXTURE_STREAMER_MAX_REQUESTS; ++i)
+	{
+		mImages[mCandidates[i]]->StreamMips(mTargetMips[mCandidates[i]]);
+		++numRequests;
+	}
+}
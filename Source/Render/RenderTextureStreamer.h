@@ -0,0 +1,169 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+
+#pragma once
+
+
+
+
+#include "Core/Core.h"
+#include "glm/vec2.hpp"
+
+
+#include <vector>
+#include <mutex>
+
+
+
+
+class RenderImage;
+class RenderScene;
+struct RDFrameSnapshot;
+
+
+
+
+// The default video memory budget of the streamed textures in MB.
+#define RENDER_TEXTURE_STREAMER_BUDGET_MB 128
+
+// The largest size of the mips uploaded when a streamed texture is created.
+#define RENDER_TEXTURE_STREAMER_INITIAL_SIZE 64
+
+// The max number of images streamed in or evicted each frame.
+#define RENDER_TEXTURE_STREAMER_MAX_REQUESTS 4
+
+// The number of frames an unused texture keeps its required mips before they can be evicted.
+#define RENDER_TEXTURE_STREAMER_KEEP_FRAMES 120
+
+
+
+
+
+// Texture streamer stats.
+struct RenderTextureStreamerStats
+{
+	// The number of streamed images & the ones waiting for their upload.
+	uint32_t numImages;
+	uint32_t numPending;
+
+	// The number of images with all their required mips resident.
+	uint32_t numResident;
+
+	// The number of images limited to lower mips than they require to fit in the budget.
+	uint32_t numOverBudget;
+
+	// The size in bytes of the resident mips, of the ones being uploaded & of all the required mips.
+	uint64_t residentBytes;
+	uint64_t pendingBytes;
+	uint64_t requiredBytes;
+
+	// The budget in bytes.
+	uint64_t budget;
+
+	// The number of images that got higher mips streamed in & the ones that got their mips evicted.
+	uint64_t numStreamedIn;
+	uint64_t numEvicted;
+
+	// The CPU time of the last update in milliseconds.
+	float updateTime;
+};
+
+
+
+
+// RenderTextureStreamer:
+//    - Stream the mips of images with a precomputed mip chain to keep their video memory under a budget.
+//    - The mip each image requires is estimated every frame from the screen space texture coordinates density
+//      of the visible primitives using it, and from the dirty light probes & irradiance volumes capturing them.
+//    - Higher mips are streamed in by the most needed first, when the required mips don't fit in the budget
+//      all the images are limited to the same max resolution & the mips above it are evicted.
+//
+class RenderTextureStreamer
+{
+public:
+	// Construct.
+	RenderTextureStreamer();
+
+	// Destruct.
+	~RenderTextureStreamer();
+
+	// Add/Remove a streamed image, called by the main thread while the render thread may be updating.
+	void AddImage(RenderImage* image);
+	void RemoveImage(RenderImage* image);
+
+	// Update the streamed images for the render scene of a frame, called after the render scene is built.
+	// @param screenHeight: the height of the viewport the scene is rendered to.
+	void Update(const RenderScene* scene, const RDFrameSnapshot* snapshot, uint32_t screenHeight);
+
+	// Set the video memory budget in bytes, called by the main thread while the render thread may be updating.
+	void SetBudget(uint64_t budget);
+
+	// Return the stats of the last update, only valid on the thread updating the streamer.
+	inline const RenderTextureStreamerStats& GetStats() const { return mStats; }
+
+public:
+	// Return the first mip uploaded when a streamed image is created.
+	static uint32_t GetInitialMip(const glm::ivec2& size, uint32_t numMips);
+
+private:
+	// Estimate the mip each image requires from its uses by the scene.
+	void ComputeRequiredMips(const RenderScene* scene, const RDFrameSnapshot* snapshot, uint32_t screenHeight);
+
+	// Lower the mip the image requires this frame for a use with a density of texture coordinates per pixel.
+	void RequireMip(RenderImage* image, float uvPerPixel);
+
+	// Compute the mips streamed for each image to fit the required mips in the budget.
+	void ComputeTargetMips();
+
+	// Stream the images toward their target mips.
+	void RequestMips();
+
+private:
+	// The streamed images.
+	std::vector<RenderImage*> mImages;
+
+	// The mip each image required by its uses this frame, UINT32_MAX if it isn't used.
+	std::vector<uint32_t> mFrameMips;
+
+	// The mip each image requires & the frame it was last used.
+	std::vector<uint32_t> mRequiredMips;
+	std::vector<uint64_t> mLastUsed;
+
+	// The mip streamed for each image to fit in the budget.
+	std::vector<uint32_t> mTargetMips;
+
+	// The images to stream in this frame.
+	std::vector<uint32_t> mCandidates;
+
+	// The video memory budget in bytes.
+	uint64_t mBudget;
+
+	// The number of updates.
+	uint64_t mFrame;
+
+	// The stats of the last update.
+	RenderTextureStreamerStats mStats;
+
+	// Lock the streamed images, added & removed by the main thread & updated by the render thread.
+	std::mutex mMutex;
+};
@@ -22,14 +22,22 @@
 
 
 #include "Renderer.h"
+#include "RendererStats.h"
 #include "Application.h"
 #include "Core/GISystem.h"
 #include "Core/Image2D.h"
 
 #include "RendererPipeline.h"
+#include "RenderTextureStreamer.h"
+#include "RenderStageOcclusion.h"
+#include "RenderGraph.h"
+#include "RenderPassCache.h"
+#include "Core/OcclusionRasterizer.h"
 #include "RenderData/RenderScene.h"
+#include "RenderData/RenderSnapshot.h"
 #include "RenderData/Shaders/RenderShader.h"
 #include "RenderData/Shaders/RenderUniform.h"
+#include "RenderData/Shaders/RenderFrameAllocator.h"
 #include "RenderData/Shaders/RenderShaderBlocks.h"
 #include "RenderData/Shaders/RenderMaterial.h"
 #include "RenderData/Primitives/RenderSphere.h"
@@ -38,6 +46,9 @@
 
 #include "VKInterface/VKIInstance.h"
 #include "VKInterface/VKIDevice.h"
+#include "VKInterface/VKIUploadManager.h"
+#include "VKInterface/VKIMipGenerator.h"
+#include "VKInterface/VKIDeletionQueue.h"
 #include "VKInterface/VKISwapChain.h"
 #include "VKInterface/VKISync.h"
 #include "VKInterface/VKICommandBuffer.h"
@@ -49,11 +60,44 @@
 
 
 
+#include "glm/common.hpp"
 #include <array>
+#include <chrono>
+#include <thread>
 
 
 
-const uint32_t Renderer::NUM_CONCURRENT_FRAMES = 2;
+const uint32_t Renderer::NUM_CONCURRENT_FRAMES = 3;
+const uint32_t Renderer::NUM_FRAME_SNAPSHOTS = 2;
+
+
+// The size of the frame allocator region of each concurrent frame.
+#define FRAME_ALLOCATOR_SIZE (4 * 1024 * 1024)
+
+// The main view common block is the first allocation of a frame, it must fit with the largest offset alignment.
+static_assert(FRAME_ALLOCATOR_SIZE >= sizeof(GUniform::CommonBlock) + 256, "Frame allocator too small for the common block.");
+
+
+
+
+// Return the current time in milliseconds.
+static double GetTimeMS()
+{
+	using namespace std::chrono;
+	return duration<double, std::milli>(high_resolution_clock::now().time_since_epoch()).count();
+}
+
+
+// Return the vulkan present mode of a renderer present mode.
+static VkPresentModeKHR ToVKPresentMode(ERenderPresentMode mode)
+{
+	switch (mode)
+	{
+	case ERenderPresentMode::Mailbox: return VK_PRESENT_MODE_MAILBOX_KHR;
+	case ERenderPresentMode::Immediate: return VK_PRESENT_MODE_IMMEDIATE_KHR;
+	default: return VK_PRESENT_MODE_FIFO_KHR;
+	}
+}
 
 
 
@@ -63,8 +107,29 @@ const uint32_t Renderer::NUM_CONCURRENT_FRAMES = 2;
 Renderer::Renderer()
 	: mCurrentFrame(1)
 	, mIsRendering(false)
+	, mFrameStartTime(0.0)
+	, mInputTime(0.0)
+	, mSnapshot(nullptr)
+	, mIsRenderThreadExit(false)
+	, mNumPendingFrames(0)
+	, mComputeWait(nullptr)
 {
-
+	mFrameSettings.framesInFlight = 2;
+	mFrameSettings.presentMode = ERenderPresentMode::Mailbox;
+	mFrameSettings.maxFrameRate = 0.0f;
+	mFrameSettings.isLowLatency = false;
+	mFrameSettings.isRenderThread = true;
+	mFrameSettings.isAsyncCompute = true;
+	mFrameSettings.isCachePasses = true;
+	mFrameSettings.isComputeMips = true;
+	mFrameSettings.isKaiserMips = false;
+	mFrameSettings.isSRGBCorrectMips = true;
+	mFrameSettings.isDynamicResolution = true;
+	mFrameSettings.targetGPUTime = 12.0f;
+	mFrameSettings.renderScale = 1.0f;
+	mFrameStats = RendererFrameStats{};
+	mRenderFrameStats = RendererFrameStats{};
+	mStats = UniquePtr<RendererStats>(new RendererStats());
 }
 
 
@@ -100,6 +165,27 @@ void Renderer::Initialize()
 	// Create Vulkan Sync Objects.
 	CreateVKSync();
 
+	// Per-Frame Allocator.
+	mFrameAllocator = UniquePtr<RenderFrameAllocator>(new RenderFrameAllocator());
+	mFrameAllocator->Create(this, FRAME_ALLOCATOR_SIZE);
+
+	// Instance Indices, the all instances region never changes.
+	{
+		mInstanceIndices = UniquePtr<VKIBuffer>(new VKIBuffer());
+		mInstanceIndices->SetSize(INSTANCE_NUM_REGIONS * MAX_NUM_INSTANCES * sizeof(uint32_t));
+		mInstanceIndices->SetUsage(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+		mInstanceIndices->SetMemoryProperties(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		mInstanceIndices->CreateBuffer(mVKData.device.get());
+
+		std::vector<uint32_t> indices(MAX_NUM_INSTANCES);
+
+		for (uint32_t i = 0; i < MAX_NUM_INSTANCES; ++i)
+			indices[i] = i;
+
+		mInstanceIndices->UpdateDataStaging(INSTANCE_REGION_ALL * MAX_NUM_INSTANCES * sizeof(uint32_t),
+			MAX_NUM_INSTANCES * sizeof(uint32_t), indices.data());
+	}
+
 	// The Renderer Sphere.
 	mRSphere = UniquePtr<RenderSphere>(new RenderSphere());
 	mRSphere->UpdateData(32);
@@ -112,10 +198,20 @@ void Renderer::Initialize()
 	mRScene = UniquePtr<RenderScene>(new RenderScene());
 	mRScene->Initialize();
 
+	// Texture Streamer.
+	mTextureStreamer = UniquePtr<RenderTextureStreamer>(new RenderTextureStreamer());
+
 	// Render Scene.
 	mRenderUI = UniquePtr<RenderImGUI>(new RenderImGUI());
 	mRenderUI->Initialize(this, appWnd);
 
+	// Frame Snapshots, all of them are free.
+	for (uint32_t i = 0; i < NUM_FRAME_SNAPSHOTS; ++i)
+	{
+		mSnapshots.emplace_back(new RDFrameSnapshot());
+		mFreeQueue.Push(mSnapshots.back().get());
+	}
+
 
 
 	// Material...
@@ -139,6 +235,14 @@ void Renderer::LoadDefaultImages()
 
 void Renderer::Destroy()
 {
+	// Render thread done with all frames.
+	StopRenderThread();
+
+	for (auto& snapshot : mSnapshots)
+		snapshot->Reset();
+
+	mSnapshots.clear();
+
 	//
 	mRSphere.reset();
 	mDefaultImages[0].reset();
@@ -153,15 +257,25 @@ void Renderer::Destroy()
 	// Destroy the scene Render Data.
 	mRScene->Destroy();
 
+	// The streamed images are destroyed with their scenes.
+	mTextureStreamer.reset();
+
 	// Destroy the Renderer Pipeline Data.
 	mPipeline->Destroy();
 
+	// Destroy the Frame Allocator.
+	mFrameAllocator->Destroy();
+	mInstanceIndices->Destroy();
+
 	// Destroy Sync Objects.
 	for (size_t i = 0; i < mVKData.frameSync.size(); ++i)
 	{
 		mVKData.frameSync[i].smImage->Destroy();
 		mVKData.frameSync[i].smRender->Destroy();
 		mVKData.frameSync[i].fnFrame->Destroy();
+		mVKData.frameSync[i].smGraphics->Destroy();
+		mVKData.frameSync[i].smCompute->Destroy();
+		mVKData.frameSync[i].fnCompute->Destroy();
 	}
 
 
@@ -192,6 +306,15 @@ void Renderer::CreateVKSync()
 
 		frameSync[i].fnFrame = UniquePtr<VKIFence>(new VKIFence());
 		frameSync[i].fnFrame->CreateFence(mVKData.device.get(), true);
+
+		frameSync[i].smGraphics = UniquePtr<VKISemaphore>(new VKISemaphore());
+		frameSync[i].smGraphics->CreateSemaphore(mVKData.device.get());
+
+		frameSync[i].smCompute = UniquePtr<VKISemaphore>(new VKISemaphore());
+		frameSync[i].smCompute->CreateSemaphore(mVKData.device.get());
+
+		frameSync[i].fnCompute = UniquePtr<VKIFence>(new VKIFence());
+		frameSync[i].fnCompute->CreateFence(mVKData.device.get(), true);
 	}
 
 }
@@ -200,25 +323,242 @@ void Renderer::CreateVKSync()
 void Renderer::NextFrame()
 {
 	uint32_t nxtFrame = (mCurrentFrame + 1) % NUM_CONCURRENT_FRAMES;
+	WaitFrameSlot(mSnapshot->frame.framesInFlight);
 
-	// Wait for frame to be ready...
-	VKIFence* fnFrame = mVKData.frameSync[nxtFrame].fnFrame.get();
-	fnFrame->Wait(UINT32_MAX);
-	fnFrame->Reset(); // Reset Signal.
+	// Objects queued before the frames we waited for are no longer in use.
+	mVKData.device->GetDeletionQueue()->NextFrame();
 
 	mCurrentFrame = nxtFrame;
 }
 
 
-void Renderer::BeginRender(Scene* scene)
+void Renderer::WaitFrameSlot(uint32_t framesInFlight)
+{
+	uint32_t nxtFrame = (mCurrentFrame + 1) % NUM_CONCURRENT_FRAMES;
+	framesInFlight = glm::clamp(framesInFlight, 1u, NUM_CONCURRENT_FRAMES);
+
+	// Wait for the frame recorded framesInFlight frames ago, frames finish in order so the next frame
+	// which is older is done too. The fence is reset right before submit so a skipped frame can't deadlock.
+	uint32_t waitFrame = (nxtFrame + NUM_CONCURRENT_FRAMES - framesInFlight) % NUM_CONCURRENT_FRAMES;
+	double waitStart = GetTimeMS();
+
+	mVKData.frameSync[waitFrame].fnFrame->Wait(UINT64_MAX);
+	mVKData.frameSync[nxtFrame].fnFrame->Wait(UINT64_MAX);
+
+	mRenderFrameStats.waitTime = glm::mix(mRenderFrameStats.waitTime, (float)(GetTimeMS() - waitStart), 0.1f);
+}
+
+
+void Renderer::SubmitFrame(Scene* scene)
+{
+	// The render thread setting changed? start or stop it between frames.
+	if (mFrameSettings.isRenderThread != mRenderThread.joinable())
+	{
+		if (mFrameSettings.isRenderThread)
+			StartRenderThread();
+		else
+			StopRenderThread();
+	}
+
+	RDFrameSnapshot* snapshot = AcquireSnapshot();
+
+	// Low Latency with the render thread, wait for it & the GPU here then sample input again,
+	// the render thread won't wait for the frame it records. Input is only sampled on the main thread.
+	if (mFrameSettings.isLowLatency && mRenderThread.joinable())
+	{
+		FlushRenderThread();
+		WaitFrameSlot(mFrameSettings.framesInFlight);
+		Application::Get().LateUpdate();
+	}
+
+	// Capture the frame, glfw & ImGui are only used on the main thread.
+	mVKData.instance->UpdateFramebufferSize();
+	snapshot->Capture(scene);
+	snapshot->frame = mFrameSettings;
+	snapshot->frame.isRenderThread = mRenderThread.joinable();
+	snapshot->inputTime = mInputTime;
+	mRenderUI->BuildFrame(snapshot->ui);
+
+	// No render thread? render it now.
+	if (!snapshot->frame.isRenderThread)
+	{
+		RenderFrame(snapshot);
+		mFreeQueue.Push(snapshot);
+		return;
+	}
+
+	// Hand it off to the render thread, the queue can't be full as we only have NUM_FRAME_SNAPSHOTS.
+	mNumPendingFrames.fetch_add(1);
+	mSubmitQueue.Push(snapshot);
+	Signal();
+}
+
+
+RDFrameSnapshot* Renderer::AcquireSnapshot()
+{
+	RDFrameSnapshot* snapshot = nullptr;
+	double waitStart = GetTimeMS();
+
+	if (!mFreeQueue.Pop(snapshot))
+	{
+		// The render thread is still recording the last frame.
+		std::unique_lock<std::mutex> lock(mSignalMutex);
+		mSignal.wait(lock, [&]() { return mFreeQueue.Pop(snapshot); });
+	}
+
+	mFrameStats.snapshotWaitTime = glm::mix(mFrameStats.snapshotWaitTime, (float)(GetTimeMS() - waitStart), 0.1f);
+	return snapshot;
+}
+
+
+void Renderer::RenderFrame(const RDFrameSnapshot* snapshot)
+{
+	double recordStart = GetTimeMS();
+
+	BeginRender(snapshot);
+	Render();
+	EndRender();
+
+	mRenderFrameStats.recordTime = glm::mix(mRenderFrameStats.recordTime, (float)(GetTimeMS() - recordStart), 0.1f);
+	PublishStats();
+}
+
+
+void Renderer::PublishStats()
+{
+	RendererStats stats;
+	stats.frame = mRenderFrameStats;
+	stats.resolution = mPipeline->GetResolution();
+	stats.draws = mRScene->GetDrawStats();
+	stats.frameAllocator = mFrameAllocator->GetStats();
+	stats.textureStreamer = mTextureStreamer->GetStats();
+	stats.occlusionRasterizer = mRScene->GetOcclusionRasterizer()->GetStats();
+	stats.graph = mPipeline->GetGraph()->GetStats();
+	stats.passCache = mPipeline->GetPassCache()->GetStats();
+	stats.mips = mVKData.device->GetUploader()->GetMipGenerator()->GetStats();
+
+	for (uint32_t i = 0; i < OCCLUSION_MAX_VIEWS; ++i)
+		stats.occlusionViews[i] = mPipeline->GetStageOcclusion()->GetViewStats(i);
+
+	// The uploads & deletions are also written by the main thread, copied under their locks.
+	stats.uploads = mVKData.device->GetUploader()->GetStats();
+	stats.deletions = mVKData.device->GetDeletionQueue()->GetStats();
+
+	std::lock_guard<std::mutex> lock(mStatsMutex);
+	*mStats = stats;
+}
+
+
+RendererStats Renderer::GetStats()
+{
+	RendererStats stats;
+
+	{
+		std::lock_guard<std::mutex> lock(mStatsMutex);
+		stats = *mStats;
+	}
+
+	// The frame pacing stats of the main thread.
+	stats.frame.frameTime = mFrameStats.frameTime;
+	stats.frame.limiterTime = mFrameStats.limiterTime;
+	stats.frame.snapshotWaitTime = mFrameStats.snapshotWaitTime;
+	return stats;
+}
+
+
+void Renderer::StartRenderThread()
+{
+	CHECK(!mRenderThread.joinable());
+	mIsRenderThreadExit = false;
+	mRenderThread = std::thread(&Renderer::RenderThreadLoop, this);
+}
+
+
+void Renderer::StopRenderThread()
+{
+	if (!mRenderThread.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(mSignalMutex);
+		mIsRenderThreadExit = true;
+	}
+
+	mSignal.notify_all();
+	mRenderThread.join();
+}
+
+
+void Renderer::RenderThreadLoop()
+{
+	while (true)
+	{
+		RDFrameSnapshot* snapshot = nullptr;
+
+		// Wait for the next submitted frame, the submitted frames are rendered before exiting.
+		{
+			std::unique_lock<std::mutex> lock(mSignalMutex);
+			mSignal.wait(lock, [&]() { return mSubmitQueue.Pop(snapshot) || mIsRenderThreadExit; });
+		}
+
+		if (!snapshot)
+			return;
+
+		RenderFrame(snapshot);
+
+		// Give the snapshot back to the main thread.
+		mFreeQueue.Push(snapshot);
+		mNumPendingFrames.fetch_sub(1);
+		Signal();
+	}
+}
+
+
+void Renderer::FlushRenderThread()
+{
+	if (!mRenderThread.joinable())
+		return;
+
+	CHECK(std::this_thread::get_id() != mRenderThread.get_id());
+
+	std::unique_lock<std::mutex> lock(mSignalMutex);
+	mSignal.wait(lock, [this]() { return mNumPendingFrames == 0; });
+}
+
+
+void Renderer::Signal()
+{
+	// Lock to not miss a thread that checked the queues & is about to wait.
+	{
+		std::lock_guard<std::mutex> lock(mSignalMutex);
+	}
+
+	mSignal.notify_all();
+}
+
+
+void Renderer::BeginRender(const RDFrameSnapshot* snapshot)
 {
 	CHECK(!mIsRendering && "No Rendering should be enabled.");
 	mIsRendering = true;
+	mSnapshot = snapshot;
+
+	// Collect Render Data from the scene snapshot.
+	mRScene->BuildRenderScene(snapshot);
 
-	// Collect Render Data from sceen.
-	mRScene->BuildRenderScene(scene);
+	// The settings of the objects only used by the thread rendering frames.
+	mPipeline->GetPassCache()->SetEnabled(snapshot->frame.isCachePasses);
 
-	// Submit all transient command buffers.
+	VKIMipGenerator* mipGenerator = mVKData.device->GetUploader()->GetMipGenerator();
+	mipGenerator->SetCompute(snapshot->frame.isComputeMips);
+	mipGenerator->SetFilter(snapshot->frame.isKaiserMips ? EVKIMipFilter::Kaiser : EVKIMipFilter::Box);
+	mipGenerator->SetSRGBCorrect(snapshot->frame.isSRGBCorrectMips);
+
+	// Stream the texture mips the scene requires, before the uploads they request are submitted.
+	mTextureStreamer->Update(mRScene.get(), snapshot, mVKData.swapchain->GetExtent().height);
+
+	// Submit pending uploads, then all transient command buffers which wait for them on the GPU.
+	mVKData.device->GetUploader()->Submit();
 	mVKData.device->SubmitTransientCmd();
 
 }
@@ -232,17 +572,13 @@ void Renderer::EndRender()
 	// Clear render scene data.
 	mRScene->Reset();
 
-	// Wait for all transient command buffers to be submited.
-	mVKData.device->WaitForTransientCmd();
+	// Retire finished uploads & transient command buffers without waiting for the ones still executing.
+	mVKData.device->GetUploader()->Retire();
+	mVKData.device->RetireTransientCmd();
 
 
-	// To avoid the next frame from using previous frame data. we wait when update happen.
-	if (mPipeline->IsWaitForUpdate())
-	{
-		LOGW("-> WAIT FOR UPATE.");
-		WaitForIdle();
-	}
-
+	// Present mode changed? the swapchain is recreated with it.
+	mVKData.swapchain->SetPresentMode(ToVKPresentMode(mSnapshot->frame.presentMode));
 
 	// Swapchain need to be recreated?
 	if (mVKData.swapchain->NeedRecreate())
@@ -250,6 +586,7 @@ void Renderer::EndRender()
 		RecreateSwapchain();
 	}
 
+	mSnapshot = nullptr;
 }
 
 
@@ -278,21 +615,42 @@ void Renderer::Render()
 		return;
 
 
-	// Update Dynamic Uniforms...
-	mRScene->UpdateUniforms(mCurrentFrame);
+	// Low Latency, sample input & update the view now that we are done waiting.
+	double inputTime = mSnapshot->inputTime;
+
+	if (mSnapshot->frame.isLowLatency && !mSnapshot->frame.isRenderThread)
+	{
+		Application::Get().LateUpdate();
+		mRScene->CollectSceneView(Application::Get().GetMainScene());
+		inputTime = mInputTime;
+	}
 
 
+	// Reset the frame allocator region of this frame, the frame is done on the GPU.
+	mFrameAllocator->BeginFrame(mCurrentFrame);
+
+
+	// The async compute command buffer of this frame is reused once its last submit is done.
+	VKIFence* fnCompute = mVKData.frameSync[mCurrentFrame].fnCompute.get();
+	fnCompute->Wait(UINT64_MAX);
+
 	// Begin Pipeline.
 	glm::vec4 viewport(0.0f, 0.0f, mVKData.swapchain->GetExtent().width, mVKData.swapchain->GetExtent().height);
+	mPipeline->SetAsyncCompute(mSnapshot->frame.isAsyncCompute && mVKData.device->IsAsyncCompute());
+	mPipeline->SetResolutionSettings(mSnapshot->frame.isDynamicResolution, mSnapshot->frame.targetGPUTime,
+		mSnapshot->frame.renderScale);
 	mPipeline->BeginRender(mCurrentFrame, mRScene.get(), viewport);
 
+	// Update Dynamic Uniforms, after the main view common block so only the draws of materials can overflow.
+	mRScene->UpdateUniforms(mCurrentFrame);
+
 
 	// Render Command Buffers...
 	VKICommandBuffer* cmdBuffer = mVKData.device->GetDrawCmd();
 	cmdBuffer->SetCurrent(mCurrentFrame);
 
 	RecordFrameCommands(imgIndex);
-	mRenderUI->RenderFrame(imgIndex, mCurrentFrame);
+	mRenderUI->RenderFrame(mSnapshot->ui, imgIndex, mCurrentFrame);
 
 
 	std::array<VkCommandBuffer, 2> cmdBuffers = {
@@ -308,35 +666,93 @@ void Renderer::Render()
 	submitInfo.pCommandBuffers = cmdBuffers.data();
 
 	// Submit-Sync...
-	std::array<VkSemaphore, 1> smWait = { smImage->Get() };
-	submitInfo.waitSemaphoreCount = (uint32_t)smWait.size();
+	std::array<VkSemaphore, 2> smWait = { smImage->Get() };
+	std::array<VkPipelineStageFlags, 2> stageWait = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+	submitInfo.waitSemaphoreCount = 1;
   submitInfo.pWaitSemaphores = smWait.data();
-
-	std::array<VkPipelineStageFlags, 1> stageWait = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-
-	if (mPipeline->IsWaitForUpdate())
-		stageWait[0] = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
-
   submitInfo.pWaitDstStageMask = stageWait.data();
 
-	std::array<VkSemaphore, 1> smSignal = { smRender->Get() };
-  submitInfo.signalSemaphoreCount = (uint32_t)smSignal.size();
+	// Wait for the probes filtered by the last async compute, only the passes that sample the
+	// irradiance or write the radiance wait, vertex & compute work overlap it.
+	if (mComputeWait)
+	{
+		smWait[1] = mComputeWait->Get();
+		stageWait[1] = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		submitInfo.waitSemaphoreCount = 2;
+		mComputeWait = nullptr;
+	}
+
+	std::array<VkSemaphore, 2> smSignal = { smRender->Get(), mVKData.frameSync[mCurrentFrame].smGraphics->Get() };
+  submitInfo.signalSemaphoreCount = mPipeline->HasAsyncCompute() ? 2 : 1;
   submitInfo.pSignalSemaphores = smSignal.data();
 
-	if (vkQueueSubmit(mVKData.device->GetGFXQueue(), 1, &submitInfo, fnFrame->Get()) != VK_SUCCESS)
+	fnFrame->Reset(); // Reset Signal.
+
 	{
-		CHECK(0 && "Failed to submit draw command buffer!");
-		return;
+		// The queues may be shared with the uploads submitted by the main thread.
+		std::lock_guard<std::mutex> queueLock(mVKData.device->GetQueueMutex());
+
+		if (vkQueueSubmit(mVKData.device->GetGFXQueue(), 1, &submitInfo, fnFrame->Get()) != VK_SUCCESS)
+		{
+			CHECK(0 && "Failed to submit draw command buffer!");
+			return;
+		}
+
+		// Submit the async compute commands once the graphics commands they depend on are done.
+		if (mPipeline->HasAsyncCompute())
+		{
+			SubmitAsyncCompute();
+		}
+
+		// Present Rendererd Frame...
+		mVKData.swapchain->PresentImage(imgIndex, smRender);
 	}
 
-	// Present Rendererd Frame...
-	mVKData.swapchain->PresentImage(imgIndex, smRender);
+	// The latency from sampling input to queuing the frame for present.
+	mRenderFrameStats.latency = glm::mix(mRenderFrameStats.latency, (float)(GetTimeMS() - inputTime), 0.1f);
 
 	// End Pipeline.
 	mPipeline->EndRender();
 }
 
 
+void Renderer::SubmitAsyncCompute()
+{
+	VkCommandBuffer computeCmd = mVKData.device->GetComputeCmd()->Get(mCurrentFrame);
+	vkEndCommandBuffer(computeCmd);
+
+	VKISemaphore* smGraphics = mVKData.frameSync[mCurrentFrame].smGraphics.get();
+	VKISemaphore* smCompute = mVKData.frameSync[mCurrentFrame].smCompute.get();
+	VKIFence* fnCompute = mVKData.frameSync[mCurrentFrame].fnCompute.get();
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &computeCmd;
+
+	VkSemaphore smWait = smGraphics->Get();
+	VkPipelineStageFlags stageWait = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+	submitInfo.waitSemaphoreCount = 1;
+	submitInfo.pWaitSemaphores = &smWait;
+	submitInfo.pWaitDstStageMask = &stageWait;
+
+	VkSemaphore smSignal = smCompute->Get();
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &smSignal;
+
+	fnCompute->Reset();
+
+	if (vkQueueSubmit(mVKData.device->GetComputeQueue(), 1, &submitInfo, fnCompute->Get()) != VK_SUCCESS)
+	{
+		CHECK(0 && "Failed to submit async compute command buffer!");
+		return;
+	}
+
+	// The next frame graphics submit wait for it.
+	mComputeWait = smCompute;
+}
+
+
 void Renderer::RecordFrameCommands(uint32_t imgIndex)
 {
 	VKICommandBuffer* cmdBuffer = mVKData.device->GetDrawCmd();
@@ -363,13 +779,50 @@ void Renderer::RecordFrameCommands(uint32_t imgIndex)
 
 void Renderer::WaitForIdle()
 {
+	// The queues are used by the render thread.
+	FlushRenderThread();
+
 	vkDeviceWaitIdle(mVKData.device->Get());
 }
 
 
+void Renderer::PaceFrame()
+{
+	double now = GetTimeMS();
+	mFrameStats.limiterTime = 0.0f;
+
+	// Frame Limiter...
+	if (mFrameSettings.maxFrameRate > 0.0f)
+	{
+		double frameEnd = mFrameStartTime + 1000.0 / (double)mFrameSettings.maxFrameRate;
+
+		// Sleep is coarse, sleep most of the remaining time then yield until the end.
+		if (frameEnd - now > 2.0)
+			std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(frameEnd - now - 1.0));
+
+		while (GetTimeMS() < frameEnd)
+			std::this_thread::yield();
+
+		double limitEnd = GetTimeMS();
+		mFrameStats.limiterTime = (float)(limitEnd - now);
+		now = limitEnd;
+	}
+
+	if (mFrameStartTime != 0.0)
+		mFrameStats.frameTime = glm::mix(mFrameStats.frameTime, (float)(now - mFrameStartTime), 0.1f);
+
+	mFrameStartTime = now;
+}
+
+
+void Renderer::MarkInputSampled()
+{
+	mInputTime = GetTimeMS();
+}
+
+
 void Renderer::RecreateSwapchain()
 {
-	WaitForIdle();
 	mVKData.instance->ReQuerySurface();
 	mVKData.swapchain->Recreate();
 
@@ -378,7 +831,13 @@ void Renderer::RecreateSwapchain()
 }
 
 
-RenderUniform* Renderer::GetMaterialUniform()
+RenderUniform* Renderer::GetTransformUniform()
+{
+	return mRScene->GetTransformUniform();
+}
+
+
+RenderUniform* Renderer::GetHelperUniform()
 {
-	return mRScene->GetMatUniform();
+	return mRScene->GetHelperUniform();
 }
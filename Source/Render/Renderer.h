@@ -28,8 +28,12 @@
 
 
 #include "Core/Core.h"
+#include "Core/SPSCQueue.h"
 
 #include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 
 
@@ -37,10 +41,14 @@ class Scene;
 class RendererPipeline;
 class RenderShader;
 class RenderUniform;
+class RenderFrameAllocator;
 class RenderScene;
 class RenderSphere;
 class RenderImGUI;
+class RenderTextureStreamer;
 class Image2D;
+struct RDFrameSnapshot;
+struct RendererStats;
 
 class VKIInstance;
 class VKIDevice;
@@ -69,6 +77,100 @@ struct VKFrameSync
 
 	// Fence for frame completion.
 	Ptr<VKIFence> fnFrame;
+
+	// Semaphore that signal the graphics commands the async compute depend on are done.
+	Ptr<VKISemaphore> smGraphics;
+
+	// Semaphore that signal async compute completion, waited by the next frame.
+	Ptr<VKISemaphore> smCompute;
+
+	// Fence for async compute completion.
+	Ptr<VKIFence> fnCompute;
+};
+
+
+
+
+
+// The swapchain present modes the renderer can use.
+enum class ERenderPresentMode : uint32_t
+{
+	// V-Sync, frames are queued & presented in order.
+	Fifo,
+
+	// V-Sync, the newest frame replaces the queued one.
+	Mailbox,
+
+	// No V-Sync, may tear.
+	Immediate
+};
+
+
+
+// Frame pacing settings, can be changed between frames.
+struct RendererFrameSettings
+{
+	// The number of frames the CPU can record ahead of the GPU, [1, NUM_CONCURRENT_FRAMES].
+	uint32_t framesInFlight;
+
+	// The swapchain present mode, fifo is used if the mode is not supported.
+	ERenderPresentMode presentMode;
+
+	// Limit the frame rate, zero for unlimited.
+	float maxFrameRate;
+
+	// If true input is sampled & the view is updated after waiting for the GPU, right before recording.
+	// With the render thread the main thread waits for it too, giving up the overlap.
+	bool isLowLatency;
+
+	// Record & submit frames on the render thread, overlapping the update of the next frame.
+	bool isRenderThread;
+
+	// Filter light probes on the async compute queue overlapping the next frame, if the device has one.
+	bool isAsyncCompute;
+
+	// Reuse the secondary command buffers of passes while their inputs are unchanged.
+	bool isCachePasses;
+
+	// Generate the mips of uploaded images by compute if supported, with a kaiser or a box filter,
+	// sRGB images are filtered in linear space if sRGB correct.
+	bool isComputeMips;
+	bool isKaiserMips;
+	bool isSRGBCorrectMips;
+
+	// If true the render scale is adjusted from the measured gpu time to keep it near the target time.
+	bool isDynamicResolution;
+
+	// The gpu time in milliseconds the dynamic resolution try to keep.
+	float targetGPUTime;
+
+	// The render scale of the output size if the resolution isn't dynamic.
+	float renderScale;
+};
+
+
+
+// Frame pacing stats, times in milliseconds.
+//    - the frame, limiter & snapshot wait times are measured by the main thread, the others by the thread rendering frames.
+struct RendererFrameStats
+{
+	// The smoothed time between frames.
+	float frameTime;
+
+	// The smoothed time the CPU waited for frames in-flight.
+	float waitTime;
+
+	// The time spent in the frame limiter last frame.
+	float limiterTime;
+
+	// The smoothed time from sampling input to queuing the frame for present.
+	float latency;
+
+	// The smoothed time the main thread waited for the render thread to free a frame snapshot.
+	float snapshotWaitTime;
+
+	// The smoothed time to build, record & submit a frame from its snapshot.
+	float recordTime;
 };
 
 
@@ -117,14 +219,18 @@ public:
 	// Destroy the renderer.
 	void Destroy();
 
-	// Begin Rendering.
-	void BeginRender(Scene* scene);
+	// Capture a snapshot of the scene & ui and render it, on the render thread if enabled.
+	void SubmitFrame(Scene* scene);
 
-	// End Rendering.
-	void EndRender();
+	// Wait until the render thread is done with all the submitted frames, the main thread can then
+	// modify or destroy render objects until the next SubmitFrame.
+	void FlushRenderThread();
 
-	// Render a single frame of the Scene.
-	void Render();
+	// Return true if we are between BeginRender & EndRender.
+	inline bool IsRendering() const { return mIsRendering; }
+
+	// Return the snapshot of the frame being rendered, null outside of BeginRender & EndRender.
+	inline const RDFrameSnapshot* GetFrameSnapshot() const { return mSnapshot; }
 
 	// Return the renderer vulkan instance.
 	inline VKIInstance* GetVKInstance() { return mVKData.instance.get(); }
@@ -138,8 +244,23 @@ public:
 	// Return the rendrer pipeline.
 	inline RendererPipeline* GetPipeline() { return mPipeline.get(); }
 
-	// Return the rendrer pipeline.
-	RenderUniform* GetMaterialUniform();
+	// Return the render scene.
+	inline RenderScene* GetRenderScene() { return mRScene.get(); }
+
+	// Return the texture streamer of the images with a precomputed mip chain.
+	inline RenderTextureStreamer* GetTextureStreamer() { return mTextureStreamer.get(); }
+
+	// Return the per-frame allocator for uniforms & dynamic data.
+	inline RenderFrameAllocator* GetFrameAllocator() { return mFrameAllocator.get(); }
+
+	// Return the instance indices of the scene draws, its regions are written by the scene & occlusion culling.
+	inline VKIBuffer* GetInstanceIndices() { return mInstanceIndices.get(); }
+
+	// Return the instances transform uniform.
+	RenderUniform* GetTransformUniform();
+
+	// Return the helpers instance uniform.
+	RenderUniform* GetHelperUniform();
 
 	// Return the renderer sphere.
 	inline RenderSphere* GetSphere() { return mRSphere.get(); }
@@ -151,7 +272,45 @@ public:
 	// Wait for the queues to be Idle/
 	void WaitForIdle();
 
+	// Wait for the frame limiter, called at the start of every frame before sampling input.
+	void PaceFrame();
+
+	// Mark the time input is sampled, used to measure the frame latency.
+	void MarkInputSampled();
+
+	// Return the frame pacing settings, they can be changed between frames.
+	inline RendererFrameSettings& GetFrameSettings() { return mFrameSettings; }
+
+	// Return a copy of the stats of the last rendered frame, published by the thread that rendered it,
+	// with the frame pacing stats of the main thread. Called by the main thread.
+	RendererStats GetStats();
+
 private:
+	// Begin Rendering a frame snapshot.
+	void BeginRender(const RDFrameSnapshot* snapshot);
+
+	// End Rendering.
+	void EndRender();
+
+	// Render a single frame of the Scene.
+	void Render();
+
+	// Begin, Render & End a frame snapshot.
+	void RenderFrame(const RDFrameSnapshot* snapshot);
+
+	// Return a free frame snapshot, waits for the render thread if all of them are in use.
+	RDFrameSnapshot* AcquireSnapshot();
+
+	// Start/Stop the render thread, called by the main thread between frames.
+	void StartRenderThread();
+	void StopRenderThread();
+
+	// The render thread loop, renders the submitted snapshots until stopped.
+	void RenderThreadLoop();
+
+	// Wake up the thread waiting for a snapshot to be submitted, freed or flushed.
+	void Signal();
+
 	// Create Vulkan Sync Objects.
 	void CreateVKSync();
 
@@ -161,16 +320,28 @@ private:
 	// Record Commands for current frame.
 	void RecordFrameCommands(uint32_t imgIndex);
 
+	// Submit the async compute commands recorded for current frame, the queue mutex must be locked.
+	void SubmitAsyncCompute();
+
+	// Wait for the GPU to finish the frame the next frame replaces, given the frames in-flight.
+	void WaitFrameSlot(uint32_t framesInFlight);
+
 	// Recreate the swapchain to match the current surface size.
 	void RecreateSwapchain();
 
+	// Publish the stats of the frame just rendered for the main thread.
+	void PublishStats();
+
 	// Load Default Images from file.
 	void LoadDefaultImages();
 
 public:
-	// The number of concurrent frames we are allowed to render.
+	// The maximum number of concurrent frames, per-frame resources are allocated for all of them.
 	static const uint32_t NUM_CONCURRENT_FRAMES;
 
+	// The number of frame snapshots, one recorded by the render thread while the next one is captured.
+	static const uint32_t NUM_FRAME_SNAPSHOTS;
+
 private:
 	// Vulkan Renderer Data.
 	VKRenderData mVKData;
@@ -184,9 +355,18 @@ private:
 	// The Pipeline.
 	UniquePtr<RendererPipeline> mPipeline;
 
+	// The per-frame allocator for uniforms & dynamic data.
+	UniquePtr<RenderFrameAllocator> mFrameAllocator;
+
+	// The instance indices of the scene draws.
+	UniquePtr<VKIBuffer> mInstanceIndices;
+
 	// The Render Data for the current scene we are rendering.
 	UniquePtr<RenderScene> mRScene;
 
+	// Stream the mips of the images with a precomputed mip chain under a video memory budget.
+	UniquePtr<RenderTextureStreamer> mTextureStreamer;
+
 	// The Render Sphere Mesh, used to draw sphere for various render stages.
 	UniquePtr<RenderSphere> mRSphere;
 
@@ -195,6 +375,45 @@ private:
 
 	// Default Render Images used for material.
 	Ptr<Image2D> mDefaultImages[2];
+
+	// Frame pacing settings & the stats measured by the main thread.
+	RendererFrameSettings mFrameSettings;
+	RendererFrameStats mFrameStats;
+
+	// The frame pacing stats measured by the thread rendering frames.
+	RendererFrameStats mRenderFrameStats;
+
+	// The time the current frame started & the last time input was sampled.
+	double mFrameStartTime;
+	double mInputTime;
+
+	// The async compute semaphore the next graphics submit must wait on, null if none.
+	VKISemaphore* mComputeWait;
+
+	// The frame snapshots & the snapshot of the frame being rendered.
+	std::vector< UniquePtr<RDFrameSnapshot> > mSnapshots;
+	const RDFrameSnapshot* mSnapshot;
+
+	// Snapshots submitted by the main thread to the render thread & snapshots freed by the render thread.
+	SPSCQueue<RDFrameSnapshot*, 4> mSubmitQueue;
+	SPSCQueue<RDFrameSnapshot*, 4> mFreeQueue;
+
+	// The render thread, not joinable if frames are rendered on the main thread.
+	std::thread mRenderThread;
+
+	// Set to stop the render thread after it renders the submitted snapshots.
+	std::atomic<bool> mIsRenderThreadExit;
+
+	// The number of submitted snapshots the render thread didn't finish yet.
+	std::atomic<uint32_t> mNumPendingFrames;
+
+	// Used to sleep while the queues are empty, the snapshots themselves are handed off lock-free.
+	std::mutex mSignalMutex;
+	std::condition_variable mSignal;
+
+	// The stats of the last rendered frame, copied in & out under the mutex.
+	UniquePtr<RendererStats> mStats;
+	std::mutex mStatsMutex;
 };
 
 
@@ -26,11 +26,15 @@
 #include "Application.h"
 #include "Renderer.h"
 #include "RenderStageLightProbes.h"
+#include "RenderStageOcclusion.h"
+#include "RenderGraph.h"
+#include "RenderPassCache.h"
 #include "RenderData/RenderScene.h"
 #include "RenderData/RenderShadow.h"
 #include "RenderData/RenderLight.h"
 #include "RenderData/Shaders/RenderShader.h"
 #include "RenderData/Shaders/RenderUniform.h"
+#include "RenderData/Shaders/RenderFrameAllocator.h"
 
 
 #include "VKInterface/VKIDevice.h"
@@ -42,9 +46,12 @@
 #include "VKInterface/VKICommandBuffer.h"
 #include "VKInterface/VKISwapChain.h"
 #include "VKInterface/VKIGraphicsPipeline.h"
+#include "VKInterface/VKIInstance.h"
+#include "VKInterface/VKIQueryPool.h"
 
 
 #include "glm/gtc/type_ptr.hpp"
+#include "glm/common.hpp"
 
 
 
@@ -83,9 +90,19 @@ RendererPipeline::RendererPipeline()
 	, mSize(0, 0)
 	, mIsRendering(false)
 	, mFrame(0)
-	, mWaitForUpdate(false)
+	, mIsUpdatingProbes(false)
+	, mIsAsyncCompute(false)
+	, mHasAsyncCompute(false)
+	, mCommonOffset(0)
+	, mMainCommonOffset(0)
+	, mOutputViewport(0)
 {
-
+	mResolution = RendererResolution{};
+	mResolution.isDynamic = true;
+	mResolution.targetTime = 12.0f;
+	mResolution.minScale = 0.5f;
+	mResolution.maxScale = 1.0f;
+	mResolution.scale = 1.0f;
 }
 
 
@@ -102,23 +119,34 @@ void RendererPipeline::Initialize()
 	mDevice = Application::Get().GetRenderer()->GetVKDevice();
 	mSwapchain = Application::Get().GetRenderer()->GetVKSwapChain();
 
-	// Initial Targets Size.
-	mSize = glm::ivec2(1920, 1080);
+	// Targets Size, large enough for a fullscreen window so resizing the output never reallocate them.
+	VkExtent2D monitorSize = Application::Get().GetRenderer()->GetVKInstance()->GetMonitorSize();
+	VkExtent2D swExtent = mSwapchain->GetExtent();
+	mSize = glm::max(glm::ivec2(monitorSize.width, monitorSize.height), glm::ivec2(swExtent.width, swExtent.height));
+	mResolution.outputSize = glm::ivec2(swExtent.width, swExtent.height);
 
-	// Create Renderer Pipeline Uniforms 
-	SetupUniforms();
+	// GPU Timestamps, two for each concurrent frame.
+	mTimestamps = UniquePtr<VKIQueryPool>(new VKIQueryPool());
+	mTimestamps->CreateTimestampPool(mDevice, 2 * Renderer::NUM_CONCURRENT_FRAMES);
+	mHasTimestamps.resize(Renderer::NUM_CONCURRENT_FRAMES, false);
 
 	// ...
 	SetupTargets();
+	SetupGraph();
 	SetupGBufferPass();
 	SetupLightingPass();
 	SetupPostProcessPass();
 	SetupBlitSwapchain();
 	SetupShadowPasses();
+	SetupPassCache();
 
 	//
 	mStageLightProbes = UniquePtr<RenderStageLightProbes>(new RenderStageLightProbes());
-	mStageLightProbes->Initialize(mDevice, mHDRTarget, &mDepthTarget, mUniforms.common.get());
+	mStageLightProbes->Initialize(mDevice, mHDRTarget, &mDepthTarget, this);
+
+	//
+	mStageOcclusion = UniquePtr<RenderStageOcclusion>(new RenderStageOcclusion());
+	mStageOcclusion->Initialize(mDevice, &mDepthTarget, mDirShadowPass.get(), glm::ivec2(mSize));
 }
 
 
@@ -128,13 +156,62 @@ void RendererPipeline::Resize(const glm::ivec2& size)
 	if (size.x == 0 || size.y == 0)
 		return;
 
-	// Smaller Size?
-	if (size.x <= mSize.x && size.y <= mSize.y)
+	// Larger than the targets? frames in-flight still use them, render at the targets size & upscale.
+	if (size.x > mSize.x || size.y > mSize.y)
+	{
+		LOGW("RendererPipeline: Output %dx%d is larger than the targets %dx%d, upscaling.",
+			size.x, size.y, (int32_t)mSize.x, (int32_t)mSize.y);
+	}
+
+	mResolution.outputSize = size;
+}
+
+
+void RendererPipeline::SetResolutionSettings(bool isDynamic, float targetTime, float scale)
+{
+	mResolution.isDynamic = isDynamic;
+	mResolution.targetTime = targetTime;
+
+	if (!isDynamic)
+		mResolution.scale = glm::clamp(scale, mResolution.minScale, mResolution.maxScale);
+}
+
+
+void RendererPipeline::UpdateResolution(float gpuTime)
+{
+	mResolution.gpuTime = gpuTime;
+	mResolution.smoothTime = mResolution.smoothTime == 0.0f ? gpuTime
+		: glm::mix(mResolution.smoothTime, gpuTime, 0.1f);
+
+	if (!mResolution.isDynamic)
+		return;
+
+	// Close enough to the target? keep the scale to avoid oscillating.
+	float ratio = mResolution.targetTime / glm::max(mResolution.smoothTime, 0.01f);
+
+	if (glm::abs(1.0f - ratio) < 0.05f)
 		return;
 
+	// The gpu time is mostly proportional to the number of pixels, which is the scale squared.
+	float scale = mResolution.scale * glm::sqrt(ratio);
+	scale = glm::mix(mResolution.scale, scale, 0.25f);
+	mResolution.scale = glm::clamp(scale, mResolution.minScale, mResolution.maxScale);
+}
+
+
+void RendererPipeline::ComputeRenderViewport()
+{
+	mResolution.scale = glm::clamp(mResolution.scale, 0.1f, 1.0f);
 
-	// Resize Targets...
-	CHECK(0 && "TODO: Resize Render Targets...");
+	// Round up the scale to steps, so small changes of scale don't change the size every frame.
+	float scale = glm::ceil(mResolution.scale * RENDER_SCALE_STEPS) / RENDER_SCALE_STEPS;
+
+	glm::ivec2 size = glm::ivec2(glm::vec2(mResolution.outputSize) * scale);
+	size = glm::clamp(size, glm::ivec2(1), glm::min(mResolution.outputSize, glm::ivec2(mSize)));
+
+	mResolution.renderSize = size;
+	mViewport = glm::vec4(0.0f, 0.0f, size.x, size.y);
+	mIntViewport = glm::ivec4(mViewport);
 }
 
 
@@ -142,11 +219,25 @@ void RendererPipeline::BeginRender(uint32_t frame, RenderScene* rscene, const gl
 {
 	CHECK(!mIsRendering);
 	mIsRendering = true;
-	mWaitForUpdate = false;
+	mIsUpdatingProbes = false;
+	mHasAsyncCompute = false;
 	mFrame = frame;
 	mScene = rscene;
-	mViewport = viewport;
-	mIntViewport = glm::ivec4(viewport);
+	mOutputViewport = glm::ivec4(viewport);
+
+	// GPU time of the last render of this frame, its fence is already signaled.
+	if (mHasTimestamps[frame])
+	{
+		double times[2];
+
+		if (mTimestamps->GetTimestamps(frame * 2, 2, times))
+			UpdateResolution((float)(times[1] - times[0]));
+
+		mHasTimestamps[frame] = false;
+	}
+
+	// The scene is rendered into the render viewport then upscaled to the output viewport.
+	ComputeRenderViewport();
 
 
 	// Common Block.
@@ -160,12 +251,21 @@ void RendererPipeline::BeginRender(uint32_t frame, RenderScene* rscene, const gl
 		mCommonBlock.sunDir = rscene->GetEnvironment().sunDir;
 		mCommonBlock.sunColorAndPower = rscene->GetEnvironment().sunColorAndPower;
 		mCommonBlock.nearFar = rscene->GetNearFar();
-		mCommonBlock.time = Application::Get().GetAppTime();
+		mCommonBlock.time = rscene->GetEnvironment().time;
 		mCommonBlock.mode = COMMON_MODE_NONE;
 
-		mUniforms.common->Update(frame, &mCommonBlock); // Update Common Block.
+		// Sub-allocate the main view common block from the frame allocator, the first allocation of the frame.
+		if (!PushCommonBlock(mCommonBlock))
+		{
+			LOGE("The main view common block(%d) doesn't fit in the frame allocator.", (int)sizeof(GUniform::CommonBlock));
+			CHECK(0 && "Frame allocator too small.");
+		}
+
+		mMainCommonOffset = mCommonOffset;
 	}
 
+	// Occlusion Culling Objects.
+	mStageOcclusion->BeginFrame(frame, rscene);
 
 }
 
@@ -182,43 +282,71 @@ void RendererPipeline::Render(VKICommandBuffer* cmdBuffer)
 {
 	CHECK(mIsRendering);
 
+	// Barriers & pass cache stats for this frame.
+	mGraph->BeginFrame();
+	mPassCache->BeginFrame();
+
+	// Frame start timestamp.
+	if (mTimestamps->IsSupported())
+	{
+		mTimestamps->Reset(cmdBuffer->GetCurrent(), mFrame * 2, 2);
+		mTimestamps->WriteTimestamp(cmdBuffer->GetCurrent(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, mFrame * 2);
+	}
+
+	// Reset occlusion culling stats for this frame.
+	mStageOcclusion->ResetStats(cmdBuffer);
+
 	// Update shadow maps if needed...
 	UpdateShadows(cmdBuffer);
 	
+	// Irradiance filtered on the async compute queue by the last render is ready.
+	ResolveProbesAsync(cmdBuffer);
+
 	// Update light probes if needed...
 	UpdateLightProbes(cmdBuffer);
 	UpdateIrradianceVolumes(cmdBuffer);
+	FilterProbesAsync(cmdBuffer);
 
 
 
 
 	// Viewport...
-	VkViewport viewport = { mViewport.x, mViewport.y, mViewport.z, mViewport.w, 0.0f, 1.0f };
-	VkRect2D scissor = { { (int32_t)mIntViewport.x, (int32_t)mIntViewport.y },
-		{ (uint32_t)mIntViewport.z, (uint32_t)mIntViewport.w } };
-
-	vkCmdSetViewport(cmdBuffer->GetCurrent(), 0, 1, &viewport);
-	vkCmdSetScissor(cmdBuffer->GetCurrent(), 0, 1, &scissor);
+	SetViewport(cmdBuffer, mIntViewport);
 
 
 	// --- -- - -- ---
 	// The Scene.
 
 	// Don't render the scene while updating...
-	if (!IsWaitForUpdate())
+	if (!IsUpdatingProbes())
 	{
-		RenderSceneStage(cmdBuffer, ERenderSceneStage::Normal);
+		RenderSceneStage(cmdBuffer, ERenderSceneStage::Normal, 0, mCommonBlock.viewProjMatrix, mIntViewport);
 	}
 
 
 
 	// --- -- - -- --- -- -
-	// Tone-Mapping Pass.
+	// Tone-Mapping Pass, cached until its inputs change.
+	if (mGraph->BeginPass(cmdBuffer, mRG.postProcess))
 	{
-		mPostProPass->Begin(cmdBuffer, mPostProFB.get(), mIntViewport);
-		mPostProShader->Bind(cmdBuffer);
-		mPostProShader->GetDescriptorSet()->Bind(cmdBuffer, mFrame, mPostProShader->GetPipeline());
-		vkCmdDraw(cmdBuffer->GetCurrent(), 3, 1, 0, 0);
+		mPostProPass->Begin(cmdBuffer, mPostProFB.get(), mIntViewport, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+		RenderPassCacheKey key;
+		key.Add(mPostProPass->Get());
+		key.Add(mPostProShader->GetPipeline()->Get());
+		key.AddDescriptorSet(mPostProShader->GetDescriptorSet(), mFrame);
+		key.Add(mIntViewport);
+
+		if (VKICommandBuffer* passCmd = mPassCache->Begin(mRC.postProcess, mFrame, key.Get(), mPostProPass.get()))
+		{
+			SetViewport(passCmd, mIntViewport);
+			mPostProShader->Bind(passCmd);
+			mPostProShader->GetDescriptorSet()->Bind(passCmd, mFrame, mPostProShader->GetPipeline());
+			vkCmdDraw(passCmd->GetCurrent(), 3, 1, 0, 0);
+			mPassCache->End(mRC.postProcess, mFrame);
+		}
+
+		mPassCache->Execute(cmdBuffer, mRC.postProcess, mFrame);
 		mPostProPass->End(cmdBuffer);
 	}
 
@@ -228,64 +356,113 @@ void RendererPipeline::Render(VKICommandBuffer* cmdBuffer)
 
 void RendererPipeline::FinalToSwapchain(VKICommandBuffer* cmdBuffer, uint32_t imgIndex)
 {
-	mSwapchain->GetRenderPass()->Begin(cmdBuffer, mSwapchain->GetFrameBuffer(imgIndex), mIntViewport);
-	mBlitSwapchain->Bind(cmdBuffer);
-	mBlitSwapchain->GetDescriptorSet()->Bind(cmdBuffer, mFrame, mBlitSwapchain->GetPipeline());
-	
-	// Testing............................................................
-	vkCmdDraw(cmdBuffer->GetCurrent(), 3, 1, 0, 0);
+	mGraph->BeginPass(cmdBuffer, mRG.blit);
 
-	mSwapchain->GetRenderPass()->End(cmdBuffer);
-}
+	// Output Viewport, the render viewport is upscaled to it.
+	glm::ivec4 viewport(0, 0, mOutputViewport.z, mOutputViewport.w);
+	VKIRenderPass* renderPass = mSwapchain->GetRenderPass();
 
+	// The same commands for every swapchain image, the framebuffer isn't part of the cached commands.
+	renderPass->Begin(cmdBuffer, mSwapchain->GetFrameBuffer(imgIndex), mOutputViewport,
+		VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
 
-void RendererPipeline::RenderSceneStage(VKICommandBuffer* cmdBuffer, ERenderSceneStage stage)
-{
+	RenderPassCacheKey key;
+	key.Add(renderPass->Get());
+	key.Add(mBlitSwapchain->GetPipeline()->Get());
+	key.AddDescriptorSet(mBlitSwapchain->GetDescriptorSet(), mFrame);
+	key.Add(viewport);
 
-	// G-Buffer Pass...
+	if (VKICommandBuffer* passCmd = mPassCache->Begin(mRC.blit, mFrame, key.Get(), renderPass))
 	{
-		mGBufferPass->Begin(cmdBuffer, mGBufferFB.get(), mIntViewport);
-		mScene->DrawSceneDeferred(cmdBuffer, mFrame);
-		mGBufferPass->End(cmdBuffer);
+		SetViewport(passCmd, viewport);
+		mBlitSwapchain->Bind(passCmd);
+		mBlitSwapchain->GetDescriptorSet()->Bind(passCmd, mFrame, mBlitSwapchain->GetPipeline());
+		vkCmdDraw(passCmd->GetCurrent(), 3, 1, 0, 0);
+		mPassCache->End(mRC.blit, mFrame);
 	}
 
+	mPassCache->Execute(cmdBuffer, mRC.blit, mFrame);
+	renderPass->End(cmdBuffer);
 
-
-	// Lighting Pass...
+	// Frame end timestamp.
+	if (mTimestamps->IsSupported())
 	{
-		mLightingPass->Begin(cmdBuffer, mLightingFB.get(), mIntViewport);
+		mTimestamps->WriteTimestamp(cmdBuffer->GetCurrent(), VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, mFrame * 2 + 1);
+		mHasTimestamps[mFrame] = true;
+	}
+}
 
-		// render light probes in the scene.
-		mStageLightProbes->Render(cmdBuffer, mFrame, mScene->GetLightProbes());
 
-		// render irradiance volumes in the scene.
-		mStageLightProbes->Render(cmdBuffer, mFrame, mScene->GetIrradianceVolumes());
+void RendererPipeline::RenderSceneStage(VKICommandBuffer* cmdBuffer, ERenderSceneStage stage, uint32_t view,
+	const glm::mat4& viewProj, const glm::ivec4& viewport)
+{
+	// Software Occlusion Culling, before recording any draw.
+	mScene->CullOccluded(cmdBuffer, viewProj, mStageOcclusion.get());
 
-		// Sun Light
-		mLightingShader->Bind(cmdBuffer);
-		mScene->GetSunLightDescSet()->Bind(cmdBuffer, mFrame, mLightingShader->GetPipeline());
+	// Occlusion Culling...
+	if (mStageOcclusion->IsEnabled())
+	{
+		mStageOcclusion->RenderDepthPrePass(cmdBuffer, view, viewProj, viewport);
 
-		RenderDirShadow* shadow = mScene->GetSunShadow();
-		glm::mat4 shadowMatrix = shadow->GetShadowMatrix();
+		// The depth pre-pass render pass leaves depth read by the depth pyramid build.
+		mGraph->SetAccess(mRG.depth, ERenderGraphUsage::SampledCompute);
+
+		mStageOcclusion->CullObjects(cmdBuffer, view, viewProj);
+	}
 
-		vkCmdPushConstants(cmdBuffer->GetCurrent(),
-			mLightingShader->GetPipeline()->GetLayout(),
-			VK_SHADER_STAGE_FRAGMENT_BIT,
-			0, sizeof(glm::mat4), &shadowMatrix);
 
+	// G-Buffer Pass, keeps the pre-pass depth so the objects visible last frame only pass the equal depth test.
+	if (mGraph->BeginPass(cmdBuffer, mRG.gbuffer))
+	{
+		VKIRenderPass* gbufferPass = mStageOcclusion->IsEnabled() ? mGBufferLoadPass.get() : mGBufferPass.get();
+		gbufferPass->Begin(cmdBuffer, mGBufferFB.get(), viewport);
+		mScene->DrawSceneDeferred(cmdBuffer, mFrame, mStageOcclusion.get());
+		gbufferPass->End(cmdBuffer);
+	}
 
-		vkCmdDraw(cmdBuffer->GetCurrent(), 3, 1, 0, 0);
 
 
-		// Draw Helpers...
+	// Lighting Pass...
+	if (mGraph->BeginPass(cmdBuffer, mRG.lighting))
+	{
 		if (stage == ERenderSceneStage::Normal)
 		{
-			mScene->DrawHelpers(cmdBuffer, mFrame);
+			// The main view is recorded into secondary command buffers, the sun light is cached until its inputs change.
+			mLightingPass->Begin(cmdBuffer, mLightingFB.get(), viewport, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
 
-			if (mScene->GetEnvironment().isLightProbeVisualize)
+			RenderPassCacheKey key;
+			key.Add(mLightingPass->Get());
+			key.Add(mLightingShader->GetPipeline()->Get());
+			key.AddDescriptorSet(mScene->GetSunLightDescSet(), mFrame);
+			key.Add(mScene->GetSunShadow()->GetShadowMatrix());
+			key.Add(viewport);
+
+			if (VKICommandBuffer* passCmd = mPassCache->Begin(mRC.sunLight, mFrame, key.Get(), mLightingPass.get()))
 			{
-				mStageLightProbes->RenderVisualize(cmdBuffer, mFrame, mScene->GetEnvironment().mSelectedLightProbe);
+				SetViewport(passCmd, viewport);
+				RecordSunLighting(passCmd);
+				mPassCache->End(mRC.sunLight, mFrame);
 			}
+
+			mPassCache->Execute(cmdBuffer, mRC.sunLight, mFrame);
+
+			// Probes & helpers follow the scene, recorded every render after the additive sun light.
+			VKICommandBuffer* dynamicCmd = mPassCache->Begin(mRC.lightingDynamic, mFrame,
+				RENDER_PASS_CACHE_NEVER, mLightingPass.get());
+
+			SetViewport(dynamicCmd, viewport);
+			RecordProbesLighting(dynamicCmd);
+			RecordHelpers(dynamicCmd, stage);
+			mPassCache->End(mRC.lightingDynamic, mFrame);
+
+			mPassCache->Execute(cmdBuffer, mRC.lightingDynamic, mFrame);
+		}
+		else
+		{
+			mLightingPass->Begin(cmdBuffer, mLightingFB.get(), viewport);
+			RecordProbesLighting(cmdBuffer);
+			RecordSunLighting(cmdBuffer);
+			RecordHelpers(cmdBuffer, stage);
 		}
 
 		mLightingPass->End(cmdBuffer);
@@ -297,6 +474,57 @@ void RendererPipeline::RenderSceneStage(VKICommandBuffer* cmdBuffer, ERenderScen
 }
 
 
+void RendererPipeline::SetViewport(VKICommandBuffer* cmdBuffer, const glm::ivec4& viewport) const
+{
+	VkViewport vkViewport = { (float)viewport.x, (float)viewport.y, (float)viewport.z, (float)viewport.w, 0.0f, 1.0f };
+	VkRect2D scissor = { { viewport.x, viewport.y }, { (uint32_t)viewport.z, (uint32_t)viewport.w } };
+
+	vkCmdSetViewport(cmdBuffer->GetCurrent(), 0, 1, &vkViewport);
+	vkCmdSetScissor(cmdBuffer->GetCurrent(), 0, 1, &scissor);
+}
+
+
+void RendererPipeline::RecordProbesLighting(VKICommandBuffer* cmdBuffer)
+{
+	// render light probes in the scene.
+	mStageLightProbes->Render(cmdBuffer, mFrame, mScene->GetLightProbes());
+
+	// render irradiance volumes in the scene.
+	mStageLightProbes->Render(cmdBuffer, mFrame, mScene->GetIrradianceVolumes());
+}
+
+
+void RendererPipeline::RecordSunLighting(VKICommandBuffer* cmdBuffer)
+{
+	mLightingShader->Bind(cmdBuffer);
+	mScene->GetSunLightDescSet()->Bind(cmdBuffer, mFrame, mLightingShader->GetPipeline());
+
+	RenderDirShadow* shadow = mScene->GetSunShadow();
+	glm::mat4 shadowMatrix = shadow->GetShadowMatrix();
+
+	vkCmdPushConstants(cmdBuffer->GetCurrent(),
+		mLightingShader->GetPipeline()->GetLayout(),
+		VK_SHADER_STAGE_FRAGMENT_BIT,
+		0, sizeof(glm::mat4), &shadowMatrix);
+
+	vkCmdDraw(cmdBuffer->GetCurrent(), 3, 1, 0, 0);
+}
+
+
+void RendererPipeline::RecordHelpers(VKICommandBuffer* cmdBuffer, ERenderSceneStage stage)
+{
+	if (stage != ERenderSceneStage::Normal)
+		return;
+
+	mScene->DrawHelpers(cmdBuffer, mFrame);
+
+	if (mScene->GetEnvironment().isLightProbeVisualize)
+	{
+		mStageLightProbes->RenderVisualize(cmdBuffer, mFrame, mScene->GetEnvironment().mSelectedLightProbe);
+	}
+}
+
+
 void RendererPipeline::UpdateShadows(VKICommandBuffer* cmdBuffer)
 {
 	// The Sun Shadow...
@@ -346,27 +574,33 @@ void RendererPipeline::UpdateLightProbes(VKICommandBuffer* cmdBuffer)
 	for (RenderLightProbe* probe : lightProbes)
 	{
 		// Need Update?
-		if (!probe->GetDirty() != 0)
+		if (probe->GetDirty() == 0)
 			continue;
 
+		// Out of frame memory? keep the probe dirty to capture it next frame.
+		uint32_t faceOffsets[6];
+
+		if (!PushCaptureBlocks(probeCommon, probe->GetPosition(), faceOffsets))
+		{
+			probe->SetDirty(probe->GetDirty() + 1);
+			continue;
+		}
+
 
 		// Capture the scene for each cubemap face.
 		for (uint32_t iface = 0; iface < 6; ++iface)
 		{
+			mCommonOffset = faceOffsets[iface];
 			probeCommon.viewProjMatrix = Transform::GetCubeViewProj(iface, probe->GetPosition());
-			probeCommon.viewProjMatrixInverse = glm::inverse(probeCommon.viewProjMatrix);
-			probeCommon.nearFar = glm::vec2(1.0, 32000.0f);
-
-			mUniforms.common->CmdUpdate(cmdBuffer, mFrame,
-				0, sizeof(GUniform::CommonBlock), &probeCommon);
 
 			// Render The Scene for light probe stae.
-			RenderSceneStage(cmdBuffer, ERenderSceneStage::LightProbe);
+			RenderSceneStage(cmdBuffer, ERenderSceneStage::LightProbe, 1 + iface, probeCommon.viewProjMatrix, riViewport);
 
 			//
 			probe->GetRadiance()->TransitionImageLayout(cmdBuffer->GetCurrent(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT);
 
 			// Render the captured scene into the cubemap.
+			mGraph->BeginPass(cmdBuffer, mRG.capture);
 			mStageLightProbes->RenderCaptureCube(cmdBuffer, mFrame, probe, iface, riViewport);
 
 			//
@@ -374,8 +608,17 @@ void RendererPipeline::UpdateLightProbes(VKICommandBuffer* cmdBuffer)
 		}
 
 
-		// Pre-Filter cube map and store it into the probe images to be used later for lighting.
-		mStageLightProbes->FilterIrradiance(cmdBuffer, mFrame, probe, riViewport);
+		// Pre-Filter cube map and store it into the probe images to be used later for lighting,
+		// the async filter wait until all the captures are done as they may still sample the irradiance.
+		if (mIsAsyncCompute)
+		{
+			mAsyncProbes.push_back(probe);
+			continue;
+		}
+
+		probe->GetIrradiance()->TransitionImageLayout(cmdBuffer->GetCurrent(), VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_ASPECT_COLOR_BIT);
+		mStageLightProbes->FilterIrradiance(cmdBuffer, probe);
+		probe->GetIrradiance()->TransitionImageLayout(cmdBuffer->GetCurrent(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT);
 	}
 
 	// Clear Dirty Flag.
@@ -383,12 +626,11 @@ void RendererPipeline::UpdateLightProbes(VKICommandBuffer* cmdBuffer)
 		probe->SetDirty(probe->GetDirty() - 1);
 
 
-	// Reset Common Block Uniform...
-	mUniforms.common->CmdUpdate(cmdBuffer, mFrame,
-		0, sizeof(GUniform::CommonBlock), &mCommonBlock);
+	// Reset Common Block to the main view...
+	mCommonOffset = mMainCommonOffset;
 
 
-	mWaitForUpdate = true;
+	mIsUpdatingProbes = true;
 }
 
 
@@ -423,33 +665,45 @@ void RendererPipeline::UpdateIrradianceVolumes(VKICommandBuffer* cmdBuffer)
 	for (RenderIrradianceVolume* volume : irVolumes)
 	{
 		// Need Update?
-		if (!volume->GetDirty() != 0)
+		if (volume->GetDirty() == 0)
 			continue;
 
+		if (mIsAsyncCompute)
+		{
+			mAsyncVolumes.push_back(volume);
+		}
+
 		uint32_t np = volume->GetNumProbes();
+		bool isOutOfMemory = false;
 
 		// Iterate over all probes in the volume.
 		for (uint32_t iP = 0; iP < np; ++iP )
 		{
 			glm::vec3 probePosition = volume->GetProbePosition(iP);
 
+			// Out of frame memory? skip the probe & keep the volume dirty to capture it next frame.
+			uint32_t faceOffsets[6];
+
+			if (!PushCaptureBlocks(probeCommon, probePosition, faceOffsets))
+			{
+				isOutOfMemory = true;
+				continue;
+			}
+
 			// Capture the scene for each cubemap face.
 			for (uint32_t iface = 0; iface < 6; ++iface)
 			{
+				mCommonOffset = faceOffsets[iface];
 				probeCommon.viewProjMatrix = Transform::GetCubeViewProj(iface, probePosition);
-				probeCommon.viewProjMatrixInverse = glm::inverse(probeCommon.viewProjMatrix);
-				probeCommon.nearFar = glm::vec2(1.0, 32000.0f);
-
-				mUniforms.common->CmdUpdate(cmdBuffer, mFrame,
-					0, sizeof(GUniform::CommonBlock), &probeCommon);
 
 				// Render The Scene for light probe stae.
-				RenderSceneStage(cmdBuffer, ERenderSceneStage::LightProbe);
+				RenderSceneStage(cmdBuffer, ERenderSceneStage::LightProbe, 1 + iface, probeCommon.viewProjMatrix, riViewport);
 
 				volume->GetRadiance()->TransitionImageLayout(cmdBuffer->GetCurrent(), 
 					VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT);
 
 				// Render the captured scene into the cubemap.
+				mGraph->BeginPass(cmdBuffer, mRG.capture);
 				mStageLightProbes->RenderCaptureCube(cmdBuffer, mFrame, volume, volume->GetProbeLayer(iP, iface), riViewport);
 
 				volume->GetRadiance()->TransitionImageLayout(cmdBuffer->GetCurrent(), 
@@ -458,9 +712,20 @@ void RendererPipeline::UpdateIrradianceVolumes(VKICommandBuffer* cmdBuffer)
 			}
 
 			// Pre-Filter cube map and store it into the probe images to be used later for lighting.
-			mStageLightProbes->FilterIrradianceVolume(cmdBuffer, mFrame, volume, iP, riViewport);
+			if (!mIsAsyncCompute)
+			{
+				volume->GetIrradiance()->TransitionImageLayout(cmdBuffer->GetCurrent(),
+					VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_ASPECT_COLOR_BIT);
+
+				mStageLightProbes->FilterIrradianceVolume(cmdBuffer, volume, iP);
+
+				volume->GetIrradiance()->TransitionImageLayout(cmdBuffer->GetCurrent(),
+					VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT);
+			}
 		}
 
+		if (isOutOfMemory)
+			volume->SetDirty(volume->GetDirty() + 1);
 	}
 	
 
@@ -471,12 +736,64 @@ void RendererPipeline::UpdateIrradianceVolumes(VKICommandBuffer* cmdBuffer)
 		volume->SetDirty(volume->GetDirty() - 1);
 
 
-	// Reset Common Block Uniform...
-	mUniforms.common->CmdUpdate(cmdBuffer, mFrame,
-		0, sizeof(GUniform::CommonBlock), &mCommonBlock);
+	// Reset Common Block to the main view...
+	mCommonOffset = mMainCommonOffset;
+
+
+	mIsUpdatingProbes = true;
+}
+
+
+void RendererPipeline::FilterProbesAsync(VKICommandBuffer* cmdBuffer)
+{
+	if (mAsyncProbes.empty() && mAsyncVolumes.empty())
+		return;
+
+	// Begin the async compute commands of this frame, submitted after the graphics commands.
+	VKICommandBuffer* computeCmd = mDevice->GetComputeCmd();
+	computeCmd->SetCurrent(mFrame);
+
+	VkCommandBufferBeginInfo cmdBeginInfo{};
+	cmdBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	cmdBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkBeginCommandBuffer(computeCmd->GetCurrent(), &cmdBeginInfo);
+	mHasAsyncCompute = true;
 
+	// The layout transitions are done on the graphics queue, the compute queue wait for it with a semaphore.
+	for (RenderLightProbe* probe : mAsyncProbes)
+	{
+		probe->GetIrradiance()->TransitionImageLayout(cmdBuffer->GetCurrent(), VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_ASPECT_COLOR_BIT);
+		mStageLightProbes->FilterIrradiance(computeCmd, probe);
+	}
+
+	for (RenderIrradianceVolume* volume : mAsyncVolumes)
+	{
+		volume->GetIrradiance()->TransitionImageLayout(cmdBuffer->GetCurrent(), VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_ASPECT_COLOR_BIT);
+
+		for (uint32_t iP = 0; iP < volume->GetNumProbes(); ++iP)
+			mStageLightProbes->FilterIrradianceVolume(computeCmd, volume, iP);
+	}
+
+	mAsyncProbes.clear();
+	mAsyncVolumes.clear();
+}
 
-	mWaitForUpdate = true;
+
+void RendererPipeline::ResolveProbesAsync(VKICommandBuffer* cmdBuffer)
+{
+	// Only the async filter leave the irradiance in the general layout between renders.
+	for (RenderLightProbe* probe : mScene->GetLightProbes())
+	{
+		if (probe->GetIrradiance()->GetLayout() == VK_IMAGE_LAYOUT_GENERAL)
+			probe->GetIrradiance()->TransitionImageLayout(cmdBuffer->GetCurrent(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT);
+	}
+
+	for (RenderIrradianceVolume* volume : mScene->GetIrradianceVolumes())
+	{
+		if (volume->GetIrradiance()->GetLayout() == VK_IMAGE_LAYOUT_GENERAL)
+			volume->GetIrradiance()->TransitionImageLayout(cmdBuffer->GetCurrent(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT);
+	}
 }
 
 
@@ -484,26 +801,22 @@ void RendererPipeline::Destroy()
 {
 	// Destroy Stages...
 	mStageLightProbes->Destroy();
+	mStageOcclusion->Destroy();
 
 
-	// Destory Uniforms...
-	mUniforms.common->Destroy();
-
+	// Destroy transient targets...
+	mGraph->Destroy();
 
 	// Destory G-Buffer...
-	mAlbedoTarget.Destroy();
-	mBRDFTarget.Destroy();
-	mNormalsTarget.Destroy();
 	mDepthTarget.Destroy();
 	mGBufferPass->Destroy();
+	mGBufferLoadPass->Destroy();
 	mGBufferFB->Destroy();
 
 
 	// Targets...
 	mHDRTarget[0].Destroy();
 	mHDRTarget[1].Destroy();
-	mLDRTarget[0].Destroy();
-	mLDRTarget[1].Destroy();
 
 	// Passes...
 	mLightingPass->Destroy();
@@ -517,81 +830,48 @@ void RendererPipeline::Destroy()
 	mBlitSwapchain->Destroy();
 	mDirShadowPass->Destroy();
 
-}
-
+	mPassCache->Destroy();
 
-void RendererPipeline::SetupUniforms()
-{
-	mUniforms.common = UniquePtr<RenderUniform>(new RenderUniform());
-	mUniforms.common->SetTransferDst(true);
-	mUniforms.common->Create(Application::Get().GetRenderer(), sizeof(GUniform::CommonBlock), false);
+	mTimestamps->Destroy();
 
 }
 
 
-void RendererPipeline::SetupGBufferPass()
+bool RendererPipeline::PushCommonBlock(const GUniform::CommonBlock& block)
 {
-	const VkExtent2D size = { (uint32_t)mSize.x, (uint32_t)mSize.y };
+	RenderFrameAllocation allocation = Application::Get().GetRenderer()->GetFrameAllocator()
+		->Push(&block, sizeof(GUniform::CommonBlock));
 
-	// Albedo...
-	{
-		mAlbedoTarget.image = UniquePtr<VKIImage>(new VKIImage());
-		mAlbedoTarget.image->SetUsage(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
-		mAlbedoTarget.image->SetImageInfo(VK_IMAGE_TYPE_2D, VK_FORMAT_R8G8B8A8_UNORM, size,
-			VK_IMAGE_LAYOUT_UNDEFINED);
-		mAlbedoTarget.image->Create(mDevice);
+	// Out of frame memory? the offset of another view must not be reused.
+	if (!allocation.IsValid())
+		return false;
 
-		mAlbedoTarget.view = UniquePtr<VKIImageView>(new VKIImageView());
-		mAlbedoTarget.view->SetType(VK_IMAGE_VIEW_TYPE_2D);
-		mAlbedoTarget.view->SetViewInfo(VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1);
-		mAlbedoTarget.view->Create(mDevice, mAlbedoTarget.image.get());
-
-		mAlbedoTarget.sampler = UniquePtr<VKISampler>(new VKISampler());
-		mAlbedoTarget.sampler->SetFilter(VK_FILTER_NEAREST, VK_FILTER_NEAREST);
-		mAlbedoTarget.sampler->SetAddressMode(VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
-		mAlbedoTarget.sampler->CreateSampler(mDevice);
-	}
+	mCommonOffset = allocation.offset;
+	return true;
+}
 
 
-	// BRDF...
+bool RendererPipeline::PushCaptureBlocks(GUniform::CommonBlock& block, const glm::vec3& position, uint32_t* faceOffsets)
+{
+	for (uint32_t iface = 0; iface < 6; ++iface)
 	{
-		mBRDFTarget.image = UniquePtr<VKIImage>(new VKIImage());
-		mBRDFTarget.image->SetUsage(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
-		mBRDFTarget.image->SetImageInfo(VK_IMAGE_TYPE_2D, VK_FORMAT_R8G8B8A8_UNORM, size,
-			VK_IMAGE_LAYOUT_UNDEFINED);
-		mBRDFTarget.image->Create(mDevice);
+		block.viewProjMatrix = Transform::GetCubeViewProj(iface, position);
+		block.viewProjMatrixInverse = glm::inverse(block.viewProjMatrix);
+		block.nearFar = glm::vec2(1.0, 32000.0f);
 
-		mBRDFTarget.view = UniquePtr<VKIImageView>(new VKIImageView());
-		mBRDFTarget.view->SetType(VK_IMAGE_VIEW_TYPE_2D);
-		mBRDFTarget.view->SetViewInfo(VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1);
-		mBRDFTarget.view->Create(mDevice, mBRDFTarget.image.get());
+		if (!PushCommonBlock(block))
+			return false;
 
-		mBRDFTarget.sampler = UniquePtr<VKISampler>(new VKISampler());
-		mBRDFTarget.sampler->SetFilter(VK_FILTER_NEAREST, VK_FILTER_NEAREST);
-		mBRDFTarget.sampler->SetAddressMode(VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
-		mBRDFTarget.sampler->CreateSampler(mDevice);
+		faceOffsets[iface] = mCommonOffset;
 	}
 
+	return true;
+}
 
-	// Normals...
-	{
-		mNormalsTarget.image = UniquePtr<VKIImage>(new VKIImage());
-		mNormalsTarget.image->SetUsage(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
-		mNormalsTarget.image->SetImageInfo(VK_IMAGE_TYPE_2D, VK_FORMAT_R16G16B16A16_SFLOAT, size,
-			VK_IMAGE_LAYOUT_UNDEFINED);
-		mNormalsTarget.image->Create(mDevice);
-
-		mNormalsTarget.view = UniquePtr<VKIImageView>(new VKIImageView());
-		mNormalsTarget.view->SetType(VK_IMAGE_VIEW_TYPE_2D);
-		mNormalsTarget.view->SetViewInfo(VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1);
-		mNormalsTarget.view->Create(mDevice, mNormalsTarget.image.get());
-
-		mNormalsTarget.sampler = UniquePtr<VKISampler>(new VKISampler());
-		mNormalsTarget.sampler->SetFilter(VK_FILTER_NEAREST, VK_FILTER_NEAREST);
-		mNormalsTarget.sampler->SetAddressMode(VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
-		mNormalsTarget.sampler->CreateSampler(mDevice);
-	}
 
+void RendererPipeline::SetupGBufferPass()
+{
+	const VkExtent2D size = { (uint32_t)mSize.x, (uint32_t)mSize.y };
 
 	// Depth...
 	{
@@ -613,62 +893,58 @@ void RendererPipeline::SetupGBufferPass()
 	}
 
 
-	// RenderPass...
+	// RenderPass, the load pass keeps the depth of the occlusion culling depth pre-pass.
 	mGBufferPass = UniquePtr<VKIRenderPass>(new VKIRenderPass());
-	mGBufferPass->SetColorAttachment(0, mAlbedoTarget.image->GetFormat(), 
-		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-		VK_IMAGE_LAYOUT_UNDEFINED,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-		VK_ATTACHMENT_LOAD_OP_CLEAR, true);
-
-	mGBufferPass->SetColorAttachment(1, mBRDFTarget.image->GetFormat(),
-		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-		VK_IMAGE_LAYOUT_UNDEFINED,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-		VK_ATTACHMENT_LOAD_OP_CLEAR, true);
-
-	mGBufferPass->SetColorAttachment(2, mNormalsTarget.image->GetFormat(),
-		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-		VK_IMAGE_LAYOUT_UNDEFINED,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-		VK_ATTACHMENT_LOAD_OP_CLEAR, true);
-
-	mGBufferPass->SetColorAttachment(3, mHDRTarget[0].image->GetFormat(),
-		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-		VK_IMAGE_LAYOUT_UNDEFINED,
-		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-		VK_ATTACHMENT_LOAD_OP_CLEAR, true);
-
-	mGBufferPass->SetDepthAttachment(mDepthTarget.image->GetFormat(),
-		VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
-		VK_IMAGE_LAYOUT_UNDEFINED,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-		VK_ATTACHMENT_LOAD_OP_CLEAR, true, false);
-
-	mGBufferPass->AddDependency(VK_SUBPASS_EXTERNAL, 0,
-		VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 
-		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
-		VK_ACCESS_MEMORY_READ_BIT, 
-		VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-		VK_DEPENDENCY_BY_REGION_BIT);
-
-	mGBufferPass->AddDependency(0, VK_SUBPASS_EXTERNAL,
-		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
-		VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-		VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-		VK_ACCESS_MEMORY_READ_BIT,
-		VK_DEPENDENCY_BY_REGION_BIT);
+	mGBufferLoadPass = UniquePtr<VKIRenderPass>(new VKIRenderPass());
 
+	VKIRenderPass* gbufferPasses[2] = { mGBufferPass.get(), mGBufferLoadPass.get() };
 
-	std::vector<VkClearValue> clearValues(5);
-	clearValues[0].color = { 0.0f, 0.0f, 0.0f, 0.0f };
-	clearValues[1].color = { 0.0f, 0.0f, 0.0f, 0.0f };
-	clearValues[2].color = { 0.0f, 0.0f, 0.0f, 0.0f };
-	clearValues[3].color = { 0.0f, 0.0f, 0.0f, 0.0f };
-	clearValues[4].depthStencil = { 1.0f, 0};
-	mGBufferPass->SetClearValues(clearValues);
-
-	mGBufferPass->CreateRenderPass(mDevice);
+	for (uint32_t i = 0; i < 2; ++i)
+	{
+		VKIRenderPass* pass = gbufferPasses[i];
+
+		// Layouts & dependencies are handled by the render graph barriers.
+		pass->SetColorAttachment(0, mAlbedoTarget.image->GetFormat(), 
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			VK_ATTACHMENT_LOAD_OP_CLEAR, true);
+
+		pass->SetColorAttachment(1, mBRDFTarget.image->GetFormat(),
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			VK_ATTACHMENT_LOAD_OP_CLEAR, true);
+
+		pass->SetColorAttachment(2, mNormalsTarget.image->GetFormat(),
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			VK_ATTACHMENT_LOAD_OP_CLEAR, true);
+
+		pass->SetColorAttachment(3, mHDRTarget[0].image->GetFormat(),
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			VK_ATTACHMENT_LOAD_OP_CLEAR, true);
+
+		pass->SetDepthAttachment(mDepthTarget.image->GetFormat(),
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+			pass == mGBufferPass.get() ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD, true, false);
+
+
+		std::vector<VkClearValue> clearValues(5);
+		clearValues[0].color = { 0.0f, 0.0f, 0.0f, 0.0f };
+		clearValues[1].color = { 0.0f, 0.0f, 0.0f, 0.0f };
+		clearValues[2].color = { 0.0f, 0.0f, 0.0f, 0.0f };
+		clearValues[3].color = { 0.0f, 0.0f, 0.0f, 0.0f };
+		clearValues[4].depthStencil = { 1.0f, 0};
+		pass->SetClearValues(clearValues);
+
+		pass->CreateRenderPass(mDevice);
+	}
 
 	// Framebuffer...
 	mGBufferFB = UniquePtr<VKIFramebuffer>(new VKIFramebuffer());
@@ -707,27 +983,63 @@ void RendererPipeline::SetupTargets()
 		mHDRTarget[i].sampler->CreateSampler(mDevice);
 	}
 
+}
 
-	// LDR 0 & 1...
-	for (uint32_t i = 0; i < 2; ++i)
-	{
-		mLDRTarget[i].image = UniquePtr<VKIImage>(new VKIImage());
-		mLDRTarget[i].image->SetUsage(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
-		mLDRTarget[i].image->SetImageInfo(VK_IMAGE_TYPE_2D, VK_FORMAT_R8G8B8A8_UNORM, size,
-			VK_IMAGE_LAYOUT_UNDEFINED);
-		mLDRTarget[i].image->Create(mDevice);
 
-		mLDRTarget[i].view = UniquePtr<VKIImageView>(new VKIImageView);
-		mLDRTarget[i].view->SetType(VK_IMAGE_VIEW_TYPE_2D);
-		mLDRTarget[i].view->SetViewInfo(VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1);
-		mLDRTarget[i].view->Create(mDevice, mLDRTarget[i].image.get());
+void RendererPipeline::SetupGraph()
+{
+	const VkExtent2D size = { (uint32_t)mSize.x, (uint32_t)mSize.y };
+	const VkImageUsageFlags targetUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
 
-		mLDRTarget[i].sampler = UniquePtr<VKISampler>(new VKISampler());
-		mLDRTarget[i].sampler->SetFilter(VK_FILTER_LINEAR, VK_FILTER_LINEAR);
-		mLDRTarget[i].sampler->SetAddressMode(VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
-		mLDRTarget[i].sampler->CreateSampler(mDevice);
-	}
+	mGraph = UniquePtr<RenderGraph>(new RenderGraph());
+
+	// Transient Targets, only used between the passes below...
+	mRG.albedo = mGraph->AddTransient("Albedo", &mAlbedoTarget,
+		{ VK_FORMAT_R8G8B8A8_UNORM, targetUsage, VK_IMAGE_ASPECT_COLOR_BIT, VK_FILTER_NEAREST });
+
+	mRG.brdf = mGraph->AddTransient("BRDF", &mBRDFTarget,
+		{ VK_FORMAT_R8G8B8A8_UNORM, targetUsage, VK_IMAGE_ASPECT_COLOR_BIT, VK_FILTER_NEAREST });
+
+	mRG.normals = mGraph->AddTransient("Normals", &mNormalsTarget,
+		{ VK_FORMAT_R16G16B16A16_SFLOAT, targetUsage, VK_IMAGE_ASPECT_COLOR_BIT, VK_FILTER_NEAREST });
 
+	mRG.ldr = mGraph->AddTransient("LDR", &mLDRTarget,
+		{ VK_FORMAT_R8G8B8A8_UNORM, targetUsage, VK_IMAGE_ASPECT_COLOR_BIT, VK_FILTER_LINEAR });
+
+	// Imported Targets, also used by the light probes & occlusion culling stages...
+	mRG.hdr = mGraph->ImportTarget("HDR", &mHDRTarget[0], VK_IMAGE_ASPECT_COLOR_BIT, false);
+	mRG.depth = mGraph->ImportTarget("Depth", &mDepthTarget, VK_IMAGE_ASPECT_DEPTH_BIT, false);
+
+
+	// Passes, in the order they are recorded...
+	mRG.gbuffer = mGraph->AddPass("GBuffer", false);
+	mGraph->Write(mRG.gbuffer, mRG.albedo, ERenderGraphUsage::ColorAttachment, true);
+	mGraph->Write(mRG.gbuffer, mRG.brdf, ERenderGraphUsage::ColorAttachment, true);
+	mGraph->Write(mRG.gbuffer, mRG.normals, ERenderGraphUsage::ColorAttachment, true);
+	mGraph->Write(mRG.gbuffer, mRG.hdr, ERenderGraphUsage::ColorAttachment, true);
+	mGraph->Write(mRG.gbuffer, mRG.depth, ERenderGraphUsage::DepthAttachment, false); // May load the pre-pass depth.
+
+	mRG.lighting = mGraph->AddPass("Lighting", false);
+	mGraph->Read(mRG.lighting, mRG.albedo, ERenderGraphUsage::SampledFragment);
+	mGraph->Read(mRG.lighting, mRG.brdf, ERenderGraphUsage::SampledFragment);
+	mGraph->Read(mRG.lighting, mRG.normals, ERenderGraphUsage::SampledFragment);
+	mGraph->Read(mRG.lighting, mRG.depth, ERenderGraphUsage::SampledFragment);
+	mGraph->Write(mRG.lighting, mRG.hdr, ERenderGraphUsage::ColorAttachment, false);
+
+	// Light probes capture, writes the probes radiance outside the graph.
+	mRG.capture = mGraph->AddPass("ProbeCapture", true);
+	mGraph->Read(mRG.capture, mRG.hdr, ERenderGraphUsage::SampledFragment);
+	mGraph->Read(mRG.capture, mRG.depth, ERenderGraphUsage::SampledFragment);
+
+	mRG.postProcess = mGraph->AddPass("PostProcess", false);
+	mGraph->Read(mRG.postProcess, mRG.hdr, ERenderGraphUsage::SampledFragment);
+	mGraph->Write(mRG.postProcess, mRG.ldr, ERenderGraphUsage::ColorAttachment, true);
+
+	// Blit to the swapchain, presented outside the graph.
+	mRG.blit = mGraph->AddPass("Blit", true);
+	mGraph->Read(mRG.blit, mRG.ldr, ERenderGraphUsage::SampledFragment);
+
+	mGraph->Compile(mDevice, size);
 }
 
 
@@ -741,23 +1053,9 @@ void RendererPipeline::SetupLightingPass()
 	mLightingPass->SetColorAttachment(0, mHDRTarget[0].image->GetFormat(), 
 		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
 		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
 		VK_ATTACHMENT_LOAD_OP_LOAD, true);
 
-	mLightingPass->AddDependency(VK_SUBPASS_EXTERNAL, 0,
-		VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-		VK_ACCESS_MEMORY_READ_BIT,
-		VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-		VK_DEPENDENCY_BY_REGION_BIT);
-
-	mLightingPass->AddDependency(0, VK_SUBPASS_EXTERNAL,
-		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-		VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-		VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-		VK_ACCESS_MEMORY_READ_BIT,
-		VK_DEPENDENCY_BY_REGION_BIT);
-
 	mLightingPass->CreateRenderPass(mDevice);
 
 
@@ -784,7 +1082,7 @@ void RendererPipeline::SetupLightingPass()
 	mLightingShader->SetBlendingEnabled(0, true);
 	mLightingShader->SetBlending(0, ERenderBlendFactor::One, ERenderBlendFactor::One, ERenderBlendOp::Add);
 
-	mLightingShader->AddInput(RenderShader::COMMON_BLOCK_BINDING, ERenderShaderInputType::Uniform,
+	mLightingShader->AddInput(RenderShader::COMMON_BLOCK_BINDING, ERenderShaderInputType::DynamicUniform,
 		ERenderShaderStage::AllStages);
 
 	mLightingShader->AddInput(1, ERenderShaderInputType::ImageSampler,
@@ -815,32 +1113,18 @@ void RendererPipeline::SetupPostProcessPass()
 	// Render Pass...
 	mPostProPass = UniquePtr<VKIRenderPass>(new VKIRenderPass());
 
-	mPostProPass->SetColorAttachment(0, mLDRTarget[0].image->GetFormat(),
+	mPostProPass->SetColorAttachment(0, mLDRTarget.image->GetFormat(),
+		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
 		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-		VK_IMAGE_LAYOUT_UNDEFINED,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
 		VK_ATTACHMENT_LOAD_OP_DONT_CARE, true);
 
-	mPostProPass->AddDependency(VK_SUBPASS_EXTERNAL, 0,
-		VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-		VK_ACCESS_MEMORY_READ_BIT,
-		VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-		VK_DEPENDENCY_BY_REGION_BIT);
-
-	mPostProPass->AddDependency(0, VK_SUBPASS_EXTERNAL,
-		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-		VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-		VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-		VK_ACCESS_MEMORY_READ_BIT,
-		VK_DEPENDENCY_BY_REGION_BIT);
-
 	mPostProPass->CreateRenderPass(mDevice);
 
 
 	// Framebuffer...
 	mPostProFB = UniquePtr<VKIFramebuffer>(new VKIFramebuffer());
-	mPostProFB->SetImgView(0, mLDRTarget[0].view.get());
+	mPostProFB->SetImgView(0, mLDRTarget.view.get());
 	mPostProFB->SetSize(size);
 	mPostProFB->CreateFrameBuffer(mDevice, mPostProPass.get());
 
@@ -853,7 +1137,7 @@ void RendererPipeline::SetupPostProcessPass()
 	mPostProShader->SetBlendingEnabled(0, false);
 	mPostProShader->SetViewport(glm::ivec4(0, 0, size.width, size.height));
 	mPostProShader->SetViewportDynamic(true);
-	mPostProShader->AddInput(0, ERenderShaderInputType::Uniform, ERenderShaderStage::AllStages);
+	mPostProShader->AddInput(0, ERenderShaderInputType::DynamicUniform, ERenderShaderStage::AllStages);
 	mPostProShader->AddInput(1, ERenderShaderInputType::ImageSampler, ERenderShaderStage::Fragment);
 	mPostProShader->Create();
 
@@ -862,8 +1146,7 @@ void RendererPipeline::SetupPostProcessPass()
 	ppDescSet->SetLayout(mPostProShader->GetLayout());
 	ppDescSet->CreateDescriptorSet(mDevice, Renderer::NUM_CONCURRENT_FRAMES);
 
-	ppDescSet->AddDescriptor(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL,
-		mUniforms.common->GetBuffers());
+	AddCommonToDescSet(ppDescSet);
 
 	ppDescSet->AddDescriptor(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT,
 		mHDRTarget[0].view.get(), mHDRTarget[0].sampler.get());
@@ -886,7 +1169,7 @@ void RendererPipeline::SetupBlitSwapchain()
 	mBlitSwapchain->SetBlendingEnabled(0, false);
 	mBlitSwapchain->SetViewport(glm::ivec4(0, 0, size.width, size.height));
 	mBlitSwapchain->SetViewportDynamic(true);
-	mBlitSwapchain->AddInput(0, ERenderShaderInputType::Uniform, ERenderShaderStage::AllStages);
+	mBlitSwapchain->AddInput(0, ERenderShaderInputType::DynamicUniform, ERenderShaderStage::AllStages);
 	mBlitSwapchain->AddInput(1, ERenderShaderInputType::ImageSampler, ERenderShaderStage::Fragment);
 	mBlitSwapchain->Create();
 
@@ -895,11 +1178,10 @@ void RendererPipeline::SetupBlitSwapchain()
 	swDescSet->SetLayout(mBlitSwapchain->GetLayout());
 	swDescSet->CreateDescriptorSet(mDevice, Renderer::NUM_CONCURRENT_FRAMES);
 
-	swDescSet->AddDescriptor(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL,
-		mUniforms.common->GetBuffers());
+	AddCommonToDescSet(swDescSet);
 
 	swDescSet->AddDescriptor(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT,
-		mLDRTarget[0].view.get(), mLDRTarget[0].sampler.get());
+		mLDRTarget.view.get(), mLDRTarget.sampler.get());
 
 	swDescSet->UpdateSets();
 
@@ -917,19 +1199,18 @@ void RendererPipeline::SetupShadowPasses()
 		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
 		VK_ATTACHMENT_LOAD_OP_CLEAR, true, false);
 
-	mGBufferPass->AddDependency(VK_SUBPASS_EXTERNAL, 0,
-		VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-		VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
-		VK_ACCESS_MEMORY_READ_BIT,
-		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
-		VK_DEPENDENCY_BY_REGION_BIT);
+	// Depth is read by lighting & by the occlusion culling depth pyramid build.
+	mDirShadowPass->AddDependency(VK_SUBPASS_EXTERNAL, 0,
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+		VK_ACCESS_SHADER_READ_BIT,
+		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT);
 
-	mGBufferPass->AddDependency(0, VK_SUBPASS_EXTERNAL,
-		VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
-		VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
-		VK_ACCESS_MEMORY_READ_BIT,
-		VK_DEPENDENCY_BY_REGION_BIT);
+	mDirShadowPass->AddDependency(0, VK_SUBPASS_EXTERNAL,
+		VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+		VK_ACCESS_SHADER_READ_BIT);
 
 	std::vector<VkClearValue> clearValues(1);
 	clearValues[0].depthStencil = { 1.0f, 0 };
@@ -946,10 +1227,33 @@ void RendererPipeline::SetupShadowPasses()
 }
 
 
+void RendererPipeline::SetupPassCache()
+{
+	mPassCache = UniquePtr<RenderPassCache>(new RenderPassCache());
+	mPassCache->Create(mDevice, Renderer::NUM_CONCURRENT_FRAMES);
+
+	mRC.sunLight = mPassCache->AddPass("SunLight");
+	mRC.lightingDynamic = mPassCache->AddPass("LightingDynamic");
+	mRC.postProcess = mPassCache->AddPass("PostProcess");
+	mRC.blit = mPassCache->AddPass("Blit");
+}
+
+
+void RendererPipeline::AddCommonToDescSet(VKIDescriptorSet* descSet)
+{
+	RenderFrameAllocator* allocator = Application::Get().GetRenderer()->GetFrameAllocator();
+
+	descSet->AddDescriptor(RenderShader::COMMON_BLOCK_BINDING, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+		VK_SHADER_STAGE_ALL, allocator->GetBuffers(), 0, sizeof(GUniform::CommonBlock));
+
+	// The offset is read when the set is bound, so all views share the same set.
+	descSet->SetDynamicOffset(RenderShader::COMMON_BLOCK_BINDING, &mCommonOffset);
+}
+
+
 void RendererPipeline::AddGBufferToDescSet(VKIDescriptorSet* descSet)
 {
-	descSet->AddDescriptor(RenderShader::COMMON_BLOCK_BINDING, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-		VK_SHADER_STAGE_ALL, mUniforms.common->GetBuffers());
+	AddCommonToDescSet(descSet);
 
 	descSet->AddDescriptor(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
 		VK_SHADER_STAGE_FRAGMENT_BIT, mAlbedoTarget.view.get(), mAlbedoTarget.sampler.get());
@@ -34,6 +34,7 @@
 #include "glm/vec4.hpp"
 
 #include <tuple>
+#include <vector>
 
 
 
@@ -41,6 +42,11 @@ class RenderShader;
 class RenderScene;
 class RenderUniform;
 class RenderStageLightProbes;
+class RenderStageOcclusion;
+class RenderGraph;
+class RenderPassCache;
+class RenderLightProbe;
+class RenderIrradianceVolume;
 
 
 class VKIDevice;
@@ -52,6 +58,7 @@ class VKIImageView;
 class VKISampler;
 class VKICommandBuffer;
 class VKIDescriptorSet;
+class VKIQueryPool;
 
 
 
@@ -59,23 +66,80 @@ class VKIDescriptorSet;
 
 
 
-// Uniforms used by the renderer pipeline.
-struct RendererPipelineUniform
+//
+enum class ERenderSceneStage : uint32_t
 {
-	// Common Uniform.
-	UniquePtr<RenderUniform> common;
+	Normal,
+	LightProbe,
+};
+
 
+
+// The pipeline resources & passes in the render graph.
+struct RendererGraphHandles
+{
+	// G-Buffer Targets.
+	uint32_t albedo;
+	uint32_t brdf;
+	uint32_t normals;
+	uint32_t depth;
+
+	// HDR & LDR Targets.
+	uint32_t hdr;
+	uint32_t ldr;
+
+	// Passes.
+	uint32_t gbuffer;
+	uint32_t lighting;
+	uint32_t capture;
+	uint32_t postProcess;
+	uint32_t blit;
 };
 
 
 
+// The pipeline passes with commands cached in secondary command buffers.
+struct RendererCachedHandles
+{
+	// The sun light of the lighting pass.
+	uint32_t sunLight;
 
+	// The light probes & helpers of the lighting pass, recorded every render.
+	uint32_t lightingDynamic;
 
-//
-enum class ERenderSceneStage : uint32_t
+	// Tone-Mapping & Blit.
+	uint32_t postProcess;
+	uint32_t blit;
+};
+
+
+
+// The pipeline render resolution, the scene is rendered into a viewport of the targets then upscaled to the output.
+//    - only used by the thread rendering frames, the settings are copied from the frame settings of each frame.
+struct RendererResolution
 {
-	Normal,
-	LightProbe,
+	// If true the render scale is adjusted from the measured gpu time to keep it near the target time.
+	bool isDynamic;
+
+	// The gpu time in milliseconds the dynamic resolution try to keep.
+	float targetTime;
+
+	// The range of the dynamic render scale.
+	float minScale;
+	float maxScale;
+
+	// The current render scale of the output size.
+	float scale;
+
+	// The last measured & the smoothed gpu time in milliseconds.
+	float gpuTime;
+	float smoothTime;
+
+	// The size we render the scene at.
+	glm::ivec2 renderSize;
+
+	// The size we output the final render to, the swapchain size.
+	glm::ivec2 outputSize;
 };
 
 
@@ -104,7 +168,7 @@ public:
 	// Destroy The Pipeline.
 	void Destroy();
 
-	// Resize the pipeline targets.
+	// Resize the pipeline output, the targets are only used up to their size.
 	void Resize(const glm::ivec2& size);
 
 	// Return G-Buffer Render Pass.
@@ -114,9 +178,15 @@ public:
 	inline VKIRenderPass* GetDirShadowPass() const { return mDirShadowPass.get(); }
 	inline VKIRenderPass* GetOmniShadowPass() const { return mOmniShadowPass.get(); }
 
-	// Return the size of the 
+	// Return the size of the pipeline render targets.
 	inline glm::ivec2 GetSize() const { return mSize; };
 
+	// Return the render resolution, only valid on the thread rendering frames.
+	inline const RendererResolution& GetResolution() const { return mResolution; }
+
+	// Set the resolution settings for the next renders, the scale is only used if the resolution isn't dynamic.
+	void SetResolutionSettings(bool isDynamic, float targetTime, float scale);
+
 	// Begin Rendering.
 	void BeginRender(uint32_t frame, RenderScene* rscene, const glm::vec4& viewport);
 
@@ -126,32 +196,55 @@ public:
 	// Render The Scene through the entire pipeline.
 	void Render(VKICommandBuffer* cmdBuffer);
 
-	// Should we wait for update before rendering next frame.
-	inline bool IsWaitForUpdate() const { return mWaitForUpdate; }
+	// Return true if the last render updated light probes or irradiance volumes.
+	inline bool IsUpdatingProbes() const { return mIsUpdatingProbes; }
+
+	// Filter probes on the async compute queue in the next renders, ignored if the device has no compute queue.
+	inline void SetAsyncCompute(bool isAsyncCompute) { mIsAsyncCompute = isAsyncCompute; }
+
+	// Return true if the last render recorded commands into the async compute command buffer.
+	inline bool HasAsyncCompute() const { return mHasAsyncCompute; }
 
 	// Perfrom a swapchain render step where we copy the final render to the swapchain image.
 	void FinalToSwapchain(VKICommandBuffer* cmdBuffer, uint32_t imgIndex);
 
-	// Retrun the uniforms.
-	inline const RendererPipelineUniform& GetUniforms() const { return mUniforms; }
-
 	// Returm LightProbes renderer stage.
 	inline RenderStageLightProbes* GetStageLightProbes() const { return mStageLightProbes.get(); }
 
+	// Return the occlusion culling stage.
+	inline RenderStageOcclusion* GetStageOcclusion() const { return mStageOcclusion.get(); }
+
+	// Return the render graph.
+	inline RenderGraph* GetGraph() const { return mGraph.get(); }
+
+	// Return the cache of the pass commands.
+	inline RenderPassCache* GetPassCache() const { return mPassCache.get(); }
+
 	// Returm the lighting passe.
 	inline VKIRenderPass* GetLightingPass() const { return mLightingPass.get(); }
 	inline RenderShader* GetSunLightingShader() const { return mLightingShader.get(); }
 
+	// Add the common block binding to a descriptor set, its offset follow the current view.
+	void AddCommonToDescSet(VKIDescriptorSet* descSet);
+
 	// Add GBuffer targets binding to a descriptor set.
 	void AddGBufferToDescSet(VKIDescriptorSet* descSet);
 
 private:
-	// Setup/Create the renderer pipeline uniforms.
-	void SetupUniforms();
+	// Push a common block into the frame allocator and make it the current one.
+	// @return false if the frame is out of memory, the current block is left unchanged & must not be used.
+	bool PushCommonBlock(const GUniform::CommonBlock& block);
+
+	// Push the common blocks of the 6 cube faces of a capture at a position into the frame allocator.
+	// @return false if the frame is out of memory, the capture must be skipped.
+	bool PushCaptureBlocks(GUniform::CommonBlock& block, const glm::vec3& position, uint32_t* faceOffsets);
 
-	// Setup HDR & LDR targets used for rendering.
+	// Setup HDR targets used for rendering.
 	void SetupTargets();
 
+	// Declare the pipeline passes & create the transient targets.
+	void SetupGraph();
+
 	// Setup GBuffer Targets & Render Pass.
 	void SetupGBufferPass();
 
@@ -167,6 +260,21 @@ private:
 	// Setup the shadow passes.
 	void SetupShadowPasses();
 
+	// Add the passes with cached commands.
+	void SetupPassCache();
+
+	// Set the viewport & scissor, secondary command buffers don't inherit them.
+	void SetViewport(VKICommandBuffer* cmdBuffer, const glm::ivec4& viewport) const;
+
+	// Record the light probes & irradiance volumes lighting.
+	void RecordProbesLighting(VKICommandBuffer* cmdBuffer);
+
+	// Record the sun lighting.
+	void RecordSunLighting(VKICommandBuffer* cmdBuffer);
+
+	// Record the helpers of a scene stage on top of the lighting.
+	void RecordHelpers(VKICommandBuffer* cmdBuffer, ERenderSceneStage stage);
+
 	// Rende Scene Shadow Maps.
 	void UpdateShadows(VKICommandBuffer* cmdBuffer);
 
@@ -176,8 +284,21 @@ private:
 	// Update Scene Irradiance Volumes.
 	void UpdateIrradianceVolumes(VKICommandBuffer* cmdBuffer);
 
+	// Filter the probes captured this render on the async compute queue.
+	void FilterProbesAsync(VKICommandBuffer* cmdBuffer);
+
+	// Transition the irradiance written by the async compute of the last render back to shader read.
+	void ResolveProbesAsync(VKICommandBuffer* cmdBuffer);
+
+	// Update the render scale from the gpu time of the last render.
+	void UpdateResolution(float gpuTime);
+
+	// Compute the render viewport from the render scale & the output size.
+	void ComputeRenderViewport();
+
 	// The stage for rendering the scene, the scene is rendered into the 
-	void RenderSceneStage(VKICommandBuffer* cmdBuffer, ERenderSceneStage stage);
+	void RenderSceneStage(VKICommandBuffer* cmdBuffer, ERenderSceneStage stage, uint32_t view,
+		const glm::mat4& viewProj, const glm::ivec4& viewport);
 
 private:
 	// The vulkan device.
@@ -193,14 +314,29 @@ private:
 	glm::vec4 mViewport;
 	glm::vec4 mIntViewport;
 
+	// The output viewport, the swapchain area we upscale the final render to.
+	glm::ivec4 mOutputViewport;
+
+	// The render resolution & dynamic resolution settings.
+	RendererResolution mResolution;
+
+	// Timestamps at the start & end of each concurrent frame render.
+	UniquePtr<VKIQueryPool> mTimestamps;
+
+	// True if the timestamps of a concurrent frame were written & not read yet.
+	std::vector<bool> mHasTimestamps;
+
 	// Flag to check if we are currently rendering.
 	bool mIsRendering;
 
 	// The index of the concurrent frame we are currently rendering.
 	uint32_t mFrame;
 
-	// The uniforms used & update by the renderer pipeline.
-	RendererPipelineUniform mUniforms;
+	// Offset of the current common block in the frame allocator buffer.
+	uint32_t mCommonOffset;
+
+	// Offset of the main view common block in the frame allocator buffer.
+	uint32_t mMainCommonOffset;
 
 	// The scene we are currently rendering.
 	RenderScene* mScene;
@@ -218,11 +354,26 @@ private:
 	StageRenderTarget mHDRTarget[2];
 
 	// LDR Target.
-	StageRenderTarget mLDRTarget[2];
+	StageRenderTarget mLDRTarget;
+
+	// The render graph, handle barriers & the memory of transient targets.
+	UniquePtr<RenderGraph> mGraph;
+
+	// The pipeline handles in the render graph.
+	RendererGraphHandles mRG;
+
+	// The cache of the pass commands that are the same every render.
+	UniquePtr<RenderPassCache> mPassCache;
+
+	// The pipeline handles in the pass cache.
+	RendererCachedHandles mRC;
 
 	// GBuffer Render Pass.
 	UniquePtr<VKIRenderPass> mGBufferPass;
 
+	// GBuffer Render Pass that loads the depth of the occlusion culling pre-pass instead of clearing it.
+	UniquePtr<VKIRenderPass> mGBufferLoadPass;
+
 	// GBuffer Framebuffer.
 	UniquePtr<VKIFramebuffer> mGBufferFB;
 
@@ -246,8 +397,20 @@ private:
 	// Render Stage for updating light probes.
 	UniquePtr<RenderStageLightProbes> mStageLightProbes;
 
-	// If last frame has updated data and we should wait for it 
-	//		to be finished before rendering next frame
-	bool mWaitForUpdate;
+	// Render Stage for occlusion culling.
+	UniquePtr<RenderStageOcclusion> mStageOcclusion;
+
+	// True if the current render updates light probes or irradiance volumes.
+	bool mIsUpdatingProbes;
+
+	// True if probes are filtered on the async compute queue.
+	bool mIsAsyncCompute;
+
+	// True if the current render recorded commands into the async compute command buffer.
+	bool mHasAsyncCompute;
+
+	// Light probes & irradiance volumes captured by the current render waiting for the async filter.
+	std::vector<RenderLightProbe*> mAsyncProbes;
+	std::vector<RenderIrradianceVolume*> mAsyncVolumes;
 };
 
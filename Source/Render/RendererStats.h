@@ -0,0 +1,76 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+
+#pragma once
+
+
+
+
+#include "Renderer.h"
+#include "RendererPipeline.h"
+#include "RenderStageOcclusion.h"
+#include "RenderGraph.h"
+#include "RenderPassCache.h"
+#include "RenderTextureStreamer.h"
+#include "RenderData/RenderScene.h"
+#include "RenderData/Shaders/RenderFrameAllocator.h"
+#include "VKInterface/VKIUploadManager.h"
+#include "VKInterface/VKIMipGenerator.h"
+#include "VKInterface/VKIDeletionQueue.h"
+#include "Core/OcclusionRasterizer.h"
+
+
+
+
+// The stats of the last rendered frame:
+//    - written by the thread rendering frames & copied to the main thread with Renderer::GetStats, the main thread
+//      never reads the state the render thread is writing.
+//
+struct RendererStats
+{
+	// The frame pacing stats.
+	RendererFrameStats frame;
+
+	// The render resolution & its settings the frame was rendered with.
+	RendererResolution resolution;
+
+	// The scene draws & the frame allocator use.
+	RDDrawStats draws;
+	RenderFrameAllocatorStats frameAllocator;
+
+	// The streamed textures.
+	RenderTextureStreamerStats textureStreamer;
+
+	// The occlusion culling of each view & the software occlusion rasterizer.
+	OcclusionViewStats occlusionViews[OCCLUSION_MAX_VIEWS];
+	OcclusionRasterizerStats occlusionRasterizer;
+
+	// The render graph & the cached passes.
+	RenderGraphStats graph;
+	RenderPassCacheStats passCache;
+
+	// The uploads, the mips generated for them & the deferred deletes.
+	VKIUploadStats uploads;
+	VKIMipStats mips;
+	VKIDeletionStats deletions;
+};
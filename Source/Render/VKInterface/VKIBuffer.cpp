@@ -22,7 +22,10 @@
 
 #include "VKIBuffer.h"
 #include "VKIDevice.h"
+#include "VKIInstance.h"
 #include "VKICommandBuffer.h"
+#include "VKIUploadManager.h"
+#include "VKIDeletionQueue.h"
 
 
 
@@ -36,6 +39,7 @@ VKIBuffer::VKIBuffer()
 	, mProperties(0)
 	, mVKDevice(nullptr)
 	, mSize(0)
+	, mMapped(nullptr)
 {
 
 }
@@ -80,6 +84,17 @@ void VKIBuffer::CreateBuffer(VKIDevice* owner)
 	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 	bufferInfo.flags = 0;
 
+	// Buffers written by the transfer queue are shared with the graphics queue.
+	const VKIQueueFamiles& queues = mVKDevice->GetInstance()->GetQueues();
+	uint32_t sharedQueues[2] = { queues.graphics, queues.transfer };
+
+	if ((mUsage & VK_BUFFER_USAGE_TRANSFER_DST_BIT) && queues.IsTransferUnique())
+	{
+		bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		bufferInfo.queueFamilyIndexCount = 2;
+		bufferInfo.pQueueFamilyIndices = sharedQueues;
+	}
+
 	VkResult result = vkCreateBuffer(mVKDevice->Get(), &bufferInfo, nullptr, &mHandle);
 	CHECK(result == VK_SUCCESS);
 
@@ -105,6 +120,15 @@ void VKIBuffer::AllocateMemory()
 	// Bind the buffer to its memory.
 	result = vkBindBufferMemory(mVKDevice->Get(), mHandle, mMemory, 0);
 	CHECK(result == VK_SUCCESS);
+
+	// Host visible memory is persistently mapped.
+	if (mProperties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+	{
+		void* mapped = nullptr;
+		result = vkMapMemory(mVKDevice->Get(), mMemory, 0, VK_WHOLE_SIZE, 0, &mapped);
+		CHECK(result == VK_SUCCESS);
+		mMapped = reinterpret_cast<uint8_t*>(mapped);
+	}
 }
 
 
@@ -123,19 +147,17 @@ void VKIBuffer::GetMemoryInfo(VkDeviceSize& outAllocateSize, uint32_t& outTypeIn
 
 void VKIBuffer::Destroy()
 {
-	// Destroy Memory.
-	vkFreeMemory(mVKDevice->Get(), mMemory, nullptr);
-
-	// Destroy Buffer.
-	vkDestroyBuffer(mVKDevice->Get(), mHandle, nullptr);
-
-	// Destroy staging if valid?
-	if (mStaging)
+	// Unmap...
+	if (mMapped)
 	{
-		mStaging->Destroy();
-		mStaging.reset();
+		vkUnmapMemory(mVKDevice->Get(), mMemory);
+		mMapped = nullptr;
 	}
 
+	// Destroy Buffer & Memory once the frames using them are done.
+	mVKDevice->GetDeletionQueue()->Push(mHandle);
+	mVKDevice->GetDeletionQueue()->Push(mMemory);
+
 	//...
 	mHandle = VK_NULL_HANDLE;
 	mMemory = VK_NULL_HANDLE;
@@ -150,11 +172,32 @@ void VKIBuffer::UpdateData(const void* data)
 
 void VKIBuffer::UpdateData(VkDeviceSize offset, VkDeviceSize size, const void* data)
 {
-	CHECK(mProperties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT && "Memory must be host visible.");
+	CHECK(mMapped && "Memory must be host visible.");
+
+	memcpy(mMapped + offset, data, size);
+	FlushMapped(offset, size);
+}
 
-	void* buffer;
-	vkMapMemory(mVKDevice->Get(), mMemory, offset, size, 0, &buffer);
-	memcpy(buffer, data, size);
+
+void VKIBuffer::FlushMapped(VkDeviceSize offset, VkDeviceSize size)
+{
+	// Host Coherent?
+	if (mProperties & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+		return;
+
+	VkMappedMemoryRange range{};
+	range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+	range.memory = mMemory;
+	range.offset = offset;
+	range.size = VK_WHOLE_SIZE;
+	VkResult result = vkFlushMappedMemoryRanges(mVKDevice->Get(), 1, &range);
+	CHECK(result == VK_SUCCESS);
+}
+
+
+void VKIBuffer::ReadData(VkDeviceSize offset, VkDeviceSize size, void* outData)
+{
+	CHECK(mMapped && "Memory must be host visible.");
 
 	// Not Host Coherent?
 	if ((mProperties & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) == 0)
@@ -164,56 +207,23 @@ void VKIBuffer::UpdateData(VkDeviceSize offset, VkDeviceSize size, const void* d
 		range.memory = mMemory;
 		range.offset = offset;
 		range.size = VK_WHOLE_SIZE;
-		VkResult result = vkFlushMappedMemoryRanges(mVKDevice->Get(), 1, &range);
+		VkResult result = vkInvalidateMappedMemoryRanges(mVKDevice->Get(), 1, &range);
 		CHECK(result == VK_SUCCESS);
 	}
 
-	
-	// Unmap...
-	vkUnmapMemory(mVKDevice->Get(), mMemory);
+	memcpy(outData, mMapped + offset, size);
 }
 
 
-void VKIBuffer::UpdateDataStaging(const void* data)
+VKIUploadHandle VKIBuffer::UpdateDataStaging(const void* data)
 {
-	UpdateDataStaging(0, mSize, data);
-}
-
-
-void VKIBuffer::UpdateDataStaging(VkDeviceSize offset, VkDeviceSize size, const void* data)
-{
-	// New Staging?
-	if (!mStaging)
-	{
-		mStaging = Ptr<VKIBuffer>(new VKIBuffer());
-		mStaging->SetSize(size);
-		mStaging->SetUsage(VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-		mStaging->SetMemoryProperties(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-		mStaging->CreateBuffer(mVKDevice);
-		mStaging->UpdateData(offset, size, data);
-
-		VkCommandBuffer cmd = mVKDevice->BeginTransientCmd();
-
-		VkBufferCopy region{};
-		region.srcOffset = 0;
-		region.dstOffset = offset;
-		region.size = size;
-		vkCmdCopyBuffer(cmd, mStaging->Get(), mHandle, 1, &region);
-
-		mVKDevice->EndTransientCmd(cmd, Delegate<>::CreateMemberRaw(this, &VKIBuffer::DestroyStaging));
-	}
-	else
-	{
-		mStaging->UpdateData(offset, size, data);
-	}
-
+	return UpdateDataStaging(0, mSize, data);
 }
 
 
-void VKIBuffer::DestroyStaging()
+VKIUploadHandle VKIBuffer::UpdateDataStaging(VkDeviceSize offset, VkDeviceSize size, const void* data)
 {
-	mStaging->Destroy();
-	mStaging.reset();
+	return mVKDevice->GetUploader()->UploadBuffer(this, offset, size, data);
 }
 
 
@@ -25,6 +25,7 @@
 
 
 #include "Core/Core.h"
+#include "VKIUploadManager.h"
 #include "vulkan/vulkan.h"
 
 
@@ -77,9 +78,12 @@ public:
 	void UpdateData(const void* data);
 	void UpdateData(VkDeviceSize offset, VkDeviceSize size, const void* data);
 
-	// Update data using staging buffer, used for local device memory.
-	void UpdateDataStaging(const void* data);
-	void UpdateDataStaging(VkDeviceSize offset, VkDeviceSize size, const void* data);
+	// Read buffer data by mapping the buffer memory, only used on host visible buffers.
+	void ReadData(VkDeviceSize offset, VkDeviceSize size, void* outData);
+
+	// Update data through the device upload manager, used for local device memory.
+	VKIUploadHandle UpdateDataStaging(const void* data);
+	VKIUploadHandle UpdateDataStaging(VkDeviceSize offset, VkDeviceSize size, const void* data);
 
 	// Return the size of the buffer.
 	inline VkDeviceSize GetSize() const { return mSize; }
@@ -87,6 +91,12 @@ public:
 	// Update the buffer using vkCmdUpdateBuffer.
 	void CmdUpdate(VKICommandBuffer* cmdBuffer, uint32_t offset, uint32_t size, const void* data);
 
+	// Return the persistently mapped memory of host visible buffers, null otherwise.
+	inline uint8_t* GetMapped() const { return mMapped; }
+
+	// Flush a range of the mapped memory, only needed if the memory is not host coherent.
+	void FlushMapped(VkDeviceSize offset, VkDeviceSize size);
+
 private:
 	// Allocate Device Memory for the created vulkan buffer.
 	void AllocateMemory();
@@ -94,9 +104,6 @@ private:
 	// Get the memory type index that best suits the created buffer.
 	void GetMemoryInfo(VkDeviceSize& outAllocateSize, uint32_t& outTypeIndex);
 
-	// Destroy Staging after it was submited & finished.
-	void DestroyStaging();
-
 private:
 	// Vulkan Buffer Handle.
 	VkBuffer mHandle;
@@ -116,8 +123,8 @@ private:
 	// The Buffer size in bytes.
 	VkDeviceSize mSize;
 
-	// Staging Buffer.
-	Ptr<VKIBuffer> mStaging;
+	// The mapped memory of host visible buffers, mapped once for the lifetime of the buffer.
+	uint8_t* mMapped;
 };
 
 
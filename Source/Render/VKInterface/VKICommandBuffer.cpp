@@ -53,6 +53,12 @@ void VKICommandBuffer::Destroy()
 
 
 void VKICommandBuffer::CreateCmdBuffer(VKIDevice* owner, VkCommandPool pool, uint32_t count)
+{
+	CreateCmdBuffer(owner, pool, count, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+}
+
+
+void VKICommandBuffer::CreateCmdBuffer(VKIDevice* owner, VkCommandPool pool, uint32_t count, VkCommandBufferLevel level)
 {
 	mVKDevice = owner;
 	mCmdPool = pool;
@@ -62,7 +68,7 @@ void VKICommandBuffer::CreateCmdBuffer(VKIDevice* owner, VkCommandPool pool, uin
 	VkCommandBufferAllocateInfo cmdBufferAllocInfo{};
 	cmdBufferAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 	cmdBufferAllocInfo.commandPool = mCmdPool;
-	cmdBufferAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	cmdBufferAllocInfo.level = level;
 	cmdBufferAllocInfo.commandBufferCount = (uint32_t)mCmdBuffers.size();
 
 	VkResult result = vkAllocateCommandBuffers(mVKDevice->Get(), &cmdBufferAllocInfo, mCmdBuffers.data());
@@ -60,6 +60,7 @@ public:
 
 	// Create/Allocate Command Buffers.
 	void CreateCmdBuffer(VKIDevice* owner, VkCommandPool pool, uint32_t count);
+	void CreateCmdBuffer(VKIDevice* owner, VkCommandPool pool, uint32_t count, VkCommandBufferLevel level);
 
 	// Set current command buffer used by the current frame.
 	inline void SetCurrent(uint32_t index) { mCurrentIndex = index; }
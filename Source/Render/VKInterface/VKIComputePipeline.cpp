@@ -0,0 +1,207 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#include "VKIComputePipeline.h"
+#include "VKIDevice.h"
+#include "VKIDescriptor.h"
+#include "VKICommandBuffer.h"
+#include "VKIDeletionQueue.h"
+
+
+
+#include <fstream>
+
+
+
+
+
+VKIComputePipeline::VKIComputePipeline()
+	: mHandle(VK_NULL_HANDLE)
+	, mVKDevice(nullptr)
+	, mEntry("main")
+	, mDescriptorLayout(nullptr)
+	, mLayout(VK_NULL_HANDLE)
+{
+
+}
+
+
+VKIComputePipeline::~VKIComputePipeline()
+{
+
+}
+
+
+void VKIComputePipeline::SetShader(const std::string& src)
+{
+	SetShader(src, "main");
+}
+
+
+void VKIComputePipeline::SetShader(const std::string& src, const std::string& entry)
+{
+	mSource = src;
+	mEntry = entry;
+}
+
+
+void VKIComputePipeline::SetDescriptorLayout(VKIDescriptorLayout* descriptorLayout)
+{
+	mDescriptorLayout = descriptorLayout;
+}
+
+
+void VKIComputePipeline::SetPushConstant(uint32_t index, uint32_t offset, uint32_t size)
+{
+	if (mPushConstant.size() < index + 1)
+		mPushConstant.resize(index + 1);
+
+	mPushConstant[index].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	mPushConstant[index].offset = offset;
+	mPushConstant[index].size = size;
+}
+
+
+void VKIComputePipeline::CreatePipeline(VKIDevice* owner)
+{
+	CHECK(!mSource.empty() && "Invalid Pipeline Data.");
+
+	VkResult result = VK_SUCCESS;
+	mVKDevice = owner;
+
+
+	// Shader Module...
+	std::vector<uint8_t> code;
+	ReadShaderFile(mSource, code);
+
+	VkShaderModuleCreateInfo moduleInfo{};
+	moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	moduleInfo.codeSize = code.size();
+	moduleInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+
+	VkShaderModule shaderModule;
+	result = vkCreateShaderModule(mVKDevice->Get(), &moduleInfo, nullptr, &shaderModule);
+	CHECK(result == VK_SUCCESS && "Failed to create shader module!");
+
+
+	// Pipeline Layout...
+	CreatePiplineLayout();
+
+
+	// Create Pipeline...
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = shaderModule;
+	pipelineInfo.stage.pName = mEntry.c_str();
+	pipelineInfo.layout = mLayout;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+	result = vkCreateComputePipelines(mVKDevice->Get(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &mHandle);
+	CHECK(result == VK_SUCCESS);
+
+
+	// The shader module is no longer needed.
+	vkDestroyShaderModule(mVKDevice->Get(), shaderModule, nullptr);
+}
+
+
+void VKIComputePipeline::Recreate()
+{
+	Destroy();
+	CreatePipeline(mVKDevice);
+}
+
+
+void VKIComputePipeline::Destroy()
+{
+	// Destroy Lyaout.
+	vkDestroyPipelineLayout(mVKDevice->Get(), mLayout, nullptr);
+
+	// Destroy Compute Pipeline once the frames using it are done...
+	mVKDevice->GetDeletionQueue()->Push(mHandle);
+
+	//...
+	mHandle = VK_NULL_HANDLE;
+	mLayout = VK_NULL_HANDLE;
+}
+
+
+void VKIComputePipeline::Bind(VKICommandBuffer* cmdBuffer) const
+{
+	vkCmdBindPipeline(cmdBuffer->GetCurrent(), VK_PIPELINE_BIND_POINT_COMPUTE, mHandle);
+}
+
+
+void VKIComputePipeline::ReadShaderFile(const std::string& filename, std::vector<uint8_t>& outCode)
+{
+	// Open a file for reading as binary and start from the end.
+	std::ifstream file(filename, std::ios::ate | std::ios::binary);
+
+	// Is Valid?
+	if (!file.is_open())
+	{
+		// Empty...
+		outCode.clear();
+		LOGE("Can't open shader file (%s)", filename.c_str());
+		return;
+	}
+
+	// Read the file...
+	size_t fileSize = (size_t)file.tellg();
+	outCode.resize(fileSize);
+
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(outCode.data()), fileSize);
+
+	file.close();
+}
+
+
+void VKIComputePipeline::CreatePiplineLayout()
+{
+	VkDescriptorSetLayout descLayout = VK_NULL_HANDLE;
+
+	// Create Pipeline Layout...
+	VkPipelineLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+
+	// Has Descriptors?
+	if (mDescriptorLayout)
+	{
+		descLayout = mDescriptorLayout->Get();
+		layoutInfo.setLayoutCount = 1;
+		layoutInfo.pSetLayouts = &descLayout;
+	}
+
+	// Has Push Constants?
+	if (!mPushConstant.empty())
+	{
+		layoutInfo.pushConstantRangeCount = (uint32_t)mPushConstant.size();
+		layoutInfo.pPushConstantRanges = mPushConstant.data();
+	}
+
+	// Create the pipeline layout and test if sucess.
+	VkResult result = vkCreatePipelineLayout(mVKDevice->Get(), &layoutInfo, nullptr, &mLayout);
+	CHECK(result == VK_SUCCESS && "failed to create pipeline layout!");
+}
@@ -0,0 +1,118 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#pragma once
+
+
+
+#include "Core/Core.h"
+#include "vulkan/vulkan.h"
+
+#include <vector>
+#include <string>
+
+
+
+
+class VKIDevice;
+class VKIDescriptorLayout;
+class VKICommandBuffer;
+
+
+
+
+
+
+
+// VKIComputePipeline:
+//    - Handle vulkan compute pipeline.
+//
+class VKIComputePipeline
+{
+public:
+	// Construct.
+	VKIComputePipeline();
+
+	// Destruct.
+	~VKIComputePipeline();
+
+	// Return the vulkan handle.
+	inline VkPipeline Get() const { return mHandle; }
+
+	// Return pipeline layout.
+	inline VkPipelineLayout GetLayout() const { return mLayout; }
+
+	// Return true if the vulkan handle is valid.
+	inline bool IsValid() const { return mHandle != VK_NULL_HANDLE; }
+
+	// Create vulkan compute pipeline.
+	void CreatePipeline(VKIDevice* owner);
+
+	// Destroy vulkan compute pipeline.
+	void Destroy();
+
+	// Recreate the pipeline.
+	void Recreate();
+
+	// Bind the pipeline to the compute bind point.
+	void Bind(VKICommandBuffer* cmdBuffer) const;
+
+public:
+	// Set shader source.
+	void SetShader(const std::string& src);
+	void SetShader(const std::string& src, const std::string& entry);
+
+	// Set descriptor layout to be used by this pipeline.
+	void SetDescriptorLayout(VKIDescriptorLayout* descriptorLayout);
+
+	// Set a push constants.
+	void SetPushConstant(uint32_t index, uint32_t offset, uint32_t size);
+
+private:
+	// Read shader source from file.
+	void ReadShaderFile(const std::string& filename, std::vector<uint8_t>& outCode);
+
+	// Create the pipeline layout using the descriptor layout & push constants.
+	void CreatePiplineLayout();
+
+private:
+	// Vulkan Pipeline Handle.
+	VkPipeline mHandle;
+
+	// The device that owns this pipline.
+	VKIDevice* mVKDevice;
+
+	// The path to the shader source.
+	std::string mSource;
+
+	// Shader Entry Point.
+	std::string mEntry;
+
+	// Pipline Descriptor Layout.
+	VKIDescriptorLayout* mDescriptorLayout;
+
+	// The Pipeline Layout.
+	VkPipelineLayout mLayout;
+
+	// The Pipeline Push Constants.
+	std::vector<VkPushConstantRange> mPushConstant;
+};
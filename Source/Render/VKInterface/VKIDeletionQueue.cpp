@@ -0,0 +1,214 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "VKIDeletionQueue.h"
+#include "VKIDevice.h"
+
+
+#include <algorithm>
+
+
+
+
+
+
+
+
+VKIDeletionQueue::VKIDeletionQueue()
+	: mVKDevice(nullptr)
+	, mFrame(0)
+	, mNumFrames(0)
+{
+	mStats = VKIDeletionStats{};
+}
+
+
+VKIDeletionQueue::~VKIDeletionQueue()
+{
+
+}
+
+
+void VKIDeletionQueue::Create(VKIDevice* owner, uint32_t numFrames)
+{
+	mVKDevice = owner;
+	mNumFrames = numFrames;
+}
+
+
+void VKIDeletionQueue::Destroy()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	for (const VKIDeletionEntry& entry : mEntries)
+		DestroyEntry(entry);
+
+	mEntries.clear();
+	mStats.numPending = 0;
+}
+
+
+void VKIDeletionQueue::Push(VkBuffer buffer)
+{
+	Add(EVKIDeletionType::Buffer, (uint64_t)buffer);
+}
+
+
+void VKIDeletionQueue::Push(VkImage image)
+{
+	Add(EVKIDeletionType::Image, (uint64_t)image);
+}
+
+
+void VKIDeletionQueue::Push(VkImageView view)
+{
+	Add(EVKIDeletionType::ImageView, (uint64_t)view);
+}
+
+
+void VKIDeletionQueue::Push(VkSampler sampler)
+{
+	Add(EVKIDeletionType::Sampler, (uint64_t)sampler);
+}
+
+
+void VKIDeletionQueue::Push(VkFramebuffer framebuffer)
+{
+	Add(EVKIDeletionType::Framebuffer, (uint64_t)framebuffer);
+}
+
+
+void VKIDeletionQueue::Push(VkRenderPass renderPass)
+{
+	Add(EVKIDeletionType::RenderPass, (uint64_t)renderPass);
+}
+
+
+void VKIDeletionQueue::Push(VkDescriptorPool pool)
+{
+	Add(EVKIDeletionType::DescriptorPool, (uint64_t)pool);
+}
+
+
+void VKIDeletionQueue::Push(VkPipeline pipeline)
+{
+	Add(EVKIDeletionType::Pipeline, (uint64_t)pipeline);
+}
+
+
+void VKIDeletionQueue::Push(VkSwapchainKHR swapchain)
+{
+	Add(EVKIDeletionType::Swapchain, (uint64_t)swapchain);
+}
+
+
+void VKIDeletionQueue::Push(VkDeviceMemory memory)
+{
+	Add(EVKIDeletionType::Memory, (uint64_t)memory);
+}
+
+
+void VKIDeletionQueue::Add(EVKIDeletionType type, uint64_t handle)
+{
+	// Destroying a null handle is a no-op.
+	if (handle == 0)
+		return;
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	mEntries.emplace_back(VKIDeletionEntry{ type, handle, mFrame });
+
+	mStats.numPending = (uint32_t)mEntries.size();
+	mStats.peakPending = std::max(mStats.peakPending, mStats.numPending);
+}
+
+
+void VKIDeletionQueue::NextFrame()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	++mFrame;
+
+	// Objects queued in frame F may be used by frames up to F, which are all done once we are numFrames later.
+	while (!mEntries.empty() && mEntries.front().frame + mNumFrames <= mFrame)
+	{
+		DestroyEntry(mEntries.front());
+		mEntries.pop_front();
+	}
+
+	mStats.numPending = (uint32_t)mEntries.size();
+}
+
+
+VKIDeletionStats VKIDeletionQueue::GetStats()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mStats;
+}
+
+
+void VKIDeletionQueue::DestroyEntry(const VKIDeletionEntry& entry)
+{
+	VkDevice device = mVKDevice->Get();
+
+	switch (entry.type)
+	{
+	case EVKIDeletionType::Buffer:
+		vkDestroyBuffer(device, (VkBuffer)entry.handle, nullptr);
+		break;
+
+	case EVKIDeletionType::Image:
+		vkDestroyImage(device, (VkImage)entry.handle, nullptr);
+		break;
+
+	case EVKIDeletionType::ImageView:
+		vkDestroyImageView(device, (VkImageView)entry.handle, nullptr);
+		break;
+
+	case EVKIDeletionType::Sampler:
+		vkDestroySampler(device, (VkSampler)entry.handle, nullptr);
+		break;
+
+	case EVKIDeletionType::Framebuffer:
+		vkDestroyFramebuffer(device, (VkFramebuffer)entry.handle, nullptr);
+		break;
+
+	case EVKIDeletionType::RenderPass:
+		vkDestroyRenderPass(device, (VkRenderPass)entry.handle, nullptr);
+		break;
+
+	case EVKIDeletionType::DescriptorPool:
+		vkDestroyDescriptorPool(device, (VkDescriptorPool)entry.handle, nullptr);
+		break;
+
+	case EVKIDeletionType::Pipeline:
+		vkDestroyPipeline(device, (VkPipeline)entry.handle, nullptr);
+		break;
+
+	case EVKIDeletionType::Swapchain:
+		vkDestroySwapchainKHR(device, (VkSwapchainKHR)entry.handle, nullptr);
+		break;
+
+	case EVKIDeletionType::Memory:
+		vkFreeMemory(device, (VkDeviceMemory)entry.handle, nullptr);
+		break;
+	}
+
+	++mStats.numDestroyed;
+}
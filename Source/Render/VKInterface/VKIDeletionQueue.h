@@ -0,0 +1,154 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+
+
+
+#include "Core/Core.h"
+#include "vulkan/vulkan.h"
+
+
+#include <deque>
+#include <mutex>
+
+
+
+
+class VKIDevice;
+
+
+
+
+// The type of a vulkan object waiting to be destroyed.
+enum class EVKIDeletionType : uint32_t
+{
+	Buffer,
+	Image,
+	ImageView,
+	Sampler,
+	Framebuffer,
+	RenderPass,
+	DescriptorPool,
+	Pipeline,
+	Swapchain,
+	Memory
+};
+
+
+
+// A vulkan object waiting for the frames that may use it to finish.
+struct VKIDeletionEntry
+{
+	// The object type.
+	EVKIDeletionType type;
+
+	// The object handle.
+	uint64_t handle;
+
+	// The frame the object was queued in.
+	uint64_t frame;
+};
+
+
+
+// Deletion queue stats.
+struct VKIDeletionStats
+{
+	// The number of objects waiting to be destroyed.
+	uint32_t numPending;
+
+	// The peak of objects waiting to be destroyed.
+	uint32_t peakPending;
+
+	// The number of objects destroyed since the queue was created.
+	uint64_t numDestroyed;
+};
+
+
+
+
+// VKIDeletionQueue:
+//    - Defer the destruction of vulkan objects until all the frames in-flight when they were queued are done.
+//    - Objects are tagged with the current frame, a frame is done once the renderer waited for its fence.
+//    - Transient & upload commands are submitted before the frame that follow them, so they are covered too.
+//    - Objects are queued by both the main & render threads, the queue is locked.
+//
+class VKIDeletionQueue
+{
+public:
+	// Construct.
+	VKIDeletionQueue();
+
+	// Destruct.
+	~VKIDeletionQueue();
+
+	// Create the queue for a number of concurrent frames.
+	void Create(VKIDevice* owner, uint32_t numFrames);
+
+	// Destroy all the queued objects, the device must be idle.
+	void Destroy();
+
+	// Queue vulkan objects to be destroyed.
+	void Push(VkBuffer buffer);
+	void Push(VkImage image);
+	void Push(VkImageView view);
+	void Push(VkSampler sampler);
+	void Push(VkFramebuffer framebuffer);
+	void Push(VkRenderPass renderPass);
+	void Push(VkDescriptorPool pool);
+	void Push(VkPipeline pipeline);
+	void Push(VkSwapchainKHR swapchain);
+	void Push(VkDeviceMemory memory);
+
+	// Start the next frame, called after waiting for the fence of the oldest concurrent frame.
+	void NextFrame();
+
+	// Return a copy of the queue stats, they are written by the threads deleting objects.
+	VKIDeletionStats GetStats();
+
+private:
+	// Add an object to the queue.
+	void Add(EVKIDeletionType type, uint64_t handle);
+
+	// Destroy a queued object.
+	void DestroyEntry(const VKIDeletionEntry& entry);
+
+private:
+	// The device that owns this queue.
+	VKIDevice* mVKDevice;
+
+	// The queued objects, oldest first.
+	std::deque<VKIDeletionEntry> mEntries;
+
+	// The current frame.
+	uint64_t mFrame;
+
+	// The number of concurrent frames.
+	uint32_t mNumFrames;
+
+	// The queue stats.
+	VKIDeletionStats mStats;
+
+	// Lock the queued objects.
+	std::mutex mMutex;
+};
@@ -28,6 +28,17 @@
 #include "VKIImage.h"
 #include "VKICommandBuffer.h"
 #include "VKIGraphicsPipeline.h"
+#include "VKIComputePipeline.h"
+#include "VKIDeletionQueue.h"
+
+
+#include <algorithm>
+#include <atomic>
+
+
+
+// Incremented every time a set is updated, the version of the last update of each set.
+static std::atomic<uint64_t> gDescriptorSetVersion(0);
 
 
 
@@ -141,6 +152,7 @@ void VKIDescriptorLayout::Recreate()
 VKIDescriptorSet::VKIDescriptorSet()
 	: mLayout(nullptr)
 	, mVKDevice(nullptr)
+	, mVersion(0)
 {
 
 }
@@ -198,17 +210,15 @@ void VKIDescriptorSet::CreateDescriptorSet(VKIDevice* owner, uint32_t count)
 	descriptorSetAllocInfo.pSetLayouts = layouts.data();
 
 	vkAllocateDescriptorSets(mVKDevice->Get(), &descriptorSetAllocInfo, mHandles.data());
+	mVersion = ++gDescriptorSetVersion;
 
 }
 
 
 void VKIDescriptorSet::Destroy()
 {
-	// Free Sets.
-	vkResetDescriptorPool(mVKDevice->Get(), mPool, 0);
-
-	// Destroy Pool.
-	vkDestroyDescriptorPool(mVKDevice->Get(), mPool, nullptr);
+	// Destroy Pool & its sets once the frames using them are done.
+	mVKDevice->GetDeletionQueue()->Push(mPool);
 
 	//...
 	mHandles.clear();
@@ -218,6 +228,7 @@ void VKIDescriptorSet::Destroy()
 
 void VKIDescriptorSet::UpdateSets()
 {
+	mVersion = ++gDescriptorSetVersion;
 	const uint32_t setCount = (uint32_t)mHandles.size();
 
 	// Infos used to update the writers.
@@ -244,6 +255,7 @@ void VKIDescriptorSet::UpdateSets()
 			{
 			case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
 			case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+			case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
 			{
 				VkDescriptorBufferInfo* bufferInfo = new VkDescriptorBufferInfo();
 				bufferInfo->buffer = mDescriptors[r].buffer[i]->Get();
@@ -257,10 +269,11 @@ void VKIDescriptorSet::UpdateSets()
 
 
 			case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+			case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
 			{
 				VkDescriptorImageInfo* imgInfo = new VkDescriptorImageInfo();
 				imgInfo->imageView = mDescriptors[r].imageView->Get();
-				imgInfo->sampler = mDescriptors[r].sampler->Get();
+				imgInfo->sampler = mDescriptors[r].sampler ? mDescriptors[r].sampler->Get() : VK_NULL_HANDLE;
 				imgInfo->imageLayout = mDescriptors[r].imgLayout;
 				imageInfos.emplace_back(imgInfo);
 
@@ -282,6 +295,8 @@ void VKIDescriptorSet::UpdateSets()
 
 void VKIDescriptorSet::UpdateDescriptorSet(uint32_t index, uint32_t binding)
 {
+	mVersion = ++gDescriptorSetVersion;
+
 	// Infos used to update the writers.
 	Ptr<VkDescriptorBufferInfo> bufferInfo;
 	Ptr<VkDescriptorImageInfo> imgInfo;
@@ -292,13 +307,14 @@ void VKIDescriptorSet::UpdateDescriptorSet(uint32_t index, uint32_t binding)
 	writer.dstBinding = mDescriptors[binding].binding;
 	writer.dstArrayElement = 0;
 	writer.descriptorCount = 1;
-	writer.descriptorType = mDescriptors[index].type;
+	writer.descriptorType = mDescriptors[binding].type;
 	
 	// Descriptor Info based on type...
-	switch (mDescriptors[index].type)
+	switch (mDescriptors[binding].type)
 	{
 	case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
 	case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+	case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
 	{
 		bufferInfo = Ptr<VkDescriptorBufferInfo>(new VkDescriptorBufferInfo());
 		bufferInfo->buffer = mDescriptors[binding].buffer[index]->Get();
@@ -311,10 +327,11 @@ void VKIDescriptorSet::UpdateDescriptorSet(uint32_t index, uint32_t binding)
 	
 	
 	case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+	case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
 	{
 		imgInfo = Ptr<VkDescriptorImageInfo>(new VkDescriptorImageInfo());
 		imgInfo->imageView = mDescriptors[binding].imageView->Get();
-		imgInfo->sampler = mDescriptors[binding].sampler->Get();
+		imgInfo->sampler = mDescriptors[binding].sampler ? mDescriptors[binding].sampler->Get() : VK_NULL_HANDLE;
 		imgInfo->imageLayout = mDescriptors[binding].imgLayout;
 	
 		writer.pImageInfo = imgInfo.get();
@@ -330,9 +347,27 @@ void VKIDescriptorSet::UpdateDescriptorSet(uint32_t index, uint32_t binding)
 }
 
 
+void VKIDescriptorSet::UpdateImage(uint32_t index, uint32_t binding, VKIImageView* view, VKISampler* sampler)
+{
+	for (uint32_t i = 0; i < (uint32_t)mDescriptors.size(); ++i)
+	{
+		if (mDescriptors[i].binding != binding)
+			continue;
+
+		mDescriptors[i].imageView = view;
+		mDescriptors[i].sampler = sampler;
+		UpdateDescriptorSet(index, i);
+		return;
+	}
+
+	CHECK(0 && "Binding not found.");
+}
+
+
 void VKIDescriptorSet::ClearDescriptor()
 {
 	mDescriptors.clear();
+	mDynamicOffsets.clear();
 }
 
 
@@ -382,6 +417,17 @@ void VKIDescriptorSet::AddDescriptor(uint32_t binding, VkDescriptorType type, Vk
 
 void VKIDescriptorSet::AddDescriptor(uint32_t binding, VkDescriptorType type, VkShaderStageFlags stages,
 	VKIImageView* view, VKISampler* sampler, uint32_t count)
+{
+	// Storage images are always accessed in the general layout.
+	VkImageLayout layout = type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE ? VK_IMAGE_LAYOUT_GENERAL
+		: VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	AddDescriptor(binding, type, stages, view, sampler, layout, count);
+}
+
+
+void VKIDescriptorSet::AddDescriptor(uint32_t binding, VkDescriptorType type, VkShaderStageFlags stages,
+	VKIImageView* view, VKISampler* sampler, VkImageLayout layout, uint32_t count)
 {
 	VKIDescriptor descriptor{};
 	descriptor.type = type;
@@ -390,16 +436,48 @@ void VKIDescriptorSet::AddDescriptor(uint32_t binding, VkDescriptorType type, Vk
 	descriptor.count = count;
 	descriptor.imageView = view;
 	descriptor.sampler = sampler;
-	descriptor.imgLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	descriptor.imgLayout = layout;
 
 	mDescriptors.emplace_back(descriptor);
 }
 
 
+void VKIDescriptorSet::SetDynamicOffset(uint32_t binding, const uint32_t* offset)
+{
+	for (auto& dynamicOffset : mDynamicOffsets)
+	{
+		if (dynamicOffset.first == binding)
+		{
+			dynamicOffset.second = offset;
+			return;
+		}
+	}
+
+	mDynamicOffsets.emplace_back(binding, offset);
+	std::sort(mDynamicOffsets.begin(), mDynamicOffsets.end());
+}
+
+
+uint32_t VKIDescriptorSet::GetDynamicOffsets(uint32_t* outOffsets) const
+{
+	CHECK(mDynamicOffsets.size() <= MAX_DYNAMIC_OFFSETS);
+
+	for (size_t i = 0; i < mDynamicOffsets.size(); ++i)
+		outOffsets[i] = *mDynamicOffsets[i].second;
+
+	return (uint32_t)mDynamicOffsets.size();
+}
+
+
 void VKIDescriptorSet::Bind(VKICommandBuffer* cmdBuffer, uint32_t index, const VKIGraphicsPipeline* pipeline) const
 {
-	std::vector<uint32_t> dynamicOffsets;
-	Bind(cmdBuffer, index, pipeline, dynamicOffsets);
+	uint32_t dynamicOffsets[MAX_DYNAMIC_OFFSETS];
+	uint32_t numOffsets = GetDynamicOffsets(dynamicOffsets);
+
+	vkCmdBindDescriptorSets(cmdBuffer->GetCurrent(),
+		VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->GetLayout(),
+		0, 1, &mHandles[index],
+		numOffsets, dynamicOffsets);
 }
 
 
@@ -412,3 +490,16 @@ void VKIDescriptorSet::Bind(VKICommandBuffer* cmdBuffer, uint32_t index, const V
 		(uint32_t)dynamicOffsets.size(), dynamicOffsets.data());
 
 }
+
+
+void VKIDescriptorSet::Bind(VKICommandBuffer* cmdBuffer, uint32_t index, const VKIComputePipeline* pipeline) const
+{
+	uint32_t dynamicOffsets[MAX_DYNAMIC_OFFSETS];
+	uint32_t numOffsets = GetDynamicOffsets(dynamicOffsets);
+
+	vkCmdBindDescriptorSets(cmdBuffer->GetCurrent(),
+		VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->GetLayout(),
+		0, 1, &mHandles[index],
+		numOffsets, dynamicOffsets);
+
+}
@@ -39,6 +39,12 @@ class VKIImageView;
 class VKIBuffer;
 class VKICommandBuffer;
 class VKIGraphicsPipeline;
+class VKIComputePipeline;
+
+
+
+// The maximum number of dynamic descriptors in a single set.
+#define MAX_DYNAMIC_OFFSETS 8
 
 
 
@@ -192,6 +198,9 @@ public:
 	// Update a DescriptorSet of index with a descriptor at binding.
 	void UpdateDescriptorSet(uint32_t index, uint32_t binding);
 
+	// Replace the image of a sampler descriptor & update it only in the set at index.
+	void UpdateImage(uint32_t index, uint32_t binding, VKIImageView* view, VKISampler* sampler);
+
 	// Clear all descriptors from this set.
 	void ClearDescriptor();
 
@@ -204,11 +213,23 @@ public:
 	// Add Image descriptor to be used by this set.
 	void AddDescriptor(uint32_t binding, VkDescriptorType type, VkShaderStageFlags stages, VKIImageView* view, VKISampler* sampler);
 	void AddDescriptor(uint32_t binding, VkDescriptorType type, VkShaderStageFlags stages, VKIImageView* view, VKISampler* sampler, uint32_t count);
+	void AddDescriptor(uint32_t binding, VkDescriptorType type, VkShaderStageFlags stages, VKIImageView* view, VKISampler* sampler, VkImageLayout layout, uint32_t count);
+
+	// Set the source of the dynamic offset of a dynamic descriptor, it is read every time the set is bound.
+	void SetDynamicOffset(uint32_t binding, const uint32_t* offset);
 
-	// Bind this Descriptor Set with a graphics pipeline.
+	// Bind this Descriptor Set with a graphics pipeline, using the dynamic offsets sources.
 	void Bind(VKICommandBuffer* cmdBuffer, uint32_t index, const VKIGraphicsPipeline* pipeline) const;
 	void Bind(VKICommandBuffer* cmdBuffer, uint32_t index, const VKIGraphicsPipeline* pipeline, const std::vector<uint32_t>& dynamicOffsets) const;
 
+	// Bind this Descriptor Set with a compute pipeline, using the dynamic offsets sources.
+	void Bind(VKICommandBuffer* cmdBuffer, uint32_t index, const VKIComputePipeline* pipeline) const;
+
+	// Read the dynamic offsets from their sources in binding order, return the number of offsets.
+	uint32_t GetDynamicOffsets(uint32_t* outOffsets) const;
+
+	// Return a version that change every time the sets are allocated or updated, unique between all sets.
+	inline uint64_t GetVersion() const { return mVersion; }
 
 private:
 	// Create a Descriptor Pool used to allocate Descriptor Set.
@@ -229,4 +250,10 @@ private:
 
 	// The Descriptors.
 	std::vector<VKIDescriptor> mDescriptors;
+
+	// The sources of the dynamic offsets sorted by binding.
+	std::vector< std::pair<uint32_t, const uint32_t*> > mDynamicOffsets;
+
+	// The version of the last update.
+	uint64_t mVersion;
 };
@@ -26,6 +26,8 @@
 #include "VKIInstance.h"
 #include "VKICommandBuffer.h"
 #include "VKISync.h"
+#include "VKIUploadManager.h"
+#include "VKIDeletionQueue.h"
 
 
 #include <vector>
@@ -40,7 +42,11 @@ VKIDevice::VKIDevice()
 	, mHandle(VK_NULL_HANDLE)
 	, mGFXQueue(VK_NULL_HANDLE)
 	, mPresentQueue(VK_NULL_HANDLE)
+	, mTransferQueue(VK_NULL_HANDLE)
+	, mComputeQueue(VK_NULL_HANDLE)
+	, mComputeCmdPool(VK_NULL_HANDLE)
 	, mCmdPool(VK_NULL_HANDLE)
+	, mIsTextureCompressionBC(false)
 {
 	// Required Vulkan Extensions that we need the physical device to support.
 	mReqExtensions = {
@@ -58,13 +64,44 @@ VKIDevice::~VKIDevice()
 
 void VKIDevice::Destroy()
 {
-	// Destroy Fences...
-	mTransientSubmitFence->Destroy();
+	// Destroy Transient Batches, commands not submitted yet are dropped...
+	WaitForTransientCmd();
+
+	if (mTransientBatch)
+	{
+		vkEndCommandBuffer(mTransientBatch->cmdBuffer->Get());
+		mTransientFree.emplace_back(std::move(mTransientBatch));
+	}
+
+	mTransientWaitSemaphores.clear();
+	mTransientWaitStages.clear();
+
+	// Destroy Uploader...
+	mUploader->Destroy();
+	mUploader.reset();
+
+	for (auto& batch : mTransientFree)
+	{
+		batch->cmdBuffer->Destroy();
+		batch->fence->Destroy();
+	}
+
+	mTransientFree.clear();
+
+	// Destroy all the objects still waiting in the deletion queue...
+	mDeletionQueue->Destroy();
+	mDeletionQueue.reset();
 
 	// Destroy Command Pools...
 	vkDestroyCommandPool(mHandle, mCmdPool, nullptr);
 	vkDestroyCommandPool(mHandle, mTransientCmdPool, nullptr);
 
+	if (mComputeCmdPool != VK_NULL_HANDLE)
+	{
+		vkDestroyCommandPool(mHandle, mComputeCmdPool, nullptr);
+		mComputeCmdPool = VK_NULL_HANDLE;
+	}
+
 	// Destroy Vulkan Device.
 	vkDestroyDevice(mHandle, nullptr);
 
@@ -100,6 +137,14 @@ void VKIDevice::CreateDevice(VKIInstance* owner)
 	deviceFeatures.fillModeNonSolid = VK_TRUE;
 	deviceFeatures.geometryShader = VK_TRUE;
 	deviceFeatures.imageCubeArray = VK_TRUE;
+	deviceFeatures.drawIndirectFirstInstance = VK_TRUE;
+
+	// Optional Features...
+	VkPhysicalDeviceFeatures supportedFeatures{};
+	vkGetPhysicalDeviceFeatures(owner->GetPhysicalDevice(), &supportedFeatures);
+
+	deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+	mIsTextureCompressionBC = supportedFeatures.textureCompressionBC == VK_TRUE;
 
 
 	// Required Ext..
@@ -133,10 +178,23 @@ void VKIDevice::CreateDevice(VKIInstance* owner)
 		mPresentQueue = mGFXQueue;
 	}
 
+	if (owner->GetQueues().IsTransferUnique())
+	{
+		vkGetDeviceQueue(mHandle, owner->GetQueues().transfer, 0, &mTransferQueue);
+	}
+	else
+	{
+		mTransferQueue = mGFXQueue;
+	}
 
-	// Create Fences...
-	mTransientSubmitFence = Ptr<VKIFence>(new VKIFence());
-	mTransientSubmitFence->CreateFence(this, false);
+	if (owner->GetQueues().IsComputeUnique())
+	{
+		vkGetDeviceQueue(mHandle, owner->GetQueues().compute, 0, &mComputeQueue);
+	}
+	else
+	{
+		mComputeQueue = mGFXQueue;
+	}
 
 }
 
@@ -161,12 +219,30 @@ void VKIDevice::CreateCommandPool()
 		VkCommandPoolCreateInfo cmdPoolInfo{};
 		cmdPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
 		cmdPoolInfo.queueFamilyIndex = mVKInstance->GetQueues().graphics;
-		cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
 		VkResult result = vkCreateCommandPool(mHandle, &cmdPoolInfo, nullptr, &mTransientCmdPool);
 		CHECK(result == VK_SUCCESS);
 	}
 
+
+	// Async compute commands are recorded from a pool on the compute queue family.
+	if (IsAsyncCompute())
+	{
+		VkCommandPoolCreateInfo cmdPoolInfo{};
+		cmdPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		cmdPoolInfo.queueFamilyIndex = mVKInstance->GetQueues().compute;
+		cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+		VkResult result = vkCreateCommandPool(mHandle, &cmdPoolInfo, nullptr, &mComputeCmdPool);
+		CHECK(result == VK_SUCCESS);
+	}
+
+
+	// Uploader, has its own command pool on the transfer queue family.
+	mUploader = UniquePtr<VKIUploadManager>(new VKIUploadManager());
+	mUploader->Create(this, VKIUploadManager::DEFAULT_RING_SIZE);
+
 }
 
 
@@ -175,6 +251,16 @@ void VKIDevice::CreateCommandBuffers(uint32_t count)
 	mDrawCmdBuffer = UniquePtr<VKICommandBuffer>(new VKICommandBuffer());
 	mDrawCmdBuffer->CreateCmdBuffer(this, mCmdPool, count);
 
+	if (IsAsyncCompute())
+	{
+		mComputeCmdBuffer = UniquePtr<VKICommandBuffer>(new VKICommandBuffer());
+		mComputeCmdBuffer->CreateCmdBuffer(this, mComputeCmdPool, count);
+	}
+
+	// Deletion Queue, objects live until all the command buffers that may use them are done.
+	mDeletionQueue = UniquePtr<VKIDeletionQueue>(new VKIDeletionQueue());
+	mDeletionQueue->Create(this, count);
+
 }
 
 
@@ -200,80 +286,154 @@ uint32_t VKIDevice::FindMemory(uint32_t filter, VkMemoryPropertyFlags properties
 
 VkCommandBuffer VKIDevice::BeginTransientCmd()
 {
-	if (mTransientCmdBuffers.size() == 15)
+	// Unlocked by EndTransientCmd.
+	mTransientMutex.lock();
+	return BeginTransientBatch();
+}
+
+
+VkCommandBuffer VKIDevice::BeginTransientBatch()
+{
+	// Already recording?
+	if (mTransientBatch)
+		return mTransientBatch->cmdBuffer->Get();
+
+	// Reuse a finished batch or create a new one.
+	if (!mTransientFree.empty())
 	{
-		SubmitTransientCmd();
-		WaitForTransientCmd();
+		mTransientBatch = std::move(mTransientFree.back());
+		mTransientFree.pop_back();
+	}
+	else
+	{
+		mTransientBatch = UniquePtr<VKITransientBatch>(new VKITransientBatch());
+		mTransientBatch->cmdBuffer = UniquePtr<VKICommandBuffer>(new VKICommandBuffer());
+		mTransientBatch->cmdBuffer->CreateCmdBuffer(this, mTransientCmdPool, 1);
+		mTransientBatch->fence = UniquePtr<VKIFence>(new VKIFence());
+		mTransientBatch->fence->CreateFence(this, false);
 	}
-
-	mTransientCmdBuffers.emplace_back( UniquePtr<VKICommandBuffer>(new VKICommandBuffer()) );
-	mTransientCmdBuffers.back()->CreateCmdBuffer(this, mTransientCmdPool, 1);
 
 	// Begin...
 	VkCommandBufferBeginInfo beginInfo{};
 	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT; // One Time Use...
-																																 
-	vkBeginCommandBuffer(mTransientCmdBuffers.back()->Get(), &beginInfo);
 
-	return mTransientCmdBuffers.back()->Get();
+	vkBeginCommandBuffer(mTransientBatch->cmdBuffer->Get(), &beginInfo);
+
+	return mTransientBatch->cmdBuffer->Get();
 }
 
 
 void VKIDevice::EndTransientCmd(VkCommandBuffer cmd, const Delegate<>& callback)
 {
-	// End...
-	vkEndCommandBuffer(cmd);
+	CHECK(mTransientBatch && mTransientBatch->cmdBuffer->Get() == cmd);
 
+	// The command buffer is ended on submit, other transient commands may still be recorded into it.
 	if (callback.IsValid())
 	{
-		mTransientSubmitEvent.Add(callback);
+		mTransientBatch->finishEvent.Add(callback);
 	}
+
+	mTransientMutex.unlock();
+}
+
+
+void VKIDevice::AddTransientWait(VkSemaphore semaphore, VkPipelineStageFlags stage)
+{
+	std::lock_guard<std::recursive_mutex> lock(mTransientMutex);
+	mTransientWaitSemaphores.push_back(semaphore);
+	mTransientWaitStages.push_back(stage);
 }
 
 
 void VKIDevice::SubmitTransientCmd()
 {
-	if (mTransientCmdBuffers.empty())
-		return;
+	std::lock_guard<std::recursive_mutex> lock(mTransientMutex);
 
-	// All transient command buffers...
-	std::vector<VkCommandBuffer> cmdBuffers;
-	cmdBuffers.resize(mTransientCmdBuffers.size());
+	// Nothing recorded but still need to wait? keep the dependency with an empty batch.
+	if (!mTransientBatch && !mTransientWaitSemaphores.empty())
+		BeginTransientBatch();
 
-	for (size_t i = 0; i < mTransientCmdBuffers.size(); ++i)
-		cmdBuffers[i] = mTransientCmdBuffers[i]->Get();
+	if (!mTransientBatch)
+		return;
 
+	// End...
+	VkCommandBuffer cmd = mTransientBatch->cmdBuffer->Get();
+	vkEndCommandBuffer(cmd);
 
 	// Submit...
 	VkSubmitInfo submitInfo{};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.commandBufferCount = (uint32_t)cmdBuffers.size();
-	submitInfo.pCommandBuffers = cmdBuffers.data();
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &cmd;
+	submitInfo.waitSemaphoreCount = (uint32_t)mTransientWaitSemaphores.size();
+	submitInfo.pWaitSemaphores = mTransientWaitSemaphores.data();
+	submitInfo.pWaitDstStageMask = mTransientWaitStages.data();
 
-	vkQueueSubmit(mGFXQueue, 1, &submitInfo, mTransientSubmitFence->Get());
-}	 
-	 
-	 
-void VKIDevice::WaitForTransientCmd()
+	{
+		std::lock_guard<std::mutex> queueLock(mQueueMutex);
+		vkQueueSubmit(mGFXQueue, 1, &submitInfo, mTransientBatch->fence->Get());
+	}
+
+	mTransientWaitSemaphores.clear();
+	mTransientWaitStages.clear();
+	mTransientInFlight.emplace_back(std::move(mTransientBatch));
+}
+
+
+void VKIDevice::RetireTransientCmd()
 {
-	if (mTransientCmdBuffers.empty())
+	std::vector< UniquePtr<VKITransientBatch> > finished;
+
+	{
+		std::lock_guard<std::recursive_mutex> lock(mTransientMutex);
+
+		// Batches finish in submission order, stop at the first one still executing.
+		size_t numFinished = 0;
+
+		for (; numFinished < mTransientInFlight.size(); ++numFinished)
+		{
+			VKITransientBatch* batch = mTransientInFlight[numFinished].get();
+
+			if (!batch->fence->IsSignaled())
+				break;
+
+			batch->fence->Reset();
+			finished.emplace_back(std::move(mTransientInFlight[numFinished]));
+		}
+
+		mTransientInFlight.erase(mTransientInFlight.begin(), mTransientInFlight.begin() + numFinished);
+	}
+
+	if (finished.empty())
 		return;
 
-	// Wait...
-	mTransientSubmitFence->Wait(UINT32_MAX);
-	mTransientSubmitFence->Reset();
+	// Signal Events, unlocked as they may lock their owner which can be recording transient commands.
+	for (auto& batch : finished)
+	{
+		batch->finishEvent.Execute();
+		batch->finishEvent.Clear();
+	}
+
+	std::lock_guard<std::recursive_mutex> lock(mTransientMutex);
 
+	for (auto& batch : finished)
+		mTransientFree.emplace_back(std::move(batch));
+}
 
-	// Destroy/Free Transient Commands...
-	for (size_t i = 0; i < mTransientCmdBuffers.size(); ++i)
-		mTransientCmdBuffers[i]->Destroy();
 
-	mTransientCmdBuffers.clear();
+void VKIDevice::WaitForTransientCmd()
+{
+	{
+		std::lock_guard<std::recursive_mutex> lock(mTransientMutex);
 
+		if (mTransientInFlight.empty())
+			return;
 
-	// Signal Events...
-	mTransientSubmitEvent.Execute();
-	mTransientSubmitEvent.Clear();
+		// Wait...
+		for (auto& batch : mTransientInFlight)
+			batch->fence->Wait(UINT64_MAX);
+	}
 
+	RetireTransientCmd();
 }
@@ -32,6 +32,8 @@
 
 #include <set>
 #include <string>
+#include <vector>
+#include <mutex>
 
 
 
@@ -40,6 +42,27 @@
 class VKIInstance;
 class VKICommandBuffer;
 class VKIFence;
+class VKIUploadManager;
+class VKIDeletionQueue;
+
+
+
+
+
+
+
+// A batch of transient commands recorded into one command buffer & submitted together.
+struct VKITransientBatch
+{
+	// The command buffer that record the batch commands.
+	UniquePtr<VKICommandBuffer> cmdBuffer;
+
+	// Fence signaled when the batch finish executing.
+	UniquePtr<VKIFence> fence;
+
+	// Event called when the batch finish executing.
+	MultiDelegate<> finishEvent;
+};
 
 
 
@@ -83,32 +106,66 @@ public:
 	// Return Draw Command Buffer.
 	inline VKICommandBuffer* GetDrawCmd() const { return mDrawCmdBuffer.get(); }
 
+	// Return Async Compute Command Buffer, null if the device has no dedicated compute queue.
+	inline VKICommandBuffer* GetComputeCmd() const { return mComputeCmdBuffer.get(); }
+
 	// Return graphics queue.
 	inline VkQueue GetGFXQueue() const { return mGFXQueue; }
 
 	// Return present queue.
 	inline VkQueue GetPresentQueue() const { return mPresentQueue; }
 
+	// Return transfer queue, same as graphics queue if the device has no dedicated transfer queue.
+	inline VkQueue GetTransferQueue() const { return mTransferQueue; }
+
+	// Return compute queue, same as graphics queue if the device has no dedicated compute queue.
+	inline VkQueue GetComputeQueue() const { return mComputeQueue; }
+
+	// Return true if compute work can run on its own queue in parallel with the graphics queue.
+	inline bool IsAsyncCompute() const { return mComputeQueue != mGFXQueue; }
+
+	// Return true if BC block compressed images can be sampled.
+	inline bool IsTextureCompressionBC() const { return mIsTextureCompressionBC; }
+
+	// Return the upload manager used to upload data to device local buffers & images.
+	inline VKIUploadManager* GetUploader() const { return mUploader.get(); }
+
+	// Return the queue used to destroy vulkan objects once the frames using them are done.
+	inline VKIDeletionQueue* GetDeletionQueue() const { return mDeletionQueue.get(); }
+
 	// Find the memory type index that match filter and properties.
 	uint32_t FindMemory(uint32_t filter, VkMemoryPropertyFlags properties);
 
 	// Return vulkan command pool created by this device.
 	inline VkCommandPool GetCmdPool() { return mCmdPool; }
 
+	// Return the mutex that must be locked to submit or present on the device queues, they may be shared.
+	inline std::mutex& GetQueueMutex() { return mQueueMutex; }
+
 public:
-	// Begin Transient Command Buffer.
+	// Begin Transient Command Buffer, all transient commands until the next submit share the same command buffer.
+	// The transient commands are locked until EndTransientCmd, they are used by the main & render threads.
 	VkCommandBuffer BeginTransientCmd();
 
 	// End Transient Command Buffer.
 	void EndTransientCmd(VkCommandBuffer cmd, const Delegate<>& callback);
 
+	// Make the next transient commands submit wait on a semaphore.
+	void AddTransientWait(VkSemaphore semaphore, VkPipelineStageFlags stage);
+
 	// Submit all transient command buffers.
 	void SubmitTransientCmd();
 
+	// Retire finished transient commands & call their callbacks, doesn't block.
+	void RetireTransientCmd();
+
 	// Wait for transient commands to be fully submitted.
 	void WaitForTransientCmd();
 
 private:
+	// Begin recording a new transient batch if we don't have one, the transient mutex must be locked.
+	VkCommandBuffer BeginTransientBatch();
+
 	// Vulkan Device Handle.
 	VkDevice mHandle;
 
@@ -124,21 +181,52 @@ private:
 	// Present queue for submitting present commands.
 	VkQueue mPresentQueue;
 
+	// Transfer queue for submitting upload commands.
+	VkQueue mTransferQueue;
+
+	// Compute queue for submitting async compute commands.
+	VkQueue mComputeQueue;
+
 	// Command Pool for this device.
 	VkCommandPool mCmdPool;
 
 	// Command Pool used for transent commands buffers.
 	VkCommandPool mTransientCmdPool;
 
+	// Command Pool used for async compute command buffers.
+	VkCommandPool mComputeCmdPool;
+
 	// Command Buffer used to hold draw commands.
 	UniquePtr<VKICommandBuffer> mDrawCmdBuffer;
 
-	// Command Buffer used to hold transient commands for a single frame.
-	std::vector< UniquePtr<VKICommandBuffer> > mTransientCmdBuffers;
+	// Command Buffer used to hold async compute commands.
+	UniquePtr<VKICommandBuffer> mComputeCmdBuffer;
+
+	// The transient batch currently being recorded.
+	UniquePtr<VKITransientBatch> mTransientBatch;
+
+	// Submitted transient batches waiting to finish, oldest first.
+	std::vector< UniquePtr<VKITransientBatch> > mTransientInFlight;
+
+	// Finished transient batches ready to be reused.
+	std::vector< UniquePtr<VKITransientBatch> > mTransientFree;
+
+	// Semaphores & stages the next transient submit wait on.
+	std::vector<VkSemaphore> mTransientWaitSemaphores;
+	std::vector<VkPipelineStageFlags> mTransientWaitStages;
+
+	// Lock the transient batches, recursive as it is held from BeginTransientCmd to EndTransientCmd.
+	std::recursive_mutex mTransientMutex;
+
+	// Lock the queues submits & presents.
+	std::mutex mQueueMutex;
+
+	// The upload manager.
+	UniquePtr<VKIUploadManager> mUploader;
 
-	// Event called when transient commands get submited & finished.
-	MultiDelegate<> mTransientSubmitEvent;
+	// The deferred deletion queue.
+	UniquePtr<VKIDeletionQueue> mDeletionQueue;
 
-	// Fence for submiting transient commands.
-	Ptr<VKIFence> mTransientSubmitFence;
+	// True if the BC block compression feature is enabled.
+	bool mIsTextureCompressionBC;
 };
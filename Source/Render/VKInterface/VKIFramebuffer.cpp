@@ -24,6 +24,7 @@
 #include "VKIDevice.h"
 #include "VKIRenderPass.h"
 #include "VKIImage.h"
+#include "VKIDeletionQueue.h"
 
 
 
@@ -104,8 +105,8 @@ void VKIFramebuffer::CreateFrameBuffer(VKIDevice* owner, VKIRenderPass* renderPa
 
 void VKIFramebuffer::Destroy()
 {
-  // Destroy Framebuffer.
-  vkDestroyFramebuffer(mVKDevice->Get(), mHandle, nullptr);
+  // Destroy Framebuffer once the frames using it are done.
+  mVKDevice->GetDeletionQueue()->Push(mHandle);
 
   //...
   mHandle = VK_NULL_HANDLE;
@@ -24,6 +24,7 @@
 #include "VKIDevice.h"
 #include "VKIRenderPass.h"
 #include "VKIDescriptor.h"
+#include "VKIDeletionQueue.h"
 
 
 
@@ -395,8 +396,8 @@ void VKIGraphicsPipeline::Destroy()
   // Destroy Lyaout.
   vkDestroyPipelineLayout(mVKDevice->Get(), mLayout, nullptr);
 
-  // Destroy Graphics Pipeline...
-  vkDestroyPipeline(mVKDevice->Get(), mHandle, nullptr);
+  // Destroy Graphics Pipeline once the frames using it are done...
+  mVKDevice->GetDeletionQueue()->Push(mHandle);
 
   //...
   mHandle = VK_NULL_HANDLE;
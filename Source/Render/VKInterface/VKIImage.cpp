@@ -23,7 +23,12 @@
 
 #include "VKIImage.h"
 #include "VKIDevice.h"
+#include "VKIInstance.h"
 #include "VKIBuffer.h"
+#include "VKIDeletionQueue.h"
+
+
+#include <algorithm>
 
 
 
@@ -38,6 +43,7 @@ VKIImage::VKIImage()
 	, mVKDevice(nullptr)
 	, mImageType(VK_IMAGE_TYPE_2D)
 	, mFormat(VK_FORMAT_UNDEFINED)
+	, mStorageFormat(VK_FORMAT_UNDEFINED)
 	, mTiling(VK_IMAGE_TILING_OPTIMAL)
 	, mUsage(VK_IMAGE_USAGE_SAMPLED_BIT)
 	, mLayout(VK_IMAGE_LAYOUT_UNDEFINED)
@@ -45,6 +51,9 @@ VKIImage::VKIImage()
 	, mLayers(1)
 	, mMipLevels(1)
 	, mIsCubeMap(false)
+	, mIsShared(false)
+	, mIsAliased(false)
+	, mIsComputeShared(false)
 {
 	mSize = { 0, 0, 0 };
 }
@@ -73,6 +82,31 @@ void VKIImage::Create(VKIDevice* owner)
   imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;	
   imageInfo.initialLayout = mLayout;
 
+	// Textures written by the transfer queue are shared with the graphics queue, attachments stay exclusive.
+	const VKIQueueFamiles& queues = mVKDevice->GetInstance()->GetQueues();
+	uint32_t sharedQueues[3] = { queues.graphics, 0, 0 };
+	uint32_t numSharedQueues = 1;
+	const VkImageUsageFlags attachments = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+
+	if ((mUsage & VK_IMAGE_USAGE_TRANSFER_DST_BIT) && !(mUsage & attachments) && queues.IsTransferUnique())
+	{
+		sharedQueues[numSharedQueues++] = queues.transfer;
+		mIsShared = true;
+	}
+
+	// Images used by async compute are shared with the compute queue, no ownership transfers needed.
+	if (mIsComputeShared && queues.IsComputeUnique())
+	{
+		sharedQueues[numSharedQueues++] = queues.compute;
+	}
+
+	if (numSharedQueues > 1)
+	{
+		imageInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		imageInfo.queueFamilyIndexCount = numSharedQueues;
+		imageInfo.pQueueFamilyIndices = sharedQueues;
+	}
+
 	// Mipmapping...
 	imageInfo.mipLevels = mMipLevels;
 	imageInfo.arrayLayers = mLayers;
@@ -83,12 +117,39 @@ void VKIImage::Create(VKIDevice* owner)
 		imageInfo.flags |= VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
 	}
 
+	// Different storage format? the image is created with it & its views use the image format.
+	if (mStorageFormat != VK_FORMAT_UNDEFINED && mStorageFormat != mFormat)
+	{
+		imageInfo.format = mStorageFormat;
+		imageInfo.flags |= VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT;
+	}
+
 	VkResult result = vkCreateImage(mVKDevice->Get(), &imageInfo, nullptr, &mHandle);
 	CHECK(result == VK_SUCCESS);
 
 
 	// Allocate Memory...
-	AllocateMemory();
+	if (!mIsAliased)
+	{
+		AllocateMemory();
+	}
+}
+
+
+VkMemoryRequirements VKIImage::GetMemoryRequirements() const
+{
+	VkMemoryRequirements memReq;
+	vkGetImageMemoryRequirements(mVKDevice->Get(), mHandle, &memReq);
+	return memReq;
+}
+
+
+void VKIImage::BindMemory(VkDeviceMemory memory, VkDeviceSize offset)
+{
+	CHECK(mIsAliased && mMemory == VK_NULL_HANDLE);
+
+	VkResult result = vkBindImageMemory(mVKDevice->Get(), mHandle, memory, offset);
+	CHECK(result == VK_SUCCESS);
 }
 
 
@@ -122,11 +183,14 @@ void VKIImage::GetMemoryInfo(VkDeviceSize& outAllocateSize, uint32_t& outTypeInd
 
 void VKIImage::Destroy()
 {
-	// Destroy Memory.
-	vkFreeMemory(mVKDevice->Get(), mMemory, nullptr);
+	// Destroy Memory once the frames using it are done, aliased images don't own theirs.
+	if (!mIsAliased)
+	{
+		mVKDevice->GetDeletionQueue()->Push(mMemory);
+	}
 
 	// Destroy Image.
-	vkDestroyImage(mVKDevice->Get(), mHandle, nullptr);
+	mVKDevice->GetDeletionQueue()->Push(mHandle);
 
 	//...
 	mHandle = VK_NULL_HANDLE;
@@ -241,6 +305,11 @@ void VKIImage::ComputePipelineStage(VkImageLayout newLayout, VkImageMemoryBarrie
 			dst = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
 			break;
 
+		case VK_IMAGE_LAYOUT_GENERAL:
+			imgBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+			dst = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+			break;
+
 		default:
 			CHECK(0 && "Unsupported Transition.");
 			break;
@@ -258,6 +327,15 @@ void VKIImage::ComputePipelineStage(VkImageLayout newLayout, VkImageMemoryBarrie
 			src = VK_PIPELINE_STAGE_TRANSFER_BIT;
 			dst = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
 		}
+		// TRANSFER_DST -> GENERAL, mips generated by compute.
+		else if (newLayout == VK_IMAGE_LAYOUT_GENERAL)
+		{
+			imgBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			imgBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+			src = VK_PIPELINE_STAGE_TRANSFER_BIT;
+			dst = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		}
 	}
 	else if (mLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
 	{
@@ -280,6 +358,25 @@ void VKIImage::ComputePipelineStage(VkImageLayout newLayout, VkImageMemoryBarrie
 			src = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
 			dst = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
 		}
+		// SHADER_READ_ONLY - > GENERAL
+		else if (newLayout == VK_IMAGE_LAYOUT_GENERAL)
+		{
+			imgBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			imgBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+			src = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+			dst = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		}
+	}
+	else if (mLayout == VK_IMAGE_LAYOUT_GENERAL)
+	{
+		// GENERAL -> SHADER_READ_ONLY, the fragment stage chains with a semaphore wait when written by async compute.
+		if (newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+		{
+			imgBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			imgBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			src = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+			dst = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		}
 	}
 	else
 	{
@@ -289,18 +386,22 @@ void VKIImage::ComputePipelineStage(VkImageLayout newLayout, VkImageMemoryBarrie
 }
 
 
-void VKIImage::UpdateImage(VkCommandBuffer cmd, VKIBuffer* buffer)
+void VKIImage::UpdateImage(VkCommandBuffer cmd, VKIBuffer* buffer, VkDeviceSize bufferOffset, uint32_t mipLevel)
 {
+	CHECK(mipLevel < mMipLevels);
+
 	VkBufferImageCopy region{};
-	region.bufferOffset = 0;
+	region.bufferOffset = bufferOffset;
 	region.bufferRowLength = 0;
 	region.bufferImageHeight = 0;
 	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	region.imageSubresource.mipLevel = 0;
+	region.imageSubresource.mipLevel = mipLevel;
 	region.imageSubresource.baseArrayLayer = 0;
 	region.imageSubresource.layerCount = mLayers;
 	region.imageOffset = { 0, 0, 0 };
-	region.imageExtent = mSize;
+	region.imageExtent.width = std::max(mSize.width >> mipLevel, 1u);
+	region.imageExtent.height = std::max(mSize.height >> mipLevel, 1u);
+	region.imageExtent.depth = std::max(mSize.depth >> mipLevel, 1u);
 
 	vkCmdCopyBufferToImage(cmd,
 		buffer->Get(), mHandle,
@@ -323,7 +424,7 @@ void VKIImage::GeneratMipmaps(VkCommandBuffer cmd)
 	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 	barrier.subresourceRange.baseArrayLayer = 0;
-	barrier.subresourceRange.layerCount = 1;
+	barrier.subresourceRange.layerCount = mLayers;
 	barrier.subresourceRange.levelCount = 1;
 
 	int32_t mipWidth = mSize.width;
@@ -349,13 +450,13 @@ void VKIImage::GeneratMipmaps(VkCommandBuffer cmd)
 		blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		blit.srcSubresource.mipLevel = i - 1;
 		blit.srcSubresource.baseArrayLayer = 0;
-		blit.srcSubresource.layerCount = 1;
+		blit.srcSubresource.layerCount = mLayers;
 		blit.dstOffsets[0] = { 0, 0, 0 };
 		blit.dstOffsets[1] = { mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1 };
 		blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		blit.dstSubresource.mipLevel = i;
 		blit.dstSubresource.baseArrayLayer = 0;
-		blit.dstSubresource.layerCount = 1;
+		blit.dstSubresource.layerCount = mLayers;
 
 		vkCmdBlitImage(cmd,
 			mHandle, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
@@ -463,7 +564,7 @@ void VKIImageView::Create(VKIDevice* device, VkImage image, VkFormat format)
 
 void VKIImageView::Destroy()
 {
-	vkDestroyImageView(mVKDevice->Get(), mHandle, nullptr);
+	mVKDevice->GetDeletionQueue()->Push(mHandle);
 
 	// ...
 	mHandle = VK_NULL_HANDLE;
@@ -556,7 +657,7 @@ void VKISampler::CreateSampler(VKIDevice* owner)
 
 void VKISampler::Destroy()
 {
-	vkDestroySampler(mVKDevice->Get(), mHandle, nullptr);
+	mVKDevice->GetDeletionQueue()->Push(mHandle);
 
 	//...
 	mHandle = VK_NULL_HANDLE;
@@ -90,9 +90,36 @@ public:
 	// Set the number of mipmap levels.
 	void SetMipLevels(uint32_t levels);
 
+	// Create the image without memory, it is bound later to memory shared with other images.
+	inline void SetAliased(bool isAliased) { mIsAliased = isAliased; }
+
+	// Share the image with the async compute queue, used by images written or read by async compute.
+	inline void SetComputeShared(bool isComputeShared) { mIsComputeShared = isComputeShared; }
+
+	// Set the format used by storage views, for formats that doesn't support storage like sRGB ones.
+	inline void SetStorageFormat(VkFormat format) { mStorageFormat = format; }
+
+	// Return the memory requirements of the created image.
+	VkMemoryRequirements GetMemoryRequirements() const;
+
+	// Bind an aliased image to its memory, the memory is owned by the caller.
+	void BindMemory(VkDeviceMemory memory, VkDeviceSize offset);
+
 	// Return the image format.
 	inline VkFormat GetFormat() const { return mFormat; }
 
+	// Return the format used by storage views.
+	inline VkFormat GetStorageFormat() const { return mStorageFormat != VK_FORMAT_UNDEFINED ? mStorageFormat : mFormat; }
+
+	// Return the image size.
+	inline const VkExtent3D& GetSize() const { return mSize; }
+
+	// Return the image usage.
+	inline VkImageUsageFlags GetUsage() const { return mUsage; }
+
+	// Return the number of layers in this image.
+	inline uint32_t GetLayers() const { return mLayers; }
+
 	// The Image Layout.
 	inline VkImageLayout GetLayout() const { return mLayout; }
 
@@ -102,8 +129,11 @@ public:
 	// Transition the image layout to a new one.
 	void TransitionImageLayout(VkCommandBuffer cmd, VkImageLayout newLayout, VkImageAspectFlags aspect);
 
-	// Update image content from buffer.
-	void UpdateImage(VkCommandBuffer cmd, VKIBuffer* buffer);
+	// Update image content of a mip level from buffer.
+	void UpdateImage(VkCommandBuffer cmd, VKIBuffer* buffer, VkDeviceSize bufferOffset = 0, uint32_t mipLevel = 0);
+
+	// Return true if the image is shared between the graphics & transfer queues.
+	inline bool IsShared() const { return mIsShared; }
 
 	// Generate Mipmaps for this image.
 	void GeneratMipmaps(VkCommandBuffer cmd);
@@ -135,6 +165,9 @@ private:
 	// Image Format
 	VkFormat mFormat;
 
+	// The format used by storage views, undefined if it is the image format.
+	VkFormat mStorageFormat;
+
 	// Image Size.
 	VkExtent3D mSize;
 
@@ -158,6 +191,15 @@ private:
 
 	// Flag used if the image has 6 layers and a cube map.
 	bool mIsCubeMap;
+
+	// Flag used if the image is shared between the graphics & transfer queues.
+	bool mIsShared;
+
+	// Flag used if the image memory is not owned by the image.
+	bool mIsAliased;
+
+	// Flag used if the image is shared with the async compute queue.
+	bool mIsComputeShared;
 };
 
 
@@ -113,6 +113,7 @@ VKIInstance::VKIInstance()
 	, mWndContext(nullptr)
 	, mPhysicalDevice(VK_NULL_HANDLE)
 {
+	mFramebufferSize = VkExtent2D{ 0, 0 };
 
 #if USE_VULKAN_VALIDATION_LAYER
 	isValidationLayer = false;
@@ -300,6 +301,9 @@ void VKIInstance::CreateSurface(AppWindow* wnd)
 {
 	VkResult result = glfwCreateWindowSurface(mHandle, wnd->GetHandle(), nullptr, &mSurface.handle);
 	CHECK(result == VK_SUCCESS);
+
+	mWndContext = wnd;
+	UpdateFramebufferSize();
 }
 
 
@@ -338,6 +342,34 @@ void VKIInstance::FindQueueFamilies(VkPhysicalDevice physicalDevice, VKIQueueFam
 		}
 	}
 
+
+	// Transfer Queue, prefer a DMA queue that only support transfer commands.
+	for (uint32_t i = 0; i < familiesCount; ++i)
+	{
+		VkQueueFlags flags = familiesProperties[i].queueFlags;
+
+		if ((flags & VK_QUEUE_TRANSFER_BIT) == 0 || (flags & VK_QUEUE_GRAPHICS_BIT) != 0)
+			continue;
+
+		outFamilies.transfer = i;
+
+		if ((flags & VK_QUEUE_COMPUTE_BIT) == 0)
+			break;
+	}
+
+
+	// Async Compute Queue, a compute queue without graphics that isn't already used for transfer.
+	for (uint32_t i = 0; i < familiesCount; ++i)
+	{
+		VkQueueFlags flags = familiesProperties[i].queueFlags;
+
+		if ((flags & VK_QUEUE_COMPUTE_BIT) == 0 || (flags & VK_QUEUE_GRAPHICS_BIT) != 0 || i == outFamilies.transfer)
+			continue;
+
+		outFamilies.compute = i;
+		break;
+	}
+
 }
 
 
@@ -401,15 +433,29 @@ void VKIInstance::PickPhysicalDevice()
 }
 
 
-VkExtent2D VKIInstance::GetFramebufferSize()
+void VKIInstance::UpdateFramebufferSize()
 {
 	int width, height;
 	glfwGetFramebufferSize(mWndContext->GetHandle(), &width, &height);
 
-	VkExtent2D fboSize;
-	fboSize.width = (uint32_t)width;
-	fboSize.height = (uint32_t)height;
-	return fboSize;
+	mFramebufferSize.width = (uint32_t)width;
+	mFramebufferSize.height = (uint32_t)height;
+}
+
+
+VkExtent2D VKIInstance::GetMonitorSize()
+{
+	const GLFWvidmode* mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+
+	VkExtent2D monitorSize = { 0, 0 };
+
+	if (mode)
+	{
+		monitorSize.width = (uint32_t)mode->width;
+		monitorSize.height = (uint32_t)mode->height;
+	}
+
+	return monitorSize;
 }
 
 
@@ -53,10 +53,18 @@ struct VKIQueueFamiles
 	// Index of a queue that can be used for present.
 	uint32_t present;
 
+	// Index of a transfer-only queue used for uploads, INVALID_UINDEX if the device has none.
+	uint32_t transfer;
+
+	// Index of a compute queue without graphics used for async compute, INVALID_UINDEX if the device has none.
+	uint32_t compute;
+
 	// Construct.
 	VKIQueueFamiles()
 		: graphics(INVALID_UINDEX)
 		, present(INVALID_UINDEX)
+		, transfer(INVALID_UINDEX)
+		, compute(INVALID_UINDEX)
 	{
 
 	}
@@ -73,6 +81,18 @@ struct VKIQueueFamiles
 		return present != graphics;
 	}
 
+	// Return true if we have a dedicated transfer queue different than the graphics queue.
+	inline bool IsTransferUnique() const
+	{
+		return transfer != INVALID_UINDEX && transfer != graphics && transfer != present;
+	}
+
+	// Return true if we have a dedicated compute queue different than the graphics & transfer queues.
+	inline bool IsComputeUnique() const
+	{
+		return compute != INVALID_UINDEX && compute != graphics && compute != present && compute != transfer;
+	}
+
 	// Return a lost of all the unique queues.
 	inline std::vector<uint32_t> GetUniqueQueues() const
 	{
@@ -84,6 +104,16 @@ struct VKIQueueFamiles
 			uniqueQueues.push_back(present);
 		}
 
+		if (IsTransferUnique())
+		{
+			uniqueQueues.push_back(transfer);
+		}
+
+		if (IsComputeUnique())
+		{
+			uniqueQueues.push_back(compute);
+		}
+
 		return uniqueQueues;
 	}
 };
@@ -156,8 +186,14 @@ public:
 	// Destroy Instance.
 	void Destroy();
 
-	// Return the current framebuffer size aquired from our windowing system.
-	VkExtent2D GetFramebufferSize();
+	// Return the framebuffer size aquired from our windowing system by the last UpdateFramebufferSize.
+	inline VkExtent2D GetFramebufferSize() const { return mFramebufferSize; }
+
+	// Query the current framebuffer size from our windowing system, called from the main thread only.
+	void UpdateFramebufferSize();
+
+	// Return the size of the primary monitor, the largest size a fullscreen window would have.
+	VkExtent2D GetMonitorSize();
 
 	// Update/Query surface information from the current physical device.
 	void ReQuerySurface();
@@ -184,6 +220,9 @@ private:
 	// The window used for creating the surface.
 	AppWindow* mWndContext;
 
+	// The framebuffer size of the window, queried on the main thread for the render thread.
+	VkExtent2D mFramebufferSize;
+
 	// The selected physical device.
 	VkPhysicalDevice mPhysicalDevice;
 
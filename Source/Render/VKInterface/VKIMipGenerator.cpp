@@ -0,0 +1,381 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "VKIMipGenerator.h"
+#include "VKIDevice.h"
+#include "VKIInstance.h"
+#include "VKIBuffer.h"
+#include "VKIImage.h"
+#include "VKIDescriptor.h"
+#include "VKIComputePipeline.h"
+#include "VKIQueryPool.h"
+
+
+#include <array>
+#include <algorithm>
+
+
+
+
+// Flags passed to the downsample shader.
+#define MIP_GEN_FLAG_SRGB 1
+#define MIP_GEN_FLAG_KAISER 2
+
+
+
+
+// Return true if images of this format can be used as storage images.
+static bool IsStorageFormat(VkPhysicalDevice physicalDevice, VkFormat format)
+{
+	VkFormatProperties properties;
+	vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+	return (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT) != 0;
+}
+
+
+// Return true if the format is sRGB encoded.
+static bool IsSRGBFormat(VkFormat format)
+{
+	return format == VK_FORMAT_R8_SRGB || format == VK_FORMAT_R8G8B8A8_SRGB || format == VK_FORMAT_B8G8R8A8_SRGB;
+}
+
+
+
+
+
+
+VKIMipGenerator::VKIMipGenerator()
+	: mVKDevice(nullptr)
+	, mIsCounterCleared(false)
+	, mNextQuery(0)
+	, mNumBatchTimings(0)
+	, mIsCompute(true)
+	, mFilter(EVKIMipFilter::Box)
+	, mIsSRGBCorrect(true)
+{
+	mStats = VKIMipStats{};
+}
+
+
+VKIMipGenerator::~VKIMipGenerator()
+{
+
+}
+
+
+void VKIMipGenerator::Create(VKIDevice* owner)
+{
+	mVKDevice = owner;
+	VkPhysicalDevice physicalDevice = mVKDevice->GetInstance()->GetPhysicalDevice();
+
+	// Layout, a storage image for each level & the atomic counters.
+	mLayout = UniquePtr<VKIDescriptorLayout>(new VKIDescriptorLayout());
+
+	for (uint32_t i = 0; i < MIP_GEN_MAX_LEVELS; ++i)
+		mLayout->AddBinding(i, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT);
+
+	mLayout->AddBinding(MIP_GEN_MAX_LEVELS, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);
+	mLayout->CreateLayout(mVKDevice);
+
+	// Pipelines, only for the formats that support storage.
+	if (IsStorageFormat(physicalDevice, VK_FORMAT_R8G8B8A8_UNORM))
+	{
+		mRGBA8 = UniquePtr<VKIComputePipeline>(new VKIComputePipeline());
+		mRGBA8->SetShader(SHADERS_DIRECTORY "MipDownsample.spv");
+		mRGBA8->SetDescriptorLayout(mLayout.get());
+		mRGBA8->SetPushConstant(0, 0, 4 * sizeof(int32_t));
+		mRGBA8->CreatePipeline(mVKDevice);
+	}
+
+	if (IsStorageFormat(physicalDevice, VK_FORMAT_R8_UNORM))
+	{
+		mR8 = UniquePtr<VKIComputePipeline>(new VKIComputePipeline());
+		mR8->SetShader(SHADERS_DIRECTORY "MipDownsample_R8.spv");
+		mR8->SetDescriptorLayout(mLayout.get());
+		mR8->SetPushConstant(0, 0, 4 * sizeof(int32_t));
+		mR8->CreatePipeline(mVKDevice);
+	}
+
+	// Counters...
+	mCounters = UniquePtr<VKIBuffer>(new VKIBuffer());
+	mCounters->SetSize(MIP_GEN_MAX_LAYERS * sizeof(uint32_t));
+	mCounters->SetUsage(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+	mCounters->SetMemoryProperties(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	mCounters->CreateBuffer(mVKDevice);
+
+	// Timestamps...
+	mTimestamps = UniquePtr<VKIQueryPool>(new VKIQueryPool());
+	mTimestamps->CreateTimestampPool(mVKDevice, MIP_GEN_MAX_TIMINGS * 2);
+
+	LOGI("Mip Generator: compute RGBA8 %s, R8 %s.", mRGBA8 ? "yes" : "no", mR8 ? "yes" : "no");
+}
+
+
+void VKIMipGenerator::Destroy()
+{
+	if (mRGBA8)
+		mRGBA8->Destroy();
+
+	if (mR8)
+		mR8->Destroy();
+
+	mLayout->Destroy();
+	mCounters->Destroy();
+	mTimestamps->Destroy();
+
+	mRGBA8.reset();
+	mR8.reset();
+	mLayout.reset();
+	mCounters.reset();
+	mTimestamps.reset();
+	mTimings.clear();
+	mBatchTimings.clear();
+}
+
+
+VkFormat VKIMipGenerator::GetStorageFormat(VkFormat format) const
+{
+	switch (format)
+	{
+	case VK_FORMAT_R8G8B8A8_UNORM:
+	case VK_FORMAT_R8G8B8A8_SRGB:
+		return mRGBA8 ? VK_FORMAT_R8G8B8A8_UNORM : VK_FORMAT_UNDEFINED;
+
+	case VK_FORMAT_R8_UNORM:
+	case VK_FORMAT_R8_SRGB:
+		return mR8 ? VK_FORMAT_R8_UNORM : VK_FORMAT_UNDEFINED;
+
+	default:
+		return VK_FORMAT_UNDEFINED;
+	}
+}
+
+
+bool VKIMipGenerator::IsSupported(const VKIImage* image) const
+{
+	const VkExtent3D& size = image->GetSize();
+	const VkFormat format = GetStorageFormat(image->GetStorageFormat());
+
+	// Mip 6 must fit in the single tile reduced by the last workgroup.
+	const uint32_t maxSize = MIP_GEN_TILE_SIZE * MIP_GEN_TILE_SIZE;
+
+	return (image->GetUsage() & VK_IMAGE_USAGE_STORAGE_BIT) != 0
+		&& format != VK_FORMAT_UNDEFINED && format == image->GetStorageFormat()
+		&& size.width <= maxSize && size.height <= maxSize && size.depth == 1
+		&& image->GetMipLevels() <= MIP_GEN_MAX_LEVELS
+		&& image->GetLayers() <= MIP_GEN_MAX_LAYERS;
+}
+
+
+void VKIMipGenerator::Generate(VkCommandBuffer cmd, VKIImage* image)
+{
+	CHECK(image->GetMipLevels() > 1);
+	const bool isCompute = mIsCompute && IsSupported(image);
+
+	uint32_t query = 0;
+	const bool isTimed = BeginTiming(cmd, query);
+
+	if (isCompute)
+	{
+		GenerateCompute(cmd, image);
+		++mStats.numCompute;
+	}
+	else
+	{
+		image->GeneratMipmaps(cmd);
+		++mStats.numBlit;
+	}
+
+	if (isTimed)
+		EndTiming(cmd, query, image, isCompute);
+}
+
+
+void VKIMipGenerator::GenerateCompute(VkCommandBuffer cmd, VKIImage* image)
+{
+	const VkExtent3D& size = image->GetSize();
+	const uint32_t levels = image->GetMipLevels();
+	const uint32_t layers = image->GetLayers();
+	const VkFormat format = image->GetStorageFormat();
+	const VKIComputePipeline* pipeline = format == VK_FORMAT_R8_UNORM ? mR8.get() : mRGBA8.get();
+
+	// Clear the counters once, the shader reset them after each layer.
+	if (!mIsCounterCleared)
+	{
+		vkCmdFillBuffer(cmd, mCounters->Get(), 0, VK_WHOLE_SIZE, 0);
+
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+		vkCmdPipelineBarrier(cmd,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+			1, &barrier,
+			0, nullptr,
+			0, nullptr);
+
+		mIsCounterCleared = true;
+	}
+
+	image->TransitionImageLayout(cmd, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_ASPECT_COLOR_BIT);
+
+	// A storage view for each level with all the layers, cube faces are layers too.
+	std::array<VKIImageView, MIP_GEN_MAX_LEVELS> views;
+
+	for (uint32_t i = 0; i < levels; ++i)
+	{
+		views[i].SetType(VK_IMAGE_VIEW_TYPE_2D_ARRAY);
+		views[i].SetViewInfo(VK_IMAGE_ASPECT_COLOR_BIT, i, 1, 0, layers);
+		views[i].Create(mVKDevice, image->Get(), format);
+	}
+
+	// The levels the image doesn't have are bound to its last level.
+	VKIDescriptorSet descSet;
+	descSet.SetLayout(mLayout.get());
+	descSet.CreateDescriptorSet(mVKDevice, 1);
+
+	for (uint32_t i = 0; i < MIP_GEN_MAX_LEVELS; ++i)
+	{
+		descSet.AddDescriptor(i, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT,
+			&views[std::min(i, levels - 1)], nullptr);
+	}
+
+	descSet.AddDescriptor(MIP_GEN_MAX_LEVELS, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, { mCounters.get() });
+	descSet.UpdateSets();
+
+	// Params...
+	int32_t flags = 0;
+
+	if (mIsSRGBCorrect && IsSRGBFormat(image->GetFormat()))
+		flags |= MIP_GEN_FLAG_SRGB;
+
+	if (mFilter == EVKIMipFilter::Kaiser)
+		flags |= MIP_GEN_FLAG_KAISER;
+
+	int32_t params[4] = { (int32_t)size.width, (int32_t)size.height, (int32_t)levels, flags };
+
+	// Dispatch...
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->Get());
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->GetLayout(),
+		0, 1, &descSet.Get(0), 0, nullptr);
+
+	vkCmdPushConstants(cmd, pipeline->GetLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), params);
+
+	vkCmdDispatch(cmd,
+		(size.width + MIP_GEN_TILE_SIZE - 1) / MIP_GEN_TILE_SIZE,
+		(size.height + MIP_GEN_TILE_SIZE - 1) / MIP_GEN_TILE_SIZE,
+		layers);
+
+	// The counters are used by the next image.
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+	vkCmdPipelineBarrier(cmd,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+		1, &barrier,
+		0, nullptr,
+		0, nullptr);
+
+	image->TransitionImageLayout(cmd, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT);
+
+	// Destroyed once the commands are done.
+	descSet.Destroy();
+
+	for (uint32_t i = 0; i < levels; ++i)
+		views[i].Destroy();
+}
+
+
+bool VKIMipGenerator::BeginTiming(VkCommandBuffer cmd, uint32_t& outQuery)
+{
+	if (!mTimestamps->IsSupported() || mTimings.size() >= MIP_GEN_MAX_TIMINGS)
+		return false;
+
+	outQuery = mNextQuery;
+	mNextQuery = (mNextQuery + 2) % (MIP_GEN_MAX_TIMINGS * 2);
+
+	// Bottom of pipe, so the previous commands in the batch are not counted.
+	mTimestamps->Reset(cmd, outQuery, 2);
+	mTimestamps->WriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, outQuery);
+
+	return true;
+}
+
+
+void VKIMipGenerator::EndTiming(VkCommandBuffer cmd, uint32_t query, const VKIImage* image, bool isCompute)
+{
+	mTimestamps->WriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, query + 1);
+
+	const VkExtent3D& size = image->GetSize();
+
+	VKIMipTiming timing;
+	timing.query = query;
+	timing.texels = (uint64_t)size.width * size.height * image->GetLayers();
+	timing.isCompute = isCompute;
+
+	mTimings.push_back(timing);
+	++mNumBatchTimings;
+}
+
+
+void VKIMipGenerator::EndBatch()
+{
+	mBatchTimings.push_back(mNumBatchTimings);
+	mNumBatchTimings = 0;
+}
+
+
+void VKIMipGenerator::FinishBatch()
+{
+	if (mBatchTimings.empty())
+		return;
+
+	// Batches finish in order, their timings are the oldest ones.
+	uint32_t count = mBatchTimings.front();
+	mBatchTimings.erase(mBatchTimings.begin());
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const VKIMipTiming& timing = mTimings[i];
+
+		double times[2];
+		if (!mTimestamps->GetTimestamps(timing.query, 2, times))
+			continue;
+
+		double time = std::max(times[1] - times[0], 0.0);
+
+		if (timing.isCompute)
+		{
+			mStats.computeTime += time;
+			mStats.computeTexels += timing.texels;
+		}
+		else
+		{
+			mStats.blitTime += time;
+			mStats.blitTexels += timing.texels;
+		}
+	}
+
+	mTimings.erase(mTimings.begin(), mTimings.begin() + count);
+}
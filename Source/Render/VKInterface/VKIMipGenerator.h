@@ -0,0 +1,217 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+
+
+#include "Core/Core.h"
+#include "vulkan/vulkan.h"
+
+
+#include <vector>
+
+
+
+
+class VKIDevice;
+class VKIImage;
+class VKIBuffer;
+class VKIQueryPool;
+class VKIDescriptorLayout;
+class VKIComputePipeline;
+
+
+
+
+// The number of source texels reduced by each workgroup in each dimension.
+#define MIP_GEN_TILE_SIZE 64
+
+// The maximum number of mip levels generated by compute, images with more use blits.
+#define MIP_GEN_MAX_LEVELS 13
+
+// The maximum number of layers generated by compute, one atomic counter each.
+#define MIP_GEN_MAX_LAYERS 64
+
+// The maximum number of generations timed at once.
+#define MIP_GEN_MAX_TIMINGS 64
+
+
+
+
+// The filter used to reduce the source level.
+enum class EVKIMipFilter
+{
+	// 2x2 average.
+	Box,
+
+	// 6x6 kaiser windowed sinc, sharper & less aliasing, the following levels use the box filter.
+	Kaiser
+};
+
+
+
+// Mip generator stats since it was created.
+struct VKIMipStats
+{
+	// The number of images generated by compute.
+	uint32_t numCompute;
+
+	// The number of images generated by blits.
+	uint32_t numBlit;
+
+	// The GPU time of the timed compute generations in milliseconds.
+	double computeTime;
+
+	// The GPU time of the timed blit generations in milliseconds.
+	double blitTime;
+
+	// The number of source texels of the timed compute generations.
+	uint64_t computeTexels;
+
+	// The number of source texels of the timed blit generations.
+	uint64_t blitTexels;
+};
+
+
+
+// A timed generation waiting for its timestamps.
+struct VKIMipTiming
+{
+	// The first of the two timestamp queries.
+	uint32_t query;
+
+	// The number of source texels.
+	uint64_t texels;
+
+	// True if generated by compute.
+	bool isCompute;
+};
+
+
+
+
+// VKIMipGenerator:
+//    - Generate the mip chain of uploaded images in a single compute dispatch, instead of a blit & a barrier
+//      for each level.
+//    - Images must be created with storage usage & a storage format supported by the generator, sRGB images
+//      are stored as UNORM & filtered in linear space by the shader.
+//    - Images that can't be generated by compute use blits, both paths are timed with timestamps.
+//
+class VKIMipGenerator
+{
+public:
+	// Construct.
+	VKIMipGenerator();
+
+	// Destruct.
+	~VKIMipGenerator();
+
+	// Create the compute pipelines & the atomic counters.
+	void Create(VKIDevice* owner);
+
+	// Destroy.
+	void Destroy();
+
+	// Return the storage format to create images of this format with, undefined if it is not supported.
+	VkFormat GetStorageFormat(VkFormat format) const;
+
+	// Return true if the image mips can be generated by compute.
+	bool IsSupported(const VKIImage* image) const;
+
+	// Generate the mips of an image in TRANSFER_DST layout, the image ends in SHADER_READ_ONLY layout.
+	void Generate(VkCommandBuffer cmd, VKIImage* image);
+
+	// End the generations recorded into the current command buffer, called when it is submitted.
+	void EndBatch();
+
+	// Read the timestamps of the oldest submitted command buffer, called once it finished executing.
+	void FinishBatch();
+
+	// Enable/Disable compute generation, disabled images use blits.
+	inline void SetCompute(bool isCompute) { mIsCompute = isCompute; }
+	inline bool IsCompute() const { return mIsCompute; }
+
+	// Set the filter used to reduce the source level.
+	inline void SetFilter(EVKIMipFilter filter) { mFilter = filter; }
+	inline EVKIMipFilter GetFilter() const { return mFilter; }
+
+	// Filter sRGB images in linear space, or directly their sRGB values.
+	inline void SetSRGBCorrect(bool isCorrect) { mIsSRGBCorrect = isCorrect; }
+	inline bool IsSRGBCorrect() const { return mIsSRGBCorrect; }
+
+	// Return the stats.
+	inline const VKIMipStats& GetStats() const { return mStats; }
+
+private:
+	// Record the compute generation.
+	void GenerateCompute(VkCommandBuffer cmd, VKIImage* image);
+
+	// Write the first timestamp of a generation, return false if all the queries are in use.
+	bool BeginTiming(VkCommandBuffer cmd, uint32_t& outQuery);
+
+	// Write the second timestamp of a generation.
+	void EndTiming(VkCommandBuffer cmd, uint32_t query, const VKIImage* image, bool isCompute);
+
+private:
+	// The device that owns this generator.
+	VKIDevice* mVKDevice;
+
+	// The downsample descriptor layout.
+	UniquePtr<VKIDescriptorLayout> mLayout;
+
+	// The downsample pipelines for RGBA8 & R8 images, invalid if the format doesn't support storage.
+	UniquePtr<VKIComputePipeline> mRGBA8;
+	UniquePtr<VKIComputePipeline> mR8;
+
+	// The atomic counters of each layer.
+	UniquePtr<VKIBuffer> mCounters;
+
+	// True once the counters are cleared.
+	bool mIsCounterCleared;
+
+	// Timestamps of the timed generations, two each.
+	UniquePtr<VKIQueryPool> mTimestamps;
+
+	// The next query pair to use.
+	uint32_t mNextQuery;
+
+	// Generations waiting for their timestamps, oldest first.
+	std::vector<VKIMipTiming> mTimings;
+
+	// The number of timed generations in the current command buffer.
+	uint32_t mNumBatchTimings;
+
+	// The number of timed generations in each submitted command buffer, oldest first.
+	std::vector<uint32_t> mBatchTimings;
+
+	// Generate mips by compute.
+	bool mIsCompute;
+
+	// The source level filter.
+	EVKIMipFilter mFilter;
+
+	// Filter sRGB images in linear space.
+	bool mIsSRGBCorrect;
+
+	// Stats.
+	VKIMipStats mStats;
+};
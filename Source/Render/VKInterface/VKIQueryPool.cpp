@@ -0,0 +1,117 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "VKIQueryPool.h"
+#include "VKIDevice.h"
+#include "VKIInstance.h"
+
+
+
+
+
+
+
+VKIQueryPool::VKIQueryPool()
+	: mHandle(VK_NULL_HANDLE)
+	, mVKDevice(nullptr)
+	, mPeriod(1.0)
+	, mValidBits(0)
+{
+
+}
+
+
+VKIQueryPool::~VKIQueryPool()
+{
+
+}
+
+
+void VKIQueryPool::CreateTimestampPool(VKIDevice* owner, uint32_t count)
+{
+	mVKDevice = owner;
+	VKIInstance* vkinstance = mVKDevice->GetInstance();
+
+	// Timestamp period & the number of valid bits on the graphics queue...
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(vkinstance->GetPhysicalDevice(), &properties);
+	mPeriod = (double)properties.limits.timestampPeriod;
+
+	uint32_t numFamilies = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(vkinstance->GetPhysicalDevice(), &numFamilies, nullptr);
+
+	std::vector<VkQueueFamilyProperties> families(numFamilies);
+	vkGetPhysicalDeviceQueueFamilyProperties(vkinstance->GetPhysicalDevice(), &numFamilies, families.data());
+	mValidBits = families[vkinstance->GetQueues().graphics].timestampValidBits;
+
+	// Create Query Pool.
+	VkQueryPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	poolInfo.queryCount = count;
+
+	VkResult result = vkCreateQueryPool(mVKDevice->Get(), &poolInfo, nullptr, &mHandle);
+	CHECK(result == VK_SUCCESS);
+
+	mResults.resize(count);
+}
+
+
+void VKIQueryPool::Destroy()
+{
+	vkDestroyQueryPool(mVKDevice->Get(), mHandle, nullptr);
+
+	//...
+	mHandle = VK_NULL_HANDLE;
+}
+
+
+void VKIQueryPool::Reset(VkCommandBuffer cmd, uint32_t first, uint32_t count)
+{
+	vkCmdResetQueryPool(cmd, mHandle, first, count);
+}
+
+
+void VKIQueryPool::WriteTimestamp(VkCommandBuffer cmd, VkPipelineStageFlagBits stage, uint32_t query)
+{
+	vkCmdWriteTimestamp(cmd, stage, mHandle, query);
+}
+
+
+bool VKIQueryPool::GetTimestamps(uint32_t first, uint32_t count, double* outTimes)
+{
+	CHECK(first + count <= (uint32_t)mResults.size());
+
+	VkResult result = vkGetQueryPoolResults(mVKDevice->Get(), mHandle, first, count,
+		count * sizeof(uint64_t), mResults.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+	// Not Ready?
+	if (result != VK_SUCCESS)
+		return false;
+
+	// Mask the invalid bits, then ticks -> nanoseconds -> milliseconds.
+	uint64_t mask = mValidBits >= 64 ? ~0ull : ((1ull << mValidBits) - 1);
+
+	for (uint32_t i = 0; i < count; ++i)
+		outTimes[i] = (double)(mResults[i] & mask) * mPeriod * 1e-6;
+
+	return true;
+}
@@ -0,0 +1,93 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+
+
+#include "Core/Core.h"
+#include "vulkan/vulkan.h"
+
+
+#include <vector>
+
+
+
+
+class VKIDevice;
+
+
+
+
+
+
+// VKIQueryPool:
+//     - Handle vulkan timestamp query pool.
+//
+class VKIQueryPool
+{
+public:
+	// Construct.
+	VKIQueryPool();
+
+	// Destruct.
+	~VKIQueryPool();
+
+	// Return the vulkan handle.
+	inline VkQueryPool Get() const { return mHandle; }
+
+	// Return true if the vulkan handle is valid.
+	inline bool IsValid() const { return mHandle != VK_NULL_HANDLE; }
+
+	// Create vulkan timestamp query pool.
+	void CreateTimestampPool(VKIDevice* owner, uint32_t count);
+
+	// Destroy vulkan query pool.
+	void Destroy();
+
+	// Reset a range of queries, must be recorded before writing them again.
+	void Reset(VkCommandBuffer cmd, uint32_t first, uint32_t count);
+
+	// Write a timestamp once all the previous commands reached the stage.
+	void WriteTimestamp(VkCommandBuffer cmd, VkPipelineStageFlagBits stage, uint32_t query);
+
+	// Read a range of timestamps in milliseconds, doesn't block, return false if they are not available yet.
+	bool GetTimestamps(uint32_t first, uint32_t count, double* outTimes);
+
+	// Return true if the graphics queue support timestamps.
+	inline bool IsSupported() const { return mValidBits != 0; }
+
+private:
+	// Vulkan Query Pool Handle.
+	VkQueryPool mHandle;
+
+	// The device that owns this query pool.
+	VKIDevice* mVKDevice;
+
+	// The number of nanoseconds for a timestamp to be incremented by 1.
+	double mPeriod;
+
+	// The number of valid bits in a timestamp.
+	uint32_t mValidBits;
+
+	// Temp results buffer.
+	std::vector<uint64_t> mResults;
+};
@@ -25,6 +25,7 @@
 #include "VKIDevice.h"
 #include "VKIFramebuffer.h"
 #include "VKICommandBuffer.h"
+#include "VKIDeletionQueue.h"
 
 
 #include <array>
@@ -205,7 +206,7 @@ void VKIRenderPass::CreateRenderPass(VKIDevice* owner)
 
 void VKIRenderPass::Destroy()
 {
-	vkDestroyRenderPass(mVKDevice->Get(), mHandle, nullptr);
+	mVKDevice->GetDeletionQueue()->Push(mHandle);
 
 	//...
 	mHandle = VK_NULL_HANDLE;
@@ -256,6 +257,13 @@ void VKIRenderPass::AddDependency(uint32_t src, uint32_t dst, VkPipelineStageFla
 
 
 void VKIRenderPass::Begin(VKICommandBuffer* cmdBuffer, VKIFramebuffer* framebuffer, const glm::ivec4& viewport)
+{
+	Begin(cmdBuffer, framebuffer, viewport, VK_SUBPASS_CONTENTS_INLINE);
+}
+
+
+void VKIRenderPass::Begin(VKICommandBuffer* cmdBuffer, VKIFramebuffer* framebuffer, const glm::ivec4& viewport,
+	VkSubpassContents contents)
 {
 	VkRenderPassBeginInfo renderPassBeginInfo{};
 	renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -265,7 +273,7 @@ void VKIRenderPass::Begin(VKICommandBuffer* cmdBuffer, VKIFramebuffer* framebuff
 	renderPassBeginInfo.clearValueCount = (uint32_t)mClearValues.size();
 	renderPassBeginInfo.pClearValues = mClearValues.data();
 
-	vkCmdBeginRenderPass(cmdBuffer->GetCurrent(), &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+	vkCmdBeginRenderPass(cmdBuffer->GetCurrent(), &renderPassBeginInfo, contents);
 }
 
 
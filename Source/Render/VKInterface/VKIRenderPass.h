@@ -136,6 +136,7 @@ public:
 
 	// Begin The Render Pass.
 	void Begin(VKICommandBuffer* cmdBuffer, VKIFramebuffer* framebuffer, const glm::ivec4& viewport);
+	void Begin(VKICommandBuffer* cmdBuffer, VKIFramebuffer* framebuffer, const glm::ivec4& viewport, VkSubpassContents contents);
 
 	// End The Render Pass.
 	void End(VKICommandBuffer* cmdBuffer);
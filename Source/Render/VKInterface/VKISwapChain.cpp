@@ -29,6 +29,7 @@
 #include "VKIFramebuffer.h"
 #include "VKISync.h"
 #include "VKIImage.h"
+#include "VKIDeletionQueue.h"
 
 
 
@@ -49,6 +50,7 @@ VKISwapChain::VKISwapChain()
 	, mImgCount(0)
 	, mHandle(VK_NULL_HANDLE)
 	, mPresentMode(VK_PRESENT_MODE_FIFO_KHR)
+	, mPreferredPresentMode(VK_PRESENT_MODE_MAILBOX_KHR)
 	, mSurfaceTransform(VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR)
 	, mNeedRecreate(false)
 {
@@ -64,6 +66,18 @@ VKISwapChain::~VKISwapChain()
 
 
 void VKISwapChain::Destroy()
+{
+	DestroyTargets();
+
+	// Destroy Swapchain once the frames presenting its images are done.
+	mVKDevice->GetDeletionQueue()->Push(mHandle);
+
+	//...
+	mHandle = VK_NULL_HANDLE;
+}
+
+
+void VKISwapChain::DestroyTargets()
 {
 	// Destroy ImageViews & Framebuffers...
 	for (size_t i = 0; i < mImages.size(); ++i)
@@ -74,12 +88,6 @@ void VKISwapChain::Destroy()
 
 	// Destroy Render Pass.
 	mRenderPass->Destroy();
-
-	// Destroy Swapchain.
-	vkDestroySwapchainKHR(mVKDevice->Get(), mHandle, nullptr);
-
-	//...
-	mHandle = VK_NULL_HANDLE;
 }
 
 
@@ -110,9 +118,9 @@ void VKISwapChain::QuerySwapchainProperties()
 
 	for (const auto& mode : vksurface.presentModes)
 	{
-		if (mode == VK_PRESENT_MODE_MAILBOX_KHR)
+		if (mode == mPreferredPresentMode)
 		{
-			mPresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+			mPresentMode = mPreferredPresentMode;
 			break;
 		}
 	}
@@ -167,6 +175,7 @@ void VKISwapChain::CreateSwapchain(VKIDevice* owner)
 	swapchainInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR; // No Alpha for window.
 	swapchainInfo.presentMode = mPresentMode;
 	swapchainInfo.clipped = VK_TRUE; // Discard regions that is not visiable on the surface.
+	swapchainInfo.oldSwapchain = mHandle; // Retire the old swapchain when recreating.
 
 
 	// Swapchain Images Info.
@@ -198,6 +207,12 @@ void VKISwapChain::CreateSwapchain(VKIDevice* owner)
 	VkResult result = vkCreateSwapchainKHR(mVKDevice->Get(), &swapchainInfo, nullptr, &mHandle);
 	CHECK(result == VK_SUCCESS && "Failed to create swap chain!");
 
+	// The retired swapchain may still be presenting, destroy it once the frames in-flight are done.
+	if (swapchainInfo.oldSwapchain != VK_NULL_HANDLE)
+	{
+		mVKDevice->GetDeletionQueue()->Push(swapchainInfo.oldSwapchain);
+	}
+
 
 	// Get The allocated Swapchain Images...
 	vkGetSwapchainImagesKHR(mVKDevice->Get(), mHandle, &mImgCount, nullptr);
@@ -344,12 +359,22 @@ void VKISwapChain::PresentImage(uint32_t imgIndex, VKISemaphore* smRender)
 }
 
 
+void VKISwapChain::SetPresentMode(VkPresentModeKHR mode)
+{
+	if (mPreferredPresentMode == mode)
+		return;
+
+	mPreferredPresentMode = mode;
+	mNeedRecreate = true;
+}
+
+
 void VKISwapChain::Recreate()
 {
 	mNeedRecreate = false;
 
-	// Destroy the old swapchain...
-	Destroy();
+	// Destroy the old swapchain targets, the swapchain itself is retired by the new one...
+	DestroyTargets();
 
 	// Recreate...
 	CreateSwapchain(mVKDevice);
@@ -75,7 +75,7 @@ public:
 	// Acquire next available swapchain image.
 	uint32_t AcquireNextImage(VKISemaphore* smImage, VKIFence* fnFrame);
 
-	// Present swapchain image to surface.
+	// Present swapchain image to surface, the device queue mutex must be locked.
 	void PresentImage(uint32_t imgIndex, VKISemaphore* smRender);
 
 	// Return true if the swapchain need to be recreated.
@@ -96,6 +96,12 @@ public:
 	// Return the surface format
 	inline VkSurfaceFormatKHR GetFormat() { return mSurfaceFormat; }
 
+	// Set the preferred present mode, the swapchain is recreated if it changed.
+	void SetPresentMode(VkPresentModeKHR mode);
+
+	// Return the present mode used by the swapchain, fifo if the preferred one isn't supported.
+	inline VkPresentModeKHR GetPresentMode() const { return mPresentMode; }
+
 
 private:
 	// Query swapchain perperties from the device.
@@ -113,6 +119,9 @@ private:
 	// Create a render pass for the swapchain.
 	void CreateRenderPass();
 
+	// Destroy the image views, framebuffers & render pass of the swapchain.
+	void DestroyTargets();
+
 private:
 	// The device that owns this swapchain.
 	VKIDevice* mVKDevice;
@@ -126,6 +135,9 @@ private:
 	// The Present Mode used for presenting the rendered images.
 	VkPresentModeKHR mPresentMode;
 
+	// The Present Mode we want to use if supported.
+	VkPresentModeKHR mPreferredPresentMode;
+
 	// The Surface Extent, used as the size of the swapchain images.
 	VkExtent2D mExtent;
 
@@ -128,3 +128,9 @@ void VKIFence::Reset()
 {
 	vkResetFences(mVKDevice->Get(), 1, &mHandle);
 }
+
+
+bool VKIFence::IsSignaled() const
+{
+	return vkGetFenceStatus(mVKDevice->Get(), mHandle) == VK_SUCCESS;
+}
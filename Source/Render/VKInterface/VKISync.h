@@ -113,6 +113,9 @@ public:
 	// Perform fence reset to signaled state.
 	void Reset();
 
+	// Return true if the fence is signaled, doesn't block.
+	bool IsSignaled() const;
+
 private:
 	// Vulkan Fence Handle.
 	VkFence mHandle;
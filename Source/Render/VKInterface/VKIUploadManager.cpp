@@ -0,0 +1,585 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#include "VKIUploadManager.h"
+#include "VKIDevice.h"
+#include "VKIInstance.h"
+#include "VKIBuffer.h"
+#include "VKIImage.h"
+#include "VKICommandBuffer.h"
+#include "VKISync.h"
+#include "VKIMipGenerator.h"
+
+
+#include <cstring>
+#include <algorithm>
+
+
+
+
+// Staging offsets alignment, work for buffer copies & image copies of all the formats we use.
+#define UPLOAD_ALIGNMENT 16
+
+
+
+const VkDeviceSize VKIUploadManager::DEFAULT_RING_SIZE = 64 * 1024 * 1024;
+
+
+
+
+
+
+VKIUploadManager::VKIUploadManager()
+	: mVKDevice(nullptr)
+	, mCmdPool(VK_NULL_HANDLE)
+	, mIsTransferQueue(false)
+	, mRingSize(0)
+	, mRingHead(0)
+	, mRingTail(0)
+	, mRingUsed(0)
+	, mBatchRingBytes(0)
+	, mLastHandle(0)
+	, mCompletedHandle(0)
+{
+	mStats = VKIUploadStats{};
+}
+
+
+VKIUploadManager::~VKIUploadManager()
+{
+
+}
+
+
+void VKIUploadManager::Create(VKIDevice* owner, VkDeviceSize ringSize)
+{
+	mVKDevice = owner;
+
+	const VKIQueueFamiles& queues = mVKDevice->GetInstance()->GetQueues();
+	mIsTransferQueue = queues.IsTransferUnique();
+
+	// Command Pool...
+	VkCommandPoolCreateInfo cmdPoolInfo{};
+	cmdPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	cmdPoolInfo.queueFamilyIndex = mIsTransferQueue ? queues.transfer : queues.graphics;
+	cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+	VkResult result = vkCreateCommandPool(mVKDevice->Get(), &cmdPoolInfo, nullptr, &mCmdPool);
+	CHECK(result == VK_SUCCESS);
+
+	// Staging Ring...
+	mRingSize = ringSize;
+	mRing = UniquePtr<VKIBuffer>(new VKIBuffer());
+	mRing->SetSize(mRingSize);
+	mRing->SetUsage(VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+	mRing->SetMemoryProperties(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	mRing->CreateBuffer(mVKDevice);
+
+	CHECK(mRing->GetMapped() && "Staging ring must be mapped.");
+
+	// Mip Generator...
+	mMipGenerator = UniquePtr<VKIMipGenerator>(new VKIMipGenerator());
+	mMipGenerator->Create(mVKDevice);
+	LOGI("Upload Manager: %s queue, staging ring %d MB.",
+		mIsTransferQueue ? "transfer" : "graphics", (int)(mRingSize / (1024 * 1024)));
+}
+
+
+void VKIUploadManager::Destroy()
+{
+	std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+	// Wait for submitted uploads...
+	for (auto& batch : mInFlight)
+		batch->fence->Wait(UINT64_MAX);
+
+	Retire();
+
+	// Uploads not submitted yet are dropped.
+	if (mBatch)
+	{
+		vkEndCommandBuffer(mBatch->cmdBuffer->Get());
+
+		for (VKIBuffer* staging : mBatch->dedicated)
+		{
+			staging->Destroy();
+			delete staging;
+		}
+
+		mFree.emplace_back(std::move(mBatch));
+	}
+
+	// Destroy Batches...
+	for (auto& batch : mFree)
+	{
+		batch->cmdBuffer->Destroy();
+		batch->fence->Destroy();
+	}
+
+	mFree.clear();
+	mPendingImages.clear();
+	mPendingLayouts.clear();
+
+	// Destroy Semaphores...
+	for (auto& semaphore : mWaitingSemaphores)
+		semaphore->Destroy();
+
+	for (auto& semaphore : mFreeSemaphores)
+		semaphore->Destroy();
+
+	mWaitingSemaphores.clear();
+	mFreeSemaphores.clear();
+
+	// Destroy Ring...
+	mRing->Destroy();
+	mRing.reset();
+
+	mMipGenerator->Destroy();
+	mMipGenerator.reset();
+
+	vkDestroyCommandPool(mVKDevice->Get(), mCmdPool, nullptr);
+	mCmdPool = VK_NULL_HANDLE;
+}
+
+
+VkCommandBuffer VKIUploadManager::BeginBatch()
+{
+	// Already recording?
+	if (mBatch)
+		return mBatch->cmdBuffer->Get();
+
+	// Reuse a finished batch or create a new one.
+	if (!mFree.empty())
+	{
+		mBatch = std::move(mFree.back());
+		mFree.pop_back();
+	}
+	else
+	{
+		mBatch = UniquePtr<VKIUploadBatch>(new VKIUploadBatch());
+		mBatch->cmdBuffer = UniquePtr<VKICommandBuffer>(new VKICommandBuffer());
+		mBatch->cmdBuffer->CreateCmdBuffer(mVKDevice, mCmdPool, 1);
+		mBatch->fence = UniquePtr<VKIFence>(new VKIFence());
+		mBatch->fence->CreateFence(mVKDevice, false);
+	}
+
+	mBatch->handle = ++mLastHandle;
+	mBatch->ringEnd = 0;
+	mBatch->ringBytes = 0;
+
+	// Begin...
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkBeginCommandBuffer(mBatch->cmdBuffer->Get(), &beginInfo);
+
+	return mBatch->cmdBuffer->Get();
+}
+
+
+bool VKIUploadManager::AllocateRing(VkDeviceSize size, VkDeviceSize& outOffset)
+{
+	// Empty ring, start from the beginning to have the most contiguous space.
+	if (mRingUsed == 0)
+	{
+		mRingHead = 0;
+		mRingTail = 0;
+	}
+
+	VkDeviceSize offset = ALIGN_SIZE(mRingHead, (VkDeviceSize)UPLOAD_ALIGNMENT);
+	VkDeviceSize used = 0;
+
+	if (mRingHead >= mRingTail)
+	{
+		if (offset + size <= mRingSize)
+		{
+			// Fit at the end of the ring.
+			used = offset + size - mRingHead;
+		}
+		else if (size < mRingTail)
+		{
+			// Wrap around to the start of the ring, the skipped end is released with this batch.
+			used = mRingSize - mRingHead + size;
+			offset = 0;
+		}
+		else
+		{
+			return false;
+		}
+	}
+	else
+	{
+		// Must stay behind the tail.
+		if (offset + size >= mRingTail)
+			return false;
+
+		used = offset + size - mRingHead;
+	}
+
+	mRingHead = offset + size;
+	mRingUsed += used;
+	mBatchRingBytes += used;
+	outOffset = offset;
+
+	return true;
+}
+
+
+VKIBuffer* VKIUploadManager::AllocateStaging(VkDeviceSize size, VkDeviceSize& outOffset)
+{
+	// Bigger than the ring? use its own staging buffer, destroyed when the batch is done.
+	if (size > mRingSize)
+	{
+		VKIBuffer* staging = new VKIBuffer();
+		staging->SetSize(size);
+		staging->SetUsage(VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+		staging->SetMemoryProperties(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		staging->CreateBuffer(mVKDevice);
+
+		BeginBatch();
+		mBatch->dedicated.push_back(staging);
+		++mStats.numDedicated;
+
+		outOffset = 0;
+		return staging;
+	}
+
+	while (!AllocateRing(size, outOffset))
+	{
+		Retire();
+
+		if (AllocateRing(size, outOffset))
+			break;
+
+		// Still full, the current batch own the rest of the ring so submit it first.
+		if (mInFlight.empty())
+			Submit();
+
+		CHECK(!mInFlight.empty());
+
+		// Wait for the oldest batch to release its space.
+		++mStats.numStalls;
+		mInFlight.front()->fence->Wait(UINT64_MAX);
+		Retire();
+	}
+
+	BeginBatch();
+	return mRing.get();
+}
+
+
+VKIUploadHandle VKIUploadManager::UploadBuffer(VKIBuffer* dst, VkDeviceSize offset, VkDeviceSize size, const void* data,
+	const Delegate<>& callback)
+{
+	std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+	CHECK(offset + size <= dst->GetSize());
+
+	VkDeviceSize stagingOffset = 0;
+	VKIBuffer* staging = AllocateStaging(size, stagingOffset);
+	memcpy(staging->GetMapped() + stagingOffset, data, size);
+
+	VkCommandBuffer cmd = BeginBatch();
+
+	// Copies to the same buffer in one batch may overlap, order them.
+	if (!mBatchDsts.insert(dst->Get()).second)
+	{
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+		vkCmdPipelineBarrier(cmd,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+			1, &barrier,
+			0, nullptr,
+			0, nullptr);
+
+		mBatchDsts.clear();
+		mBatchDsts.insert(dst->Get());
+	}
+
+	// Copy...
+	VkBufferCopy region{};
+	region.srcOffset = stagingOffset;
+	region.dstOffset = offset;
+	region.size = size;
+	vkCmdCopyBuffer(cmd, staging->Get(), dst->Get(), 1, &region);
+
+	if (callback.IsValid())
+		mBatch->finishEvent.Add(callback);
+
+	++mStats.numUploads;
+	mStats.uploadedBytes += size;
+
+	return mBatch->handle;
+}
+
+
+VKIUploadHandle VKIUploadManager::UploadImage(VKIImage* dst, const void* data, VkDeviceSize size,
+	const Delegate<>& callback)
+{
+	std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+	CHECK(dst->GetLayout() == VK_IMAGE_LAYOUT_UNDEFINED && "Only new images can be uploaded.");
+	CHECK((!mIsTransferQueue || dst->IsShared()) && "Image must be shared with the transfer queue.");
+
+	VkDeviceSize stagingOffset = 0;
+	VKIBuffer* staging = AllocateStaging(size, stagingOffset);
+	memcpy(staging->GetMapped() + stagingOffset, data, size);
+
+	VkCommandBuffer cmd = BeginBatch();
+
+	// Copy the first mip, the rest is done on the graphics queue after the copy.
+	dst->TransitionImageLayout(cmd, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT);
+	dst->UpdateImage(cmd, staging, stagingOffset);
+	mPendingImages.push_back(dst);
+
+	if (callback.IsValid())
+		mBatch->finishEvent.Add(callback);
+
+	++mStats.numUploads;
+	mStats.uploadedBytes += size;
+
+	return mBatch->handle;
+}
+
+
+VKIUploadHandle VKIUploadManager::UploadImageMips(VKIImage* dst, const void* data, VkDeviceSize size,
+	const VkDeviceSize* mipOffsets, const Delegate<>& callback)
+{
+	std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+	CHECK(dst->GetLayout() == VK_IMAGE_LAYOUT_UNDEFINED && "Only new images can be uploaded.");
+	CHECK((!mIsTransferQueue || dst->IsShared()) && "Image must be shared with the transfer queue.");
+
+	VkDeviceSize stagingOffset = 0;
+	VKIBuffer* staging = AllocateStaging(size, stagingOffset);
+	memcpy(staging->GetMapped() + stagingOffset, data, size);
+
+	VkCommandBuffer cmd = BeginBatch();
+
+	// Copy every mip from the same staging range.
+	dst->TransitionImageLayout(cmd, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT);
+
+	for (uint32_t i = 0; i < dst->GetMipLevels(); ++i)
+	{
+		CHECK(mipOffsets[i] < size);
+		dst->UpdateImage(cmd, staging, stagingOffset + mipOffsets[i], i);
+	}
+
+	mPendingLayouts.push_back(dst);
+
+	if (callback.IsValid())
+		mBatch->finishEvent.Add(callback);
+
+	++mStats.numUploads;
+	mStats.uploadedBytes += size;
+
+	return mBatch->handle;
+}
+
+
+void VKIUploadManager::Submit()
+{
+	std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+	Retire();
+
+	if (!mBatch)
+		return;
+
+	// End...
+	VkCommandBuffer cmd = mBatch->cmdBuffer->Get();
+	vkEndCommandBuffer(cmd);
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &cmd;
+
+	// Separate queues? the graphics queue wait on a semaphore signaled by this batch.
+	VkSemaphore semaphore = VK_NULL_HANDLE;
+
+	if (mIsTransferQueue)
+	{
+		if (mFreeSemaphores.empty())
+		{
+			mFreeSemaphores.emplace_back(UniquePtr<VKISemaphore>(new VKISemaphore()));
+			mFreeSemaphores.back()->CreateSemaphore(mVKDevice);
+		}
+
+		mWaitingSemaphores.emplace_back(std::move(mFreeSemaphores.back()));
+		mFreeSemaphores.pop_back();
+
+		semaphore = mWaitingSemaphores.back()->Get();
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &semaphore;
+	}
+
+	{
+		std::lock_guard<std::mutex> queueLock(mVKDevice->GetQueueMutex());
+		vkQueueSubmit(mVKDevice->GetTransferQueue(), 1, &submitInfo, mBatch->fence->Get());
+	}
+
+	mBatch->ringEnd = mRingHead;
+	mBatch->ringBytes = mBatchRingBytes;
+	mBatchRingBytes = 0;
+	mBatchDsts.clear();
+	mInFlight.emplace_back(std::move(mBatch));
+	++mStats.numBatches;
+
+
+	// Graphics queue part, recorded into the device transient commands...
+	VkCommandBuffer gfxCmd = mVKDevice->BeginTransientCmd();
+
+	// Make the copies visible to everything after them on the graphics queue.
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+
+	vkCmdPipelineBarrier(gfxCmd,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+		1, &barrier,
+		0, nullptr,
+		0, nullptr);
+
+	for (VKIImage* image : mPendingImages)
+	{
+		if (image->GetMipLevels() > 1)
+			mMipGenerator->Generate(gfxCmd, image);
+		else
+			image->TransitionImageLayout(gfxCmd, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT);
+	}
+
+	for (VKIImage* image : mPendingLayouts)
+		image->TransitionImageLayout(gfxCmd, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT);
+
+	mPendingImages.clear();
+	mPendingLayouts.clear();
+	mMipGenerator->EndBatch();
+
+	if (semaphore != VK_NULL_HANDLE)
+		mVKDevice->AddTransientWait(semaphore, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+	mVKDevice->EndTransientCmd(gfxCmd, Delegate<>::CreateMemberRaw(this, &VKIUploadManager::OnGraphicsFinished));
+}
+
+
+void VKIUploadManager::Retire()
+{
+	std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+	// Batches finish in submission order, stop at the first one still executing.
+	size_t numFinished = 0;
+
+	for (; numFinished < mInFlight.size(); ++numFinished)
+	{
+		VKIUploadBatch* batch = mInFlight[numFinished].get();
+
+		if (!batch->fence->IsSignaled())
+			break;
+
+		batch->fence->Reset();
+
+		// Release ring space...
+		if (batch->ringBytes != 0)
+		{
+			mRingTail = batch->ringEnd;
+			mRingUsed -= batch->ringBytes;
+		}
+
+		for (VKIBuffer* staging : batch->dedicated)
+		{
+			staging->Destroy();
+			delete staging;
+		}
+
+		batch->dedicated.clear();
+		mCompletedHandle = batch->handle;
+
+		// Signal Events...
+		batch->finishEvent.Execute();
+		batch->finishEvent.Clear();
+
+		mFree.emplace_back(std::move(mInFlight[numFinished]));
+	}
+
+	mInFlight.erase(mInFlight.begin(), mInFlight.begin() + numFinished);
+}
+
+
+void VKIUploadManager::Wait(VKIUploadHandle handle)
+{
+	std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+	if (IsComplete(handle))
+		return;
+
+	// Still recording?
+	if (mBatch && mBatch->handle <= handle)
+		Submit();
+
+	for (auto& batch : mInFlight)
+	{
+		if (batch->handle > handle)
+			break;
+
+		batch->fence->Wait(UINT64_MAX);
+	}
+
+	Retire();
+}
+
+
+VKIUploadStats VKIUploadManager::GetStats()
+{
+	std::lock_guard<std::recursive_mutex> lock(mMutex);
+	return mStats;
+}
+
+
+VKIUploadHandle VKIUploadManager::GetLastHandle()
+{
+	std::lock_guard<std::recursive_mutex> lock(mMutex);
+	return mLastHandle;
+}
+
+
+void VKIUploadManager::OnGraphicsFinished()
+{
+	std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+	// Graphics batches finish in order, their mip timings are ready.
+	mMipGenerator->FinishBatch();
+
+	if (!mIsTransferQueue)
+		return;
+
+	CHECK(!mWaitingSemaphores.empty());
+
+	// The oldest waiting semaphore was consumed.
+	mFreeSemaphores.emplace_back(std::move(mWaitingSemaphores.front()));
+	mWaitingSemaphores.erase(mWaitingSemaphores.begin());
+}
@@ -0,0 +1,248 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#pragma once
+
+
+
+
+#include "Core/Core.h"
+#include "Core/Delegate.h"
+#include "vulkan/vulkan.h"
+
+
+#include <vector>
+#include <unordered_set>
+#include <mutex>
+#include <atomic>
+
+
+
+
+class VKIDevice;
+class VKIBuffer;
+class VKIImage;
+class VKICommandBuffer;
+class VKIFence;
+class VKISemaphore;
+class VKIMipGenerator;
+
+
+
+
+// Handle of a submitted upload, used to query or wait for its completion.
+typedef uint64_t VKIUploadHandle;
+
+
+
+// Upload manager stats since it was created.
+struct VKIUploadStats
+{
+	// The number of buffer & image uploads.
+	uint32_t numUploads;
+
+	// The number of bytes copied through the staging ring.
+	uint64_t uploadedBytes;
+
+	// The number of submitted batches.
+	uint32_t numBatches;
+
+	// The number of times an upload had to wait for the ring to have space.
+	uint32_t numStalls;
+
+	// The number of uploads bigger than the ring that used their own staging buffer.
+	uint32_t numDedicated;
+};
+
+
+
+// A batch of upload commands submitted together.
+struct VKIUploadBatch
+{
+	// The handle of the uploads recorded in this batch.
+	VKIUploadHandle handle;
+
+	// Command buffer that record the batch copies.
+	UniquePtr<VKICommandBuffer> cmdBuffer;
+
+	// Fence signaled when the batch copies are done.
+	UniquePtr<VKIFence> fence;
+
+	// The end of the ring space used by this batch.
+	VkDeviceSize ringEnd;
+
+	// The ring bytes used by this batch, including the space skipped when wrapping.
+	VkDeviceSize ringBytes;
+
+	// Staging buffers for uploads bigger than the ring.
+	std::vector<VKIBuffer*> dedicated;
+
+	// Event called when the batch copies are done.
+	MultiDelegate<> finishEvent;
+};
+
+
+
+
+// VKIUploadManager:
+//    - Upload data to device local buffers & images through a persistently mapped staging ring.
+//    - Copies are recorded into one command buffer per batch, and submitted on the transfer queue if the device
+//      has one, the graphics queue waits for them using a semaphore.
+//    - Each batch is tracked by a fence, uploads return a handle instead of blocking.
+//    - Uploads are recorded by the main thread while the render thread submits them, every call is locked.
+//
+class VKIUploadManager
+{
+public:
+	// The default size of the staging ring.
+	static const VkDeviceSize DEFAULT_RING_SIZE;
+
+public:
+	// Construct.
+	VKIUploadManager();
+
+	// Destruct.
+	~VKIUploadManager();
+
+	// Create the staging ring & the command pool on the transfer queue family.
+	void Create(VKIDevice* owner, VkDeviceSize ringSize);
+
+	// Wait for all uploads & destroy.
+	void Destroy();
+
+	// Return true if the uploads are submitted on a dedicated transfer queue.
+	inline bool IsTransferQueue() const { return mIsTransferQueue; }
+
+	// Upload data to a range of a device local buffer.
+	VKIUploadHandle UploadBuffer(VKIBuffer* dst, VkDeviceSize offset, VkDeviceSize size, const void* data,
+		const Delegate<>& callback = Delegate<>());
+
+	// Upload the first mip of a new image, the remaining mips are generated on the graphics queue if the image has them,
+	// by compute if the image supports it.
+	VKIUploadHandle UploadImage(VKIImage* dst, const void* data, VkDeviceSize size,
+		const Delegate<>& callback = Delegate<>());
+
+	// Upload all the mips of a new image from a precomputed mip chain, mipOffsets has the offset of each mip in data.
+	VKIUploadHandle UploadImageMips(VKIImage* dst, const void* data, VkDeviceSize size, const VkDeviceSize* mipOffsets,
+		const Delegate<>& callback = Delegate<>());
+
+	// Submit the recorded uploads, their graphics queue part is recorded into the device transient commands.
+	void Submit();
+
+	// Retire finished batches & call their callbacks, doesn't block.
+	void Retire();
+
+	// Return true if the copies of an upload are done.
+	inline bool IsComplete(VKIUploadHandle handle) const { return handle <= mCompletedHandle; }
+
+	// Block until the copies of an upload are done.
+	void Wait(VKIUploadHandle handle);
+
+	// Return the handle of the last recorded batch, it is complete once all the uploads recorded so far are.
+	VKIUploadHandle GetLastHandle();
+
+	// Return a copy of the upload stats, they are written by the threads uploading.
+	VKIUploadStats GetStats();
+
+	// Return the generator used for the mips of uploaded images.
+	inline VKIMipGenerator* GetMipGenerator() const { return mMipGenerator.get(); }
+
+private:
+	// Begin recording a new batch if we don't have one.
+	VkCommandBuffer BeginBatch();
+
+	// Allocate staging memory for the current batch, wait for older batches if the ring is full.
+	VKIBuffer* AllocateStaging(VkDeviceSize size, VkDeviceSize& outOffset);
+
+	// Try to allocate space from the ring, return false if the ring is full.
+	bool AllocateRing(VkDeviceSize size, VkDeviceSize& outOffset);
+
+	// Called when the graphics queue part of a batch is done & its semaphore can be reused if it has one.
+	void OnGraphicsFinished();
+
+private:
+	// The device that owns this uploader.
+	VKIDevice* mVKDevice;
+
+	// Command pool on the transfer queue family.
+	VkCommandPool mCmdPool;
+
+	// True if we have a dedicated transfer queue.
+	bool mIsTransferQueue;
+
+	// The persistently mapped staging ring.
+	UniquePtr<VKIBuffer> mRing;
+
+	// The ring size.
+	VkDeviceSize mRingSize;
+
+	// The next free byte of the ring.
+	VkDeviceSize mRingHead;
+
+	// The first byte of the ring still used by submitted batches.
+	VkDeviceSize mRingTail;
+
+	// The ring bytes used by submitted & current batches.
+	VkDeviceSize mRingUsed;
+
+	// The ring bytes used by the current batch.
+	VkDeviceSize mBatchRingBytes;
+
+	// The batch currently being recorded.
+	UniquePtr<VKIUploadBatch> mBatch;
+
+	// Submitted batches waiting to finish, oldest first.
+	std::vector< UniquePtr<VKIUploadBatch> > mInFlight;
+
+	// Finished batches ready to be reused.
+	std::vector< UniquePtr<VKIUploadBatch> > mFree;
+
+	// Images that need their mips generated or layout transitioned on the graphics queue.
+	std::vector<VKIImage*> mPendingImages;
+
+	// Images uploaded with all their mips that only need their layout transitioned on the graphics queue.
+	std::vector<VKIImage*> mPendingLayouts;
+
+	// Generate the mips of uploaded images.
+	UniquePtr<VKIMipGenerator> mMipGenerator;
+
+	// Semaphores signaled by the transfer queue & waited by the graphics queue, oldest first.
+	std::vector< UniquePtr<VKISemaphore> > mWaitingSemaphores;
+
+	// Semaphores ready to be reused.
+	std::vector< UniquePtr<VKISemaphore> > mFreeSemaphores;
+
+	// The handle of the last recorded batch.
+	VKIUploadHandle mLastHandle;
+
+	// The handle of the last finished batch, read without locking by IsComplete.
+	std::atomic<VKIUploadHandle> mCompletedHandle;
+
+	// Buffers written by the current batch, used to order overlapping copies.
+	std::unordered_set<VkBuffer> mBatchDsts;
+
+	// Stats.
+	VKIUploadStats mStats;
+
+	// Lock the uploader, recursive as uploads submit & retire batches & finished callbacks may upload again.
+	std::recursive_mutex mMutex;
+};
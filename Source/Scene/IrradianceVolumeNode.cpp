@@ -37,6 +37,7 @@ IrradianceVolumeNode::IrradianceVolumeNode()
 	: mStart(0.0f)
 	, mExtent(0.0f)
 	, mCount(0)
+	, mDirty(0)
 {
 	mType = ENodeType::IrradianceVolume;
 }
@@ -95,5 +96,13 @@ Box IrradianceVolumeNode::GetBounds() const
 
 void IrradianceVolumeNode::SetDirty()
 {
-	mRenderIrradianceVolume->SetDirty(LIGHT_PROBES_BOUNCES);
+	mDirty = LIGHT_PROBES_BOUNCES;
+}
+
+
+uint32_t IrradianceVolumeNode::TakeDirty()
+{
+	uint32_t dirty = mDirty;
+	mDirty = 0;
+	return dirty;
 }
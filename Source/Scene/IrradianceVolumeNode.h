@@ -70,6 +70,9 @@ public:
 	// Set light probe dirty to get updated.
 	void SetDirty();
 
+	// Return the dirty value set since the last call & clear it, passed to the render thread by the frame snapshot.
+	uint32_t TakeDirty();
+
 	// Set/Get Volume Attenuation.
 	inline void SetAtten(const glm::vec3& atten) { mAtten = atten; }
 	inline glm::vec3 GetAtten() const { return mAtten; }
@@ -93,6 +96,9 @@ private:
 
 	// Volume Attenuation.
 	glm::vec3 mAtten;
+
+	// The dirty value set since the last frame snapshot, zero if none.
+	uint32_t mDirty;
 };
 
 
@@ -36,6 +36,7 @@
 LightProbeNode::LightProbeNode()
 	: mRadius(100.0f)
 	, mIsSelected(false)
+	, mDirty(0)
 {
 	mType = ENodeType::LightProbe;
 
@@ -54,10 +55,7 @@ void LightProbeNode::SetRadius(float radius)
 	mRadius = radius;
 
 	if (mRenderLightProbe)
-	{
-		mRenderLightProbe->SetRadius(mRadius);
-		mRenderLightProbe->SetDirty(true);
-	}
+		mDirty = 1;
 
 }
 
@@ -71,10 +69,7 @@ glm::vec3 LightProbeNode::GetPosition() const
 void LightProbeNode::OnTransform()
 {
 	if (mRenderLightProbe)
-	{
-		mRenderLightProbe->SetPosition(GetTransform().GetTranslate());
-		mRenderLightProbe->SetDirty(true);
-	}
+		mDirty = 1;
 }
 
 
@@ -93,6 +88,14 @@ void LightProbeNode::UpdateRenderLightProbe()
 
 void LightProbeNode::SetDirty()
 {
-	mRenderLightProbe->SetDirty(LIGHT_PROBES_BOUNCES);
+	mDirty = LIGHT_PROBES_BOUNCES;
 
 }
+
+
+uint32_t LightProbeNode::TakeDirty()
+{
+	uint32_t dirty = mDirty;
+	mDirty = 0;
+	return dirty;
+}
@@ -74,6 +74,9 @@ public:
 	// Set light probe dirty to get updated.
 	void SetDirty();
 
+	// Return the dirty value set since the last call & clear it, passed to the render thread by the frame snapshot.
+	uint32_t TakeDirty();
+
 protected:
 	// Called when the node transform changes.
 	virtual void OnTransform() override;
@@ -87,6 +90,9 @@ private:
 
 	// True if the probe current selcted & active.
 	bool mIsSelected;
+
+	// The dirty value set since the last frame snapshot, zero if none.
+	uint32_t mDirty;
 };
 
 
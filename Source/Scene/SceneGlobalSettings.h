@@ -72,6 +72,9 @@ public:
 		, isLightProbeEnabled(false)
 		, isLightProbeHelpers(false)
 		, isLightProbeVisualize(false)
+		, isHelperImpostors(false)
+		, isOcclusionCulling(true)
+		, isSoftwareOcclusion(false)
 	{
 
 	}
@@ -117,4 +120,13 @@ public:
 	bool isLightProbeHelpers;
 	bool isLightProbeVisualize;
 
+	// Draw sphere helpers as screen aligned quads with analytic sphere shading.
+	bool isHelperImpostors;
+
+	// Cull occluded primitives using the depth pyramid.
+	bool isOcclusionCulling;
+
+	// Cull occluded primitives on the CPU before recording draw commands.
+	bool isSoftwareOcclusion;
+
 };
@@ -0,0 +1,158 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "Tests.h"
+#include "Core/BlockCompression.h"
+
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+
+
+
+// The min PSNR in dB of the compressed test image for each format.
+#define BCTEST_MIN_PSNR_BC1 34.0f
+#define BCTEST_MIN_PSNR_BC3 35.0f
+#define BCTEST_MIN_PSNR_BC5 45.0f
+
+// The guard bytes written past the compressed & decompressed chains.
+#define BCTEST_GUARD_SIZE 64
+#define BCTEST_GUARD_BYTE 0xCD
+
+
+
+
+// Clamp a channel value to a byte.
+static inline uint8_t BCTestToByte(int32_t value)
+{
+	return (uint8_t)std::min(std::max(value, 0), 255);
+}
+
+
+// Fill an RGBA image with smooth gradients & some noise, like a typical texture.
+static void BCTestFillImage(const glm::ivec2& size, uint8_t* rgba)
+{
+	std::mt19937 rng(1234);
+	std::uniform_int_distribution<int32_t> noise(-4, 4);
+
+	for (int32_t y = 0; y < size.y; ++y)
+	{
+		for (int32_t x = 0; x < size.x; ++x)
+		{
+			uint8_t* px = rgba + (y * size.x + x) * 4;
+			px[0] = BCTestToByte(40 + x * 3 + noise(rng));
+			px[1] = BCTestToByte(60 + y * 3 + noise(rng));
+			px[2] = BCTestToByte(128 + (x - y) * 2 + noise(rng));
+			px[3] = BCTestToByte(220 - x * 2 - y + noise(rng));
+		}
+	}
+}
+
+
+// Compress & decompress a mip chain, check each mip against its source & that nothing is written past the chains.
+static void BCTestRoundTrip(EImageFormat format, const glm::ivec2& size, uint32_t numMips, float minPSNR)
+{
+	uint32_t srcOffsets[IMAGE2D_MAX_MIPS];
+	uint32_t dstOffsets[IMAGE2D_MAX_MIPS];
+	uint32_t srcSize = Image2D::ComputeMipChain(EImageFormat::RGBA, size, numMips, srcOffsets);
+	uint32_t dstSize = Image2D::ComputeMipChain(format, size, numMips, dstOffsets);
+
+	// The source chain, each mip is filled independently, only the round trip matters.
+	std::vector<uint8_t> src(srcSize);
+
+	for (uint32_t i = 0; i < numMips; ++i)
+	{
+		glm::ivec2 mipSize(std::max(size.x >> i, 1), std::max(size.y >> i, 1));
+		BCTestFillImage(mipSize, src.data() + srcOffsets[i]);
+	}
+
+	std::vector<uint8_t> blocks(dstSize + BCTEST_GUARD_SIZE, BCTEST_GUARD_BYTE);
+	BCCompressMipChain(format, size, numMips, src.data(), blocks.data());
+
+	std::vector<uint8_t> decoded(srcSize + BCTEST_GUARD_SIZE, BCTEST_GUARD_BYTE);
+	BCDecompressMipChain(format, size, numMips, blocks.data(), decoded.data());
+
+	bool isGuardKept = true;
+
+	for (uint32_t i = 0; i < BCTEST_GUARD_SIZE; ++i)
+		isGuardKept = isGuardKept && blocks[dstSize + i] == BCTEST_GUARD_BYTE && decoded[srcSize + i] == BCTEST_GUARD_BYTE;
+
+	TEST_CHECK(isGuardKept);
+
+	// Each mip, down to the 1x1 tail whose blocks are mostly padding.
+	for (uint32_t i = 0; i < numMips; ++i)
+	{
+		glm::ivec2 mipSize(std::max(size.x >> i, 1), std::max(size.y >> i, 1));
+		float psnr = BCComputePSNR(format, mipSize, src.data() + srcOffsets[i], blocks.data() + dstOffsets[i]);
+
+		if (!TEST_CHECK(psnr >= minPSNR))
+			LOGE("Format %d mip %d (%dx%d) PSNR %.2f dB.", (int32_t)format, i, mipSize.x, mipSize.y, psnr);
+	}
+
+	// The decompressed chain matches the blocks it was decoded from.
+	float psnr = BCComputePSNR(format, size, decoded.data(), blocks.data());
+	TEST_CHECK(psnr >= 100.0f);
+}
+
+
+// A single color block is encoded exactly for each format.
+static bool BCTestSolidBlock(EImageFormat format)
+{
+	uint8_t rgba[64];
+	uint8_t block[16];
+
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		rgba[i * 4 + 0] = 255;
+		rgba[i * 4 + 1] = 0;
+		rgba[i * 4 + 2] = 255;
+		rgba[i * 4 + 3] = 255;
+	}
+
+	BCCompressBlock(format, rgba, block);
+	return BCComputePSNR(format, glm::ivec2(4, 4), rgba, block) >= 100.0f;
+}
+
+
+
+
+
+void Tests::TestBlockCompression()
+{
+	// Solid blocks.
+	TEST_CHECK(BCTestSolidBlock(EImageFormat::BC1));
+	TEST_CHECK(BCTestSolidBlock(EImageFormat::BC3));
+	TEST_CHECK(BCTestSolidBlock(EImageFormat::BC5));
+
+	// Power of two chains.
+	glm::ivec2 size(64, 64);
+	uint32_t numMips = Image2D::GetMaxMips(size);
+	BCTestRoundTrip(EImageFormat::BC1, size, numMips, BCTEST_MIN_PSNR_BC1);
+	BCTestRoundTrip(EImageFormat::BC3, size, numMips, BCTEST_MIN_PSNR_BC3);
+	BCTestRoundTrip(EImageFormat::BC5, size, numMips, BCTEST_MIN_PSNR_BC5);
+
+	// Odd sizes, the mip tails have partial blocks & 1 pixel wide mips.
+	size = glm::ivec2(37, 13);
+	numMips = Image2D::GetMaxMips(size);
+	BCTestRoundTrip(EImageFormat::BC1, size, numMips, BCTEST_MIN_PSNR_BC1);
+	BCTestRoundTrip(EImageFormat::BC3, size, numMips, BCTEST_MIN_PSNR_BC3);
+	BCTestRoundTrip(EImageFormat::BC5, size, numMips, BCTEST_MIN_PSNR_BC5);
+}
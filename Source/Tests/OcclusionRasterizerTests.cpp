@@ -0,0 +1,126 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+
+
+#include "Tests.h"
+#include "Core/OcclusionRasterizer.h"
+#include "Core/Transform.h"
+
+
+
+
+// Camera at the origin looking down +Z, like the renderer's LH view.
+static glm::mat4 OCRTestViewProj()
+{
+	return Transform::Perspective(glm::radians(60.0f), 1.0f, 0.1f, 100.0f)
+		* Transform::LookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+
+// Rasterize a quad occluder from its 4 corners.
+static void OCRTestRenderQuad(OcclusionRasterizer& rasterizer, const glm::vec3& p0, const glm::vec3& p1,
+	const glm::vec3& p2, const glm::vec3& p3)
+{
+	const glm::vec3 positions[4] = { p0, p1, p2, p3 };
+	const uint32_t indices[6] = { 0, 1, 2, 0, 2, 3 };
+
+	rasterizer.RenderTriangles(positions, sizeof(glm::vec3), indices, 6, glm::mat4(1.0f));
+}
+
+
+// Rasterize a quad facing the camera at depth z.
+static void OCRTestRenderQuad(OcclusionRasterizer& rasterizer, float x0, float y0, float x1, float y1, float z)
+{
+	OCRTestRenderQuad(rasterizer, glm::vec3(x0, y0, z), glm::vec3(x1, y0, z), glm::vec3(x1, y1, z), glm::vec3(x0, y1, z));
+}
+
+
+
+
+
+void Tests::TestOcclusionRasterizer()
+{
+	OcclusionRasterizer rasterizer;
+	rasterizer.Initialize(60, 60);
+	TEST_CHECK(rasterizer.GetWidth() == 64 && rasterizer.GetHeight() == 64);
+
+	// Fully occluded, a wall covering the whole view in front of the box.
+	{
+		rasterizer.Begin(OCRTestViewProj());
+		OCRTestRenderQuad(rasterizer, -10.0f, -10.0f, 10.0f, 10.0f, 5.0f);
+		rasterizer.End();
+
+		TEST_CHECK(rasterizer.GetStats().numTriangles == 2);
+		TEST_CHECK(!rasterizer.TestBox(Box(glm::vec3(-0.5f, -0.5f, 9.0f), glm::vec3(0.5f, 0.5f, 10.0f))));
+		TEST_CHECK(!rasterizer.TestBox(Box(glm::vec3(-20.0f, -20.0f, 20.0f), glm::vec3(20.0f, 20.0f, 30.0f))));
+
+		// In front of the wall or intersecting it.
+		TEST_CHECK(rasterizer.TestBox(Box(glm::vec3(-0.5f, -0.5f, 2.0f), glm::vec3(0.5f, 0.5f, 3.0f))));
+		TEST_CHECK(rasterizer.TestBox(Box(glm::vec3(-0.5f, -0.5f, 4.0f), glm::vec3(0.5f, 0.5f, 6.0f))));
+
+		// Outside the view, culled without an occluder.
+		TEST_CHECK(!rasterizer.TestBox(Box(glm::vec3(50.0f, -0.5f, 2.0f), glm::vec3(51.0f, 0.5f, 3.0f))));
+
+		rasterizer.EndTests();
+		TEST_CHECK(rasterizer.GetStats().numTested == 5 && rasterizer.GetStats().numCulled == 3);
+	}
+
+	// Partially occluded, a wall covering the left half of the view.
+	{
+		rasterizer.Begin(OCRTestViewProj());
+		OCRTestRenderQuad(rasterizer, -10.0f, -10.0f, 0.0f, 10.0f, 5.0f);
+		rasterizer.End();
+
+		// Straddling the wall edge & behind the uncovered half.
+		TEST_CHECK(rasterizer.TestBox(Box(glm::vec3(-1.0f, -0.5f, 9.0f), glm::vec3(1.0f, 0.5f, 10.0f))));
+		TEST_CHECK(rasterizer.TestBox(Box(glm::vec3(1.0f, -0.5f, 9.0f), glm::vec3(2.0f, 0.5f, 10.0f))));
+
+		// Behind the covered half.
+		TEST_CHECK(!rasterizer.TestBox(Box(glm::vec3(-2.0f, -0.5f, 9.0f), glm::vec3(-1.0f, 0.5f, 10.0f))));
+
+		rasterizer.EndTests();
+	}
+
+	// Crossing the near plane, such boxes are always visible and such occluders are never rendered.
+	{
+		rasterizer.Begin(OCRTestViewProj());
+		OCRTestRenderQuad(rasterizer, -10.0f, -10.0f, 10.0f, 10.0f, 5.0f);
+		rasterizer.End();
+
+		// Around the camera, even with a wall covering the view.
+		TEST_CHECK(rasterizer.TestBox(Box(glm::vec3(-1.0f), glm::vec3(1.0f))));
+		TEST_CHECK(rasterizer.TestBox(Box(glm::vec3(-0.5f, -0.5f, -1.0f), glm::vec3(0.5f, 0.5f, 9.0f))));
+		rasterizer.EndTests();
+
+
+		// A floor from behind the camera into the view.
+		rasterizer.Begin(OCRTestViewProj());
+		OCRTestRenderQuad(rasterizer, glm::vec3(-10.0f, -10.0f, -1.0f), glm::vec3(10.0f, -10.0f, -1.0f),
+			glm::vec3(10.0f, 10.0f, 5.0f), glm::vec3(-10.0f, 10.0f, 5.0f));
+		rasterizer.End();
+
+		TEST_CHECK(rasterizer.GetStats().numTriangles == 0);
+		TEST_CHECK(rasterizer.TestBox(Box(glm::vec3(-0.5f, -0.5f, 9.0f), glm::vec3(0.5f, 0.5f, 10.0f))));
+		rasterizer.EndTests();
+	}
+}
@@ -0,0 +1,91 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+
+
+#include "Tests.h"
+#include "Core/RadixSort.h"
+
+
+#include <algorithm>
+#include <random>
+
+
+
+
+// Sort the items with RadixSort64 & std::stable_sort, return true if both have the same order.
+static bool RSTestMatchStdSort(const std::vector<RadixSortItem>& items)
+{
+	std::vector<RadixSortItem> radixItems = items;
+	std::vector<RadixSortItem> temp;
+	RadixSort64(radixItems, temp);
+
+	// The radix sort is stable, equal keys keep their order.
+	std::vector<RadixSortItem> stdItems = items;
+	std::stable_sort(stdItems.begin(), stdItems.end(),
+		[](const RadixSortItem& a, const RadixSortItem& b) { return a.key < b.key; });
+
+	for (size_t i = 0; i < items.size(); ++i)
+	{
+		if (radixItems[i].key != stdItems[i].key || radixItems[i].value != stdItems[i].value)
+			return false;
+	}
+
+	return radixItems.size() == items.size();
+}
+
+
+
+
+
+void Tests::TestRadixSort()
+{
+	std::mt19937_64 rng(1234);
+	std::vector<RadixSortItem> items;
+
+	// Empty & a single item.
+	TEST_CHECK(RSTestMatchStdSort(items));
+	items.push_back(RadixSortItem{ rng(), 0 });
+	TEST_CHECK(RSTestMatchStdSort(items));
+
+	// Random 64-bit keys.
+	items.resize(10000);
+
+	for (uint32_t i = 0; i < (uint32_t)items.size(); ++i)
+		items[i] = RadixSortItem{ rng(), i };
+
+	TEST_CHECK(RSTestMatchStdSort(items));
+
+	// Keys with constant digits that are skipped & many equal keys, like the draw sort keys.
+	for (uint32_t i = 0; i < (uint32_t)items.size(); ++i)
+		items[i] = RadixSortItem{ ((rng() & 0x3) << 56) | ((rng() & 0xFF) << 40) | ((rng() & 0x7) << 24), i };
+
+	TEST_CHECK(RSTestMatchStdSort(items));
+
+	// Already sorted & reversed.
+	for (uint32_t i = 0; i < (uint32_t)items.size(); ++i)
+		items[i] = RadixSortItem{ (uint64_t)i << 20, i };
+
+	TEST_CHECK(RSTestMatchStdSort(items));
+	std::reverse(items.begin(), items.end());
+	TEST_CHECK(RSTestMatchStdSort(items));
+}
@@ -0,0 +1,70 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+
+
+#include "Tests.h"
+
+
+
+
+uint32_t Tests::sNumChecks = 0;
+uint32_t Tests::sNumFailed = 0;
+
+
+
+
+
+uint32_t Tests::RunAll()
+{
+	sNumChecks = 0;
+	sNumFailed = 0;
+
+	TestOcclusionRasterizer();
+	TestRadixSort();
+	TestBlockCompression();
+
+	if (sNumFailed == 0)
+	{
+		LOGI("Tests passed, %d checks.", sNumChecks);
+	}
+	else
+	{
+		LOGE("Tests failed, %d of %d checks.", sNumFailed, sNumChecks);
+	}
+
+	return sNumFailed;
+}
+
+
+bool Tests::Check(bool cond, const char* expr, const char* file, int32_t line)
+{
+	++sNumChecks;
+
+	if (!cond)
+	{
+		++sNumFailed;
+		LOGE("Test check failed: %s (%s:%d)", expr, file, line);
+	}
+
+	return cond;
+}
@@ -0,0 +1,65 @@
+// Copyright (c) 2021 Ammar Herzallah
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+
+
+#pragma once
+
+
+
+
+#include "Core/Core.h"
+
+
+
+
+// Check a test condition, failures are logged & counted without stopping the test.
+#define TEST_CHECK(cond) Tests::Check((cond), #cond, __FILE__, __LINE__)
+
+
+
+
+
+// Tests:
+//    - CPU tests of the core modules, they run without a window or a device.
+//    - run from the command line with -runtests, the application exits with the number of failed checks.
+//
+class Tests
+{
+public:
+	// Run all the tests, return the number of failed checks.
+	static uint32_t RunAll();
+
+	// Record the result of a check, return the condition.
+	static bool Check(bool cond, const char* expr, const char* file, int32_t line);
+
+private:
+	// The tests of each module.
+	static void TestOcclusionRasterizer();
+	static void TestRadixSort();
+	static void TestBlockCompression();
+
+private:
+	// The number of checks & failures of the current run.
+	static uint32_t sNumChecks;
+	static uint32_t sNumFailed;
+};